@@ -37,6 +37,10 @@ bool AddrInfo::getHostInfo( const std::string host,
   hints.ai_addr = NULL;
   hints.ai_next = NULL;
 
+  if (m_addrInfo != 0) {
+    freeaddrinfo(m_addrInfo);
+    m_addrInfo = 0;
+  }
 
   int status = getaddrinfo(host.c_str(), port.c_str(), &hints, &m_addrInfo);
 
@@ -0,0 +1,534 @@
+#include "BackendPool.hpp"
+
+#include "ScopedLock.hpp"
+#include "Logger.hpp"
+#include "Common.hpp"
+
+#include <algorithm>
+#include <set>
+#include <stdlib.h> // rand_r
+#include <poll.h>
+
+
+struct BackendPool::Backend
+{
+  Backend( const std::string &host, const std::string &port )
+    : m_host(host)
+    , m_port(port)
+    , m_idle()
+    , m_outstanding(0)
+    , m_connecting(0)
+    , m_failures(0)
+    , m_healthy(true)
+    , m_busy(false)
+    , m_removed(false)
+  {
+  }
+
+  size_t size() const { return m_idle.size() + m_outstanding + m_connecting; }
+
+  const std::string               m_host;
+  const std::string               m_port;
+  std::vector<StreamConnection*>  m_idle;
+  size_t                          m_outstanding;
+  size_t                          m_connecting;
+  int                             m_failures;
+  bool                            m_healthy;
+  bool                            m_busy;   // being added or probed
+  bool                            m_removed;
+};
+
+
+// ProberThread
+
+BackendPool::ProberThread::ProberThread( BackendPool &pool )
+  : m_pool(pool)
+{
+  TRACE;
+}
+
+
+void BackendPool::ProberThread::stopProber()
+{
+  TRACE;
+
+  ScopedLock sl(m_pool.m_mutex);
+  stop();
+  m_pool.m_condVar.broadcast();
+}
+
+
+void* BackendPool::ProberThread::run()
+{
+  TRACE;
+
+  while ( m_isRunning ) {
+    {
+      ScopedLock sl(m_pool.m_mutex);
+      if ( !m_isRunning )
+        break;
+
+      m_pool.m_condVar.wait( m_pool.m_probeIntervalMs / 1000,
+                             (m_pool.m_probeIntervalMs % 1000) * 1000000 );
+      if ( !m_isRunning )
+        break;
+    }
+    m_pool.probe();
+  }
+
+  return 0;
+}
+
+
+// BackendPool
+
+BackendPool::BackendPool( Factory       factory,
+                          const Policy  policy,
+                          const size_t  minConnections,
+                          const size_t  maxConnections,
+                          const int     maxFailures,
+                          const int     probeIntervalMs,
+                          const int     connectTimeoutMs )
+  : m_factory(factory)
+  , m_policy(policy)
+  , m_minConnections(minConnections)
+  , m_maxConnections(std::max(minConnections, maxConnections))
+  , m_maxFailures(maxFailures)
+  , m_probeIntervalMs(probeIntervalMs)
+  , m_connectTimeoutMs(connectTimeoutMs)
+  , m_mutex()
+  , m_condVar(m_mutex)
+  , m_backends()
+  , m_inUse()
+  , m_seed(1)
+  , m_prober(*this)
+{
+  TRACE;
+  m_prober.start();
+}
+
+
+BackendPool::~BackendPool()
+{
+  TRACE;
+
+  m_prober.stopProber();
+  m_prober.join();
+
+  ScopedLock sl(m_mutex);
+
+  // removed backends left for reap() are known from their connections only
+  std::set<Backend*> removed;
+  std::map<StreamConnection*, Backend*>::iterator it;
+  for ( it = m_inUse.begin(); it != m_inUse.end(); ++it ) {
+    LOG( Logger::WARNING, "Connection not released before destroying the pool." );
+    delete it->first;
+    if ( it->second->m_removed )
+      removed.insert(it->second);
+  }
+
+  std::set<Backend*>::iterator it4;
+  for ( it4 = removed.begin(); it4 != removed.end(); ++it4 )
+    delete *it4;
+
+  std::vector<Backend*>::iterator it2;
+  for ( it2 = m_backends.begin(); it2 != m_backends.end(); ++it2 ) {
+    std::vector<StreamConnection*>::iterator it3;
+    for ( it3 = (*it2)->m_idle.begin(); it3 != (*it2)->m_idle.end(); ++it3 )
+      delete *it3;
+    delete *it2;
+  }
+}
+
+
+bool BackendPool::addBackend( const std::string &host, const std::string &port )
+{
+  TRACE;
+
+  Backend *backend(0);
+  {
+    ScopedLock sl(m_mutex);
+    if ( findBackend(host, port) != 0 )
+      return false;
+
+    backend = new Backend(host, port);
+    backend->m_busy = true;
+    m_backends.push_back(backend);
+  }
+
+  warmUp(backend);
+
+  std::vector<StreamConnection*> closing;
+  {
+    ScopedLock sl(m_mutex);
+    if ( m_minConnections > 0 && backend->m_idle.empty() && backend->m_healthy &&
+         !backend->m_removed )
+      eject(backend, closing);
+
+    backend->m_busy = false;
+    reap(backend);
+  }
+
+  closeConnections(closing);
+  return true;
+}
+
+
+bool BackendPool::removeBackend( const std::string &host, const std::string &port )
+{
+  TRACE;
+
+  std::vector<StreamConnection*> closing;
+  {
+    ScopedLock sl(m_mutex);
+    Backend *backend = findBackend(host, port);
+    if ( backend == 0 )
+      return false;
+
+    m_backends.erase( std::find(m_backends.begin(), m_backends.end(), backend) );
+    backend->m_removed = true;
+    closing.swap(backend->m_idle);
+
+    // the in-use ones are deleted on release
+    reap(backend);
+  }
+
+  closeConnections(closing);
+  return true;
+}
+
+
+StreamConnection* BackendPool::acquire()
+{
+  TRACE;
+
+  // a failed connect may eject the picked backend, then try the others
+  for ( size_t attempt = 0; ; ++attempt ) {
+
+    Backend *backend(0);
+    {
+      ScopedLock sl(m_mutex);
+      if ( attempt > m_backends.size() )
+        return 0;
+
+      backend = pick();
+      if ( backend == 0 )
+        return 0;
+
+      backend->m_outstanding++;
+      if ( !backend->m_idle.empty() ) {
+        StreamConnection *connection = backend->m_idle.back();
+        backend->m_idle.pop_back();
+        m_inUse[connection] = backend;
+        return connection;
+      }
+    }
+
+    // below maxConnections: grow
+    StreamConnection *connection = connectTo(backend);
+
+    std::vector<StreamConnection*> closing;
+    {
+      ScopedLock sl(m_mutex);
+      if ( connection != 0 && !backend->m_removed ) {
+        m_inUse[connection] = backend;
+        return connection;
+      }
+
+      if ( connection != 0 )
+        closing.push_back(connection);
+      backend->m_outstanding--;
+      if ( connection == 0 )
+        recordFailure(backend, closing);
+      reap(backend);
+    }
+
+    closeConnections(closing);
+  }
+}
+
+
+void BackendPool::release( StreamConnection *connection, const bool success )
+{
+  TRACE;
+
+  std::vector<StreamConnection*> closing;
+  {
+    ScopedLock sl(m_mutex);
+    std::map<StreamConnection*, Backend*>::iterator it = m_inUse.find(connection);
+    if ( it == m_inUse.end() ) {
+      LOG( Logger::ERR, "Releasing a connection not acquired from the pool." );
+      return;
+    }
+
+    Backend *backend = it->second;
+    m_inUse.erase(it);
+    backend->m_outstanding--;
+
+    if ( !success ) {
+      closing.push_back(connection);
+      recordFailure(backend, closing);
+    } else if ( backend->m_removed || !backend->m_healthy ) {
+      closing.push_back(connection);
+    } else {
+      backend->m_failures = 0;
+      backend->m_idle.push_back(connection);
+    }
+
+    reap(backend);
+  }
+
+  closeConnections(closing);
+}
+
+
+size_t BackendPool::getNumberOfBackends() const
+{
+  TRACE;
+
+  ScopedLock sl(m_mutex);
+  return m_backends.size();
+}
+
+
+size_t BackendPool::getNumberOfHealthyBackends() const
+{
+  TRACE;
+
+  ScopedLock sl(m_mutex);
+  size_t healthy(0);
+  std::vector<Backend*>::const_iterator it;
+  for ( it = m_backends.begin(); it != m_backends.end(); ++it )
+    if ( (*it)->m_healthy )
+      ++healthy;
+
+  return healthy;
+}
+
+
+int BackendPool::getOutstanding( const std::string &host, const std::string &port ) const
+{
+  TRACE;
+
+  ScopedLock sl(m_mutex);
+  Backend *backend = findBackend(host, port);
+  return backend == 0 ? -1 : backend->m_outstanding;
+}
+
+
+BackendPool::Backend* BackendPool::findBackend( const std::string &host,
+                                                const std::string &port ) const
+{
+  TRACE;
+
+  std::vector<Backend*>::const_iterator it;
+  for ( it = m_backends.begin(); it != m_backends.end(); ++it )
+    if ( (*it)->m_host == host && (*it)->m_port == port )
+      return *it;
+
+  return 0;
+}
+
+
+BackendPool::Backend* BackendPool::pick()
+{
+  TRACE;
+
+  std::vector<Backend*> candidates;
+  std::vector<Backend*>::iterator it;
+  for ( it = m_backends.begin(); it != m_backends.end(); ++it )
+    if ( (*it)->m_healthy &&
+         ( !(*it)->m_idle.empty() || (*it)->size() < m_maxConnections ) )
+      candidates.push_back(*it);
+
+  if ( candidates.empty() )
+    return 0;
+
+  const size_t n = candidates.size();
+  const size_t first = rand_r(&m_seed) % n;
+
+  if ( m_policy == POWER_OF_TWO_CHOICES ) {
+    if ( n == 1 )
+      return candidates[0];
+
+    const size_t second = (first + 1 + rand_r(&m_seed) % (n - 1)) % n;
+    return candidates[second]->m_outstanding < candidates[first]->m_outstanding ?
+             candidates[second] : candidates[first];
+  }
+
+  // least outstanding, ties broken from a random start
+  Backend *best = candidates[first];
+  for ( size_t i = 1; i < n; ++i ) {
+    Backend *b = candidates[(first + i) % n];
+    if ( b->m_outstanding < best->m_outstanding )
+      best = b;
+  }
+  return best;
+}
+
+
+StreamConnection* BackendPool::connectTo( Backend *backend )
+{
+  TRACE;
+
+  StreamConnection *connection = m_factory(backend->m_host, backend->m_port);
+  if ( connection == 0 )
+    return 0;
+
+  bool inProgress(false);
+  bool connected = connection->startConnect(inProgress);
+  if ( connected && inProgress ) {
+    const uint64_t deadline = monotonicNs() + (uint64_t)m_connectTimeoutMs * 1000000;
+    pollfd pfd;
+    pfd.fd = connection->getSocket();
+    pfd.events = POLLOUT;
+    int ret(-1);
+    for ( uint64_t current = monotonicNs(); current < deadline; current = monotonicNs() ) {
+      pfd.revents = 0;
+      ret = poll(&pfd, 1, (deadline - current + 999999) / 1000000);
+      if ( ret != -1 || errno != EINTR )
+        break;
+    }
+    connected = ret == 1 && connection->finishConnect();
+  }
+
+  if ( !connected ) {
+    LOG_BEGIN(Logger::DEBUG)
+      LOG_PROP("Host", backend->m_host)
+      LOG_PROP("Port", backend->m_port)
+    LOG_END("Could not connect to backend.");
+    delete connection;
+    return 0;
+  }
+
+  return connection;
+}
+
+
+void BackendPool::warmUp( Backend *backend )
+{
+  TRACE;
+
+  size_t needed(0);
+  {
+    ScopedLock sl(m_mutex);
+    if ( backend->size() < m_minConnections )
+      needed = m_minConnections - backend->size();
+    backend->m_connecting += needed;
+  }
+
+  for ( size_t i = 0; i < needed; ++i ) {
+    StreamConnection *connection = connectTo(backend);
+
+    std::vector<StreamConnection*> closing;
+    {
+      ScopedLock sl(m_mutex);
+      backend->m_connecting--;
+      if ( connection == 0 ) {
+        recordFailure(backend, closing);
+      } else if ( backend->m_removed || !backend->m_healthy ) {
+        closing.push_back(connection);
+      } else {
+        backend->m_idle.push_back(connection);
+      }
+    }
+
+    closeConnections(closing);
+  }
+}
+
+
+void BackendPool::recordFailure( Backend *backend,
+                                 std::vector<StreamConnection*> &closing )
+{
+  TRACE;
+
+  if ( ++backend->m_failures >= m_maxFailures && backend->m_healthy )
+    eject(backend, closing);
+}
+
+
+void BackendPool::eject( Backend *backend,
+                         std::vector<StreamConnection*> &closing )
+{
+  TRACE;
+
+  LOG_BEGIN(Logger::WARNING)
+    LOG_PROP("Host", backend->m_host)
+    LOG_PROP("Port", backend->m_port)
+    LOG_PROP("Failures", backend->m_failures)
+  LOG_END("Ejecting backend.");
+
+  backend->m_healthy = false;
+  closing.insert(closing.end(), backend->m_idle.begin(), backend->m_idle.end());
+  backend->m_idle.clear();
+}
+
+
+void BackendPool::probe()
+{
+  TRACE;
+
+  std::vector<Backend*> ejected;
+  {
+    ScopedLock sl(m_mutex);
+    std::vector<Backend*>::iterator it;
+    for ( it = m_backends.begin(); it != m_backends.end(); ++it )
+      if ( !(*it)->m_healthy && !(*it)->m_busy ) {
+        (*it)->m_busy = true;
+        ejected.push_back(*it);
+      }
+  }
+
+  std::vector<Backend*>::iterator it;
+  for ( it = ejected.begin(); it != ejected.end(); ++it ) {
+    Backend *backend = *it;
+    StreamConnection *connection = connectTo(backend);
+
+    bool reinstated(false);
+    {
+      ScopedLock sl(m_mutex);
+      if ( connection != 0 && !backend->m_removed ) {
+        LOG_BEGIN(Logger::INFO)
+          LOG_PROP("Host", backend->m_host)
+          LOG_PROP("Port", backend->m_port)
+        LOG_END("Reinstating backend.");
+
+        backend->m_healthy = true;
+        backend->m_failures = 0;
+        backend->m_idle.push_back(connection);
+        reinstated = true;
+      }
+    }
+
+    if ( !reinstated )
+      delete connection;
+
+    if ( reinstated )
+      warmUp(backend);
+
+    ScopedLock sl(m_mutex);
+    backend->m_busy = false;
+    reap(backend);
+  }
+}
+
+
+void BackendPool::closeConnections( const std::vector<StreamConnection*> &connections )
+{
+  TRACE_STATIC;
+
+  std::vector<StreamConnection*>::const_iterator it;
+  for ( it = connections.begin(); it != connections.end(); ++it )
+    delete *it;
+}
+
+
+void BackendPool::reap( Backend *backend )
+{
+  TRACE;
+
+  if ( backend->m_removed && backend->m_outstanding == 0 &&
+       backend->m_connecting == 0 && !backend->m_busy )
+    delete backend;
+}
@@ -0,0 +1,120 @@
+#ifndef BACKEND_POOL_HPP
+#define BACKEND_POOL_HPP
+
+#include "StreamConnection.hpp"
+#include "Thread.hpp"
+#include "Mutex.hpp"
+#include "ConditionVariable.hpp"
+
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+#include <stddef.h> // size_t
+
+
+/** @brief Warm connections to a set of backends, one picked per request.
+ *
+ * The factory creates the connections (TcpConnection, SslConnection, ...),
+ * the pool connects and owns them. acquire() picks a backend by the policy
+ * among the healthy ones with spare capacity and hands out an idle
+ * connection, release() gives it back. maxFailures consecutive failed
+ * releases or connects eject a backend: its connections are closed and the
+ * prober thread tries to connect every probeIntervalMs, reinstating it on
+ * success.
+ *
+ * Connecting is startConnect() with connectTimeoutMs for writability, so a
+ * black-holed backend does not hold up the probing of the others. A
+ * connection without a non-blocking startConnect() connects blocking, a
+ * non-blocking SslConnection is handed out with its handshake started.
+ */
+
+class BackendPool
+{
+public:
+
+  enum Policy {
+    LEAST_OUTSTANDING,
+    POWER_OF_TWO_CHOICES
+  };
+
+  typedef std::function<StreamConnection* (const std::string &host,
+                                           const std::string &port)> Factory;
+
+  BackendPool( Factory       factory,
+               const Policy  policy = POWER_OF_TWO_CHOICES,
+               const size_t  minConnections = 1,
+               const size_t  maxConnections = 8,
+               const int     maxFailures = 3,
+               const int     probeIntervalMs = 1000,
+               const int     connectTimeoutMs = 1000 );
+
+  virtual ~BackendPool();
+
+  // warms up minConnections, an unreachable backend starts ejected
+  bool addBackend( const std::string &host, const std::string &port );
+  bool removeBackend( const std::string &host, const std::string &port );
+
+  // 0 if no healthy backend has a free connection
+  StreamConnection* acquire();
+
+  // a failed connection is closed and counts against its backend
+  void release( StreamConnection *connection, const bool success = true );
+
+  size_t getNumberOfBackends() const;
+  size_t getNumberOfHealthyBackends() const;
+  int getOutstanding( const std::string &host, const std::string &port ) const;
+
+private:
+
+  BackendPool(const BackendPool&);
+  BackendPool& operator=(const BackendPool&);
+
+  struct Backend;
+
+  class ProberThread : public Thread
+  {
+  public:
+
+    ProberThread( BackendPool &pool );
+    void stopProber();
+
+  private:
+
+    ProberThread(const ProberThread&);
+    ProberThread& operator=(const ProberThread&);
+
+    void* run();
+
+    BackendPool &m_pool;
+  };
+
+  Backend* findBackend( const std::string &host, const std::string &port ) const;
+  Backend* pick();
+  StreamConnection* connectTo( Backend *backend );
+  void warmUp( Backend *backend );
+  // with m_mutex held, the connections to close are added to closing
+  void recordFailure( Backend *backend, std::vector<StreamConnection*> &closing );
+  void eject( Backend *backend, std::vector<StreamConnection*> &closing );
+  void probe();
+  void reap( Backend *backend );
+  // deletes them, without m_mutex held: closing may block
+  static void closeConnections( const std::vector<StreamConnection*> &connections );
+
+  Factory                    m_factory;
+  const Policy               m_policy;
+  const size_t               m_minConnections;
+  const size_t               m_maxConnections;
+  const int                  m_maxFailures;
+  const int                  m_probeIntervalMs;
+  const int                  m_connectTimeoutMs;
+
+  mutable Mutex              m_mutex;
+  ConditionVariable          m_condVar;
+  std::vector<Backend*>      m_backends;
+  std::map<StreamConnection*, Backend*> m_inUse;
+  unsigned int               m_seed;
+  ProberThread               m_prober;
+};
+
+#endif // BACKEND_POOL_HPP
@@ -0,0 +1,56 @@
+#include "Barrier.hpp"
+
+#include "Futex.hpp"
+#include "Common.hpp"
+
+
+Barrier::Barrier( const int count, const std::function<void()> &completion )
+  : m_count(count)
+  , m_completion(completion)
+  , m_arrived(0)
+  , m_phase(0)
+{
+  TRACE;
+}
+
+
+Barrier::~Barrier()
+{
+  TRACE;
+}
+
+
+bool Barrier::arriveAndWait()
+{
+  TRACE;
+
+  // read before arriving, the last one moves it on
+  const int phase = m_phase.load();
+
+  if ( m_arrived.fetch_add(1) + 1 == m_count ) {
+    if ( m_completion )
+      m_completion();
+    m_arrived.store(0);
+    m_phase.fetch_add(1);
+    futexWake(&m_phase);
+    return true;
+  }
+
+  while ( m_phase.load() == phase )
+    futexWait(&m_phase, phase);
+  return false;
+}
+
+
+int Barrier::getCount() const
+{
+  TRACE;
+  return m_count;
+}
+
+
+int Barrier::getPhase() const
+{
+  TRACE;
+  return m_phase.load();
+}
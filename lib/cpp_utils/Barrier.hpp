@@ -0,0 +1,40 @@
+#ifndef BARRIER_HPP
+#define BARRIER_HPP
+
+#include <atomic>
+#include <functional>
+
+
+/** @brief Reusable meeting point of a fixed number of threads.
+ *
+ * The last thread to arrive runs the completion function, if any, before
+ * it releases the others, then the barrier is ready for the next phase.
+ * Waiters sleep on a futex holding the phase number.
+ */
+
+class Barrier
+{
+public:
+
+  Barrier( const int count,
+           const std::function<void()> &completion = std::function<void()>() );
+  ~Barrier();
+
+  // true for the one that ran the completion
+  bool arriveAndWait();
+
+  int getCount() const;
+  int getPhase() const;
+
+private:
+
+  Barrier(const Barrier&);
+  Barrier& operator=(const Barrier&);
+
+  const int m_count;
+  const std::function<void()> m_completion;
+  std::atomic<int> m_arrived;
+  std::atomic<int> m_phase;  // futex word
+};
+
+#endif // BARRIER_HPP
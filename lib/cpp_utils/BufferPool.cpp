@@ -0,0 +1,89 @@
+#include "BufferPool.hpp"
+
+#include "ScopedLock.hpp"
+#include "Logger.hpp"
+
+
+BufferPool::BufferPool( const size_t bufferLength, const size_t maxFree )
+  : m_bufferLength(bufferLength)
+  , m_maxFree(maxFree)
+  , m_mutex()
+  , m_free()
+  , m_used(0)
+{
+  TRACE;
+}
+
+
+BufferPool::~BufferPool()
+{
+  TRACE;
+
+  if ( m_used != 0 ) {
+    LOG_BEGIN(Logger::WARNING)
+      LOG_PROP("Used", m_used)
+    LOG_END("Buffer pool destroyed while buffers are lent.");
+  }
+
+  std::vector<unsigned char*>::iterator it;
+  for ( it = m_free.begin(); it != m_free.end(); ++it )
+    delete[] *it;
+}
+
+
+unsigned char* BufferPool::acquire()
+{
+  TRACE;
+
+  ScopedLock sl(m_mutex);
+  m_used++;
+  if ( m_free.empty() )
+    return new unsigned char[m_bufferLength];
+
+  unsigned char *buffer = m_free.back();
+  m_free.pop_back();
+  return buffer;
+}
+
+
+void BufferPool::release( unsigned char *buffer )
+{
+  TRACE;
+
+  if ( buffer == 0 )
+    return;
+
+  ScopedLock sl(m_mutex);
+  m_used--;
+  if ( m_free.size() >= m_maxFree ) {
+    delete[] buffer;
+    return;
+  }
+
+  m_free.push_back(buffer);
+}
+
+
+size_t BufferPool::getBufferLength() const
+{
+  TRACE;
+  return m_bufferLength;
+}
+
+
+size_t BufferPool::getFree() const
+{
+  TRACE;
+
+  ScopedLock sl(m_mutex);
+  return m_free.size();
+}
+
+
+size_t BufferPool::getUsed() const
+{
+  TRACE;
+
+  ScopedLock sl(m_mutex);
+  return m_used;
+}
@@ -0,0 +1,47 @@
+#ifndef BUFFER_POOL_HPP
+#define BUFFER_POOL_HPP
+
+#include "Mutex.hpp"
+
+#include <vector>
+#include <stddef.h> // size_t
+
+
+/** @brief Fixed size buffers lent to connections while they read.
+ *
+ * Idle connections hold none, so memory follows the number of active
+ * ones. At most maxFree buffers are kept for reuse, the others are freed
+ * on release. Thread safe, must outlive the connections using it.
+ */
+
+class BufferPool
+{
+public:
+
+  BufferPool( const size_t bufferLength = 16 * 1024,
+              const size_t maxFree = 64 );
+
+  virtual ~BufferPool();
+
+  // never 0, allocates when there is no free one
+  unsigned char* acquire();
+  void release( unsigned char *buffer );
+
+  size_t getBufferLength() const;
+  size_t getFree() const;
+  size_t getUsed() const;
+
+private:
+
+  BufferPool(const BufferPool&);
+  BufferPool& operator=(const BufferPool&);
+
+  const size_t                  m_bufferLength;
+  const size_t                  m_maxFree;
+
+  mutable Mutex                 m_mutex;
+  std::vector<unsigned char*>   m_free;
+  size_t                        m_used;
+};
+
+#endif // BUFFER_POOL_HPP
@@ -8,6 +8,7 @@
 
 
 #include <time.h> // timespec, CLOCK_REALTIME
+#include <stdint.h> // uint64_t
 
 #include <typeinfo> //typeid
 #include <stdexcept> // runtime_error
@@ -20,11 +21,13 @@
 const long NANO = 1000000000L;  // 10^9
 
 
-inline timespec addTotimespec( const long int & sec, const long int & nsec)
+// CLOCK_MONOTONIC for deadlines which must not jump with the wall clock
+inline timespec addTotimespec( const long int & sec, const long int & nsec,
+                               const clockid_t clock = CLOCK_REALTIME )
 {
 
   timespec abs_time;
-  clock_gettime ( CLOCK_REALTIME, &abs_time );
+  clock_gettime ( clock, &abs_time );
   long int nsecSum( abs_time.tv_nsec + nsec );
 
   if ( nsecSum >= NANO ) {
@@ -38,6 +41,15 @@ inline timespec addTotimespec( const long int & sec, const long int & nsec)
 }
 
 
+// ns since an arbitrary point, for measuring intervals
+inline uint64_t monotonicNs()
+{
+  timespec ts;
+  clock_gettime ( CLOCK_MONOTONIC, &ts );
+  return (uint64_t)ts.tv_sec * NANO + ts.tv_nsec;
+}
+
+
 inline timespec timespecAdd( timespec& t1, const timespec& t2 )
 {
   timespec  result;
@@ -4,6 +4,7 @@
 #include <deque>
 #include <mutex>
 #include <condition_variable>
+#include <chrono>
 
 #include "Logger.hpp"
 
@@ -57,6 +58,41 @@ public:
     return retVal;
   }
 
+  // false on timeout
+  bool waitAndPop(T &value, const long int timeoutMs)
+  {
+    TRACE;
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    const std::chrono::steady_clock::time_point deadline =
+      std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    while (m_queue.empty() && !m_cancelled)
+      if (m_condVar.wait_until(lock, deadline) == std::cv_status::timeout)
+        break;
+
+    if (m_cancelled) throw CancelledException();
+    if (m_queue.empty())
+      return false;
+
+    value = m_queue.front();
+    m_queue.pop_front();
+    return true;
+  }
+
+  // false if there is nothing to pop right now
+  bool tryPop(T &value)
+  {
+    TRACE;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_cancelled) throw CancelledException();
+    if (m_queue.empty())
+      return false;
+
+    value = m_queue.front();
+    m_queue.pop_front();
+    return true;
+  }
+
   bool empty() const
   {
     TRACE;
@@ -65,6 +101,16 @@ public:
     return m_queue.empty();
   }
 
+  // takes what is left, cancelled or not
+  std::deque<T> drain()
+  {
+    TRACE;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    std::deque<T> left;
+    left.swap(m_queue);
+    return left;
+  }
+
   void cancel()
   {
     TRACE;
@@ -0,0 +1,301 @@
+#ifndef CONCURRENT_HASH_MAP_HPP
+#define CONCURRENT_HASH_MAP_HPP
+
+#include "Mutex.hpp"
+#include "ScopedLock.hpp"
+#include "Logger.hpp"
+
+#include <vector>
+#include <functional> // std::hash
+#include <stddef.h> // size_t
+#include <stdint.h> // uint64_t
+
+
+/** @brief Hash map split into shards, each with its own lock.
+ *
+ * Threads working on keys of different shards do not wait for each other.
+ * A shard is an open addressing table with linear probing, grown when
+ * more than half of its slots are used or deleted. Keys and values have
+ * to be default constructible and copyable, a call copies them in or out,
+ * no reference leaves the lock.
+ *
+ * compute() runs a functor on the value under the shard's lock:
+ *   bool f(V &value, const bool found)
+ * the returned bool tells whether the key stays (inserting it if it was
+ * not found) or goes.
+ */
+
+template < typename K, typename V, typename Hash = std::hash<K> >
+class ConcurrentHashMap
+{
+public:
+
+  ConcurrentHashMap( const size_t shards = 16,
+                     const size_t initialCapacity = 16 )
+    : m_shards(powerOfTwo(shards, 1), Shard(powerOfTwo(initialCapacity, 8)))
+    , m_shardBits(0)
+    , m_hash()
+  {
+    TRACE;
+
+    // the low bits of the hash pick the shard, the others the slot
+    while ( ((size_t)1 << m_shardBits) < m_shards.size() )
+      ++m_shardBits;
+  }
+
+  ~ConcurrentHashMap()
+  {
+    TRACE;
+  }
+
+  bool find( const K &key, V &value ) const
+  {
+    TRACE;
+
+    const uint64_t hash = mix(key);
+    const Shard &shard = shardOf(hash);
+    ScopedLock sl(shard.m_mutex);
+    const size_t slot = shard.lookup(key, hash >> m_shardBits);
+    if ( slot == NOT_FOUND )
+      return false;
+
+    value = shard.m_slots[slot].m_value;
+    return true;
+  }
+
+  bool contains( const K &key ) const
+  {
+    TRACE;
+
+    const uint64_t hash = mix(key);
+    const Shard &shard = shardOf(hash);
+    ScopedLock sl(shard.m_mutex);
+    return shard.lookup(key, hash >> m_shardBits) != NOT_FOUND;
+  }
+
+  // false if the key is already there, the value is not overwritten
+  bool insert( const K &key, const V &value )
+  {
+    TRACE;
+
+    const uint64_t hash = mix(key);
+    Shard &shard = shardOf(hash);
+    ScopedLock sl(shard.m_mutex);
+    if ( shard.lookup(key, hash >> m_shardBits) != NOT_FOUND )
+      return false;
+
+    shard.add(key, value, hash >> m_shardBits);
+    return true;
+  }
+
+  // true if it was there
+  bool erase( const K &key )
+  {
+    TRACE;
+
+    const uint64_t hash = mix(key);
+    Shard &shard = shardOf(hash);
+    ScopedLock sl(shard.m_mutex);
+    const size_t slot = shard.lookup(key, hash >> m_shardBits);
+    if ( slot == NOT_FOUND )
+      return false;
+
+    shard.remove(slot);
+    return true;
+  }
+
+  // true if the key is there afterwards
+  template < typename F >
+  bool compute( const K &key, F f )
+  {
+    TRACE;
+
+    const uint64_t hash = mix(key);
+    Shard &shard = shardOf(hash);
+    ScopedLock sl(shard.m_mutex);
+    const size_t slot = shard.lookup(key, hash >> m_shardBits);
+
+    if ( slot != NOT_FOUND ) {
+      if ( f(shard.m_slots[slot].m_value, true) )
+        return true;
+      shard.remove(slot);
+      return false;
+    }
+
+    V value = V();
+    if ( !f(value, false) )
+      return false;
+
+    shard.add(key, value, hash >> m_shardBits);
+    return true;
+  }
+
+  // shard by shard, not a snapshot of the whole map
+  template < typename F >
+  void forEach( F f ) const
+  {
+    TRACE;
+
+    for ( size_t i = 0; i < m_shards.size(); ++i ) {
+      const Shard &shard = m_shards[i];
+      ScopedLock sl(shard.m_mutex);
+      for ( size_t j = 0; j < shard.m_slots.size(); ++j )
+        if ( shard.m_slots[j].m_state == FULL )
+          f(shard.m_slots[j].m_key, shard.m_slots[j].m_value);
+    }
+  }
+
+  size_t size() const
+  {
+    TRACE;
+
+    size_t size(0);
+    for ( size_t i = 0; i < m_shards.size(); ++i ) {
+      ScopedLock sl(m_shards[i].m_mutex);
+      size += m_shards[i].m_size;
+    }
+    return size;
+  }
+
+  void clear()
+  {
+    TRACE;
+
+    for ( size_t i = 0; i < m_shards.size(); ++i ) {
+      Shard &shard = m_shards[i];
+      ScopedLock sl(shard.m_mutex);
+      shard.m_slots = std::vector<Slot>(8);
+      shard.m_size = 0;
+      shard.m_used = 0;
+    }
+  }
+
+private:
+
+  ConcurrentHashMap(const ConcurrentHashMap&);
+  ConcurrentHashMap& operator=(const ConcurrentHashMap&);
+
+  enum State { EMPTY, FULL, DELETED };
+  static const size_t NOT_FOUND = (size_t)-1;
+
+  struct Slot
+  {
+    Slot() : m_state(EMPTY), m_hash(0), m_key(), m_value() {}
+
+    State m_state;
+    uint64_t m_hash;  // compared first, kept for rehash
+    K m_key;
+    V m_value;
+  };
+
+  struct Shard
+  {
+    Shard( const size_t capacity )
+      : m_mutex()
+      , m_slots(capacity)
+      , m_size(0)
+      , m_used(0)
+    {}
+
+    // only the capacity is copied, when the shards are made
+    Shard( const Shard &other )
+      : m_mutex()
+      , m_slots(other.m_slots.size())
+      , m_size(0)
+      , m_used(0)
+    {}
+
+    size_t lookup( const K &key, const uint64_t hash ) const
+    {
+      const size_t mask = m_slots.size() - 1;
+      for ( size_t i = hash & mask; ; i = (i + 1) & mask ) {
+        if ( m_slots[i].m_state == EMPTY )
+          return NOT_FOUND;
+        if ( m_slots[i].m_state == FULL && m_slots[i].m_hash == hash &&
+             m_slots[i].m_key == key )
+          return i;
+      }
+    }
+
+    void add( const K &key, const V &value, const uint64_t hash )
+    {
+      // deleted ones count, they lengthen the probes as well
+      if ( (m_used + 1) * 2 > m_slots.size() )
+        rehash(m_size * 4 > m_slots.size() ? m_slots.size() * 2 : m_slots.size());
+
+      const size_t mask = m_slots.size() - 1;
+      size_t i = hash & mask;
+      while ( m_slots[i].m_state == FULL )
+        i = (i + 1) & mask;
+
+      if ( m_slots[i].m_state == EMPTY )
+        m_used++;
+      m_slots[i].m_state = FULL;
+      m_slots[i].m_hash = hash;
+      m_slots[i].m_key = key;
+      m_slots[i].m_value = value;
+      m_size++;
+    }
+
+    void remove( const size_t slot )
+    {
+      m_slots[slot].m_state = DELETED;
+      m_slots[slot].m_key = K();
+      m_slots[slot].m_value = V();
+      m_size--;
+    }
+
+    // same size again drops the deleted ones
+    void rehash( const size_t capacity )
+    {
+      std::vector<Slot> old(capacity);
+      old.swap(m_slots);
+      m_size = 0;
+      m_used = 0;
+
+      for ( size_t i = 0; i < old.size(); ++i )
+        if ( old[i].m_state == FULL )
+          add(old[i].m_key, old[i].m_value, old[i].m_hash);
+    }
+
+    mutable Mutex       m_mutex;
+    std::vector<Slot>   m_slots;
+    size_t              m_size;   // full
+    size_t              m_used;   // full or deleted
+    char                m_padding[64];  // no false sharing of the locks
+  };
+
+  static size_t powerOfTwo( const size_t atLeast, size_t value )
+  {
+    while ( value < atLeast )
+      value <<= 1;
+    return value;
+  }
+
+  uint64_t mix( const K &key ) const
+  {
+    // std::hash of integers is the identity, spread it over all the bits
+    uint64_t hash = m_hash(key);
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    return hash;
+  }
+
+  Shard& shardOf( const uint64_t hash )
+  {
+    return m_shards[hash & (m_shards.size() - 1)];
+  }
+
+  const Shard& shardOf( const uint64_t hash ) const
+  {
+    return m_shards[hash & (m_shards.size() - 1)];
+  }
+
+  std::vector<Shard>  m_shards;
+  size_t              m_shardBits;
+  Hash                m_hash;
+};
+
+
+#endif // CONCURRENT_HASH_MAP_HPP
@@ -0,0 +1,521 @@
+#ifndef CONCURRENT_SKIP_LIST_HPP
+#define CONCURRENT_SKIP_LIST_HPP
+
+#include "EpochReclaimer.hpp"
+#include "ConcurrentDeque.hpp" // CancelledException
+#include "Futex.hpp"
+#include "Common.hpp"
+
+#include <atomic>
+#include <functional> // std::less
+#include <stdint.h> // uint32_t, uint64_t
+#include <sched.h> // sched_yield
+
+
+/** @brief Ordered map on a skip list, with lock-free reads.
+ *
+ * A lazy skip list: lookups and iteration take no lock, an insert or
+ * erase locks just the predecessors of the node it links or unlinks, so
+ * writers at different keys do not wait for each other. Erased nodes are
+ * retired to an EpochReclaimer and freed once no reader can be on them.
+ *
+ * With Multi, equal keys are kept in insertion order. Keys and values
+ * are copied in and out, a value is not changed once inserted.
+ *
+ * forEach() and forRange() visit the entries present during the whole
+ * walk, and may see those added or erased meanwhile. popFirst() and
+ * waitForFirst() serve ordered queues, e.g. of timers by deadline.
+ * After cancel() the waiters and further inserts throw CancelledException.
+ */
+
+template < typename K, typename V, typename Compare = std::less<K>, bool Multi = false >
+class ConcurrentSkipList
+{
+public:
+
+  ConcurrentSkipList()
+    : m_head(new Node(K(), V(), 0, MAX_LEVEL))
+    , m_compare()
+    , m_reclaimer()
+    , m_size(0)
+    , m_sequence(0)
+    , m_version(0)
+    , m_waiters(0)
+    , m_cancelled(false)
+  {
+    TRACE;
+  }
+
+  // no thread may use it any more
+  ~ConcurrentSkipList()
+  {
+    TRACE;
+
+    Node *node = m_head;
+    while ( node != 0 ) {
+      Node *next = node->m_next[0].load(std::memory_order_relaxed);
+      delete node;
+      node = next;
+    }
+  }
+
+  // false if it is not Multi and the key is there already
+  bool insert( const K &key, const V &value )
+  {
+    TRACE;
+
+    if ( m_cancelled.load() )
+      throw CancelledException();
+
+    const uint64_t sequence = Multi ? ++m_sequence : 0;
+    const int topLevel = randomLevel();
+    Node *preds[MAX_LEVEL];
+    Node *succs[MAX_LEVEL];
+
+    ScopedEpoch se(m_reclaimer);
+    for (;;) {
+      const int found = lookup(key, sequence, preds, succs);
+      if ( found != -1 ) {
+        Node *node = succs[found];
+        if ( !node->m_marked.load() ) {
+          while ( !node->m_fullyLinked.load() )
+            cpuRelax();
+          return false;
+        }
+        continue;  // being erased, retry once it is gone
+      }
+
+      int highestLocked = -1;
+      bool valid = true;
+      Node *previous = 0;
+      for ( int level = 0; valid && level < topLevel; ++level ) {
+        Node *pred = preds[level];
+        Node *succ = succs[level];
+        if ( pred != previous ) {
+          pred->lock();
+          highestLocked = level;
+          previous = pred;
+        }
+        valid = !pred->m_marked.load() &&
+                ( succ == 0 || !succ->m_marked.load() ) &&
+                pred->m_next[level].load() == succ;
+      }
+
+      if ( !valid ) {
+        unlockPreds(preds, highestLocked);
+        continue;
+      }
+
+      Node *node = new Node(key, value, sequence, topLevel);
+      for ( int level = 0; level < topLevel; ++level )
+        node->m_next[level].store(succs[level], std::memory_order_relaxed);
+      for ( int level = 0; level < topLevel; ++level )
+        preds[level]->m_next[level].store(node, std::memory_order_release);
+      node->m_fullyLinked.store(true, std::memory_order_release);
+      unlockPreds(preds, highestLocked);
+      break;
+    }
+
+    m_size++;
+    notifyWaiters();
+    return true;
+  }
+
+  // the first one of an equal range
+  bool find( const K &key, V &value ) const
+  {
+    TRACE;
+
+    ScopedEpoch se(m_reclaimer);
+    const Node *node = lowerBound(key);
+    if ( node == 0 || m_compare(key, node->m_key) )
+      return false;
+
+    value = node->m_value;
+    return true;
+  }
+
+  bool contains( const K &key ) const
+  {
+    TRACE;
+
+    ScopedEpoch se(m_reclaimer);
+    const Node *node = lowerBound(key);
+    return node != 0 && !m_compare(key, node->m_key);
+  }
+
+  // all with that key, returns how many
+  size_t erase( const K &key )
+  {
+    TRACE;
+
+    size_t erased(0);
+    for (;;) {
+      Node *victim = 0;
+      {
+        ScopedEpoch se(m_reclaimer);
+        const Node *node = lowerBound(key);
+        if ( node == 0 || m_compare(key, node->m_key) )
+          break;
+        victim = remove(node->m_key, node->m_sequence);
+      }
+      if ( victim != 0 ) {
+        m_reclaimer.retire(victim);
+        ++erased;
+      }
+    }
+    return erased;
+  }
+
+  // the first entry with that key and value
+  bool erase( const K &key, const V &value )
+  {
+    TRACE;
+
+    for (;;) {
+      Node *victim = 0;
+      {
+        ScopedEpoch se(m_reclaimer);
+        const Node *node = lowerBound(key);
+        while ( node != 0 && !m_compare(key, node->m_key) &&
+                !(node->m_value == value) )
+          node = nextPresent(node);
+        if ( node == 0 || m_compare(key, node->m_key) )
+          return false;
+        victim = remove(node->m_key, node->m_sequence);
+      }
+      // erased by someone else meanwhile, look for another
+      if ( victim != 0 ) {
+        m_reclaimer.retire(victim);
+        return true;
+      }
+    }
+  }
+
+  bool first( K &key, V &value ) const
+  {
+    TRACE;
+
+    ScopedEpoch se(m_reclaimer);
+    const Node *node = nextPresent(m_head);
+    if ( node == 0 )
+      return false;
+
+    key = node->m_key;
+    value = node->m_value;
+    return true;
+  }
+
+  bool popFirst( K &key, V &value )
+  {
+    TRACE;
+
+    for (;;) {
+      Node *victim = 0;
+      {
+        ScopedEpoch se(m_reclaimer);
+        const Node *node = nextPresent(m_head);
+        if ( node == 0 )
+          return false;
+        victim = remove(node->m_key, node->m_sequence);
+        if ( victim != 0 ) {
+          key = victim->m_key;
+          value = victim->m_value;
+        }
+      }
+      if ( victim != 0 ) {
+        m_reclaimer.retire(victim);
+        return true;
+      }
+    }
+  }
+
+  /** Waits for an entry and returns the first one without removing it.
+   * False on timeout, 0 sec and 0 nsec waits forever, CLOCK_MONOTONIC.
+   */
+  bool waitForFirst( K &key, V &value,
+                     const long int intervalSec = 0,
+                     const long int intervalNSec = 0 )
+  {
+    TRACE;
+
+    const bool timed = intervalSec != 0 || intervalNSec != 0;
+    const timespec deadline = addTotimespec(intervalSec, intervalNSec, CLOCK_MONOTONIC);
+
+    m_waiters++;
+    bool found = false;
+    for (;;) {
+      const int version = m_version.load();
+      if ( m_cancelled.load() )
+        break;
+      if ( first(key, value) ) {
+        found = true;
+        break;
+      }
+      if ( futexWaitUntil(&m_version, version, timed ? &deadline : 0) == -1 &&
+           errno == ETIMEDOUT )
+        break;
+    }
+    m_waiters--;
+
+    if ( m_cancelled.load() )
+      throw CancelledException();
+    return found;
+  }
+
+  // f(const K&, const V&) for each entry, in order
+  template < typename F >
+  void forEach( F f ) const
+  {
+    TRACE;
+
+    ScopedEpoch se(m_reclaimer);
+    for ( const Node *node = nextPresent(m_head); node != 0; node = nextPresent(node) )
+      f(node->m_key, node->m_value);
+  }
+
+  // the same for the keys in [from, to)
+  template < typename F >
+  void forRange( const K &from, const K &to, F f ) const
+  {
+    TRACE;
+
+    ScopedEpoch se(m_reclaimer);
+    for ( const Node *node = lowerBound(from);
+          node != 0 && m_compare(node->m_key, to);
+          node = nextPresent(node) )
+      f(node->m_key, node->m_value);
+  }
+
+  size_t size() const
+  {
+    TRACE;
+    return m_size.load(std::memory_order_relaxed);
+  }
+
+  bool empty() const
+  {
+    TRACE;
+    return size() == 0;
+  }
+
+  void cancel()
+  {
+    TRACE;
+
+    m_cancelled.store(true);
+    m_version++;
+    futexWake(&m_version);
+  }
+
+private:
+
+  ConcurrentSkipList(const ConcurrentSkipList&);
+  ConcurrentSkipList& operator=(const ConcurrentSkipList&);
+
+  static const int MAX_LEVEL = 16;  // enough for 4^16 entries
+
+  struct Node
+  {
+    Node( const K &key, const V &value, const uint64_t sequence, const int topLevel )
+      : m_key(key)
+      , m_value(value)
+      , m_sequence(sequence)
+      , m_topLevel(topLevel)
+      , m_next(new std::atomic<Node*>[topLevel])
+      , m_marked(false)
+      , m_fullyLinked(false)
+      , m_locked(false)
+    {
+      for ( int level = 0; level < topLevel; ++level )
+        m_next[level].store(0, std::memory_order_relaxed);
+    }
+
+    ~Node() { delete[] m_next; }
+
+    // held for a few stores only
+    void lock()
+    {
+      for ( int spins = 0; m_locked.exchange(true, std::memory_order_acquire); ++spins )
+        spins < 100 ? cpuRelax() : (void)sched_yield();
+    }
+
+    void unlock() { m_locked.store(false, std::memory_order_release); }
+
+    const K m_key;
+    const V m_value;
+    const uint64_t m_sequence;  // orders equal keys of a Multi
+    const int m_topLevel;
+    std::atomic<Node*> *m_next;
+    std::atomic<bool> m_marked;  // logically erased
+    std::atomic<bool> m_fullyLinked;
+    std::atomic<bool> m_locked;
+
+  private:
+
+    Node(const Node&);
+    Node& operator=(const Node&);
+  };
+
+  bool before( const Node *node, const K &key, const uint64_t sequence ) const
+  {
+    return m_compare(node->m_key, key) ||
+           ( !m_compare(key, node->m_key) && node->m_sequence < sequence );
+  }
+
+  // fills the neighbours of (key, sequence) on each level, returns the
+  // highest level the node itself was found on or -1
+  int lookup( const K &key, const uint64_t sequence,
+              Node **preds, Node **succs ) const
+  {
+    int found = -1;
+    Node *pred = m_head;
+    for ( int level = MAX_LEVEL - 1; level >= 0; --level ) {
+      Node *curr = pred->m_next[level].load(std::memory_order_acquire);
+      while ( curr != 0 && before(curr, key, sequence) ) {
+        pred = curr;
+        curr = pred->m_next[level].load(std::memory_order_acquire);
+      }
+      if ( found == -1 && curr != 0 &&
+           !m_compare(key, curr->m_key) && curr->m_sequence == sequence )
+        found = level;
+      preds[level] = pred;
+      succs[level] = curr;
+    }
+    return found;
+  }
+
+  // the first present node not before key
+  const Node* lowerBound( const K &key ) const
+  {
+    Node *preds[MAX_LEVEL];
+    Node *succs[MAX_LEVEL];
+    lookup(key, 0, preds, succs);
+
+    const Node *node = succs[0];
+    if ( node != 0 && ( node->m_marked.load() || !node->m_fullyLinked.load() ) )
+      node = nextPresent(node);
+    return node;
+  }
+
+  const Node* nextPresent( const Node *node ) const
+  {
+    do {
+      node = node->m_next[0].load(std::memory_order_acquire);
+    } while ( node != 0 && ( node->m_marked.load() || !node->m_fullyLinked.load() ) );
+    return node;
+  }
+
+  // unlinks it, in an epoch region; 0 if someone else erased it first
+  Node* remove( const K &key, const uint64_t sequence )
+  {
+    Node *preds[MAX_LEVEL];
+    Node *succs[MAX_LEVEL];
+    Node *victim = 0;
+    int topLevel = -1;
+
+    for (;;) {
+      const int found = lookup(key, sequence, preds, succs);
+
+      if ( victim == 0 ) {
+        if ( found == -1 )
+          return 0;
+        Node *candidate = succs[found];
+        if ( !candidate->m_fullyLinked.load() ||
+             candidate->m_topLevel - 1 != found ||
+             candidate->m_marked.load() )
+          return 0;
+
+        candidate->lock();
+        if ( candidate->m_marked.load() ) {
+          candidate->unlock();
+          return 0;
+        }
+        candidate->m_marked.store(true);
+        victim = candidate;
+        topLevel = victim->m_topLevel;
+      }
+
+      int highestLocked = -1;
+      bool valid = true;
+      Node *previous = 0;
+      for ( int level = 0; valid && level < topLevel; ++level ) {
+        Node *pred = preds[level];
+        if ( pred != previous ) {
+          pred->lock();
+          highestLocked = level;
+          previous = pred;
+        }
+        valid = !pred->m_marked.load() &&
+                pred->m_next[level].load() == victim;
+      }
+
+      if ( !valid ) {
+        unlockPreds(preds, highestLocked);
+        continue;
+      }
+
+      for ( int level = topLevel - 1; level >= 0; --level )
+        preds[level]->m_next[level].store(victim->m_next[level].load(),
+                                          std::memory_order_release);
+      victim->unlock();
+      unlockPreds(preds, highestLocked);
+      m_size--;
+      return victim;
+    }
+  }
+
+  static void unlockPreds( Node **preds, const int highestLocked )
+  {
+    Node *previous = 0;
+    for ( int level = 0; level <= highestLocked; ++level ) {
+      if ( preds[level] != previous ) {
+        preds[level]->unlock();
+        previous = preds[level];
+      }
+    }
+  }
+
+  void notifyWaiters()
+  {
+    m_version++;
+    if ( m_waiters.load() != 0 )
+      futexWake(&m_version);
+  }
+
+  // a level more with a chance of 1/4
+  static int randomLevel()
+  {
+    static __thread uint32_t seed = 0;
+    if ( seed == 0 )
+      seed = (uint32_t)(uintptr_t)&seed | 1;
+
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+
+    int level = 1;
+    for ( uint32_t bits = seed; level < MAX_LEVEL && (bits & 3) == 0; bits >>= 2 )
+      ++level;
+    return level;
+  }
+
+  Node                    *m_head;
+  Compare                  m_compare;
+  mutable EpochReclaimer   m_reclaimer;
+  std::atomic<size_t>      m_size;
+  std::atomic<uint64_t>    m_sequence;
+  std::atomic<int>         m_version;  // futex word of waitForFirst
+  std::atomic<int>         m_waiters;
+  std::atomic<bool>        m_cancelled;
+};
+
+
+template < typename K, typename V, typename Compare = std::less<K> >
+class ConcurrentSkipListMap : public ConcurrentSkipList<K, V, Compare, false> {};
+
+template < typename K, typename V, typename Compare = std::less<K> >
+class ConcurrentSkipListMultiMap : public ConcurrentSkipList<K, V, Compare, true> {};
+
+
+#endif // CONCURRENT_SKIP_LIST_HPP
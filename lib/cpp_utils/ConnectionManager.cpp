@@ -0,0 +1,890 @@
+#include "ConnectionManager.hpp"
+
+#include "Resolver.hpp"
+#include "ScopedLock.hpp"
+#include "Logger.hpp"
+#include "Common.hpp"
+
+#include <atomic>
+#include <climits> // INT_MAX
+#include <stdlib.h> // rand_r
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h> // close
+#include <time.h> // clock_gettime
+
+
+namespace {
+
+  const int MAX_EVENTS = 64;
+
+  // writability only while the connection waits for it
+  uint32_t readEvents( const StreamConnection *connection )
+  {
+    return connection->wantsWrite() ? EPOLLIN | EPOLLPRI | EPOLLOUT
+                                    : EPOLLIN | EPOLLPRI;
+  }
+
+} // anonym namespace
+
+
+struct ConnectionManager::Entry
+{
+  enum State {
+    WAITING,     // for the next connect attempt
+    RESOLVING,
+    CONNECTING,
+    CONNECTED,
+    CLOSED       // not reconnecting
+  };
+
+  Entry( StreamConnection *connection,
+         const Callbacks &callbacks,
+         Reactor *reactor,
+         const int backoffMs )
+    : m_connection(connection)
+    , m_callbacks(callbacks)
+    , m_reactor(reactor)
+    , m_state(WAITING)
+    , m_fd(-1)
+    , m_events(0)
+    , m_deadline(0)
+    , m_backoffMs(backoffMs)
+    , m_removed(false)
+    , m_lookup(0)
+    , m_socketMutex(Mutex::Recursive)
+    , m_users(0)
+    , m_freed(false)
+  {
+  }
+
+  StreamConnection  *m_connection;
+  Callbacks          m_callbacks;
+  Reactor           *m_reactor;
+  std::atomic<int>   m_state;
+  int                m_fd;
+  uint32_t           m_events;
+  uint64_t           m_deadline;
+  int                m_backoffMs;
+  bool               m_removed;
+  uint64_t           m_lookup;    // the pending one, stale results differ
+  // send() and receive() hold it, the reactor to disconnect; recursive,
+  // a Message may send() from within receive()
+  Mutex              m_socketMutex;
+  int                m_users;     // by the manager's m_mutex, send()s
+  bool               m_freed;     // by the manager's m_mutex
+
+private:
+
+  Entry(const Entry&);
+  Entry& operator=(const Entry&);
+};
+
+
+// Reactor
+
+ConnectionManager::Reactor::Reactor( ConnectionManager &manager,
+                                     const unsigned int seed )
+  : m_manager(manager)
+  , m_epoll(-1)
+  , m_wakeFd(-1)
+  , m_thread()
+  , m_seed(seed)
+  , m_mutex()
+  , m_condVar(m_mutex)
+  , m_commands()
+  , m_entries()
+  , m_timers()
+  , m_released()
+  , m_finished(false)
+  , m_lookups(0)
+{
+  TRACE;
+}
+
+
+ConnectionManager::Reactor::~Reactor()
+{
+  TRACE;
+
+  if ( m_wakeFd != -1 )
+    close(m_wakeFd);
+
+  if ( m_epoll != -1 )
+    close(m_epoll);
+}
+
+
+bool ConnectionManager::Reactor::init()
+{
+  TRACE;
+
+  {
+    ScopedLock sl(m_mutex);
+    m_finished = false;
+  }
+
+  m_epoll = epoll_create1(EPOLL_CLOEXEC);
+  m_wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if ( m_epoll == -1 || m_wakeFd == -1 ) {
+    LOG( Logger::ERR, errnoToString("Could not create reactor. ").c_str() );
+    return false;
+  }
+
+  // the wake up descriptor is the one without an entry
+  epoll_event event;
+  event.events = EPOLLIN;
+  event.data.ptr = 0;
+  if ( epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_wakeFd, &event) == -1 ) {
+    LOG( Logger::ERR, errnoToString("Could not watch wake up descriptor. ").c_str() );
+    return false;
+  }
+
+  return true;
+}
+
+
+void ConnectionManager::Reactor::stopReactor()
+{
+  TRACE;
+  stop();
+  wakeUp();
+}
+
+
+void ConnectionManager::Reactor::add( Entry *entry )
+{
+  TRACE;
+
+  Command command = { entry, Command::ADD, 0, 0 };
+  bool finished(false);
+  {
+    ScopedLock sl(m_mutex);
+    finished = m_finished;
+    if ( !finished )
+      m_commands.push_back(command);
+  }
+
+  // raced with stop(), never connected
+  if ( finished ) {
+    m_manager.freeEntry(entry);
+    return;
+  }
+  wakeUp();
+}
+
+
+void ConnectionManager::Reactor::remove( Entry *entry )
+{
+  TRACE;
+
+  // from a callback: the loop is ours
+  if ( pthread_equal(pthread_self(), m_thread) ) {
+    release(entry);
+    return;
+  }
+
+  bool done(false);
+  Command command = { entry, Command::REMOVE, &done, 0 };
+  {
+    ScopedLock sl(m_mutex);
+    // the entry is freed already, by the way out of run()
+    if ( m_finished )
+      return;
+    m_commands.push_back(command);
+  }
+  wakeUp();
+
+  // or stopped before getting to the command, freeing it with the rest
+  ScopedLock sl(m_mutex);
+  while ( !done && !m_finished )
+    m_condVar.wait();
+}
+
+
+void* ConnectionManager::Reactor::run()
+{
+  TRACE;
+
+  m_thread = pthread_self();
+  epoll_event events[MAX_EVENTS];
+
+  while ( m_isRunning ) {
+
+    const int ret = epoll_wait(m_epoll, events, MAX_EVENTS, nextTimeout());
+    if ( ret == -1 && errno != EINTR ) {
+      LOG( Logger::ERR, errnoToString("ERROR polling. ").c_str() );
+      break;
+    }
+
+    for ( int i = 0; i < ret; ++i ) {
+      if ( events[i].data.ptr == 0 ) {
+        uint64_t counter;
+        while ( read(m_wakeFd, &counter, sizeof(counter)) > 0 )
+          ;
+        continue;
+      }
+      handleEvent( static_cast<Entry*>(events[i].data.ptr), events[i].events );
+    }
+
+    processCommands();
+    processTimers();
+
+    // entries released during this round may still had events in the array
+    std::vector<Entry*>::iterator it;
+    for ( it = m_released.begin(); it != m_released.end(); ++it )
+      m_manager.freeEntry(*it);
+    m_released.clear();
+  }
+
+  // let the waiting removers go, then drop everything
+  processCommands();
+
+  std::set<Entry*>::iterator it;
+  for ( it = m_entries.begin(); it != m_entries.end(); ++it ) {
+    unwatch(*it);
+    disconnect(*it, Entry::CLOSED);
+    m_manager.freeEntry(*it);
+  }
+  m_entries.clear();
+  m_timers.clear();
+
+  std::vector<Entry*>::iterator it2;
+  for ( it2 = m_released.begin(); it2 != m_released.end(); ++it2 )
+    m_manager.freeEntry(*it2);
+  m_released.clear();
+
+  // commands queued since the drain above, no later ones are
+  std::deque<Command> commands;
+  {
+    ScopedLock sl(m_mutex);
+    m_finished = true;
+    commands.swap(m_commands);
+    m_condVar.broadcast();
+  }
+
+  // the removes of these are among them, the rest are freed already
+  std::deque<Command>::iterator it3;
+  for ( it3 = commands.begin(); it3 != commands.end(); ++it3 )
+    if ( it3->m_type == Command::ADD )
+      m_manager.freeEntry(it3->m_entry);
+
+  return 0;
+}
+
+
+void ConnectionManager::Reactor::wakeUp()
+{
+  TRACE;
+
+  const uint64_t one(1);
+  if ( write(m_wakeFd, &one, sizeof(one)) == -1 && errno != EAGAIN ) {
+    LOG( Logger::ERR, errnoToString("Could not wake up reactor. ").c_str() );
+  }
+}
+
+
+void ConnectionManager::Reactor::rearm( Entry *entry )
+{
+  TRACE;
+
+  // from a callback: watched again after it
+  if ( pthread_equal(pthread_self(), m_thread) )
+    return;
+
+  Command command = { entry, Command::REARM, 0, 0 };
+  {
+    ScopedLock sl(m_mutex);
+    if ( m_finished )
+      return;
+    m_commands.push_back(command);
+  }
+  wakeUp();
+}
+
+
+void ConnectionManager::Reactor::resolved( Entry *entry, const uint64_t lookup )
+{
+  TRACE;
+
+  Command command = { entry, Command::RESOLVED, 0, lookup };
+  {
+    ScopedLock sl(m_mutex);
+    if ( m_finished )
+      return;
+    m_commands.push_back(command);
+  }
+  wakeUp();
+}
+
+
+void ConnectionManager::Reactor::processCommands()
+{
+  TRACE;
+
+  std::deque<Command> commands;
+  {
+    ScopedLock sl(m_mutex);
+    commands.swap(m_commands);
+  }
+
+  std::deque<Command>::iterator it;
+  for ( it = commands.begin(); it != commands.end(); ++it ) {
+
+    if ( it->m_type == Command::ADD ) {
+      m_entries.insert(it->m_entry);
+      if ( m_isRunning )
+        connect(it->m_entry);
+      continue;
+    }
+
+    // the entry may be gone since, or another one at its address
+    if ( it->m_type == Command::REARM ) {
+      Entry *entry = it->m_entry;
+      if ( m_entries.find(entry) != m_entries.end() &&
+           entry->m_state == Entry::CONNECTED &&
+           !watch(entry, wantedEvents(entry)) ) {
+        unwatch(entry);
+        disconnect(entry, Entry::WAITING);
+        closeEntry(entry, true);
+      }
+      continue;
+    }
+
+    // timed out, removed or freed meanwhile: a later lookup or none waits
+    if ( it->m_type == Command::RESOLVED ) {
+      Entry *entry = it->m_entry;
+      if ( m_entries.find(entry) != m_entries.end() &&
+           entry->m_state == Entry::RESOLVING &&
+           entry->m_lookup == it->m_lookup ) {
+        setDeadline(entry, 0);
+        startConnect(entry);
+      }
+      continue;
+    }
+
+    release(it->m_entry);
+
+    ScopedLock sl(m_mutex);
+    *(it->m_done) = true;
+    m_condVar.broadcast();
+  }
+}
+
+
+void ConnectionManager::Reactor::processTimers()
+{
+  TRACE;
+
+  const uint64_t current = now();
+  while ( !m_timers.empty() && m_timers.begin()->first <= current ) {
+
+    Entry *entry = m_timers.begin()->second;
+    m_timers.erase(m_timers.begin());
+    entry->m_deadline = 0;
+
+    if ( entry->m_state == Entry::WAITING ) {
+      connect(entry);
+    } else if ( entry->m_state == Entry::RESOLVING ) {
+      LOG_BEGIN(Logger::WARNING)
+        LOG_PROP("Host", entry->m_connection->getHost())
+        LOG_PROP("Port", entry->m_connection->getPort())
+      LOG_END("Resolving timed out.");
+      closeEntry(entry, false);
+    } else if ( entry->m_state == Entry::CONNECTING ) {
+      LOG_BEGIN(Logger::WARNING)
+        LOG_PROP("Host", entry->m_connection->getHost())
+        LOG_PROP("Port", entry->m_connection->getPort())
+      LOG_END("Connect timed out.");
+      unwatch(entry);
+      disconnect(entry, Entry::WAITING);
+      closeEntry(entry, false);
+    }
+  }
+}
+
+
+int ConnectionManager::Reactor::nextTimeout() const
+{
+  TRACE;
+
+  if ( m_timers.empty() )
+    return -1;
+
+  const uint64_t deadline = m_timers.begin()->first;
+  const uint64_t current = now();
+  if ( deadline <= current )
+    return 0;
+
+  return deadline - current > (uint64_t)INT_MAX ? INT_MAX : deadline - current;
+}
+
+
+void ConnectionManager::Reactor::handleEvent( Entry *entry, const uint32_t events )
+{
+  TRACE;
+
+  if ( entry->m_removed )
+    return;
+
+  StreamConnection *connection = entry->m_connection;
+
+  if ( entry->m_state == Entry::CONNECTING ) {
+    unwatch(entry);
+    setDeadline(entry, 0);
+    if ( connection->finishConnect() ) {
+      connected(entry);
+    } else {
+      disconnect(entry, Entry::WAITING);
+      closeEntry(entry, false);
+    }
+    return;
+  }
+
+  if ( entry->m_state != Entry::CONNECTED )
+    return;
+
+  if ( !(events & (EPOLLIN | EPOLLPRI | EPOLLOUT | EPOLLERR | EPOLLHUP)) )
+    return;
+
+  // not while a send() writes on it
+  bool received(false);
+  {
+    ScopedLock sl(entry->m_socketMutex);
+    received = connection->receive();
+  }
+
+  if ( !received ) {
+    unwatch(entry);
+    disconnect(entry, Entry::WAITING);
+    closeEntry(entry, true);
+    return;
+  }
+
+  if ( entry->m_callbacks.onReceived )
+    entry->m_callbacks.onReceived(connection);
+
+  // a TLS handshake, or output queued by the callback, may wait for writability
+  if ( !entry->m_removed && !watch(entry, wantedEvents(entry)) ) {
+    unwatch(entry);
+    disconnect(entry, Entry::WAITING);
+    closeEntry(entry, true);
+  }
+}
+
+
+void ConnectionManager::Reactor::connect( Entry *entry )
+{
+  TRACE;
+
+  const std::string host = entry->m_connection->getHost();
+  const std::string port = entry->m_connection->getPort();
+  if ( m_manager.m_resolver->lookup(host, port) ) {
+    startConnect(entry);
+    return;
+  }
+
+  // the connect timeout covers the lookup too
+  entry->m_state = Entry::RESOLVING;
+  entry->m_lookup = ++m_lookups;
+  setDeadline(entry, now() + m_manager.m_connectTimeoutMs);
+
+  // the entry may be freed by the time the result comes, it is not touched
+  Reactor *reactor = this;
+  const uint64_t lookup = entry->m_lookup;
+  m_manager.m_resolver->resolve(host, port,
+    [reactor, entry, lookup]( const Resolver::Result& )
+      { reactor->resolved(entry, lookup); });
+}
+
+
+void ConnectionManager::Reactor::startConnect( Entry *entry )
+{
+  TRACE;
+
+  // not under the entry's lock: send() leaves a connecting socket alone
+  entry->m_state = Entry::CONNECTING;
+  bool inProgress(false);
+  if ( !entry->m_connection->startConnect(inProgress) ) {
+    disconnect(entry, Entry::WAITING);
+    closeEntry(entry, false);
+    return;
+  }
+
+  if ( !inProgress ) {
+    connected(entry);
+    return;
+  }
+
+  if ( !watch(entry, EPOLLOUT) ) {
+    disconnect(entry, Entry::WAITING);
+    closeEntry(entry, false);
+    return;
+  }
+
+  setDeadline(entry, now() + m_manager.m_connectTimeoutMs);
+}
+
+
+void ConnectionManager::Reactor::connected( Entry *entry )
+{
+  TRACE;
+
+  if ( !watch(entry, wantedEvents(entry)) ) {
+    disconnect(entry, Entry::WAITING);
+    closeEntry(entry, false);
+    return;
+  }
+
+  {
+    ScopedLock sl(entry->m_socketMutex);
+    entry->m_state = Entry::CONNECTED;
+  }
+  entry->m_backoffMs = m_manager.m_minBackoffMs;
+
+  if ( entry->m_callbacks.onConnected )
+    entry->m_callbacks.onConnected(entry->m_connection);
+
+  if ( !entry->m_removed )
+    watch(entry, wantedEvents(entry));
+}
+
+
+void ConnectionManager::Reactor::closeEntry( Entry *entry, const bool wasConnected )
+{
+  TRACE;
+
+  setDeadline(entry, 0);
+  entry->m_state = m_manager.m_reconnect ? Entry::WAITING : Entry::CLOSED;
+
+  if ( wasConnected && entry->m_callbacks.onDisconnected )
+    entry->m_callbacks.onDisconnected(entry->m_connection);
+
+  // the callback may have removed it
+  if ( entry->m_removed || !m_manager.m_reconnect )
+    return;
+
+  // jitter, so a farm of clients does not reconnect in lockstep
+  const int backoff = entry->m_backoffMs;
+  const int jitter = rand_r(&m_seed) % (backoff / 4 + 1);
+  setDeadline(entry, now() + backoff + jitter);
+
+  entry->m_backoffMs = backoff * 2 > m_manager.m_maxBackoffMs ?
+                         m_manager.m_maxBackoffMs : backoff * 2;
+
+  LOG_BEGIN(Logger::DEBUG)
+    LOG_PROP("Host", entry->m_connection->getHost())
+    LOG_PROP("Port", entry->m_connection->getPort())
+    LOG_PROP("Backoff ms", backoff + jitter)
+  LOG_END("Reconnect scheduled.");
+}
+
+
+void ConnectionManager::Reactor::release( Entry *entry )
+{
+  TRACE;
+
+  if ( entry->m_removed )
+    return;
+
+  unwatch(entry);
+  setDeadline(entry, 0);
+
+  // waits for a send() on it, none gets to it after this
+  disconnect(entry, Entry::CLOSED);
+  entry->m_removed = true;
+  m_entries.erase(entry);
+  m_released.push_back(entry);
+}
+
+
+void ConnectionManager::Reactor::disconnect( Entry *entry, const int state )
+{
+  TRACE;
+
+  ScopedLock sl(entry->m_socketMutex);
+  if ( entry->m_state == Entry::CONNECTING || entry->m_state == Entry::CONNECTED )
+    entry->m_connection->disconnect();
+
+  entry->m_state = state;
+}
+
+
+uint32_t ConnectionManager::Reactor::wantedEvents( Entry *entry )
+{
+  TRACE;
+
+  ScopedLock sl(entry->m_socketMutex);
+  return readEvents(entry->m_connection);
+}
+
+
+void ConnectionManager::Reactor::setDeadline( Entry *entry, const uint64_t deadline )
+{
+  TRACE;
+
+  if ( entry->m_deadline != 0 )
+    m_timers.erase( std::make_pair(entry->m_deadline, entry) );
+
+  entry->m_deadline = deadline;
+  if ( deadline != 0 )
+    m_timers.insert( std::make_pair(deadline, entry) );
+}
+
+
+bool ConnectionManager::Reactor::watch( Entry *entry, const uint32_t events )
+{
+  TRACE;
+
+  const int fd = entry->m_connection->getSocket();
+  if ( entry->m_fd == fd && entry->m_events == events )
+    return true;
+
+  epoll_event event;
+  event.events = events;
+  event.data.ptr = entry;
+
+  if ( epoll_ctl(m_epoll, entry->m_fd == fd ? EPOLL_CTL_MOD : EPOLL_CTL_ADD,
+                 fd, &event) == -1 ) {
+    LOG_BEGIN(Logger::ERR)
+      LOG_PROP("Socket", fd)
+      LOG_PROP("Error message", strerror(errno))
+    LOG_END("Could not watch socket.");
+    return false;
+  }
+
+  entry->m_fd = fd;
+  entry->m_events = events;
+  return true;
+}
+
+
+void ConnectionManager::Reactor::unwatch( Entry *entry )
+{
+  TRACE;
+
+  if ( entry->m_fd == -1 )
+    return;
+
+  epoll_ctl(m_epoll, EPOLL_CTL_DEL, entry->m_fd, 0);
+  entry->m_fd = -1;
+  entry->m_events = 0;
+}
+
+
+// ConnectionManager
+
+ConnectionManager::ConnectionManager( const int   numberOfReactors,
+                                      const int   connectTimeoutMs,
+                                      const int   minBackoffMs,
+                                      const int   maxBackoffMs,
+                                      const bool  reconnect )
+  : m_connectTimeoutMs(connectTimeoutMs)
+  , m_minBackoffMs(minBackoffMs)
+  , m_maxBackoffMs(maxBackoffMs)
+  , m_reconnect(reconnect)
+  , m_resolver(new Resolver)
+  , m_reactors()
+  , m_mutex()
+  , m_entries()
+  , m_nextReactor(0)
+  , m_running(false)
+{
+  TRACE;
+
+  for ( int i = 0; i < numberOfReactors; ++i )
+    m_reactors.push_back(new Reactor(*this, i + 1));
+}
+
+
+ConnectionManager::~ConnectionManager()
+{
+  TRACE;
+
+  stop();
+
+  // its threads call back into the reactors
+  delete m_resolver;
+
+  std::vector<Reactor*>::iterator it;
+  for ( it = m_reactors.begin(); it != m_reactors.end(); ++it )
+    delete *it;
+}
+
+
+bool ConnectionManager::start()
+{
+  TRACE;
+
+  ScopedLock sl(m_mutex);
+  if ( m_running || m_reactors.empty() )
+    return false;
+
+  std::vector<Reactor*>::iterator it;
+  for ( it = m_reactors.begin(); it != m_reactors.end(); ++it )
+    if ( !(*it)->init() )
+      return false;
+
+  for ( it = m_reactors.begin(); it != m_reactors.end(); ++it )
+    (*it)->start();
+
+  m_running = true;
+  return true;
+}
+
+
+void ConnectionManager::stop()
+{
+  TRACE;
+
+  std::vector<StreamConnection*> connections;
+  {
+    ScopedLock sl(m_mutex);
+    if ( !m_running )
+      return;
+
+    // the reactors free the entries on their way out
+    m_running = false;
+    std::map<StreamConnection*, Entry*>::const_iterator it;
+    for ( it = m_entries.begin(); it != m_entries.end(); ++it )
+      connections.push_back(it->first);
+    m_entries.clear();
+  }
+
+  std::vector<Reactor*>::iterator it;
+  for ( it = m_reactors.begin(); it != m_reactors.end(); ++it )
+    (*it)->stopReactor();
+
+  for ( it = m_reactors.begin(); it != m_reactors.end(); ++it )
+    (*it)->join();
+
+  std::vector<StreamConnection*>::iterator it2;
+  for ( it2 = connections.begin(); it2 != connections.end(); ++it2 )
+    (*it2)->setResolver(0);
+}
+
+
+bool ConnectionManager::addConnection( StreamConnection  *connection,
+                                       const Callbacks   &callbacks )
+{
+  TRACE;
+
+  Entry *entry(0);
+  {
+    ScopedLock sl(m_mutex);
+    if ( !m_running || m_entries.find(connection) != m_entries.end() )
+      return false;
+
+    Reactor *reactor = m_reactors[m_nextReactor++ % m_reactors.size()];
+    entry = new Entry(connection, callbacks, reactor, m_minBackoffMs);
+    m_entries[connection] = entry;
+  }
+
+  // the reactor resolved the name, connecting finds it cached
+  connection->setResolver(m_resolver);
+
+  entry->m_reactor->add(entry);
+  return true;
+}
+
+
+bool ConnectionManager::removeConnection( StreamConnection *connection )
+{
+  TRACE;
+
+  Entry *entry(0);
+  {
+    ScopedLock sl(m_mutex);
+    std::map<StreamConnection*, Entry*>::iterator it = m_entries.find(connection);
+    if ( it == m_entries.end() )
+      return false;
+
+    entry = it->second;
+    m_entries.erase(it);
+  }
+
+  entry->m_reactor->remove(entry);
+  connection->setResolver(0);
+  return true;
+}
+
+
+bool ConnectionManager::send( StreamConnection *connection,
+                              const void* msg,
+                              const size_t msgLen )
+{
+  TRACE;
+
+  Entry *entry(0);
+  {
+    ScopedLock sl(m_mutex);
+    std::map<StreamConnection*, Entry*>::const_iterator it = m_entries.find(connection);
+    if ( it == m_entries.end() )
+      return false;
+
+    // not freed until this send is done, even if removed meanwhile
+    entry = it->second;
+    ++entry->m_users;
+  }
+
+  bool sent(false);
+  {
+    // the reactor does not close, reconnect or read the socket meanwhile
+    ScopedLock sl(entry->m_socketMutex);
+    sent = entry->m_state == Entry::CONNECTED && connection->send(msg, msgLen);
+
+    // the rest waits for writability, not for the peer to send something
+    if ( sent && connection->wantsWrite() )
+      entry->m_reactor->rearm(entry);
+  }
+
+  ScopedLock sl(m_mutex);
+  if ( --entry->m_users == 0 && entry->m_freed )
+    delete entry;
+
+  return sent;
+}
+
+
+bool ConnectionManager::isConnected( StreamConnection *connection ) const
+{
+  TRACE;
+
+  ScopedLock sl(m_mutex);
+  std::map<StreamConnection*, Entry*>::const_iterator it = m_entries.find(connection);
+  return it != m_entries.end() && it->second->m_state == Entry::CONNECTED;
+}
+
+
+size_t ConnectionManager::getNumberOfConnections() const
+{
+  TRACE;
+
+  ScopedLock sl(m_mutex);
+  return m_entries.size();
+}
+
+
+void ConnectionManager::freeEntry( Entry *entry )
+{
+  TRACE;
+
+  ScopedLock sl(m_mutex);
+  if ( entry->m_users > 0 ) {
+    entry->m_freed = true;
+    return;
+  }
+
+  delete entry;
+}
+
+
+uint64_t ConnectionManager::now()
+{
+  TRACE_STATIC;
+
+  timespec ts;
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
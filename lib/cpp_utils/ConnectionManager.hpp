@@ -0,0 +1,173 @@
+#ifndef CONNECTION_MANAGER_HPP
+#define CONNECTION_MANAGER_HPP
+
+
+#include "StreamConnection.hpp"
+#include "Thread.hpp"
+#include "Mutex.hpp"
+#include "ConditionVariable.hpp"
+
+#include <map>
+#include <set>
+#include <deque>
+#include <vector>
+#include <functional>
+#include <stdint.h> // uint64_t
+#include <stddef.h> // size_t
+
+class Resolver;
+
+/** @brief Many outbound connections sharing a few epoll event loops.
+ *
+ * Replaces a SocketClient (and its poller thread) per connection.
+ * Connections are spread over the reactors round-robin, connected with
+ * startConnect() under a timeout and reconnected with exponential backoff
+ * after failures or disconnects. Names are resolved by the manager's
+ * Resolver threads first, set on the connections while they are added, so
+ * a slow lookup does not hold up the reactor.
+ *
+ * Incoming data is delivered to the connection's Message by receive(),
+ * the callbacks run on the connection's reactor thread afterwards.
+ * send() can be called from any thread. What a non-blocking connection
+ * could not write at once is flushed by the reactor on writability.
+ * The connections are not owned.
+ */
+
+class ConnectionManager
+{
+public:
+
+  typedef std::function<void (StreamConnection*)> Callback;
+
+  struct Callbacks {
+    Callbacks() : onConnected(), onReceived(), onDisconnected() {}
+
+    Callback onConnected;
+    Callback onReceived;
+    Callback onDisconnected;
+  };
+
+  ConnectionManager( const int       numberOfReactors = 1,
+                     const int       connectTimeoutMs = 5000,
+                     const int       minBackoffMs = 100,
+                     const int       maxBackoffMs = 30000,
+                     const bool      reconnect = true );
+
+  virtual ~ConnectionManager();
+
+  bool start();
+  void stop();
+
+  bool addConnection( StreamConnection  *connection,
+                      const Callbacks   &callbacks = Callbacks() );
+
+  // disconnects, after returning the connection can be deleted
+  bool removeConnection( StreamConnection *connection );
+
+  // false if the connection is not (yet) connected
+  bool send( StreamConnection *connection, const void* msg, const size_t msgLen );
+
+  bool isConnected( StreamConnection *connection ) const;
+  size_t getNumberOfConnections() const;
+
+private:
+
+  struct Entry;
+
+  class Reactor : public Thread
+  {
+  public:
+
+    Reactor( ConnectionManager &manager, const unsigned int seed );
+    virtual ~Reactor();
+
+    bool init();
+    void stopReactor();
+
+    void add( Entry *entry );
+    void remove( Entry *entry );
+    // watches for writability too if the connection waits for it
+    void rearm( Entry *entry );
+    // from the resolver: the lookup of the entry's host is done
+    void resolved( Entry *entry, const uint64_t lookup );
+
+  private:
+
+    Reactor(const Reactor&);
+    Reactor& operator=(const Reactor&);
+
+    struct Command {
+      enum Type {
+        ADD,
+        REMOVE,
+        REARM,
+        RESOLVED
+      };
+
+      Entry    *m_entry;
+      Type      m_type;
+      bool     *m_done;
+      uint64_t  m_lookup;
+    };
+
+    void* run();
+
+    void wakeUp();
+    void processCommands();
+    void processTimers();
+    int nextTimeout() const;
+    void handleEvent( Entry *entry, const uint32_t events );
+
+    void connect( Entry *entry );
+    void startConnect( Entry *entry );
+    void connected( Entry *entry );
+    void closeEntry( Entry *entry, const bool wasConnected );
+    void release( Entry *entry );
+    // closes the socket if open, and sets the state, under the entry's lock
+    void disconnect( Entry *entry, const int state );
+    // the events to watch, under the entry's lock
+    uint32_t wantedEvents( Entry *entry );
+    void setDeadline( Entry *entry, const uint64_t deadline );
+    bool watch( Entry *entry, const uint32_t events );
+    void unwatch( Entry *entry );
+
+    ConnectionManager                  &m_manager;
+    int                                 m_epoll;
+    int                                 m_wakeFd;
+    pthread_t                           m_thread;
+    unsigned int                        m_seed;
+
+    Mutex                               m_mutex;
+    ConditionVariable                   m_condVar;
+    std::deque<Command>                 m_commands;
+
+    std::set<Entry*>                    m_entries;
+    std::set< std::pair<uint64_t, Entry*> > m_timers;
+    std::vector<Entry*>                 m_released;
+    bool                                m_finished;  // by m_mutex, run() left
+    uint64_t                            m_lookups;
+
+  };  // class Reactor
+
+
+  ConnectionManager(const ConnectionManager&);
+  ConnectionManager& operator=(const ConnectionManager&);
+
+  static uint64_t now();
+  // deletes it, or leaves that to the last send() using it
+  void freeEntry( Entry *entry );
+
+  const int              m_connectTimeoutMs;
+  const int              m_minBackoffMs;
+  const int              m_maxBackoffMs;
+  const bool             m_reconnect;
+
+  Resolver              *m_resolver;
+  std::vector<Reactor*>  m_reactors;
+  mutable Mutex          m_mutex;
+  std::map<StreamConnection*, Entry*> m_entries;
+  size_t                 m_nextReactor;
+  bool                   m_running;
+};
+
+#endif // CONNECTION_MANAGER_HPP
@@ -0,0 +1,207 @@
+#include "CpuTopology.hpp"
+
+#include "Common.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <algorithm> // sort
+#include <map>
+#include <unistd.h> // sysconf
+#include <sched.h> // sched_getaffinity
+
+
+namespace {
+
+bool readFile( const std::string &path, std::string &content )
+{
+  std::ifstream file(path.c_str());
+  if ( !file )
+    return false;
+
+  std::getline(file, content);
+  return true;
+}
+
+
+int readInt( const std::string &path, const int fallback )
+{
+  std::string content;
+  if ( !readFile(path, content) || content.empty() )
+    return fallback;
+  return StrToT<int>(content);
+}
+
+
+bool compactLess( const CpuTopology::Cpu &a, const CpuTopology::Cpu &b )
+{
+  if ( a.m_package != b.m_package ) return a.m_package < b.m_package;
+  if ( a.m_core != b.m_core ) return a.m_core < b.m_core;
+  return a.m_id < b.m_id;
+}
+
+} // anonym namespace
+
+
+CpuTopology::CpuTopology()
+  : m_cpus()
+{
+  TRACE;
+
+  std::string online;
+  std::vector<int> ids;
+  if ( readFile("/sys/devices/system/cpu/online", online) ) {
+    ids = parseCpuList(online);
+  } else {
+    const long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    for ( long i = 0; i < (cpus > 0 ? cpus : 1); ++i )
+      ids.push_back(i);
+  }
+
+  // taskset or a cpuset may leave some to others, threads can not be pinned there
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  if ( sched_getaffinity(0, sizeof(allowed), &allowed) == 0 ) {
+    std::vector<int> usable;
+    for ( size_t i = 0; i < ids.size(); ++i )
+      if ( ids[i] < CPU_SETSIZE && CPU_ISSET(ids[i], &allowed) )
+        usable.push_back(ids[i]);
+    if ( !usable.empty() )
+      ids.swap(usable);
+  }
+
+  for ( size_t i = 0; i < ids.size(); ++i ) {
+    const std::string topology = "/sys/devices/system/cpu/cpu" + TToStr(ids[i]) + "/topology/";
+    Cpu cpu = { ids[i],
+                readInt(topology + "core_id", ids[i]),
+                readInt(topology + "physical_package_id", 0),
+                0,
+                0 };
+    m_cpus.push_back(cpu);
+  }
+
+  std::string nodes;
+  if ( readFile("/sys/devices/system/node/online", nodes) ) {
+    const std::vector<int> nodeIds = parseCpuList(nodes);
+    for ( size_t i = 0; i < nodeIds.size(); ++i ) {
+      std::string list;
+      if ( !readFile("/sys/devices/system/node/node" + TToStr(nodeIds[i]) + "/cpulist", list) )
+        continue;
+      const std::vector<int> cpus = parseCpuList(list);
+      for ( size_t j = 0; j < m_cpus.size(); ++j )
+        if ( std::find(cpus.begin(), cpus.end(), m_cpus[j].m_id) != cpus.end() )
+          m_cpus[j].m_node = nodeIds[i];
+    }
+  }
+
+  // number the hyperthreads of each core
+  std::vector<Cpu> sorted = m_cpus;
+  std::sort(sorted.begin(), sorted.end(), compactLess);
+  std::map<int, int> siblingOf;
+  for ( size_t i = 0; i < sorted.size(); ++i ) {
+    const bool sameCore = i > 0 && sorted[i].m_package == sorted[i-1].m_package &&
+                          sorted[i].m_core == sorted[i-1].m_core;
+    siblingOf[sorted[i].m_id] = sameCore ? siblingOf[sorted[i-1].m_id] + 1 : 0;
+  }
+  for ( size_t i = 0; i < m_cpus.size(); ++i )
+    m_cpus[i].m_sibling = siblingOf[m_cpus[i].m_id];
+}
+
+
+const std::vector<CpuTopology::Cpu>& CpuTopology::getCpus() const
+{
+  TRACE;
+  return m_cpus;
+}
+
+
+std::vector<int> CpuTopology::getNodeCpus( const int node ) const
+{
+  TRACE;
+
+  std::vector<int> cpus;
+  for ( size_t i = 0; i < m_cpus.size(); ++i )
+    if ( m_cpus[i].m_node == node )
+      cpus.push_back(m_cpus[i].m_id);
+  return cpus;
+}
+
+
+size_t CpuTopology::getPhysicalCoreCount() const
+{
+  TRACE;
+  return physicalCoreOrder().size();
+}
+
+
+std::vector<int> CpuTopology::compactOrder() const
+{
+  TRACE;
+
+  std::vector<Cpu> sorted = m_cpus;
+  std::sort(sorted.begin(), sorted.end(), compactLess);
+
+  std::vector<int> order;
+  for ( size_t i = 0; i < sorted.size(); ++i )
+    order.push_back(sorted[i].m_id);
+  return order;
+}
+
+
+std::vector<int> CpuTopology::scatterOrder() const
+{
+  TRACE;
+
+  // by sibling, then the n-th core of each package in turn
+  std::vector<Cpu> sorted = m_cpus;
+  std::sort(sorted.begin(), sorted.end(), compactLess);
+
+  std::map<int, int> coresSeen;  // per package
+  std::vector< std::pair< std::pair<int, int>, std::pair<int, int> > > keyed;
+  for ( size_t i = 0; i < sorted.size(); ++i ) {
+    if ( sorted[i].m_sibling == 0 )
+      coresSeen[sorted[i].m_package]++;
+    const int coreRank = coresSeen[sorted[i].m_package] - 1;
+    keyed.push_back(std::make_pair(std::make_pair(sorted[i].m_sibling, coreRank),
+                                   std::make_pair(sorted[i].m_package, sorted[i].m_id)));
+  }
+  std::sort(keyed.begin(), keyed.end());
+
+  std::vector<int> order;
+  for ( size_t i = 0; i < keyed.size(); ++i )
+    order.push_back(keyed[i].second.second);
+  return order;
+}
+
+
+std::vector<int> CpuTopology::physicalCoreOrder() const
+{
+  TRACE;
+
+  const std::vector<int> scatter = scatterOrder();
+  std::vector<int> order;
+  for ( size_t i = 0; i < scatter.size(); ++i )
+    for ( size_t j = 0; j < m_cpus.size(); ++j )
+      if ( m_cpus[j].m_id == scatter[i] && m_cpus[j].m_sibling == 0 )
+        order.push_back(scatter[i]);
+  return order;
+}
+
+
+std::vector<int> CpuTopology::parseCpuList( const std::string &list )
+{
+  TRACE_STATIC;
+
+  std::vector<int> cpus;
+  std::istringstream ss(list);
+  std::string range;
+  while ( std::getline(ss, range, ',') ) {
+    if ( range.empty() )
+      continue;
+    const size_t dash = range.find('-');
+    const int first = StrToT<int>(range.substr(0, dash));
+    const int last = dash == std::string::npos ? first : StrToT<int>(range.substr(dash + 1));
+    for ( int cpu = first; cpu <= last; ++cpu )
+      cpus.push_back(cpu);
+  }
+  return cpus;
+}
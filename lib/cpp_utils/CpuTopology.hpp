@@ -0,0 +1,52 @@
+#ifndef CPU_TOPOLOGY_HPP
+#define CPU_TOPOLOGY_HPP
+
+#include <string>
+#include <vector>
+#include <stddef.h> // size_t
+
+
+/** @brief The online CPUs with their core, package and NUMA node.
+ *
+ * Read from /sys/devices/system at construction, only those in the
+ * affinity mask of the process, as narrowed by taskset or a cpuset.
+ * Without sysfs every CPU is a core of its own, on package and node 0.
+ *
+ * The orders list CPU ids for placing threads one after the other:
+ * compact fills a core's hyperthreads, then the next core of the
+ * package; scatter takes a core of each package in turn, siblings only
+ * after every core got one; physical cores is one CPU of each core.
+ */
+
+class CpuTopology
+{
+public:
+
+  struct Cpu
+  {
+    int m_id;
+    int m_core;     // core_id, unique within the package only
+    int m_package;
+    int m_node;
+    int m_sibling;  // 0 for the first hyperthread of the core
+  };
+
+  CpuTopology();
+
+  const std::vector<Cpu>& getCpus() const;
+  std::vector<int> getNodeCpus( const int node ) const;
+  size_t getPhysicalCoreCount() const;
+
+  std::vector<int> compactOrder() const;
+  std::vector<int> scatterOrder() const;
+  std::vector<int> physicalCoreOrder() const;
+
+  // the "0-3,8,10-11" format of sysfs and taskset
+  static std::vector<int> parseCpuList( const std::string &list );
+
+private:
+
+  std::vector<Cpu> m_cpus;
+};
+
+#endif // CPU_TOPOLOGY_HPP
@@ -0,0 +1,161 @@
+#include "EpochReclaimer.hpp"
+
+#include "ScopedLock.hpp"
+#include "Futex.hpp" // cpuRelax
+#include "Common.hpp"
+
+#include <sched.h> // sched_getcpu, sched_yield
+#include <unistd.h> // sysconf
+
+
+EpochReclaimer::EpochReclaimer( const size_t slots, const size_t batchSize )
+  : m_slotCount(slots)
+  , m_slots(0)
+  , m_epoch(1)
+  , m_batchSize(batchSize)
+  , m_mutex()
+  , m_retired()
+{
+  TRACE;
+
+  if ( m_slotCount == 0 ) {
+    const long cpus = sysconf(_SC_NPROCESSORS_CONF);
+    m_slotCount = 4 * (cpus > 0 ? cpus : 1);
+  }
+  m_slots = new Slot[m_slotCount];
+}
+
+
+EpochReclaimer::~EpochReclaimer()
+{
+  TRACE;
+
+  std::vector<Retired>::iterator it;
+  for ( it = m_retired.begin(); it != m_retired.end(); ++it )
+    it->m_deleter(it->m_object);
+
+  delete[] m_slots;
+}
+
+
+size_t EpochReclaimer::enter()
+{
+  TRACE;
+
+  // start at the CPU's slots, take the first free one
+  const int cpu = sched_getcpu();
+  const size_t first = cpu < 0 ? 0 : (cpu * 4) % m_slotCount;
+
+  for ( size_t i = first, tries = 0; ; i = (i + 1) % m_slotCount, ++tries ) {
+    uint64_t epoch = m_epoch.load(std::memory_order_seq_cst);
+    uint64_t idle = 0;
+    if ( m_slots[i].m_epoch.compare_exchange_strong(idle, epoch) ) {
+
+      // the epoch may have advanced before the store was seen
+      uint64_t current;
+      while ( (current = m_epoch.load(std::memory_order_seq_cst)) != epoch ) {
+        epoch = current;
+        m_slots[i].m_epoch.store(epoch, std::memory_order_seq_cst);
+      }
+      return i;
+    }
+
+    // every slot taken
+    if ( tries >= m_slotCount )
+      tries < 2 * m_slotCount ? cpuRelax() : (void)sched_yield();
+  }
+}
+
+
+void EpochReclaimer::leave( const size_t slot )
+{
+  TRACE;
+  m_slots[slot].m_epoch.store(0, std::memory_order_release);
+}
+
+
+void EpochReclaimer::retire( void *object, void (*deleter)(void*) )
+{
+  TRACE;
+
+  bool full;
+  {
+    ScopedLock sl(m_mutex);
+    const Retired retired = { object, deleter,
+                              m_epoch.load(std::memory_order_seq_cst) };
+    m_retired.push_back(retired);
+    full = m_retired.size() >= m_batchSize;
+  }
+
+  if ( full )
+    reclaim();
+}
+
+
+size_t EpochReclaimer::reclaim()
+{
+  TRACE;
+
+  // twice when no reader is in, so the last batch goes at once
+  if ( tryAdvance() )
+    tryAdvance();
+  return collect(m_epoch.load(std::memory_order_seq_cst));
+}
+
+
+uint64_t EpochReclaimer::getEpoch() const
+{
+  TRACE;
+  return m_epoch.load(std::memory_order_relaxed);
+}
+
+
+size_t EpochReclaimer::getPending() const
+{
+  TRACE;
+  ScopedLock sl(m_mutex);
+  return m_retired.size();
+}
+
+
+bool EpochReclaimer::tryAdvance()
+{
+  TRACE;
+
+  uint64_t epoch = m_epoch.load(std::memory_order_seq_cst);
+  for ( size_t i = 0; i < m_slotCount; ++i ) {
+    const uint64_t slotEpoch = m_slots[i].m_epoch.load(std::memory_order_seq_cst);
+    if ( slotEpoch != 0 && slotEpoch != epoch )
+      return false;
+  }
+
+  return m_epoch.compare_exchange_strong(epoch, epoch + 1);
+}
+
+
+size_t EpochReclaimer::collect( const uint64_t epoch )
+{
+  TRACE;
+
+  // retired in epoch e: readers of e-1 may have seen it, those of e+1 not
+  std::vector<Retired> ready;
+  {
+    ScopedLock sl(m_mutex);
+    std::vector<Retired>::iterator keep = m_retired.begin();
+    std::vector<Retired>::iterator it;
+    for ( it = m_retired.begin(); it != m_retired.end(); ++it ) {
+      if ( it->m_epoch + 2 <= epoch )
+        ready.push_back(*it);
+      else
+        *keep++ = *it;
+    }
+    m_retired.erase(keep, m_retired.end());
+  }
+
+  // outside of the lock, a destructor may retire further ones
+  std::vector<Retired>::iterator it;
+  for ( it = ready.begin(); it != ready.end(); ++it )
+    it->m_deleter(it->m_object);
+
+  return ready.size();
+}
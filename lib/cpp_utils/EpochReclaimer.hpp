@@ -0,0 +1,109 @@
+#ifndef EPOCH_RECLAIMER_HPP
+#define EPOCH_RECLAIMER_HPP
+
+#include "Mutex.hpp"
+
+#include <atomic>
+#include <vector>
+#include <stddef.h> // size_t
+#include <stdint.h> // uint64_t
+
+
+/** @brief Deferred delete of objects other threads may still be reading.
+ *
+ * Readers enter a region before they pick up a shared pointer and leave
+ * it when they are done with it: a store into a slot of their own, like
+ * PerCpuRWLock's readers. An object unlinked from the shared structure is
+ * retired instead of deleted. It is tagged with the global epoch, and
+ * freed once the epoch advanced twice, which needs every reader that was
+ * in a region to leave it.
+ *
+ * enter() returns the slot to be given back to leave(), regions do not
+ * nest. Retired objects are freed in batches, by retire() once there are
+ * batchSize of them or by reclaim(); both outside of a region. A reader
+ * stuck in a region holds back every free, for long-held references see
+ * HazardPointers.
+ */
+
+class EpochReclaimer
+{
+public:
+
+  // 0 for 4 slots per configured CPU
+  EpochReclaimer( const size_t slots = 0, const size_t batchSize = 64 );
+  // frees all retired, no thread may be in a region
+  ~EpochReclaimer();
+
+  size_t enter();
+  void leave( const size_t slot );
+
+  template < typename T >
+  void retire( T *object )
+  {
+    retire(object, &deleteObject<T>);
+  }
+
+  void retire( void *object, void (*deleter)(void*) );
+
+  // returns the number of objects freed
+  size_t reclaim();
+
+  uint64_t getEpoch() const;
+  size_t getPending() const;
+
+private:
+
+  EpochReclaimer(const EpochReclaimer&);
+  EpochReclaimer& operator=(const EpochReclaimer&);
+
+  template < typename T >
+  static void deleteObject( void *object )
+  {
+    delete static_cast<T*>(object);
+  }
+
+  struct Slot
+  {
+    Slot() : m_epoch(0) {}
+
+    std::atomic<uint64_t> m_epoch;  // 0 while outside a region
+    char m_padding[64 - sizeof(std::atomic<uint64_t>)];  // a cache line each
+  };
+
+  struct Retired
+  {
+    void *m_object;
+    void (*m_deleter)(void*);
+    uint64_t m_epoch;
+  };
+
+  bool tryAdvance();
+  size_t collect( const uint64_t epoch );
+
+  size_t m_slotCount;
+  Slot *m_slots;
+  std::atomic<uint64_t> m_epoch;
+  const size_t m_batchSize;
+  mutable Mutex m_mutex;  // for m_retired
+  std::vector<Retired> m_retired;
+};
+
+
+class ScopedEpoch
+{
+public:
+
+  ScopedEpoch( EpochReclaimer& reclaimer )
+    : m_reclaimer(reclaimer), m_slot(reclaimer.enter()) {}
+  ~ScopedEpoch() { m_reclaimer.leave(m_slot); }
+
+private:
+
+  ScopedEpoch(const ScopedEpoch&);
+  ScopedEpoch& operator=(const ScopedEpoch&);
+
+  EpochReclaimer& m_reclaimer;
+  const size_t m_slot;
+};
+
+#endif // EPOCH_RECLAIMER_HPP
@@ -0,0 +1,88 @@
+#include "Event.hpp"
+
+#include "Futex.hpp"
+#include "Common.hpp"
+
+
+Event::Event( const bool autoReset, const bool initiallySet )
+  : m_autoReset( autoReset )
+  , m_state( initiallySet ? 1 : 0 )
+  , m_waiters( 0 )
+{
+  TRACE;
+}
+
+
+Event::~Event( void )
+{
+  TRACE;
+}
+
+
+void Event::set( void )
+{
+  TRACE;
+
+  if ( m_state.exchange(1) == 1 )
+    return;
+
+  if ( m_waiters.load() != 0 )
+    futexWake(&m_state, m_autoReset ? 1 : INT_MAX);
+}
+
+
+void Event::reset( void )
+{
+  TRACE;
+  m_state.store(0);
+}
+
+
+bool Event::isSet( void ) const
+{
+  TRACE;
+  return m_state.load() == 1;
+}
+
+
+bool Event::wait( const long int intervalSec, const long int intervalNSec )
+{
+  TRACE;
+
+  if ( tryConsume() )
+    return true;
+
+  const bool timed = intervalSec != 0 || intervalNSec != 0;
+  const timespec deadline = addTotimespec(intervalSec, intervalNSec, CLOCK_MONOTONIC);
+
+  m_waiters++;
+  bool signaled = false;
+  for (;;) {
+    if ( tryConsume() ) {
+      signaled = true;
+      break;
+    }
+    if ( futexWaitUntil(&m_state, 0, timed ? &deadline : 0) == -1 &&
+         errno == ETIMEDOUT )
+      break;
+  }
+  m_waiters--;
+
+  // an auto reset set() woke only this one, pass it on if it came too late
+  if ( !signaled && m_autoReset && m_state.load() == 1 && m_waiters.load() != 0 )
+    futexWake(&m_state, 1);
+
+  return signaled;
+}
+
+
+bool Event::tryConsume( void )
+{
+  TRACE;
+
+  if ( !m_autoReset )
+    return m_state.load() == 1;
+
+  int expected = 1;
+  return m_state.compare_exchange_strong(expected, 0);
+}
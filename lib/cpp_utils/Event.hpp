@@ -0,0 +1,42 @@
+#ifndef EVENT_HPP
+#define EVENT_HPP
+
+#include <atomic>
+
+
+/** @brief One thread tells others that something happened, on a futex.
+ *
+ * A manual reset event stays set and lets every waiter through until
+ * reset(), an auto reset one lets a single waiter through and is reset by
+ * it. set() on a set event and wait() on a set event make no syscall.
+ * Timed waits run against CLOCK_MONOTONIC, 0 sec and 0 nsec waits forever.
+ */
+
+class Event
+{
+
+public:
+
+  Event( const bool autoReset = false, const bool initiallySet = false );
+  ~Event( void );
+
+  void set( void );
+  void reset( void );
+  bool isSet( void ) const;
+
+  // false on timeout
+  bool wait( const long int intervalSec = 0, const long int intervalNSec = 0 );
+
+private:
+
+  Event(const Event&);
+  Event& operator=(const Event&);
+
+  bool tryConsume( void );
+
+  const bool m_autoReset;
+  std::atomic<int> m_state;    // futex word, 1 if set
+  std::atomic<int> m_waiters;
+};
+
+#endif // EVENT_HPP
@@ -0,0 +1,63 @@
+#ifndef FUTEX_HPP
+#define FUTEX_HPP
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <time.h> // timespec
+#include <climits> // INT_MAX
+
+
+/** @brief Thin wrappers around the futex(2) syscall.
+ *
+ * Private variants are for process-local words, the shared ones work on
+ * words placed into memory mapped by several processes.
+ * futexWait takes a relative interval, futexWaitUntil an absolute deadline.
+ */
+
+inline int futexWait( volatile void *address,
+                      const int expected,
+                      const timespec *timeout = 0,
+                      const bool processPrivate = true )
+{
+  return syscall( SYS_futex, address,
+                  processPrivate ? FUTEX_WAIT_PRIVATE : FUTEX_WAIT,
+                  expected, timeout, 0, 0 );
+}
+
+
+// deadline is absolute, on CLOCK_MONOTONIC, 0 waits without one
+inline int futexWaitUntil( volatile void *address,
+                           const int expected,
+                           const timespec *deadline,
+                           const bool processPrivate = true )
+{
+  return syscall( SYS_futex, address,
+                  processPrivate ? FUTEX_WAIT_BITSET_PRIVATE : FUTEX_WAIT_BITSET,
+                  expected, deadline, 0, FUTEX_BITSET_MATCH_ANY );
+}
+
+
+inline int futexWake( volatile void *address,
+                      const int count = INT_MAX,
+                      const bool processPrivate = true )
+{
+  return syscall( SYS_futex, address,
+                  processPrivate ? FUTEX_WAKE_PRIVATE : FUTEX_WAKE,
+                  count, 0, 0, 0 );
+}
+
+
+// pause instruction, lets the sibling hyperthread run while spinning
+inline void cpuRelax()
+{
+#if defined(__i386__) || defined(__x86_64__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield" ::: "memory");
+#else
+  asm volatile("" ::: "memory");
+#endif
+}
+
+#endif // FUTEX_HPP
@@ -0,0 +1,138 @@
+#include "HazardPointers.hpp"
+
+#include "ScopedLock.hpp"
+#include "Futex.hpp" // cpuRelax
+#include "Common.hpp"
+
+#include <algorithm> // sort, binary_search
+#include <sched.h> // sched_getcpu, sched_yield
+#include <unistd.h> // sysconf
+
+
+HazardPointers::HazardPointers( const size_t slots, const size_t batchSize )
+  : m_slotCount(slots)
+  , m_slots(0)
+  , m_batchSize(batchSize)
+  , m_mutex()
+  , m_retired()
+{
+  TRACE;
+
+  if ( m_slotCount == 0 ) {
+    const long cpus = sysconf(_SC_NPROCESSORS_CONF);
+    m_slotCount = 4 * (cpus > 0 ? cpus : 1);
+  }
+  m_slots = new Slot[m_slotCount];
+}
+
+
+HazardPointers::~HazardPointers()
+{
+  TRACE;
+
+  std::vector<Retired>::iterator it;
+  for ( it = m_retired.begin(); it != m_retired.end(); ++it )
+    it->m_deleter(it->m_object);
+
+  delete[] m_slots;
+}
+
+
+size_t HazardPointers::acquire()
+{
+  TRACE;
+
+  const int cpu = sched_getcpu();
+  const size_t first = cpu < 0 ? 0 : (cpu * 4) % m_slotCount;
+
+  for ( size_t i = first, tries = 0; ; i = (i + 1) % m_slotCount, ++tries ) {
+    bool owned = false;
+    if ( !m_slots[i].m_owned.load(std::memory_order_relaxed) &&
+         m_slots[i].m_owned.compare_exchange_strong(owned, true) )
+      return i;
+
+    // every slot taken
+    if ( tries >= m_slotCount )
+      tries < 2 * m_slotCount ? cpuRelax() : (void)sched_yield();
+  }
+}
+
+
+void HazardPointers::release( const size_t slot )
+{
+  TRACE;
+  m_slots[slot].m_pointer.store(0, std::memory_order_release);
+  m_slots[slot].m_owned.store(false, std::memory_order_release);
+}
+
+
+void HazardPointers::clear( const size_t slot )
+{
+  TRACE;
+  m_slots[slot].m_pointer.store(0, std::memory_order_release);
+}
+
+
+void HazardPointers::retire( void *object, void (*deleter)(void*) )
+{
+  TRACE;
+
+  bool full;
+  {
+    ScopedLock sl(m_mutex);
+    const Retired retired = { object, deleter };
+    m_retired.push_back(retired);
+    full = m_retired.size() >= m_batchSize;
+  }
+
+  if ( full )
+    reclaim();
+}
+
+
+size_t HazardPointers::reclaim()
+{
+  TRACE;
+
+  std::vector<Retired> candidates;
+  {
+    ScopedLock sl(m_mutex);
+    candidates.swap(m_retired);
+  }
+
+  // unlinked before retired, so a reader publishing it after this scan
+  // sees the source changed and retries
+  std::vector<void*> hazards;
+  for ( size_t i = 0; i < m_slotCount; ++i ) {
+    void *pointer = m_slots[i].m_pointer.load(std::memory_order_seq_cst);
+    if ( pointer != 0 )
+      hazards.push_back(pointer);
+  }
+  std::sort(hazards.begin(), hazards.end());
+
+  std::vector<Retired> kept;
+  size_t freed(0);
+  std::vector<Retired>::iterator it;
+  for ( it = candidates.begin(); it != candidates.end(); ++it ) {
+    if ( std::binary_search(hazards.begin(), hazards.end(), it->m_object) ) {
+      kept.push_back(*it);
+    } else {
+      it->m_deleter(it->m_object);
+      ++freed;
+    }
+  }
+
+  if ( !kept.empty() ) {
+    ScopedLock sl(m_mutex);
+    m_retired.insert(m_retired.end(), kept.begin(), kept.end());
+  }
+  return freed;
+}
+
+
+size_t HazardPointers::getPending() const
+{
+  TRACE;
+  ScopedLock sl(m_mutex);
+  return m_retired.size();
+}
@@ -0,0 +1,119 @@
+#ifndef HAZARD_POINTERS_HPP
+#define HAZARD_POINTERS_HPP
+
+#include "Mutex.hpp"
+
+#include <atomic>
+#include <vector>
+#include <stddef.h> // size_t
+
+
+/** @brief Deferred delete, guarding single objects instead of regions.
+ *
+ * A reader takes a hazard slot and publishes the pointer it is about to
+ * use in it with protect(). A retired object is freed only once no slot
+ * holds it, so a reader keeping a reference for long delays that one
+ * object alone, unlike with EpochReclaimer. Protecting costs a store and
+ * a reload of the source per pointer.
+ *
+ * Retired objects are freed in batches, by retire() once there are
+ * batchSize of them or by reclaim().
+ */
+
+class HazardPointers
+{
+public:
+
+  // 0 for 4 slots per configured CPU
+  HazardPointers( const size_t slots = 0, const size_t batchSize = 64 );
+  // frees all retired, no slot may be in use
+  ~HazardPointers();
+
+  size_t acquire();
+  // clears the slot as well
+  void release( const size_t slot );
+
+  // the pointer read from source, kept from being freed until cleared
+  template < typename T >
+  T* protect( const size_t slot, const std::atomic<T*> &source )
+  {
+    T *pointer = source.load(std::memory_order_seq_cst);
+    for (;;) {
+      m_slots[slot].m_pointer.store(pointer, std::memory_order_seq_cst);
+      T *current = source.load(std::memory_order_seq_cst);
+      if ( current == pointer )
+        return pointer;
+      pointer = current;
+    }
+  }
+
+  void clear( const size_t slot );
+
+  template < typename T >
+  void retire( T *object )
+  {
+    retire(object, &deleteObject<T>);
+  }
+
+  void retire( void *object, void (*deleter)(void*) );
+
+  // returns the number of objects freed
+  size_t reclaim();
+
+  size_t getPending() const;
+
+private:
+
+  HazardPointers(const HazardPointers&);
+  HazardPointers& operator=(const HazardPointers&);
+
+  template < typename T >
+  static void deleteObject( void *object )
+  {
+    delete static_cast<T*>(object);
+  }
+
+  struct Slot
+  {
+    Slot() : m_owned(false), m_pointer(0) {}
+
+    std::atomic<bool> m_owned;
+    std::atomic<void*> m_pointer;
+    char m_padding[64 - sizeof(std::atomic<bool>) - sizeof(std::atomic<void*>)];
+  };
+
+  struct Retired
+  {
+    void *m_object;
+    void (*m_deleter)(void*);
+  };
+
+  size_t m_slotCount;
+  Slot *m_slots;
+  const size_t m_batchSize;
+  mutable Mutex m_mutex;  // for m_retired
+  std::vector<Retired> m_retired;
+};
+
+
+class ScopedHazard
+{
+public:
+
+  ScopedHazard( HazardPointers& hazards )
+    : m_hazards(hazards), m_slot(hazards.acquire()) {}
+  ~ScopedHazard() { m_hazards.release(m_slot); }
+
+  template < typename T >
+  T* protect( const std::atomic<T*> &source ) { return m_hazards.protect(m_slot, source); }
+
+private:
+
+  ScopedHazard(const ScopedHazard&);
+  ScopedHazard& operator=(const ScopedHazard&);
+
+  HazardPointers& m_hazards;
+  const size_t m_slot;
+};
+
+#endif // HAZARD_POINTERS_HPP
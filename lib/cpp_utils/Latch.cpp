@@ -0,0 +1,78 @@
+#include "Latch.hpp"
+
+#include "Futex.hpp"
+#include "Common.hpp"
+
+
+Latch::Latch( const int count )
+  : m_count(count)
+  , m_waiters(0)
+{
+  TRACE;
+}
+
+
+Latch::~Latch()
+{
+  TRACE;
+}
+
+
+void Latch::countDown( const int n )
+{
+  TRACE;
+
+  const int count = m_count.fetch_sub(n) - n;
+  if ( count <= 0 && count + n > 0 && m_waiters.load() != 0 )
+    futexWake(&m_count);
+}
+
+
+bool Latch::wait( const long int intervalSec, const long int intervalNSec )
+{
+  TRACE;
+
+  if ( tryWait() )
+    return true;
+
+  const bool timed = intervalSec != 0 || intervalNSec != 0;
+  const timespec deadline = addTotimespec(intervalSec, intervalNSec, CLOCK_MONOTONIC);
+
+  m_waiters++;
+  bool done = false;
+  for (;;) {
+    const int count = m_count.load();
+    if ( count <= 0 ) {
+      done = true;
+      break;
+    }
+    if ( futexWaitUntil(&m_count, count, timed ? &deadline : 0) == -1 &&
+         errno == ETIMEDOUT )
+      break;
+  }
+  m_waiters--;
+  return done;
+}
+
+
+bool Latch::tryWait() const
+{
+  TRACE;
+  return m_count.load() <= 0;
+}
+
+
+void Latch::arriveAndWait()
+{
+  TRACE;
+  countDown();
+  wait();
+}
+
+
+int Latch::getCount() const
+{
+  TRACE;
+  const int count = m_count.load(std::memory_order_relaxed);
+  return count > 0 ? count : 0;
+}
@@ -0,0 +1,38 @@
+#ifndef LATCH_HPP
+#define LATCH_HPP
+
+#include <atomic>
+
+
+/** @brief Single use count down: waiters go once it reached zero.
+ *
+ * The count is a futex word, countDown() makes a syscall only when it
+ * reaches zero while someone waits. Timed waits run against
+ * CLOCK_MONOTONIC, 0 sec and 0 nsec waits forever.
+ */
+
+class Latch
+{
+public:
+
+  Latch( const int count );
+  ~Latch();
+
+  void countDown( const int n = 1 );
+  // false on timeout
+  bool wait( const long int intervalSec = 0, const long int intervalNSec = 0 );
+  bool tryWait() const;
+  void arriveAndWait();
+
+  int getCount() const;
+
+private:
+
+  Latch(const Latch&);
+  Latch& operator=(const Latch&);
+
+  std::atomic<int> m_count;  // futex word
+  std::atomic<int> m_waiters;
+};
+
+#endif // LATCH_HPP
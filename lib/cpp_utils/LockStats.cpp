@@ -0,0 +1,147 @@
+#include "LockStats.hpp"
+
+#include <algorithm> // sort
+#include <vector>
+#include <mutex>
+#include <iomanip>
+
+
+namespace {
+
+// not a Mutex, that would profile itself
+std::mutex& registryMutex()
+{
+  static std::mutex mutex;
+  return mutex;
+}
+
+std::vector<const LockStats*>& registry()
+{
+  static std::vector<const LockStats*> instances;
+  return instances;
+}
+
+bool moreContended( const LockStats *a, const LockStats *b )
+{
+  return a->getContended() > b->getContended();
+}
+
+} // anonym namespace
+
+
+LockStats::LockStats( const std::string &name )
+  : m_name(name)
+  , m_acquisitions(0)
+  , m_contended(0)
+  , m_waitNs(0)
+  , m_holdNs(0)
+  , m_waits()
+{
+  for ( size_t i = 0; i < BUCKETS; ++i )
+    m_waits[i].store(0, std::memory_order_relaxed);
+
+  std::lock_guard<std::mutex> lock(registryMutex());
+  registry().push_back(this);
+}
+
+
+LockStats::~LockStats()
+{
+  std::lock_guard<std::mutex> lock(registryMutex());
+  std::vector<const LockStats*> &instances = registry();
+  instances.erase(std::remove(instances.begin(), instances.end(), this),
+                  instances.end());
+}
+
+
+void LockStats::acquired( const bool contended, const uint64_t waitNs )
+{
+  m_acquisitions.fetch_add(1, std::memory_order_relaxed);
+  if ( !contended )
+    return;
+
+  m_contended.fetch_add(1, std::memory_order_relaxed);
+  m_waitNs.fetch_add(waitNs, std::memory_order_relaxed);
+
+  size_t bucket = waitNs == 0 ? 0 : 63 - __builtin_clzll(waitNs);
+  if ( bucket >= BUCKETS )
+    bucket = BUCKETS - 1;
+  m_waits[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+
+void LockStats::released( const uint64_t holdNs )
+{
+  m_holdNs.fetch_add(holdNs, std::memory_order_relaxed);
+}
+
+
+const std::string& LockStats::getName() const
+{
+  return m_name;
+}
+
+
+uint64_t LockStats::getAcquisitions() const
+{
+  return m_acquisitions.load(std::memory_order_relaxed);
+}
+
+
+uint64_t LockStats::getContended() const
+{
+  return m_contended.load(std::memory_order_relaxed);
+}
+
+
+uint64_t LockStats::getWaitNs() const
+{
+  return m_waitNs.load(std::memory_order_relaxed);
+}
+
+
+uint64_t LockStats::getHoldNs() const
+{
+  return m_holdNs.load(std::memory_order_relaxed);
+}
+
+
+uint64_t LockStats::getWaits( const size_t bucket ) const
+{
+  return bucket < BUCKETS ? m_waits[bucket].load(std::memory_order_relaxed) : 0;
+}
+
+
+void LockStats::report( std::ostream &os, const size_t top )
+{
+  std::lock_guard<std::mutex> lock(registryMutex());
+  std::vector<const LockStats*> sorted(registry());
+  std::sort(sorted.begin(), sorted.end(), moreContended);
+  if ( sorted.size() > top )
+    sorted.resize(top);
+
+  os << std::left << std::setw(24) << "lock"
+     << std::right << std::setw(12) << "acquired"
+     << std::setw(12) << "contended"
+     << std::setw(14) << "avg wait ns"
+     << std::setw(14) << "avg hold ns"
+     << "  waits by ns (2^i:count)" << std::endl;
+
+  std::vector<const LockStats*>::const_iterator it;
+  for ( it = sorted.begin(); it != sorted.end(); ++it ) {
+    const LockStats &stats = **it;
+    const uint64_t acquisitions = stats.getAcquisitions();
+    const uint64_t contended = stats.getContended();
+
+    os << std::left << std::setw(24) << stats.getName()
+       << std::right << std::setw(12) << acquisitions
+       << std::setw(12) << contended
+       << std::setw(14) << (contended ? stats.getWaitNs() / contended : 0)
+       << std::setw(14) << (acquisitions ? stats.getHoldNs() / acquisitions : 0)
+       << " ";
+    for ( size_t i = 0; i < BUCKETS; ++i )
+      if ( stats.getWaits(i) != 0 )
+        os << " " << i << ":" << stats.getWaits(i);
+    os << std::endl;
+  }
+}
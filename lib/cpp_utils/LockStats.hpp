@@ -0,0 +1,54 @@
+#ifndef LOCK_STATS_HPP
+#define LOCK_STATS_HPP
+
+#include <atomic>
+#include <string>
+#include <ostream>
+#include <stddef.h> // size_t
+#include <stdint.h> // uint64_t
+
+
+/** @brief Contention statistics of one lock.
+ *
+ * Counters are atomic, recording costs a clock read and a few relaxed
+ * increments. Every instance is registered, report() lists the most
+ * contended ones of the process. Waits are in a log2 histogram of
+ * nanoseconds: bucket i counts waits in [2^i, 2^(i+1)).
+ */
+
+class LockStats
+{
+public:
+
+  static const size_t BUCKETS = 32;
+
+  LockStats( const std::string &name );
+  ~LockStats();
+
+  void acquired( const bool contended, const uint64_t waitNs );
+  void released( const uint64_t holdNs );
+
+  const std::string& getName() const;
+  uint64_t getAcquisitions() const;
+  uint64_t getContended() const;
+  uint64_t getWaitNs() const;
+  uint64_t getHoldNs() const;
+  uint64_t getWaits( const size_t bucket ) const;
+
+  // the top ones by contended acquisitions
+  static void report( std::ostream &os, const size_t top = 10 );
+
+private:
+
+  LockStats(const LockStats&);
+  LockStats& operator=(const LockStats&);
+
+  const std::string       m_name;
+  std::atomic<uint64_t>   m_acquisitions;
+  std::atomic<uint64_t>   m_contended;
+  std::atomic<uint64_t>   m_waitNs;
+  std::atomic<uint64_t>   m_holdNs;
+  std::atomic<uint64_t>   m_waits[BUCKETS];
+};
+
+#endif // LOCK_STATS_HPP
@@ -1,11 +1,26 @@
 #ifndef MULTITON_H
 #define MULTITON_H
 
+#include "EpochReclaimer.hpp"
+
 #include <map>
+#include <atomic>
+#include <mutex>
 
 // http://stackoverflow.com/questions/2346091/c-templated-class-implementation-of-the-multiton-pattern
 
-/// @note Not thread-safe! Use some concurrent map!
+/** @brief One instance per key, created on the first get.
+ *
+ * Reads take no lock: the instances are in an immutable map, published
+ * atomically. Creation and remove are serialized by a mutex, copy the map
+ * and publish the copy, so exactly one instance is created per key. That
+ * fits registries read often and written rarely.
+ *
+ * Getters look up in an EpochReclaimer region, a replaced map is retired
+ * to it and freed by the create or remove after the last getter on it has
+ * left. destroy() must not run concurrently with getters.
+ * A removed instance is deleted, pointers to it must not be used after.
+ */
 
 template <typename Key, typename T> class Multiton
 {
@@ -18,37 +33,62 @@ public:
 
     static T* getPtr( const Key& key )
     {
-        typename std::map<Key, T*>::const_iterator it = m_instances.find(key);
-
-        if ( it != m_instances.end() ) {
-            return (T*)(it->second);
+        // made before the first map is published
+        EpochReclaimer *reclaimer = m_reclaimer.load(std::memory_order_acquire);
+        if ( reclaimer != 0 ) {
+            ScopedEpoch se(*reclaimer);
+            const Map *instances = m_instances.load(std::memory_order_acquire);
+            if ( instances != 0 ) {
+                typename Map::const_iterator it = instances->find(key);
+                if ( it != instances->end() )
+                    return it->second;
+            }
         }
 
-        T* instance = new T;
-        m_instances[key] = instance;
-        return instance;
+        return create(key);
     }
 
     static bool remove( const Key& key )
     {
-        typename std::map<Key, T*>::const_iterator it = m_instances.find(key);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const Map *instances = m_instances.load(std::memory_order_relaxed);
+        if ( instances == 0 )
+            return false;
 
-        if ( it == m_instances.end() ) {
+        typename Map::const_iterator it = instances->find(key);
+        if ( it == instances->end() )
             return false;
-        }
 
-        delete (*it).second;
-        m_instances.remove(it);
+        T* instance = it->second;
+        Map *next = new Map(*instances);
+        next->erase(key);
+        publish(next);
+        delete instance;
         return true;
     }
 
+    // frees the replaced maps no getter is on, create and remove do it too
+    static void reclaim()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        EpochReclaimer *reclaimer = m_reclaimer.load(std::memory_order_relaxed);
+        if ( reclaimer != 0 )
+            reclaimer->reclaim();
+    }
+
     static void destroy()
     {
-        typename std::map<Key, T*>::const_iterator it;
-        for ( it = m_instances.begin(); it != m_instances.end(); ++it ) {
-            delete (*it).second;
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const Map *instances = m_instances.exchange(0);
+        if ( instances != 0 ) {
+            typename Map::const_iterator it;
+            for ( it = instances->begin(); it != instances->end(); ++it )
+                delete it->second;
+            delete instances;
         }
-        m_instances.clear();
+
+        // frees the retired maps
+        delete m_reclaimer.exchange(0);
     }
 
 protected:
@@ -61,9 +101,47 @@ private:
     Multiton(const Multiton&) {}
     Multiton& operator= (const Multiton&) { return *this; }
 
-    static std::map<Key, T*> m_instances;
+    typedef std::map<Key, T*> Map;
+
+    static T* create( const Key& key )
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // another thread may have created it since the lookup
+        const Map *instances = m_instances.load(std::memory_order_relaxed);
+        if ( instances != 0 ) {
+            typename Map::const_iterator it = instances->find(key);
+            if ( it != instances->end() )
+                return it->second;
+        }
+
+        if ( m_reclaimer.load(std::memory_order_relaxed) == 0 )
+            m_reclaimer.store(new EpochReclaimer(0, 1), std::memory_order_release);
+
+        T* instance = new T;
+        Map *next = instances != 0 ? new Map(*instances) : new Map;
+        (*next)[key] = instance;
+        publish(next);
+        return instance;
+    }
+
+    // with m_mutex held; a batch of one: the copy costs more than the
+    // reclaimer's scan, and the retired maps are bounded by the getters
+    static void publish( const Map *next )
+    {
+        const Map *previous = m_instances.exchange(next, std::memory_order_acq_rel);
+        if ( previous != 0 )
+            m_reclaimer.load(std::memory_order_relaxed)->retire(const_cast<Map*>(previous));
+    }
+
+    static std::atomic<const Map*> m_instances;
+    static std::mutex m_mutex;  // constant initialized, unlike Mutex
+    // made with the first instance, not at static initialization, as Mutex
+    static std::atomic<EpochReclaimer*> m_reclaimer;
 };
 
-template <typename Key, typename T> std::map<Key, T*> Multiton<Key, T>::m_instances;
+template <typename Key, typename T> std::atomic<const std::map<Key, T*>*> Multiton<Key, T>::m_instances(0);
+template <typename Key, typename T> std::mutex Multiton<Key, T>::m_mutex;
+template <typename Key, typename T> std::atomic<EpochReclaimer*> Multiton<Key, T>::m_reclaimer(0);
 
 #endif // MULTITON_H
@@ -1,8 +1,12 @@
 #include "Mutex.hpp"
 
+#include "LockStats.hpp"
+#include "Futex.hpp" // cpuRelax
 #include "Common.hpp"
 
 #include <time.h>
+#include <errno.h> // EBUSY
+#include <unistd.h> // sysconf
 
 namespace {
 
@@ -25,10 +29,13 @@ Mutex::Mutex( MutexType type )
   : m_mutex( MutexCtor( m_mutex ) )
   , m_type( type )
   , m_attr( AttrCtor( m_attr ) )
+  , m_stats( 0 )
+  , m_lockedAt( 0 )
 {
   TRACE;
   if ( (int)type != PTHREAD_MUTEX_DEFAULT ) {
-    pthread_mutexattr_settype( &m_attr, type );
+    // ours spins already, glibc's adaptive one would spin once more
+    pthread_mutexattr_settype( &m_attr, type == Adaptive ? (int)PTHREAD_MUTEX_NORMAL : (int)type );
     pthread_mutex_init( &m_mutex, &m_attr );
   }
 }
@@ -38,19 +45,45 @@ Mutex::~Mutex()
 {
   TRACE;
   pthread_mutex_destroy ( &m_mutex );
+  delete m_stats;
 }
 
 
 int Mutex::lock()
 {
   TRACE;
-  return pthread_mutex_lock( &m_mutex );
+
+  if ( m_stats == 0 ) {
+    if ( m_type == Adaptive && spinLock() )
+      return 0;
+    return pthread_mutex_lock( &m_mutex );
+  }
+
+  int ret = pthread_mutex_trylock( &m_mutex );
+  if ( ret == 0 ) {
+    m_lockedAt = monotonicNs();
+    m_stats->acquired( false, 0 );
+    return 0;
+  }
+
+  const uint64_t start = monotonicNs();
+  ret = m_type == Adaptive && spinLock() ? 0 : pthread_mutex_lock( &m_mutex );
+  if ( ret != 0 )
+    return ret;
+
+  m_lockedAt = monotonicNs();
+  m_stats->acquired( true, m_lockedAt - start );
+  return 0;
 }
 
 
 int Mutex::unlock()
 {
   TRACE;
+
+  if ( m_stats != 0 )
+    m_stats->released( monotonicNs() - m_lockedAt );
+
   return pthread_mutex_unlock ( &m_mutex );
 }
 
@@ -58,10 +91,62 @@ int Mutex::unlock()
 int Mutex::tryLock( const long int intervalSec, const long int intervalNSec )
 {
   TRACE;
-  if ( intervalSec == 0 and intervalNSec == 0 ) {
-    return pthread_mutex_trylock( &m_mutex );
-  } else {
-    timespec tspec = addTotimespec( intervalSec, intervalSec );
-    return pthread_mutex_timedlock( &m_mutex, &tspec );
+  int ret = pthread_mutex_trylock( &m_mutex );
+  if ( ret == 0 ) {
+    if ( m_stats != 0 ) {
+      m_lockedAt = monotonicNs();
+      m_stats->acquired( false, 0 );
+    }
+    return 0;
+  }
+
+  if ( ret != EBUSY || (intervalSec == 0 and intervalNSec == 0) )
+    return ret;
+
+  // a contended wait, as in lock()
+  const uint64_t start = m_stats != 0 ? monotonicNs() : 0;
+  timespec tspec = addTotimespec( intervalSec, intervalNSec );
+  ret = pthread_mutex_timedlock( &m_mutex, &tspec );
+
+  if ( ret == 0 && m_stats != 0 ) {
+    m_lockedAt = monotonicNs();
+    m_stats->acquired( true, m_lockedAt - start );
+  }
+  return ret;
+}
+
+
+void Mutex::enableStats( const std::string &name )
+{
+  TRACE;
+
+  if ( m_stats == 0 )
+    m_stats = new LockStats( name );
+}
+
+
+const LockStats* Mutex::getStats() const
+{
+  TRACE;
+  return m_stats;
+}
+
+
+bool Mutex::spinLock()
+{
+  TRACE;
+
+  // on one CPU the owner can not release it while we spin
+  static const bool multiCpu = sysconf( _SC_NPROCESSORS_ONLN ) > 1;
+  if ( !multiCpu )
+    return false;
+
+  // tried first, a pause is only worth it once it is taken
+  for ( int backoff = 1; backoff <= 1024; backoff <<= 1 ) {
+    if ( pthread_mutex_trylock( &m_mutex ) == 0 )
+      return true;
+    for ( int i = 0; i < backoff; ++i )
+      cpuRelax();
   }
+  return pthread_mutex_trylock( &m_mutex ) == 0;
 }
\ No newline at end of file
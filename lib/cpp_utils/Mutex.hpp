@@ -2,6 +2,10 @@
 #define MUTEX_HPP
 
 #include <pthread.h>
+#include <string>
+#include <stdint.h> // uint64_t
+
+class LockStats;
 
 class Mutex
 {
@@ -12,7 +16,8 @@ public:
     Normal = PTHREAD_MUTEX_NORMAL, // no deadlock check, unlock a non-locked mutex results undefined behaviour
     ErrorCheck = PTHREAD_MUTEX_ERRORCHECK, // error returned when relock or unlocking a non-locked mutex
     Recursive = PTHREAD_MUTEX_RECURSIVE, // Lock counting with error handling.
-    Default = PTHREAD_MUTEX_DEFAULT // equals normal
+    Default = PTHREAD_MUTEX_DEFAULT, // equals normal
+    Adaptive = PTHREAD_MUTEX_ADAPTIVE_NP // spins with backoff before it sleeps, for short critical sections; a normal one underneath
   };
 
   Mutex(MutexType type = Default);
@@ -30,6 +35,12 @@ public:
   int tryLock( const long int intervalSec = 0,
                const long int intervalNSec = 0 );
 
+  // Before the mutex is shared: counts every lock, ScopedLock's as well,
+  // listed under name by LockStats::report. Hold time includes waits on a
+  // ConditionVariable.
+  void enableStats( const std::string &name );
+  const LockStats* getStats() const;
+
 private:
 
   Mutex(const Mutex& m);
@@ -38,6 +49,10 @@ private:
   pthread_mutex_t m_mutex;
   MutexType m_type;
   pthread_mutexattr_t m_attr;
+  LockStats *m_stats;
+  uint64_t m_lockedAt;  // written by the owner only
+
+  bool spinLock();
 };
 
 #endif // MUTEX_HPP
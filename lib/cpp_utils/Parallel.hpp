@@ -0,0 +1,264 @@
+#ifndef PARALLEL_HPP
+#define PARALLEL_HPP
+
+#include "ThreadPool.hpp"
+#include "TaskGroup.hpp"
+#include "Common.hpp"
+
+#include <algorithm> // sort, inplace_merge
+#include <functional> // std::less
+#include <iterator> // iterator_traits
+#include <vector>
+#include <stddef.h> // size_t
+#include <stdint.h> // uint64_t
+
+
+/** @brief Data parallel loops, sort and reductions on a ThreadPool.
+ *
+ * The caller takes part: it runs the first iterations itself, measuring
+ * them, then splits the rest into chunks of about PARALLEL_CHUNK_NS of
+ * work each, but at least four per thread, so uneven iterations still
+ * balance. Chunks are split off the range recursively as tasks of a
+ * TaskGroup, and the caller runs queued tasks until all are done.
+ *
+ * The functors are called concurrently, on a shared instance.
+ * An explicit grain, iterations per chunk, skips the measuring.
+ */
+
+// a chunk is this much work, well above the cost of a task
+const uint64_t PARALLEL_CHUNK_NS = 100 * 1000;
+// the measuring stops after this long
+const uint64_t PARALLEL_SAMPLE_NS = 20 * 1000;
+
+
+inline size_t parallelGrain( const size_t remaining,
+                             const uint64_t iterationNs,
+                             const size_t workers )
+{
+  size_t grain = iterationNs > 0 ? PARALLEL_CHUNK_NS / iterationNs : remaining;
+  const size_t balanced = remaining / (4 * (workers + 1));
+  if ( grain > balanced )
+    grain = balanced;
+  return grain > 0 ? grain : 1;
+}
+
+
+// runs f on the start of [first, last) in doubling batches, returns where
+// it stopped, iterationNs is the measured cost of one
+template < typename Index, typename F >
+Index parallelSample( const Index first, const Index last,
+                      const size_t workers, F &f, uint64_t &iterationNs )
+{
+  // leave the most of it to the others
+  const size_t limit = (last - first) / (8 * (workers + 1));
+
+  const uint64_t start = monotonicNs();
+  uint64_t elapsed(0);
+  Index i = first;
+  for ( size_t batch = 1;
+        (size_t)(i - first) < limit && elapsed < PARALLEL_SAMPLE_NS;
+        batch *= 2 ) {
+    for ( size_t j = 0; j < batch && (size_t)(i - first) < limit; ++j, ++i )
+      f(i);
+    elapsed = monotonicNs() - start;
+  }
+
+  iterationNs = i != first ? elapsed / (i - first) : 0;
+  return i;
+}
+
+
+template < typename Index, typename F >
+class ParallelRangeTask : public Task
+{
+public:
+
+  ParallelRangeTask( TaskGroup &group, const Index begin, const Index end,
+                     const size_t grain, F &f )
+    : m_group(group), m_begin(begin), m_end(end), m_grain(grain), m_f(f) {}
+
+  void run()
+  {
+    TRACE;
+
+    // hand the upper halves to others, keep the lowest chunk
+    Index end = m_end;
+    while ( (size_t)(end - m_begin) > m_grain ) {
+      const Index middle = m_begin + (end - m_begin) / 2;
+      m_group.run(new ParallelRangeTask(m_group, middle, end, m_grain, m_f));
+      end = middle;
+    }
+
+    for ( Index i = m_begin; i < end; ++i )
+      m_f(i);
+  }
+
+private:
+
+  ParallelRangeTask(const ParallelRangeTask&);
+  ParallelRangeTask& operator=(const ParallelRangeTask&);
+
+  TaskGroup &m_group;
+  const Index m_begin;
+  const Index m_end;
+  const size_t m_grain;
+  F &m_f;
+};
+
+
+// f(i) for each i of [first, last)
+template < typename Index, typename F >
+void parallelFor( ThreadPool &pool, Index first, const Index last,
+                  F f, size_t grain = 0 )
+{
+  TRACE_STATIC;
+
+  if ( !(first < last) )
+    return;
+
+  const size_t workers = pool.getWorkerCount();
+  if ( grain == 0 ) {
+    uint64_t iterationNs(0);
+    first = parallelSample(first, last, workers, f, iterationNs);
+    if ( !(first < last) )
+      return;
+    grain = parallelGrain(last - first, iterationNs, workers);
+  }
+
+  TaskGroup group(pool);
+  ParallelRangeTask<Index, F> task(group, first, last, grain, f);
+  task.run();
+  group.wait();
+}
+
+
+// out[i] = f(in[i]), random access iterators
+template < typename InputIterator, typename OutputIterator, typename F >
+void parallelTransform( ThreadPool &pool,
+                        const InputIterator first, const InputIterator last,
+                        const OutputIterator out,
+                        F f, const size_t grain = 0 )
+{
+  TRACE_STATIC;
+
+  parallelFor(pool, (size_t)0, (size_t)(last - first),
+              [&]( const size_t i ) { out[i] = f(first[i]); },
+              grain);
+}
+
+
+/** reduce(... reduce(reduce(identity, map(first)), map(first + 1)) ...)
+ * reduce has to be associative, it need not be commutative: the chunks
+ * are combined in order.
+ */
+template < typename Index, typename T, typename Map, typename Reduce >
+T parallelReduce( ThreadPool &pool, const Index first, const Index last,
+                  const T &identity, Map map, Reduce reduce,
+                  size_t grain = 0 )
+{
+  TRACE_STATIC;
+
+  if ( !(first < last) )
+    return identity;
+
+  const size_t workers = pool.getWorkerCount();
+  T prefix = identity;
+  Index begin = first;
+  if ( grain == 0 ) {
+    uint64_t iterationNs(0);
+    auto accumulate = [&]( const Index i ) { prefix = reduce(prefix, map(i)); };
+    begin = parallelSample(first, last, workers, accumulate, iterationNs);
+    if ( !(begin < last) )
+      return prefix;
+    grain = parallelGrain(last - begin, iterationNs, workers);
+  }
+
+  // fixed chunks, each with its own partial result
+  const size_t length = last - begin;
+  const size_t chunks = (length + grain - 1) / grain;
+  std::vector<T> partials(chunks, identity);
+  parallelFor(pool, (size_t)0, chunks,
+              [&]( const size_t chunk ) {
+                const Index from = begin + chunk * grain;
+                const Index to = chunk + 1 < chunks ? from + grain : last;
+                T partial = identity;
+                for ( Index i = from; i < to; ++i )
+                  partial = reduce(partial, map(i));
+                partials[chunk] = partial;
+              },
+              1);
+
+  T result = prefix;
+  for ( size_t i = 0; i < chunks; ++i )
+    result = reduce(result, partials[i]);
+  return result;
+}
+
+
+template < typename RandomIterator, typename Compare >
+class ParallelSortTask : public Task
+{
+public:
+
+  ParallelSortTask( ThreadPool &pool,
+                    const RandomIterator first, const RandomIterator last,
+                    const size_t cutoff, Compare &compare )
+    : m_pool(pool), m_first(first), m_last(last), m_cutoff(cutoff), m_compare(compare) {}
+
+  void run()
+  {
+    TRACE;
+
+    if ( (size_t)(m_last - m_first) <= m_cutoff ) {
+      std::sort(m_first, m_last, m_compare);
+      return;
+    }
+
+    const RandomIterator middle = m_first + (m_last - m_first) / 2;
+    TaskGroup group(m_pool);
+    group.run(new ParallelSortTask(m_pool, m_first, middle, m_cutoff, m_compare));
+    ParallelSortTask(m_pool, middle, m_last, m_cutoff, m_compare).run();
+    group.wait();
+    std::inplace_merge(m_first, middle, m_last, m_compare);
+  }
+
+private:
+
+  ParallelSortTask(const ParallelSortTask&);
+  ParallelSortTask& operator=(const ParallelSortTask&);
+
+  ThreadPool &m_pool;
+  const RandomIterator m_first;
+  const RandomIterator m_last;
+  const size_t m_cutoff;
+  Compare &m_compare;
+};
+
+
+// merge sort over std::sort-ed pieces, a few per thread; not stable
+template < typename RandomIterator, typename Compare >
+void parallelSort( ThreadPool &pool,
+                   const RandomIterator first, const RandomIterator last,
+                   Compare compare )
+{
+  TRACE_STATIC;
+
+  const size_t workers = pool.getWorkerCount();
+  size_t cutoff = (last - first) / (4 * (workers + 1));
+  if ( cutoff < 4096 )
+    cutoff = 4096;  // below that the merging costs more than it gains
+
+  ParallelSortTask<RandomIterator, Compare>(pool, first, last, cutoff, compare).run();
+}
+
+
+template < typename RandomIterator >
+void parallelSort( ThreadPool &pool,
+                   const RandomIterator first, const RandomIterator last )
+{
+  parallelSort(pool, first, last,
+               std::less<typename std::iterator_traits<RandomIterator>::value_type>());
+}
+
+
+#endif // PARALLEL_HPP
@@ -0,0 +1,89 @@
+#include "PerCpuRWLock.hpp"
+
+#include "Futex.hpp"
+#include "Common.hpp"
+
+#include <sched.h> // sched_getcpu, sched_yield
+#include <unistd.h> // sysconf
+
+
+PerCpuRWLock::PerCpuRWLock( const size_t slots )
+  : m_slotCount(slots)
+  , m_slots(0)
+  , m_writer(0)
+  , m_writerMutex()
+{
+  TRACE;
+
+  if ( m_slotCount == 0 ) {
+    const long cpus = sysconf(_SC_NPROCESSORS_CONF);
+    m_slotCount = cpus > 0 ? cpus : 1;
+  }
+  m_slots = new Slot[m_slotCount];
+}
+
+
+PerCpuRWLock::~PerCpuRWLock()
+{
+  TRACE;
+  delete[] m_slots;
+}
+
+
+size_t PerCpuRWLock::readLock()
+{
+  TRACE;
+
+  while ( true ) {
+    const int cpu = sched_getcpu();
+    const size_t slot = cpu < 0 ? 0 : cpu % m_slotCount;
+    m_slots[slot].m_readers.fetch_add(1, std::memory_order_seq_cst);
+
+    // the writer raises the flag then reads the counters, we do the opposite
+    if ( m_writer.load(std::memory_order_seq_cst) == 0 )
+      return slot;
+
+    m_slots[slot].m_readers.fetch_sub(1, std::memory_order_release);
+    while ( m_writer.load(std::memory_order_acquire) != 0 )
+      futexWait(&m_writer, 1);
+  }
+}
+
+
+void PerCpuRWLock::readUnlock( const size_t slot )
+{
+  TRACE;
+  m_slots[slot].m_readers.fetch_sub(1, std::memory_order_release);
+}
+
+
+void PerCpuRWLock::writeLock()
+{
+  TRACE;
+
+  m_writerMutex.lock();
+  m_writer.store(1, std::memory_order_seq_cst);
+
+  for ( size_t i = 0; i < m_slotCount; ++i )
+    for ( int spins = 0;
+          m_slots[i].m_readers.load(std::memory_order_acquire) != 0;
+          ++spins )
+      spins < 100 ? cpuRelax() : (void)sched_yield();
+}
+
+
+void PerCpuRWLock::writeUnlock()
+{
+  TRACE;
+
+  m_writer.store(0, std::memory_order_release);
+  futexWake(&m_writer);
+  m_writerMutex.unlock();
+}
+
+
+size_t PerCpuRWLock::getSlots() const
+{
+  TRACE;
+  return m_slotCount;
+}
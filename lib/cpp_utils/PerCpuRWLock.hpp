@@ -0,0 +1,90 @@
+#ifndef PER_CPU_RWLOCK_HPP
+#define PER_CPU_RWLOCK_HPP
+
+#include "Mutex.hpp"
+
+#include <atomic>
+#include <stddef.h> // size_t
+
+
+/** @brief Reader-writer lock with a reader counter per CPU.
+ *
+ * A reader only touches the counter of the CPU it runs on, so readers on
+ * different CPUs share no cache line: reads scale with the cores. A
+ * writer is expensive, it raises a flag and waits for every counter to
+ * drain. New readers wait for the writer, it is preferred.
+ *
+ * readLock() returns the slot to be given back to readUnlock(), the
+ * thread may be on another CPU by then.
+ */
+
+class PerCpuRWLock
+{
+public:
+
+  // 0 for as many slots as configured CPUs
+  PerCpuRWLock( const size_t slots = 0 );
+  ~PerCpuRWLock();
+
+  size_t readLock();
+  void readUnlock( const size_t slot );
+
+  void writeLock();
+  void writeUnlock();
+
+  size_t getSlots() const;
+
+private:
+
+  PerCpuRWLock(const PerCpuRWLock&);
+  PerCpuRWLock& operator=(const PerCpuRWLock&);
+
+  struct Slot
+  {
+    Slot() : m_readers(0) {}
+
+    std::atomic<int> m_readers;
+    char m_padding[64 - sizeof(std::atomic<int>)];  // a cache line each
+  };
+
+  size_t m_slotCount;
+  Slot *m_slots;
+  std::atomic<int> m_writer;  // futex word, 1 while a writer is in or waits
+  Mutex m_writerMutex;
+};
+
+
+class ScopedPerCpuReadLock
+{
+public:
+
+  ScopedPerCpuReadLock( PerCpuRWLock& rwLock )
+    : m_rwLock(rwLock), m_slot(rwLock.readLock()) {}
+  ~ScopedPerCpuReadLock() { m_rwLock.readUnlock(m_slot); }
+
+private:
+
+  ScopedPerCpuReadLock(const ScopedPerCpuReadLock&);
+  ScopedPerCpuReadLock& operator=(const ScopedPerCpuReadLock&);
+
+  PerCpuRWLock& m_rwLock;
+  const size_t m_slot;
+};
+
+
+class ScopedPerCpuWriteLock
+{
+public:
+
+  ScopedPerCpuWriteLock( PerCpuRWLock& rwLock ) : m_rwLock(rwLock) { m_rwLock.writeLock(); }
+  ~ScopedPerCpuWriteLock() { m_rwLock.writeUnlock(); }
+
+private:
+
+  ScopedPerCpuWriteLock(const ScopedPerCpuWriteLock&);
+  ScopedPerCpuWriteLock& operator=(const ScopedPerCpuWriteLock&);
+
+  PerCpuRWLock& m_rwLock;
+};
+
+#endif // PER_CPU_RWLOCK_HPP
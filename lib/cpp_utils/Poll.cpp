@@ -14,6 +14,7 @@ Poll::Poll( StreamConnection  *connection,
             const int          timeOut )
   : m_timeOut(timeOut)
   , m_connection(connection)
+  , m_reclaimer(0)
   , m_polling(false)
   , m_connections()
   , m_maxclients(maxClient)
@@ -22,6 +23,13 @@ Poll::Poll( StreamConnection  *connection,
 {
   TRACE;
   m_fds = new pollfd[m_maxclients+1]; // plus the server socket
+
+  // poll() skips negative descriptors
+  for ( nfds_t i = 0; i <= m_maxclients; ++i ) {
+    m_fds[i].fd = -1;
+    m_fds[i].events = 0;
+    m_fds[i].revents = 0;
+  }
   addFd( m_connection->getSocket(), POLLIN | POLLPRI );
 }
 
@@ -57,6 +65,10 @@ void Poll::startPolling()
     }
 
     removeTimeoutedConnections();
+    updateEvents();
+
+    if ( m_reclaimer != 0 )
+      m_reclaimer->reclaim();
 
   } // while
 }
@@ -76,6 +88,13 @@ bool Poll::isPolling() const
 }
 
 
+void Poll::setReclaimer( EpochReclaimer *reclaimer )
+{
+  TRACE;
+  m_reclaimer = reclaimer;
+}
+
+
 void Poll::acceptClient()
 {
   TRACE;
@@ -110,8 +129,28 @@ void Poll::handleClient( const int socket )
     return;
   }
 
-  if (!it->second->receive())
+  if (!it->second->receive()) {
     removeConnection(socket, it);
+    return;
+  }
+
+  // a TLS handshake or a partial write may wait for writability
+  setEvents( socket, it->second->wantsWrite() ? POLLIN | POLLPRI | POLLOUT
+                                              : POLLIN | POLLPRI );
+}
+
+
+void Poll::updateEvents()
+{
+  TRACE;
+
+  // output may be left by other threads too, e.g. TLS crypto tasks
+  for ( nfds_t i = 0; i < m_num_of_fds; ++i ) {
+    ConnectionMap::iterator it = m_connections.find(m_fds[i].fd);
+    if ( it != m_connections.end() )
+      m_fds[i].events = it->second->wantsWrite() ? POLLIN | POLLPRI | POLLOUT
+                                                 : POLLIN | POLLPRI;
+  }
 }
 
 
@@ -142,7 +181,10 @@ Poll::ConnectionMap::iterator Poll::removeConnection(int socket, std::map< int,
   next++;
 
   removeFd(socket);
-  delete it->second;
+  if ( m_reclaimer != 0 )
+    m_reclaimer->retire(it->second);
+  else
+    delete it->second;
   m_connections.erase(it);
 
   return next;
@@ -168,6 +210,18 @@ bool Poll::addFd( const int socket, const short events )
 }
 
 
+void Poll::setEvents( const int socket, const short events )
+{
+  TRACE;
+
+  for ( nfds_t i = 0; i < m_num_of_fds; ++i )
+    if ( m_fds[i].fd == socket ) {
+      m_fds[i].events = events;
+      return;
+    }
+}
+
+
 bool Poll::removeFd( const int socket )
 {
   TRACE;
@@ -185,7 +239,7 @@ bool Poll::removeFd( const int socket )
   for ( ; i < m_maxclients - 1; ++i )
     m_fds[i] = m_fds[i+1] ;
 
-  m_fds[i].fd = 0 ;
+  m_fds[i].fd = -1 ;
   m_fds[i].events = 0 ;
   m_fds[i].revents = 0 ;
   m_num_of_fds--;
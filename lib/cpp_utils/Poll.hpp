@@ -2,6 +2,7 @@
 #define POLL_HPP
 
 #include "StreamConnection.hpp"
+#include "EpochReclaimer.hpp"
 
 #include <poll.h>
 #include <map>
@@ -23,6 +24,10 @@ public:
 
   bool isPolling() const;
 
+  // removed connections are retired instead of deleted, for threads still
+  // using them in an epoch region; the socket closes when they are freed
+  void setReclaimer( EpochReclaimer *reclaimer );
+
 
 protected:
 
@@ -47,10 +52,13 @@ private:
 
   bool addFd( const int socket, const short events );
   bool removeFd( const int socket );
+  void setEvents( const int socket, const short events );
+  void updateEvents();
 
 
   int                m_timeOut;
   StreamConnection  *m_connection;
+  EpochReclaimer    *m_reclaimer;
   volatile bool      m_polling;
   ConnectionMap      m_connections;
 
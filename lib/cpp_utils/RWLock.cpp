@@ -0,0 +1,71 @@
+#include "RWLock.hpp"
+
+#include "Common.hpp"
+
+#include <time.h>
+
+
+RWLock::RWLock()
+  : m_rwLock()
+{
+  TRACE;
+
+  // the default lets a steady stream of readers starve the writers
+  pthread_rwlockattr_t attr;
+  pthread_rwlockattr_init( &attr );
+  pthread_rwlockattr_setkind_np( &attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP );
+  pthread_rwlock_init( &m_rwLock, &attr );
+  pthread_rwlockattr_destroy( &attr );
+}
+
+
+RWLock::~RWLock()
+{
+  TRACE;
+  pthread_rwlock_destroy( &m_rwLock );
+}
+
+
+int RWLock::readLock()
+{
+  TRACE;
+  return pthread_rwlock_rdlock( &m_rwLock );
+}
+
+
+int RWLock::writeLock()
+{
+  TRACE;
+  return pthread_rwlock_wrlock( &m_rwLock );
+}
+
+
+int RWLock::unlock()
+{
+  TRACE;
+  return pthread_rwlock_unlock( &m_rwLock );
+}
+
+
+int RWLock::tryReadLock( const long int intervalSec, const long int intervalNSec )
+{
+  TRACE;
+  if ( intervalSec == 0 and intervalNSec == 0 ) {
+    return pthread_rwlock_tryrdlock( &m_rwLock );
+  } else {
+    timespec tspec = addTotimespec( intervalSec, intervalNSec );
+    return pthread_rwlock_timedrdlock( &m_rwLock, &tspec );
+  }
+}
+
+
+int RWLock::tryWriteLock( const long int intervalSec, const long int intervalNSec )
+{
+  TRACE;
+  if ( intervalSec == 0 and intervalNSec == 0 ) {
+    return pthread_rwlock_trywrlock( &m_rwLock );
+  } else {
+    timespec tspec = addTotimespec( intervalSec, intervalNSec );
+    return pthread_rwlock_timedwrlock( &m_rwLock, &tspec );
+  }
+}
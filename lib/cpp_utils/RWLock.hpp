@@ -0,0 +1,40 @@
+#ifndef RWLOCK_HPP
+#define RWLOCK_HPP
+
+#include <pthread.h>
+
+
+/** @brief Reader-writer lock preferring writers.
+ *
+ * Readers share it, a writer waits only for the readers inside: new
+ * readers queue behind a waiting writer, so read-mostly data can not
+ * starve its updates. Not recursive, a reader must not ask for it again
+ * while a writer waits.
+ */
+
+class RWLock
+{
+public:
+
+  RWLock();
+  ~RWLock();
+
+  int readLock();
+  int writeLock();
+  int unlock();
+
+  // If currently locked, the call shall return immediately.
+  int tryReadLock( const long int intervalSec = 0,
+                   const long int intervalNSec = 0 );
+  int tryWriteLock( const long int intervalSec = 0,
+                    const long int intervalNSec = 0 );
+
+private:
+
+  RWLock(const RWLock&);
+  RWLock& operator=(const RWLock&);
+
+  pthread_rwlock_t m_rwLock;
+};
+
+#endif // RWLOCK_HPP
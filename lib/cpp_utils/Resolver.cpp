@@ -0,0 +1,260 @@
+#include "Resolver.hpp"
+
+#include "WorkerThread.hpp"
+#include "ScopedLock.hpp"
+#include "Logger.hpp"
+#include "Common.hpp"
+
+
+Resolver::CacheEntry::CacheEntry( const Result &result, const time_t expires )
+  : m_result(result)
+  , m_expires(expires)
+{
+}
+
+
+Resolver::Pending::Pending()
+  : m_promise()
+  , m_future(m_promise.get_future().share())
+  , m_callbacks()
+{
+}
+
+
+Resolver::ResolveTask::ResolveTask( Resolver &resolver, const Key &key )
+  : m_resolver(resolver)
+  , m_key(key)
+{
+  TRACE;
+}
+
+
+void Resolver::ResolveTask::run()
+{
+  TRACE;
+
+  Result result(new AddrInfo);
+  if ( result->getHostInfo(m_key.first, m_key.second) )
+    result->printHostDetails();
+  else
+    result.reset();
+
+  m_resolver.complete(m_key, result);
+}
+
+
+Resolver::Resolver( const int numberOfThreads,
+                    const time_t ttlSec,
+                    const time_t negativeTtlSec,
+                    const size_t maxEntries )
+  : m_ttlSec(ttlSec)
+  , m_negativeTtlSec(negativeTtlSec)
+  , m_maxEntries(maxEntries)
+  , m_mutex()
+  , m_cache()
+  , m_pending()
+  , m_pool()
+{
+  TRACE;
+
+  for ( int i = 0; i < numberOfThreads; ++i )
+    m_pool.pushWorkerThread(new WorkerThread(m_pool));
+
+  m_pool.startWorkerThreads();
+}
+
+
+Resolver::~Resolver()
+{
+  TRACE;
+
+  m_pool.stop();
+  m_pool.join();
+
+  // waiters get a broken promise
+  std::map<Key, Pending*>::iterator it;
+  for ( it = m_pending.begin(); it != m_pending.end(); ++it )
+    delete it->second;
+}
+
+
+std::shared_future<Resolver::Result> Resolver::resolve( const std::string host,
+                                                        const std::string port )
+{
+  TRACE;
+
+  const Key key(host, port);
+  ScopedLock sl(m_mutex);
+
+  Result result;
+  if ( findCached(key, result) ) {
+    std::promise<Result> promise;
+    promise.set_value(result);
+    return promise.get_future().share();
+  }
+
+  return startLookup(key)->m_future;
+}
+
+
+void Resolver::resolve( const std::string host,
+                        const std::string port,
+                        Callback callback )
+{
+  TRACE;
+
+  const Key key(host, port);
+  Result result;
+  {
+    ScopedLock sl(m_mutex);
+    if ( !findCached(key, result) ) {
+      startLookup(key)->m_callbacks.push_back(callback);
+      return;
+    }
+  }
+
+  callback(result);
+}
+
+
+Resolver::Result Resolver::lookup( const std::string host,
+                                   const std::string port )
+{
+  TRACE;
+
+  ScopedLock sl(m_mutex);
+  Result result;
+  findCached(Key(host, port), result);
+  return result;
+}
+
+
+void Resolver::invalidate( const std::string host, const std::string port )
+{
+  TRACE;
+
+  ScopedLock sl(m_mutex);
+  m_cache.erase(Key(host, port));
+}
+
+
+void Resolver::clear()
+{
+  TRACE;
+
+  ScopedLock sl(m_mutex);
+  m_cache.clear();
+}
+
+
+size_t Resolver::cacheSize() const
+{
+  TRACE;
+
+  ScopedLock sl(m_mutex);
+  return m_cache.size();
+}
+
+
+Resolver::Pending* Resolver::startLookup( const Key &key )
+{
+  TRACE;
+
+  std::map<Key, Pending*>::iterator it = m_pending.find(key);
+  if ( it != m_pending.end() ) {
+    LOG_BEGIN(Logger::DEBUG)
+      LOG_PROP("Host", key.first)
+      LOG_PROP("Port", key.second)
+    LOG_END("Joining pending lookup.");
+    return it->second;
+  }
+
+  Pending *pending = new Pending;
+  m_pending[key] = pending;
+  m_pool.pushTask(new ResolveTask(*this, key));
+  return pending;
+}
+
+
+bool Resolver::findCached( const Key &key, Result &result )
+{
+  TRACE;
+
+  std::map<Key, CacheEntry>::iterator it = m_cache.find(key);
+  if ( it == m_cache.end() )
+    return false;
+
+  if ( it->second.m_expires <= now() ) {
+    m_cache.erase(it);
+    return false;
+  }
+
+  result = it->second.m_result;
+  return true;
+}
+
+
+void Resolver::complete( const Key &key, const Result &result )
+{
+  TRACE;
+
+  Pending *pending(0);
+  {
+    ScopedLock sl(m_mutex);
+
+    const time_t ttl = result ? m_ttlSec : m_negativeTtlSec;
+    if ( ttl > 0 ) {
+      m_cache.erase(key);
+      m_cache.insert(std::make_pair(key, CacheEntry(result, now() + ttl)));
+      if ( m_cache.size() > m_maxEntries )
+        evict();
+    }
+
+    std::map<Key, Pending*>::iterator it = m_pending.find(key);
+    if ( it == m_pending.end() )
+      return;
+
+    pending = it->second;
+    m_pending.erase(it);
+  }
+
+  pending->m_promise.set_value(result);
+
+  std::vector<Callback>::iterator it;
+  for ( it = pending->m_callbacks.begin(); it != pending->m_callbacks.end(); ++it )
+    (*it)(result);
+
+  delete pending;
+}
+
+
+void Resolver::evict()
+{
+  TRACE;
+
+  // expired ones first, then the ones expiring soonest
+  const time_t current = now();
+  std::map<Key, CacheEntry>::iterator it, oldest = m_cache.end();
+  for ( it = m_cache.begin(); it != m_cache.end(); ) {
+    if ( it->second.m_expires <= current ) {
+      m_cache.erase(it++);
+      continue;
+    }
+    if ( oldest == m_cache.end() || it->second.m_expires < oldest->second.m_expires )
+      oldest = it;
+    ++it;
+  }
+
+  if ( m_cache.size() > m_maxEntries && oldest != m_cache.end() )
+    m_cache.erase(oldest);
+}
+
+
+time_t Resolver::now()
+{
+  TRACE_STATIC;
+
+  timespec ts;
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return ts.tv_sec;
+}
@@ -0,0 +1,106 @@
+#ifndef RESOLVER_HPP
+#define RESOLVER_HPP
+
+#include "AddrInfo.hpp"
+#include "ThreadPool.hpp"
+#include "Mutex.hpp"
+
+#include <string>
+#include <map>
+#include <vector>
+#include <memory> // shared_ptr
+#include <future> // shared_future
+#include <functional>
+#include <time.h> // time_t
+
+
+/** @brief Asynchronous, caching name resolution in front of AddrInfo.
+ *
+ * Lookups run on a small pool of resolver threads. Results are cached for
+ * ttlSec, failures for negativeTtlSec (getaddrinfo does not report the
+ * DNS TTL). Concurrent lookups of the same host and port share one
+ * getaddrinfo call.
+ *
+ * A null Result means the lookup failed. Callbacks run on the caller's
+ * thread on a cache hit, on a resolver thread otherwise.
+ */
+
+class Resolver
+{
+public:
+
+  typedef std::shared_ptr<AddrInfo> Result;
+  typedef std::function<void (const Result&)> Callback;
+
+  Resolver( const int numberOfThreads = 2,
+            const time_t ttlSec = 60,
+            const time_t negativeTtlSec = 5,
+            const size_t maxEntries = 1024 );
+
+  virtual ~Resolver();
+
+  std::shared_future<Result> resolve( const std::string host,
+                                      const std::string port );
+
+  void resolve( const std::string host,
+                const std::string port,
+                Callback callback );
+
+  // cache only, never blocks; null if not cached or expired
+  Result lookup( const std::string host, const std::string port );
+
+  void invalidate( const std::string host, const std::string port );
+  void clear();
+  size_t cacheSize() const;
+
+private:
+
+  Resolver(const Resolver&);
+  Resolver& operator=(const Resolver&);
+
+  typedef std::pair<std::string, std::string> Key;
+
+  struct CacheEntry {
+    CacheEntry( const Result &result, const time_t expires );
+    Result m_result;
+    time_t m_expires;
+  };
+
+  struct Pending {
+    Pending();
+    std::promise<Result> m_promise;
+    std::shared_future<Result> m_future;
+    std::vector<Callback> m_callbacks;
+  };
+
+  class ResolveTask : public Task
+  {
+  public:
+    ResolveTask( Resolver &resolver, const Key &key );
+    void run();
+  private:
+    ResolveTask(const ResolveTask&);
+    ResolveTask& operator=(const ResolveTask&);
+    Resolver &m_resolver;
+    Key m_key;
+  };
+
+  // returns the pending lookup of key, starts one if needed; m_mutex held
+  Pending* startLookup( const Key &key );
+  bool findCached( const Key &key, Result &result );
+  void complete( const Key &key, const Result &result );
+  void evict();
+
+  static time_t now();
+
+  const time_t  m_ttlSec;
+  const time_t  m_negativeTtlSec;
+  const size_t  m_maxEntries;
+
+  mutable Mutex                   m_mutex;
+  std::map<Key, CacheEntry>       m_cache;
+  std::map<Key, Pending*>         m_pending;
+  ThreadPool                      m_pool;
+};
+
+#endif // RESOLVER_HPP
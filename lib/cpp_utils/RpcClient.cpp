@@ -0,0 +1,258 @@
+#include "RpcClient.hpp"
+
+#include "ScopedLock.hpp"
+#include "Logger.hpp"
+
+#include <vector>
+#include <time.h> // clock_gettime
+
+
+RpcClient::RpcClient( StreamConnection  *connection,
+                      RpcMessage        *message,
+                      const int          defaultTimeoutMs )
+  : SocketClient(connection)
+  , TimerUser()
+  , m_connection(connection)
+  , m_defaultTimeoutMs(defaultTimeoutMs)
+  , m_mutex()
+  , m_sendMutex()
+  , m_nextId(1)
+  , m_pending()
+  , m_deadlines()
+  , m_armedDeadline(0)
+{
+  TRACE;
+
+  message->setHandler( [this](Connection*, uint64_t id, const std::string &payload)
+                       { onResponse(id, payload); } );
+}
+
+
+RpcClient::~RpcClient()
+{
+  TRACE;
+  disconnect();
+}
+
+
+void RpcClient::disconnect()
+{
+  TRACE;
+
+  SocketClient::disconnect();
+  failAll(Response::DISCONNECTED);
+}
+
+
+std::shared_future<RpcClient::Response> RpcClient::call( const void   *request,
+                                                          const size_t  length,
+                                                          const int     timeoutMs )
+{
+  TRACE;
+
+  Pending *pending = new Pending;
+  std::shared_future<Response> future = pending->m_promise.get_future().share();
+  sendRequest(pending, request, length, timeoutMs);
+  return future;
+}
+
+
+void RpcClient::call( const void   *request,
+                      const size_t  length,
+                      Callback      callback,
+                      const int     timeoutMs )
+{
+  TRACE;
+
+  Pending *pending = new Pending;
+  pending->m_callback = callback;
+  sendRequest(pending, request, length, timeoutMs);
+}
+
+
+size_t RpcClient::getNumberOfPending() const
+{
+  TRACE;
+
+  ScopedLock sl(m_mutex);
+  return m_pending.size();
+}
+
+
+void RpcClient::timerExpired()
+{
+  TRACE;
+
+  std::vector<Pending*> expired;
+  {
+    ScopedLock sl(m_mutex);
+
+    const uint64_t current = now();
+    while ( !m_deadlines.empty() && m_deadlines.begin()->first <= current ) {
+      std::map<uint64_t, Pending*>::iterator it =
+        m_pending.find(m_deadlines.begin()->second);
+      expired.push_back(it->second);
+      m_pending.erase(it);
+      m_deadlines.erase(m_deadlines.begin());
+    }
+
+    m_armedDeadline = 0;
+    armTimer();
+  }
+
+  if ( !expired.empty() ) {
+    LOG_BEGIN(Logger::DEBUG)
+      LOG_PROP("Host", m_connection->getHost())
+      LOG_PROP("Port", m_connection->getPort())
+      LOG_PROP("Expired", expired.size())
+    LOG_END("Requests timed out.");
+  }
+
+  Response response;
+  response.status = Response::TIMEOUT;
+  std::vector<Pending*>::iterator it;
+  for ( it = expired.begin(); it != expired.end(); ++it )
+    complete(*it, response);
+}
+
+
+void RpcClient::sendRequest( Pending       *pending,
+                             const void    *request,
+                             const size_t   length,
+                             const int      timeoutMs )
+{
+  TRACE;
+
+  uint64_t id;
+  {
+    ScopedLock sl(m_mutex);
+
+    // registered before sending: the response may arrive before send returns
+    id = m_nextId++;
+    pending->m_deadline = now() + (timeoutMs > 0 ? timeoutMs : m_defaultTimeoutMs);
+    m_pending[id] = pending;
+    m_deadlines.insert( std::make_pair(pending->m_deadline, id) );
+    armTimer();
+  }
+
+  const std::string frame = RpcMessage::frame(id, request, length);
+  bool sent;
+  {
+    ScopedLock sl(m_sendMutex);
+    sent = m_connection->send(frame.data(), frame.length());
+  }
+
+  if ( sent )
+    return;
+
+  {
+    ScopedLock sl(m_mutex);
+    std::map<uint64_t, Pending*>::iterator it = m_pending.find(id);
+    if ( it == m_pending.end() )
+      return; // completed meanwhile
+
+    m_deadlines.erase( std::make_pair(pending->m_deadline, id) );
+    m_pending.erase(it);
+  }
+
+  complete(pending, Response());
+}
+
+
+void RpcClient::onResponse( const uint64_t id, const std::string &payload )
+{
+  TRACE;
+
+  Pending *pending(0);
+  {
+    ScopedLock sl(m_mutex);
+    std::map<uint64_t, Pending*>::iterator it = m_pending.find(id);
+    if ( it == m_pending.end() ) {
+      LOG_BEGIN(Logger::DEBUG)
+        LOG_PROP("Id", id)
+      LOG_END("Response to an unknown or expired request.");
+      return;
+    }
+
+    pending = it->second;
+    m_deadlines.erase( std::make_pair(pending->m_deadline, id) );
+    m_pending.erase(it);
+  }
+
+  Response response;
+  response.status = Response::OK;
+  response.payload = payload;
+  complete(pending, response);
+}
+
+
+void RpcClient::connectionClosed()
+{
+  TRACE;
+  failAll(Response::DISCONNECTED);
+}
+
+
+void RpcClient::failAll( const Response::Status status )
+{
+  TRACE;
+
+  std::map<uint64_t, Pending*> pending;
+  {
+    ScopedLock sl(m_mutex);
+    pending.swap(m_pending);
+    m_deadlines.clear();
+    if ( m_armedDeadline != 0 ) {
+      stopTimer();
+      m_armedDeadline = 0;
+    }
+  }
+
+  Response response;
+  response.status = status;
+  std::map<uint64_t, Pending*>::iterator it;
+  for ( it = pending.begin(); it != pending.end(); ++it )
+    complete(it->second, response);
+}
+
+
+void RpcClient::armTimer()
+{
+  TRACE;
+
+  // one timer for the earliest deadline, rearmed when that passes
+  if ( m_deadlines.empty() )
+    return;
+
+  const uint64_t next = m_deadlines.begin()->first;
+  if ( m_armedDeadline != 0 && m_armedDeadline <= next )
+    return;
+
+  const uint64_t current = now();
+  const uint64_t diff = next > current ? next - current : 1; // 0 would disarm
+  if ( startTimer(diff / 1000, (diff % 1000) * 1000000) )
+    m_armedDeadline = next;
+}
+
+
+void RpcClient::complete( Pending *pending, const Response &response )
+{
+  TRACE_STATIC;
+
+  if ( pending->m_callback )
+    pending->m_callback(response);
+  else
+    pending->m_promise.set_value(response);
+
+  delete pending;
+}
+
+
+uint64_t RpcClient::now()
+{
+  TRACE_STATIC;
+
+  timespec ts;
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
@@ -0,0 +1,106 @@
+#ifndef RPC_CLIENT_HPP
+#define RPC_CLIENT_HPP
+
+#include "SocketClient.hpp"
+#include "TimerUser.hpp"
+#include "RpcMessage.hpp"
+#include "Mutex.hpp"
+
+#include <future>
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+#include <stdint.h> // uint64_t
+#include <stddef.h> // size_t
+
+
+/** @brief Pipelined request/response over a SocketClient.
+ *
+ * Every call() gets a correlation id and is framed by RpcMessage, the
+ * peer answers with a frame carrying the same id, in any order. Any number
+ * of calls can be in flight on one connection, each completes exactly once:
+ * with the response, at its deadline or when the connection goes away.
+ *
+ * The connection must use the RpcMessage passed here. Callbacks run on the
+ * poller thread (responses), the timer thread (timeouts) or the caller's
+ * thread (send failure, disconnect), without the client's lock held.
+ */
+
+class RpcClient : public SocketClient
+                , public TimerUser
+{
+public:
+
+  struct Response {
+    enum Status {
+      OK,
+      TIMEOUT,
+      DISCONNECTED
+    };
+
+    Response() : status(DISCONNECTED), payload() {}
+
+    Status      status;
+    std::string payload;
+  };
+
+  typedef std::function<void (const Response&)> Callback;
+
+  RpcClient( StreamConnection  *connection,
+             RpcMessage        *message,
+             const int          defaultTimeoutMs = 5000 );
+
+  virtual ~RpcClient();
+
+  void disconnect();
+
+  // timeoutMs 0 means the default one
+  std::shared_future<Response> call( const void   *request,
+                                     const size_t  length,
+                                     const int     timeoutMs = 0 );
+
+  void call( const void   *request,
+             const size_t  length,
+             Callback      callback,
+             const int     timeoutMs = 0 );
+
+  size_t getNumberOfPending() const;
+
+  void timerExpired();
+
+private:
+
+  RpcClient(const RpcClient&);
+  RpcClient& operator=(const RpcClient&);
+
+  struct Pending {
+    Pending() : m_promise(), m_callback(), m_deadline(0) {}
+
+    std::promise<Response>  m_promise;
+    Callback                m_callback;
+    uint64_t                m_deadline;
+  };
+
+  void sendRequest( Pending *pending, const void *request,
+                    const size_t length, const int timeoutMs );
+  void onResponse( const uint64_t id, const std::string &payload );
+  void connectionClosed();
+  void failAll( const Response::Status status );
+  void armTimer();
+
+  static void complete( Pending *pending, const Response &response );
+  static uint64_t now();
+
+  StreamConnection                    *m_connection;
+  const int                            m_defaultTimeoutMs;
+
+  mutable Mutex                        m_mutex;
+  Mutex                                m_sendMutex;
+  uint64_t                             m_nextId;
+  std::map<uint64_t, Pending*>         m_pending;
+  std::set< std::pair<uint64_t, uint64_t> > m_deadlines;  // deadline, id
+  uint64_t                             m_armedDeadline;
+};
+
+#endif // RPC_CLIENT_HPP
@@ -0,0 +1,126 @@
+#include "RpcMessage.hpp"
+
+#include "Connection.hpp"
+#include "Logger.hpp"
+
+#include <arpa/inet.h> // htonl, ntohl
+#include <endian.h> // htobe64, be64toh
+#include <string.h> // memcpy
+
+
+RpcMessage::RpcMessage( Handler handler, const size_t maxFrameLength )
+  : Message()
+  , m_handler(handler)
+  , m_maxFrameLength(maxFrameLength)
+  , m_id(0)
+  , m_payload()
+{
+  TRACE;
+}
+
+
+Message* RpcMessage::clone()
+{
+  TRACE;
+  return new RpcMessage(m_handler, m_maxFrameLength);
+}
+
+
+bool RpcMessage::buildMessage( const void   *msgPart,
+                               const size_t  msgLen )
+{
+  TRACE;
+
+  m_buffer.append( (const char*)msgPart, msgLen );
+
+  // consume every complete frame, compact the buffer once
+  size_t offset(0);
+  while ( m_buffer.length() - offset >= HEADER_LENGTH ) {
+
+    uint32_t length;
+    uint64_t id;
+    memcpy(&length, m_buffer.data() + offset, sizeof(length));
+    memcpy(&id, m_buffer.data() + offset + sizeof(length), sizeof(id));
+    length = ntohl(length);
+
+    if ( length > m_maxFrameLength ) {
+      LOG_BEGIN(Logger::ERR)
+        LOG_PROP("Length", length)
+        LOG_PROP("Max length", m_maxFrameLength)
+      LOG_END("Frame too long, dropping the connection.");
+      m_buffer.clear();
+      return false;
+    }
+
+    if ( m_buffer.length() - offset < HEADER_LENGTH + length )
+      break;
+
+    m_id = be64toh(id);
+    m_payload.assign(m_buffer, offset + HEADER_LENGTH, length);
+    offset += HEADER_LENGTH + length;
+
+    onMessageReady();
+  }
+
+  m_buffer.erase(0, offset);
+  return true;
+}
+
+
+void RpcMessage::onMessageReady()
+{
+  TRACE;
+
+  if ( m_handler )
+    m_handler(m_connection, m_id, m_payload);
+}
+
+
+void RpcMessage::setHandler( Handler handler )
+{
+  TRACE;
+  m_handler = handler;
+}
+
+
+std::string RpcMessage::frame( const uint64_t  id,
+                               const void     *payload,
+                               const size_t    length )
+{
+  TRACE_STATIC;
+
+  const uint32_t netLength = htonl(length);
+  const uint64_t netId = htobe64(id);
+
+  std::string frame;
+  frame.reserve(HEADER_LENGTH + length);
+  frame.append( (const char*)&netLength, sizeof(netLength) );
+  frame.append( (const char*)&netId, sizeof(netId) );
+  frame.append( (const char*)payload, length );
+  return frame;
+}
+
+
+bool RpcMessage::reply( Connection     *connection,
+                        const uint64_t  id,
+                        const void     *payload,
+                        const size_t    length )
+{
+  TRACE_STATIC;
+
+  const std::string f = frame(id, payload, length);
+  return connection->send(f.data(), f.length());
+}
+
+
+size_t RpcMessage::getExpectedLength()
+{
+  TRACE;
+
+  if ( m_buffer.length() < HEADER_LENGTH )
+    return HEADER_LENGTH;
+
+  uint32_t length;
+  memcpy(&length, m_buffer.data(), sizeof(length));
+  return HEADER_LENGTH + ntohl(length);
+}
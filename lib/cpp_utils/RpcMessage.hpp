@@ -0,0 +1,61 @@
+#ifndef RPC_MESSAGE_HPP
+#define RPC_MESSAGE_HPP
+
+#include "Message.hpp"
+
+#include <functional>
+#include <string>
+#include <stdint.h> // uint32_t, uint64_t
+#include <stddef.h> // size_t
+
+
+/** @brief Length prefixed frames carrying a correlation id.
+ *
+ * Frame: [uint32 payload length][uint64 id][payload], network byte order.
+ * Every complete frame is passed to the handler with the connection it
+ * arrived on, so the same class decodes requests on the server (clones
+ * keep the handler) and responses on the RpcClient side.
+ */
+
+class RpcMessage : public Message
+{
+public:
+
+  typedef std::function<void (Connection*, uint64_t, const std::string&)> Handler;
+
+  static const size_t HEADER_LENGTH = sizeof(uint32_t) + sizeof(uint64_t);
+
+  RpcMessage( Handler handler = Handler(),
+              const size_t maxFrameLength = 16 * 1024 * 1024 );
+
+  Message* clone();
+
+  bool buildMessage( const void   *msgPart,
+                     const size_t  msgLen );
+
+  void onMessageReady();
+
+  void setHandler( Handler handler );
+
+  static std::string frame( const uint64_t  id,
+                            const void     *payload,
+                            const size_t    length );
+
+  static bool reply( Connection     *connection,
+                     const uint64_t  id,
+                     const void     *payload,
+                     const size_t    length );
+
+protected:
+
+  size_t getExpectedLength();
+
+private:
+
+  Handler       m_handler;
+  const size_t  m_maxFrameLength;
+  uint64_t      m_id;
+  std::string   m_payload;
+};
+
+#endif // RPC_MESSAGE_HPP
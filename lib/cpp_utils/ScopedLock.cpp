@@ -14,3 +14,31 @@ ScopedLock::~ScopedLock()
   TRACE;
   m_mutex.unlock();
 }
+
+
+ScopedReadLock::ScopedReadLock( RWLock& rwLock ) : m_rwLock(rwLock)
+{
+  TRACE;
+  m_rwLock.readLock();
+}
+
+
+ScopedReadLock::~ScopedReadLock()
+{
+  TRACE;
+  m_rwLock.unlock();
+}
+
+
+ScopedWriteLock::ScopedWriteLock( RWLock& rwLock ) : m_rwLock(rwLock)
+{
+  TRACE;
+  m_rwLock.writeLock();
+}
+
+
+ScopedWriteLock::~ScopedWriteLock()
+{
+  TRACE;
+  m_rwLock.unlock();
+}
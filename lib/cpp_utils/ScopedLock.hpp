@@ -2,6 +2,7 @@
 #define SCOPEDLOCK_HPP
 
 #include "Mutex.hpp"
+#include "RWLock.hpp"
 
 
 class ScopedLock
@@ -22,4 +23,36 @@ private:
 };
 
 
+class ScopedReadLock
+{
+public:
+
+  ScopedReadLock( RWLock& rwLock );
+  ~ScopedReadLock();
+
+private:
+
+  ScopedReadLock(const ScopedReadLock&);
+  ScopedReadLock& operator=(const ScopedReadLock&);
+
+  RWLock& m_rwLock;
+};
+
+
+class ScopedWriteLock
+{
+public:
+
+  ScopedWriteLock( RWLock& rwLock );
+  ~ScopedWriteLock();
+
+private:
+
+  ScopedWriteLock(const ScopedWriteLock&);
+  ScopedWriteLock& operator=(const ScopedWriteLock&);
+
+  RWLock& m_rwLock;
+};
+
+
 #endif // SCOPEDLOCK_HPP
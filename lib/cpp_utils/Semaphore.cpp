@@ -1,14 +1,14 @@
 #include "Semaphore.hpp"
 
-#include "ScopedLock.hpp"
+#include "Futex.hpp"
 #include "Common.hpp"
 
 
 Semaphore::Semaphore( int maxCount )
   : m_maxCount( maxCount )
   , m_count( maxCount )
-  , m_mutex()
-  , m_condVar(m_mutex)
+  , m_waiters( 0 )
+  , m_batchWaiters( 0 )
 {
   TRACE;
 }
@@ -20,36 +20,99 @@ Semaphore::~Semaphore( void )
 }
 
 
-bool Semaphore::lock( const long int intervalSec, const long int intervalNSec )
+bool Semaphore::acquire( const int n,
+                         const long int intervalSec,
+                         const long int intervalNSec )
 {
   TRACE;
-  ScopedLock sl(m_mutex);
-  if ( m_count == 0 ) {
-    if ( m_condVar.wait( intervalSec, intervalNSec ) != 0 ) {
-      return false;
+
+  if ( tryAcquire(n) )
+    return true;
+
+  const bool timed = intervalSec != 0 || intervalNSec != 0;
+  const timespec deadline = addTotimespec(intervalSec, intervalNSec, CLOCK_MONOTONIC);
+
+  m_waiters++;
+  if ( n > 1 )
+    m_batchWaiters++;
+
+  bool acquired = false;
+  for (;;) {
+    int count = m_count.load();
+    while ( count >= n && !m_count.compare_exchange_weak(count, count - n) )
+      ;
+    if ( count >= n ) {
+      acquired = true;
+      break;
     }
+
+    // returns at once if the count changed since the load
+    if ( futexWaitUntil(&m_count, count, timed ? &deadline : 0) == -1 &&
+         errno == ETIMEDOUT )
+      break;
   }
-  m_count--;
-  return true;
+
+  if ( n > 1 )
+    m_batchWaiters--;
+  m_waiters--;
+
+  // a release may have woken this one just as it timed out, rare enough
+  // to wake all the others
+  if ( !acquired && m_count.load() > 0 && m_waiters.load() != 0 )
+    futexWake(&m_count);
+
+  return acquired;
 }
 
 
-bool Semaphore::unLock( void )
+bool Semaphore::tryAcquire( const int n )
+{
+  TRACE;
+
+  int count = m_count.load(std::memory_order_relaxed);
+  while ( count >= n )
+    if ( m_count.compare_exchange_weak(count, count - n) )
+      return true;
+
+  return false;
+}
+
+
+bool Semaphore::release( const int n )
 {
   TRACE;
-  ScopedLock sc(m_mutex);
-  if ( m_count == m_maxCount ) {
-    return false;
+
+  int count = m_count.load(std::memory_order_relaxed);
+  do {
+    if ( count + n > m_maxCount )
+      return false;
+  } while ( !m_count.compare_exchange_weak(count, count + n) );
+
+  if ( m_waiters.load() != 0 ) {
+    // a woken batch waiter may find too few and sleep again, while a
+    // smaller waiter could have gone on
+    futexWake(&m_count, m_batchWaiters.load() != 0 ? INT_MAX : n);
   }
-  m_count++;
-  m_condVar.signal();
   return true;
 }
 
 
+bool Semaphore::lock( const long int intervalSec, const long int intervalNSec )
+{
+  TRACE;
+  return acquire(1, intervalSec, intervalNSec);
+}
+
+
+bool Semaphore::unLock( void )
+{
+  TRACE;
+  return release(1);
+}
+
+
 int Semaphore::getCount( void ) const
 {
   TRACE;
-  ScopedLock sc(m_mutex);
-  return m_count;
+  return m_count.load(std::memory_order_relaxed);
 }
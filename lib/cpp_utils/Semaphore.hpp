@@ -1,10 +1,17 @@
 #ifndef SEMAPHORE_HPP
 #define SEMAPHORE_HPP
 
-#include "Mutex.hpp"
-#include "ConditionVariable.hpp"
+#include <atomic>
 
 
+/** @brief Counting semaphore on a futex.
+ *
+ * Acquire and release are a compare and swap on the count when nobody
+ * has to wait, the futex syscalls are only made by waiters and by
+ * releases while there are waiters.
+ * Timed waits run against CLOCK_MONOTONIC, 0 sec and 0 nsec waits forever.
+ */
+
 class Semaphore
 {
 
@@ -13,16 +20,26 @@ public:
   Semaphore( int maxCount = 1 );
   ~Semaphore( void );
 
+  bool acquire( const int n = 1,
+                const long int intervalSec = 0,
+                const long int intervalNSec = 0 );
+  bool tryAcquire( const int n = 1 );
+  // false, and nothing released, if it would go above maxCount
+  bool release( const int n = 1 );
+
   bool lock( const long int intervalSec = 0, const long int intervalNSec = 0 );
   bool unLock( void );
   int getCount( void ) const;
 
 private:
 
-  int m_maxCount;
-  int m_count;
-  mutable Mutex m_mutex;
-  ConditionVariable m_condVar;
+  Semaphore(const Semaphore&);
+  Semaphore& operator=(const Semaphore&);
+
+  const int m_maxCount;
+  std::atomic<int> m_count;         // futex word
+  std::atomic<int> m_waiters;
+  std::atomic<int> m_batchWaiters;  // waiting for more than one
 };
 
 #endif // SEMAPHORE_HPP
@@ -0,0 +1,101 @@
+#ifndef SEQLOCK_HPP
+#define SEQLOCK_HPP
+
+#include "Futex.hpp" // cpuRelax
+
+#include <atomic>
+#include <type_traits>
+#include <string.h> // memcpy
+#include <stdint.h> // uint64_t
+
+
+/** @brief Sequence lock around a small trivially copyable value.
+ *
+ * Readers never write shared memory: they copy the value and retry if a
+ * writer was inside meanwhile, so stats or clocks can be read at any rate
+ * without the cache line bouncing between readers. Writers exclude each
+ * other by spinning, keep the value small and the writes short.
+ *
+ * The value is kept in atomic words, a torn copy is never used but is not
+ * a data race either.
+ */
+
+template <typename T>
+class SeqLock
+{
+public:
+
+  static_assert(std::is_trivially_copyable<T>::value,
+                "SeqLock needs a trivially copyable value");
+
+  SeqLock( const T &value = T() )
+    : m_sequence(0)
+    , m_words()
+  {
+    store(value);
+  }
+
+  T read() const
+  {
+    T value;
+    unsigned before, after;
+    do {
+      while ( (before = m_sequence.load(std::memory_order_acquire)) & 1 )
+        cpuRelax();
+
+      uint64_t words[WORDS];
+      for ( size_t i = 0; i < WORDS; ++i )
+        words[i] = m_words[i].load(std::memory_order_relaxed);
+      memcpy(&value, words, sizeof(T));
+
+      // the copy before the second look at the sequence
+      std::atomic_thread_fence(std::memory_order_acquire);
+      after = m_sequence.load(std::memory_order_relaxed);
+    } while ( before != after );
+
+    return value;
+  }
+
+  void write( const T &value )
+  {
+    // odd while writing
+    unsigned sequence = m_sequence.load(std::memory_order_relaxed);
+    while ( (sequence & 1) ||
+            !m_sequence.compare_exchange_weak(sequence, sequence + 1,
+                                              std::memory_order_acquire) ) {
+      cpuRelax();
+      sequence = m_sequence.load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+
+    store(value);
+
+    m_sequence.store(sequence + 2, std::memory_order_release);
+  }
+
+  // of the writes so far, even when nobody writes
+  unsigned getSequence() const
+  {
+    return m_sequence.load(std::memory_order_acquire);
+  }
+
+private:
+
+  SeqLock(const SeqLock&);
+  SeqLock& operator=(const SeqLock&);
+
+  static const size_t WORDS = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+  void store( const T &value )
+  {
+    uint64_t words[WORDS] = {};
+    memcpy(words, &value, sizeof(T));
+    for ( size_t i = 0; i < WORDS; ++i )
+      m_words[i].store(words[i], std::memory_order_relaxed);
+  }
+
+  std::atomic<unsigned> m_sequence;
+  std::atomic<uint64_t> m_words[WORDS];
+};
+
+#endif // SEQLOCK_HPP
@@ -0,0 +1,423 @@
+#include "ShmConnection.hpp"
+
+#include "Logger.hpp"
+#include "Common.hpp"
+#include "Futex.hpp"
+
+#include <atomic>
+
+#include <sys/mman.h> // shm_open, mmap
+#include <sys/stat.h> // fstat
+#include <fcntl.h> // O_CREAT
+#include <unistd.h> // ftruncate, close
+
+
+namespace {
+
+  const uint32_t SHM_MAGIC = 0x53484d31; // "SHM1"
+  const uint32_t WRAP_MARKER = 0xffffffff;
+  const size_t CACHE_LINE = 64;
+  const size_t MIN_RING_SIZE = 4096;
+
+  const uint32_t MIN_SPIN = 16;
+  const uint32_t MAX_SPIN = 16 * 1024;
+
+  // records are [uint32_t length][payload] padded to 8 bytes
+  inline size_t recordLength( const size_t length )
+  {
+    return ( sizeof(uint32_t) + length + 7 ) & ~static_cast<size_t>(7);
+  }
+
+} // anonym namespace
+
+
+// head and tail are free running byte counters, kept on separate lines
+struct ShmConnection::Ring
+{
+  std::atomic<uint64_t> head;
+  char pad0[CACHE_LINE - sizeof(std::atomic<uint64_t>)];
+
+  std::atomic<uint64_t> tail;
+  char pad1[CACHE_LINE - sizeof(std::atomic<uint64_t>)];
+
+  std::atomic<uint32_t> dataSeq;
+  std::atomic<uint32_t> readerWaiting;
+  char pad2[CACHE_LINE - 2 * sizeof(std::atomic<uint32_t>)];
+
+  std::atomic<uint32_t> spaceSeq;
+  std::atomic<uint32_t> writerWaiting;
+  char pad3[CACHE_LINE - 2 * sizeof(std::atomic<uint32_t>)];
+};
+
+
+// creator sends on rings[0], the attached peer on rings[1]
+struct ShmConnection::Segment
+{
+  std::atomic<uint32_t> magic;
+  uint32_t ringSize;
+  std::atomic<uint32_t> closed;
+  char pad[CACHE_LINE - 3 * sizeof(uint32_t)];
+
+  Ring rings[2];
+};
+
+
+ShmConnection::ShmConnection ( const std::string   name,
+                               Message            *message,
+                               const size_t        ringSize )
+  : Connection(name, "")
+  , m_message(message)
+  , m_ringSize(MIN_RING_SIZE)
+  , m_segment(0)
+  , m_segmentSize(0)
+  , m_txRing(0)
+  , m_rxRing(0)
+  , m_txData(0)
+  , m_rxData(0)
+  , m_creator(false)
+  , m_sendSpinLimit(MIN_SPIN)
+  , m_receiveSpinLimit(MIN_SPIN)
+{
+  TRACE;
+
+  // power of two, so positions are simple masks
+  while ( m_ringSize < ringSize )
+    m_ringSize <<= 1;
+
+  m_message->setConnection(this);
+}
+
+
+ShmConnection::~ShmConnection()
+{
+  TRACE;
+  disconnect();
+}
+
+
+Connection* ShmConnection::clone(const int)
+{
+  TRACE;
+  LOG( Logger::ERR, "Shared memory connections cannot be cloned.");
+  return 0;
+}
+
+
+bool ShmConnection::bind()
+{
+  TRACE;
+
+  if ( m_segment != 0 ) {
+    LOG(Logger::ERR, "Connection is open already.");
+    return false;
+  }
+
+  int fd = shm_open(m_host.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+  if ( fd == -1 ) {
+    LOG_BEGIN(Logger::ERR)
+      LOG_PROP("Name", m_host)
+      LOG_PROP("Error message", strerror(errno))
+    LOG_END("Could not create shared memory object.");
+    return false;
+  }
+
+  const size_t segmentSize = sizeof(Segment) + 2 * m_ringSize;
+  if ( ftruncate(fd, segmentSize) == -1 || !mapSegment(fd, segmentSize) ) {
+    LOG_BEGIN(Logger::ERR)
+      LOG_PROP("Name", m_host)
+      LOG_PROP("Error message", strerror(errno))
+    LOG_END("Could not size shared memory object.");
+    close(fd);
+    shm_unlink(m_host.c_str());
+    return false;
+  }
+  close(fd);
+
+  // ftruncate zero fills, only the size and the magic needs to be set
+  m_creator = true;
+  m_segment->ringSize = m_ringSize;
+  m_txRing = &m_segment->rings[0];
+  m_rxRing = &m_segment->rings[1];
+  m_txData = reinterpret_cast<char*>(m_segment + 1);
+  m_rxData = m_txData + m_ringSize;
+  m_segment->magic.store(SHM_MAGIC, std::memory_order_release);
+
+  LOG_BEGIN(Logger::INFO)
+    LOG_PROP("Name", m_host)
+    LOG_PROP("Ring size", m_ringSize)
+  LOG_END("Shared memory segment created.");
+  return true;
+}
+
+
+bool ShmConnection::connect()
+{
+  TRACE;
+
+  if ( m_segment != 0 ) {
+    LOG(Logger::ERR, "Connection is open already.");
+    return false;
+  }
+
+  int fd = shm_open(m_host.c_str(), O_RDWR, 0600);
+  if ( fd == -1 ) {
+    LOG_BEGIN(Logger::ERR)
+      LOG_PROP("Name", m_host)
+      LOG_PROP("Error message", strerror(errno))
+    LOG_END("Could not open shared memory object.");
+    return false;
+  }
+
+  struct stat status;
+  if ( fstat(fd, &status) == -1 ||
+       (size_t)status.st_size < sizeof(Segment) ||
+       !mapSegment(fd, status.st_size) ) {
+    LOG(Logger::ERR, "Invalid shared memory object.");
+    close(fd);
+    return false;
+  }
+  close(fd);
+
+  if ( m_segment->magic.load(std::memory_order_acquire) != SHM_MAGIC ||
+       sizeof(Segment) + 2 * (size_t)m_segment->ringSize != m_segmentSize ) {
+    LOG(Logger::ERR, "Shared memory segment is not initialized.");
+    unmapSegment();
+    return false;
+  }
+
+  m_creator = false;
+  m_ringSize = m_segment->ringSize;
+  m_txRing = &m_segment->rings[1];
+  m_rxRing = &m_segment->rings[0];
+  m_rxData = reinterpret_cast<char*>(m_segment + 1);
+  m_txData = m_rxData + m_ringSize;
+
+  LOG_BEGIN(Logger::INFO)
+    LOG_PROP("Name", m_host)
+    LOG_PROP("Ring size", m_ringSize)
+  LOG_END("Attached to shared memory segment.");
+  return true;
+}
+
+
+bool ShmConnection::disconnect()
+{
+  TRACE;
+
+  if ( m_segment == 0 )
+    return false;
+
+  m_segment->closed.store(1, std::memory_order_seq_cst);
+  for ( int i = 0; i < 2; ++i ) {
+    m_segment->rings[i].dataSeq.fetch_add(1);
+    futexWake(&m_segment->rings[i].dataSeq, INT_MAX, false);
+    m_segment->rings[i].spaceSeq.fetch_add(1);
+    futexWake(&m_segment->rings[i].spaceSeq, INT_MAX, false);
+  }
+
+  unmapSegment();
+
+  if ( m_creator )
+    shm_unlink(m_host.c_str());
+
+  return true;
+}
+
+
+bool ShmConnection::send( const void* message, const size_t length )
+{
+  TRACE;
+
+  if ( closed() )
+    return false;
+
+  if ( length > getMaxMessageLength() ) {
+    LOG_BEGIN(Logger::ERR)
+      LOG_PROP("Length", length)
+      LOG_PROP("Max length", getMaxMessageLength())
+    LOG_END("Message does not fit into the ring.");
+    return false;
+  }
+
+  const size_t record = recordLength(length);
+  uint64_t head = m_txRing->head.load(std::memory_order_relaxed);
+  size_t position = head & (m_ringSize - 1);
+  const size_t contiguous = m_ringSize - position;
+
+  // records never wrap, the rest of the ring is skipped instead
+  const size_t needed = record <= contiguous ? record : contiguous + record;
+  if ( !waitFor(m_txRing, false, needed) )
+    return false;
+
+  if ( record > contiguous ) {
+    memcpy(m_txData + position, &WRAP_MARKER, sizeof(uint32_t));
+    head += contiguous;
+    position = 0;
+  }
+
+  const uint32_t length32 = length;
+  memcpy(m_txData + position, &length32, sizeof(uint32_t));
+  memcpy(m_txData + position + sizeof(uint32_t), message, length);
+
+  m_txRing->head.store(head + record, std::memory_order_seq_cst);
+  wakeUp(m_txRing, true);
+  return true;
+}
+
+
+bool ShmConnection::receive()
+{
+  TRACE;
+
+  if ( m_segment == 0 )
+    return false;
+
+  if ( !waitFor(m_rxRing, true, 1) )
+    return false;
+
+  uint64_t tail = m_rxRing->tail.load(std::memory_order_relaxed);
+  const uint64_t head = m_rxRing->head.load(std::memory_order_acquire);
+
+  bool retVal = true;
+  while ( tail != head ) {
+
+    const size_t position = tail & (m_ringSize - 1);
+    uint32_t length;
+    memcpy(&length, m_rxData + position, sizeof(uint32_t));
+
+    if ( length == WRAP_MARKER ) {
+      tail += m_ringSize - position;
+      continue;
+    }
+
+    if ( !m_message->buildMessage(m_rxData + position + sizeof(uint32_t), length) )
+      retVal = false;
+
+    // release the space per message, so a blocked writer can go on
+    tail += recordLength(length);
+    m_rxRing->tail.store(tail, std::memory_order_seq_cst);
+    wakeUp(m_rxRing, false);
+  }
+
+  return retVal;
+}
+
+
+int ShmConnection::getSocket() const
+{
+  TRACE;
+  return -1;
+}
+
+
+bool ShmConnection::closed() const
+{
+  TRACE;
+  return m_segment == 0 || peerClosed();
+}
+
+
+size_t ShmConnection::getMaxMessageLength() const
+{
+  TRACE;
+  return m_ringSize / 2 - sizeof(uint32_t);
+}
+
+
+bool ShmConnection::mapSegment( const int fd, const size_t segmentSize )
+{
+  TRACE;
+
+  void *address = mmap(0, segmentSize, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, fd, 0);
+  if ( address == MAP_FAILED ) {
+    LOG_BEGIN(Logger::ERR)
+      LOG_PROP("Error message", strerror(errno))
+    LOG_END("Could not map shared memory.");
+    return false;
+  }
+
+  m_segment = static_cast<Segment*>(address);
+  m_segmentSize = segmentSize;
+  return true;
+}
+
+
+void ShmConnection::unmapSegment()
+{
+  TRACE;
+
+  munmap(m_segment, m_segmentSize);
+  m_segment = 0;
+  m_segmentSize = 0;
+  m_txRing = m_rxRing = 0;
+  m_txData = m_rxData = 0;
+}
+
+
+bool ShmConnection::waitFor( Ring *ring, const bool forData, const size_t bytes )
+{
+  TRACE;
+
+  std::atomic<uint32_t> &sequence = forData ? ring->dataSeq : ring->spaceSeq;
+  std::atomic<uint32_t> &waiting = forData ? ring->readerWaiting
+                                           : ring->writerWaiting;
+  uint32_t &spinLimit = forData ? m_receiveSpinLimit : m_sendSpinLimit;
+  uint32_t spins = 0;
+  while ( true ) {
+
+    const uint64_t used = ring->head.load(std::memory_order_seq_cst) -
+                          ring->tail.load(std::memory_order_seq_cst);
+    if ( forData ? used >= bytes : m_ringSize - used >= bytes ) {
+      // the peer was quick enough: worth spinning longer next time
+      if ( spins > 0 && spinLimit < MAX_SPIN )
+        spinLimit <<= 1;
+      return true;
+    }
+
+    if ( peerClosed() )
+      return false;
+
+    if ( spins < spinLimit ) {
+      ++spins;
+      cpuRelax();
+      continue;
+    }
+
+    // park: announce, then re-check before sleeping, so wakeUp can't be lost
+    waiting.store(1, std::memory_order_seq_cst);
+    const uint32_t seq = sequence.load(std::memory_order_seq_cst);
+    const uint64_t usedNow = ring->head.load(std::memory_order_seq_cst) -
+                             ring->tail.load(std::memory_order_seq_cst);
+    const bool ready = forData ? usedNow >= bytes : m_ringSize - usedNow >= bytes;
+    if ( !ready && !peerClosed() )
+      futexWait(&sequence, seq, 0, false);
+    waiting.store(0, std::memory_order_relaxed);
+
+    if ( spinLimit > MIN_SPIN )
+      spinLimit >>= 1;
+    spins = 0;
+  }
+}
+
+
+void ShmConnection::wakeUp( Ring *ring, const bool forData )
+{
+  TRACE;
+
+  std::atomic<uint32_t> &sequence = forData ? ring->dataSeq : ring->spaceSeq;
+  std::atomic<uint32_t> &waiting = forData ? ring->readerWaiting
+                                           : ring->writerWaiting;
+
+  if ( waiting.load(std::memory_order_seq_cst) ) {
+    sequence.fetch_add(1, std::memory_order_seq_cst);
+    futexWake(&sequence, 1, false);
+  }
+}
+
+
+bool ShmConnection::peerClosed() const
+{
+  TRACE;
+  return m_segment->closed.load(std::memory_order_acquire) != 0;
+}
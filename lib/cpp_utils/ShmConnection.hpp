@@ -0,0 +1,83 @@
+#ifndef SHM_CONNECTION_HPP
+#define SHM_CONNECTION_HPP
+
+
+#include "Connection.hpp"
+#include "Message.hpp"
+
+#include <string>
+#include <stdint.h> // uint32_t
+
+
+/** @brief Point-to-point connection over a POSIX shared memory segment.
+ *
+ * The segment holds two single-producer/single-consumer rings, one per
+ * direction. The host is the shm object name ("/name"), the port is unused.
+ * One side creates the segment with bind(), the other attaches with connect().
+ *
+ * receive() hands the messages to Message::buildMessage() straight from the
+ * shared memory: the buffer is only valid until buildMessage() returns.
+ *
+ * Waiting readers/writers spin adaptively, then sleep on a shared futex.
+ * There is no file descriptor to poll: getSocket() returns -1 and clone()
+ * is not supported.
+ */
+
+class ShmConnection : public Connection
+{
+public:
+
+  ShmConnection ( const std::string   name,
+                  Message            *message,
+                  const size_t        ringSize = 1024 * 1024 );
+
+  virtual ~ShmConnection();
+
+  Connection* clone(const int socket);
+
+  // creates the segment
+  bool bind();
+  // attaches to a segment created by the peer's bind()
+  bool connect();
+  bool disconnect();
+
+  bool send( const void* message, const size_t length );
+
+  // blocks until there is data, delivers all pending messages
+  bool receive();
+
+  int getSocket() const;
+
+  bool closed() const;
+  size_t getMaxMessageLength() const;
+
+private:
+
+  struct Ring;
+  struct Segment;
+
+  ShmConnection(const ShmConnection&);
+  ShmConnection& operator=(const ShmConnection&);
+
+  bool mapSegment( const int fd, const size_t segmentSize );
+  void unmapSegment();
+  bool waitFor( Ring *ring, const bool forData, const size_t bytes );
+  void wakeUp( Ring *ring, const bool forData );
+  bool peerClosed() const;
+
+  Message   *m_message;
+  size_t     m_ringSize;
+  Segment   *m_segment;
+  size_t     m_segmentSize;
+  Ring      *m_txRing;
+  Ring      *m_rxRing;
+  char      *m_txData;
+  char      *m_rxData;
+  bool       m_creator;
+  // one per direction, a thread may send while another receives
+  uint32_t   m_sendSpinLimit;
+  uint32_t   m_receiveSpinLimit;
+};
+
+
+#endif // SHM_CONNECTION_HPP
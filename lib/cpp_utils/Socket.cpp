@@ -8,9 +8,12 @@
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <arpa/inet.h> // inet_ntop
+#include <sys/un.h> // sockaddr_un
+#include <stddef.h> // offsetof
 #include <sys/select.h>
 
 #include <unistd.h>
+#include <fcntl.h> // fcntl
 
 #include <string.h> // strerror
 #include <errno.h> // errno
@@ -84,7 +87,15 @@ bool Socket::connect(struct addrinfo *servinfo)
   if (servinfo == 0)
     return false;
 
-  if (::connect(m_socket, servinfo->ai_addr, servinfo->ai_addrlen) == -1) {
+  return connect(servinfo->ai_addr, servinfo->ai_addrlen);
+}
+
+
+bool Socket::connect(const sockaddr *address, const socklen_t addressLength)
+{
+  TRACE;
+
+  if (::connect(m_socket, address, addressLength) == -1) {
     LOG_BEGIN(Logger::ERR)
       LOG_PROP("Error message", strerror(errno))
     LOG_END("Could not connect to peer.");
@@ -94,6 +105,66 @@ bool Socket::connect(struct addrinfo *servinfo)
 }
 
 
+bool Socket::startConnect( const sockaddr *address,
+                           const socklen_t addressLength,
+                           bool &inProgress )
+{
+  TRACE;
+
+  inProgress = false;
+  if (::connect(m_socket, address, addressLength) == 0)
+    return true;
+
+  if (errno == EINPROGRESS) {
+    inProgress = true;
+    return true;
+  }
+
+  LOG_BEGIN(Logger::ERR)
+    LOG_PROP("Error message", strerror(errno))
+  LOG_END("Could not connect to peer.");
+  return false;
+}
+
+
+bool Socket::finishConnect()
+{
+  TRACE;
+
+  int error(0);
+  socklen_t length = sizeof(error);
+  if (getsockopt(m_socket, SOL_SOCKET, SO_ERROR, &error, &length) == -1)
+    error = errno;
+
+  if (error != 0) {
+    LOG_BEGIN(Logger::ERR)
+      LOG_PROP("Error message", strerror(error))
+    LOG_END("Could not connect to peer.");
+    return false;
+  }
+  return true;
+}
+
+
+bool Socket::setNonBlocking( const bool nonBlocking )
+{
+  TRACE;
+
+  int flags = fcntl(m_socket, F_GETFL, 0);
+  if (flags != -1)
+    flags = fcntl(m_socket, F_SETFL,
+                  nonBlocking ? flags | O_NONBLOCK : flags & ~O_NONBLOCK);
+
+  if (flags == -1) {
+    LOG_BEGIN(Logger::ERR)
+      LOG_PROP("Error message", strerror(errno))
+    LOG_END("Could not change blocking mode of socket.");
+    return false;
+  }
+  return true;
+}
+
+
 bool Socket::bind(struct addrinfo *servinfo )
 {
   TRACE;
@@ -101,8 +172,16 @@ bool Socket::bind(struct addrinfo *servinfo )
   if (servinfo == 0)
     return false;
 
+  return bind(servinfo->ai_addr, servinfo->ai_addrlen);
+}
+
+
+bool Socket::bind(const sockaddr *address, const socklen_t addressLength)
+{
+  TRACE;
+
   /// @bug Not error message on quick re-bind error.
-  if (::bind(m_socket, servinfo->ai_addr, servinfo->ai_addrlen) == -1) {
+  if (::bind(m_socket, address, addressLength) == -1) {
     LOG_BEGIN(Logger::ERR)
       LOG_PROP("Error message", strerror(errno))
     LOG_END("Could not bind name to socket.");
@@ -129,10 +208,10 @@ bool Socket::listen(const int maxPendingQueueLen)
 bool Socket::accept(int& client_socket)
 {
   TRACE;
-  sockaddr clientAddr;
+  sockaddr_storage clientAddr;
   socklen_t clientAddrLen = sizeof(clientAddr);
 
-  client_socket = ::accept( m_socket, &clientAddr, &clientAddrLen ) ;
+  client_socket = ::accept( m_socket, (sockaddr*)&clientAddr, &clientAddrLen ) ;
   if ( client_socket == -1 ) {
     LOG_BEGIN(Logger::ERR)
       LOG_PROP("Error message", strerror(errno))
@@ -172,19 +251,98 @@ bool Socket::receive( void *buffer, const int bufferLen, ssize_t *msgLen )
 }
 
 
+bool Socket::sendMsg( const msghdr *message )
+{
+  TRACE;
+
+  if ( ::sendmsg(m_socket, message, MSG_NOSIGNAL) == -1 ) {
+    LOG_BEGIN(Logger::ERR)
+      LOG_PROP("Error message", strerror(errno))
+    LOG_END("Could not send message to socket.");
+    return false;
+  }
+  return true;
+}
+
+
+bool Socket::receiveMsg( msghdr *message, ssize_t *msgLen )
+{
+  TRACE;
+
+  *msgLen = recvmsg(m_socket, message, MSG_CMSG_CLOEXEC);
+  if (*msgLen == -1) {
+    LOG_BEGIN(Logger::ERR)
+      LOG_PROP("Error message", strerror(errno))
+    LOG_END("Could not read from socket.");
+    return false;
+  }
+  return true;
+}
+
+
+bool Socket::setOption( const SocketOptions::Option option, const int value )
+{
+  TRACE;
+  return SocketOptions::setOption(m_socket, option, value);
+}
+
+
+bool Socket::getOption( const SocketOptions::Option option, int &value ) const
+{
+  TRACE;
+  return SocketOptions::getOption(m_socket, option, value);
+}
+
+
+bool Socket::setOptions( const SocketOptions &options )
+{
+  TRACE;
+  return options.apply(m_socket);
+}
+
+
 void Socket::getPeerName( std::string &host,
                           std::string &port )
 {
   TRACE;
 
-  struct sockaddr_in  address ;
+  sockaddr_storage address;
   memset(&address, 0, sizeof(address));
   socklen_t addressLength = sizeof(address) ;
   getpeername( m_socket, (struct sockaddr*)&address, &addressLength ) ;
 
-  char tmp[INET_ADDRSTRLEN];
-  host = inet_ntop(AF_INET, &address.sin_addr, tmp, INET_ADDRSTRLEN);
-  port = TToStr(address.sin_port);
+  switch ( address.ss_family ) {
+    case AF_INET : {
+      const sockaddr_in *ipv4 = (const sockaddr_in *)&address;
+      char tmp[INET_ADDRSTRLEN];
+      host = inet_ntop(AF_INET, &ipv4->sin_addr, tmp, INET_ADDRSTRLEN);
+      port = TToStr(ntohs(ipv4->sin_port));
+      break;
+    }
+    case AF_INET6 : {
+      const sockaddr_in6 *ipv6 = (const sockaddr_in6 *)&address;
+      char tmp[INET6_ADDRSTRLEN];
+      host = inet_ntop(AF_INET6, &ipv6->sin6_addr, tmp, INET6_ADDRSTRLEN);
+      port = TToStr(ntohs(ipv6->sin6_port));
+      break;
+    }
+    case AF_UNIX : {
+      // unnamed peers (the usual client side) have no path at all
+      const sockaddr_un *local = (const sockaddr_un *)&address;
+      const size_t pathLength = addressLength - offsetof(sockaddr_un, sun_path);
+      if ( addressLength <= offsetof(sockaddr_un, sun_path) )
+        host.clear();
+      else if ( local->sun_path[0] == '\0' ) // abstract namespace
+        host = std::string("@").append(local->sun_path + 1, pathLength - 1);
+      else
+        host = local->sun_path;
+      port.clear();
+      break;
+    }
+    default :
+      host.clear();
+      port.clear();
+  }
 }
 
 
@@ -5,6 +5,8 @@
 #include <sys/socket.h>
 #include <netdb.h>
 
+#include "SocketOptions.hpp"
+
 #include <string>
 
 class Socket
@@ -23,13 +25,30 @@ public:
   bool closeSocket();
 
   bool connect(addrinfo *servinfo);
+  bool connect(const sockaddr *address, const socklen_t addressLength);
+  // inProgress is set if the connection completes asynchronously
+  bool startConnect( const sockaddr *address,
+                     const socklen_t addressLength,
+                     bool &inProgress );
+  bool finishConnect();
+  bool setNonBlocking( const bool nonBlocking = true );
+
   bool bind(addrinfo *servinfo);
+  bool bind(const sockaddr *address, const socklen_t addressLength);
   bool listen( const int maxPendingQueueLen = 64 );
   bool accept( int& client_socket );
 
   bool send( const void *message, const int lenght );
   bool receive ( void* buffer, const int bufferLen, ssize_t *msgLen );
 
+  // scatter/gather & ancillary data (SCM_RIGHTS) variants
+  bool sendMsg( const msghdr *message );
+  bool receiveMsg( msghdr *message, ssize_t *msgLen );
+
+  bool setOption( const SocketOptions::Option option, const int value );
+  bool getOption( const SocketOptions::Option option, int &value ) const;
+  bool setOptions( const SocketOptions &options );
+
   void getPeerName(std::string &host, std::string &port);
   int getSocket() const;
 
@@ -5,8 +5,10 @@
 
 // PollerThread
 
+// only the own socket is polled, with a short timeout: disconnect() waits
+// for the poller to notice the stop
 SocketClient::PollerThread::PollerThread( SocketClient* data )
-  : Poll(data->m_connection)
+  : Poll(data->m_connection, 1, 100)
   , m_tcpClient(data)
 {
   TRACE;
@@ -25,8 +27,11 @@ void SocketClient::PollerThread::acceptClient()
 {
   TRACE;
 
-  m_tcpClient->m_connection->receive();
+  if ( m_tcpClient->m_connection->receive() )
+    return;
+
   stopPolling();
+  m_tcpClient->connectionClosed();
 }
 
 
@@ -35,6 +40,7 @@ void SocketClient::PollerThread::handleClient( const int )
   TRACE;
   LOG( Logger::DEBUG, "Server closed the connection." );
   stopPolling();
+  m_tcpClient->connectionClosed();
 }
 
 
@@ -54,12 +54,17 @@ public:
   virtual ~SocketClient();
 
   bool connect();
-  void disconnect();
+  virtual void disconnect();
 
   bool send( const void* msg, const size_t msgLen );
 
   bool isPolling() const;
 
+protected:
+
+  // called from the poller thread when the peer closed the connection
+  virtual void connectionClosed() {}
+
 private:
 
   SocketClient(const SocketClient& );
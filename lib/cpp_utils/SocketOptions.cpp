@@ -0,0 +1,188 @@
+#include "SocketOptions.hpp"
+
+#include "Logger.hpp"
+#include "Common.hpp"
+
+#include <sys/socket.h>
+#include <netinet/in.h> // IPPROTO_TCP
+#include <netinet/tcp.h> // TCP_NODELAY
+
+#ifndef SO_BUSY_POLL
+#define SO_BUSY_POLL 46
+#endif
+
+#ifndef TCP_NOTSENT_LOWAT
+#define TCP_NOTSENT_LOWAT 25
+#endif
+
+
+namespace {
+
+  struct OptionDescriptor {
+    int level;
+    int name;
+    const char *text;
+  };
+
+  // indexed by SocketOptions::Option
+  const OptionDescriptor descriptors[] = {
+    { IPPROTO_TCP, TCP_NODELAY,       "TCP_NODELAY" },
+    { IPPROTO_TCP, TCP_QUICKACK,      "TCP_QUICKACK" },
+    { IPPROTO_TCP, TCP_CORK,          "TCP_CORK" },
+    { SOL_SOCKET,  SO_SNDBUF,         "SO_SNDBUF" },
+    { SOL_SOCKET,  SO_RCVBUF,         "SO_RCVBUF" },
+    { SOL_SOCKET,  SO_KEEPALIVE,      "SO_KEEPALIVE" },
+    { IPPROTO_TCP, TCP_KEEPIDLE,      "TCP_KEEPIDLE" },
+    { IPPROTO_TCP, TCP_KEEPINTVL,     "TCP_KEEPINTVL" },
+    { IPPROTO_TCP, TCP_KEEPCNT,       "TCP_KEEPCNT" },
+    { SOL_SOCKET,  SO_BUSY_POLL,      "SO_BUSY_POLL" },
+    { IPPROTO_TCP, TCP_NOTSENT_LOWAT, "TCP_NOTSENT_LOWAT" },
+    { SOL_SOCKET,  SO_REUSEADDR,      "SO_REUSEADDR" },
+    { SOL_SOCKET,  SO_REUSEPORT,      "SO_REUSEPORT" }
+  };
+
+} // anonym namespace
+
+
+SocketOptions::SocketOptions()
+  : m_options()
+{
+  TRACE;
+}
+
+
+SocketOptions& SocketOptions::set( const Option option, const int value )
+{
+  TRACE;
+  m_options[option] = value;
+  return *this;
+}
+
+
+bool SocketOptions::unset( const Option option )
+{
+  TRACE;
+  return m_options.erase(option) > 0;
+}
+
+
+bool SocketOptions::get( const Option option, int &value ) const
+{
+  TRACE;
+
+  std::map<Option, int>::const_iterator it = m_options.find(option);
+  if ( it == m_options.end() )
+    return false;
+
+  value = it->second;
+  return true;
+}
+
+
+bool SocketOptions::empty() const
+{
+  TRACE;
+  return m_options.empty();
+}
+
+
+SocketOptions& SocketOptions::merge( const SocketOptions &other )
+{
+  TRACE;
+
+  std::map<Option, int>::const_iterator it;
+  for ( it = other.m_options.begin(); it != other.m_options.end(); ++it )
+    m_options[it->first] = it->second;
+
+  return *this;
+}
+
+
+bool SocketOptions::apply( const int socket ) const
+{
+  TRACE;
+
+  bool retVal = true;
+  std::map<Option, int>::const_iterator it;
+  for ( it = m_options.begin(); it != m_options.end(); ++it )
+    if ( !setOption(socket, it->first, it->second) )
+      retVal = false;
+
+  return retVal;
+}
+
+
+bool SocketOptions::setOption( const int socket,
+                               const Option option,
+                               const int value )
+{
+  TRACE_STATIC;
+
+  const OptionDescriptor &d = descriptors[option];
+  if ( setsockopt(socket, d.level, d.name, &value, sizeof(value)) == -1 ) {
+    LOG_BEGIN(Logger::WARNING)
+      LOG_PROP("Option", d.text)
+      LOG_PROP("Value", value)
+      LOG_PROP("Socket", socket)
+      LOG_PROP("Error message", strerror(errno))
+    LOG_END_STATIC("Could not set socket option.");
+    return false;
+  }
+  return true;
+}
+
+
+bool SocketOptions::getOption( const int socket,
+                               const Option option,
+                               int &value )
+{
+  TRACE_STATIC;
+
+  const OptionDescriptor &d = descriptors[option];
+  socklen_t length = sizeof(value);
+  if ( getsockopt(socket, d.level, d.name, &value, &length) == -1 ) {
+    LOG_BEGIN(Logger::WARNING)
+      LOG_PROP("Option", d.text)
+      LOG_PROP("Socket", socket)
+      LOG_PROP("Error message", strerror(errno))
+    LOG_END_STATIC("Could not get socket option.");
+    return false;
+  }
+  return true;
+}
+
+
+const char* SocketOptions::optionName( const Option option )
+{
+  TRACE_STATIC;
+  return descriptors[option].text;
+}
+
+
+SocketOptions SocketOptions::lowLatency()
+{
+  TRACE_STATIC;
+
+  SocketOptions options;
+  options.set(NoDelay, 1)
+         .set(QuickAck, 1)
+         .set(NotSentLowAt, 16 * 1024);
+  return options;
+}
+
+
+SocketOptions SocketOptions::bulk()
+{
+  TRACE_STATIC;
+
+  // fixed buffers turn off the kernel's autotuning for these sockets
+  SocketOptions options;
+  options.set(NoDelay, 0)
+         .set(SendBuffer, 4 * 1024 * 1024)
+         .set(ReceiveBuffer, 4 * 1024 * 1024)
+         .set(KeepAlive, 1)
+         .set(KeepIdle, 60)
+         .set(KeepInterval, 10)
+         .set(KeepCount, 6);
+  return options;
+}
@@ -0,0 +1,66 @@
+#ifndef SOCKET_OPTIONS_HPP
+#define SOCKET_OPTIONS_HPP
+
+#include <map>
+
+
+/** @brief Typed set of socket options, applied in one go.
+ *
+ * Boolean options take 0/1, sizes are in bytes, times as the kernel
+ * expects them: KeepIdle/KeepInterval in sec, BusyPoll in usec.
+ *
+ * @note QuickAck is not permanent, the kernel may leave quick ack mode.
+ * @note ReuseAddress/ReusePort have to be set before bind.
+ */
+
+class SocketOptions
+{
+public:
+
+  enum Option {
+    NoDelay,        // TCP_NODELAY
+    QuickAck,       // TCP_QUICKACK
+    Cork,           // TCP_CORK
+    SendBuffer,     // SO_SNDBUF
+    ReceiveBuffer,  // SO_RCVBUF
+    KeepAlive,      // SO_KEEPALIVE
+    KeepIdle,       // TCP_KEEPIDLE
+    KeepInterval,   // TCP_KEEPINTVL
+    KeepCount,      // TCP_KEEPCNT
+    BusyPoll,       // SO_BUSY_POLL
+    NotSentLowAt,   // TCP_NOTSENT_LOWAT
+    ReuseAddress,   // SO_REUSEADDR
+    ReusePort       // SO_REUSEPORT
+  };
+
+  SocketOptions();
+
+  // returns *this, so calls can be chained
+  SocketOptions& set( const Option option, const int value );
+  bool unset( const Option option );
+  bool get( const Option option, int &value ) const;
+  bool empty() const;
+
+  // later values override the ones in this
+  SocketOptions& merge( const SocketOptions &other );
+
+  // tries all of them, false if any failed
+  bool apply( const int socket ) const;
+
+  static bool setOption( const int socket, const Option option, const int value );
+  static bool getOption( const int socket, const Option option, int &value );
+  static const char* optionName( const Option option );
+
+  // interactive traffic: small messages, no batching delays
+  static SocketOptions lowLatency();
+
+  // large transfers: big fixed buffers, keepalive on long lived connections
+  static SocketOptions bulk();
+
+private:
+
+  std::map<Option, int> m_options;
+};
+
+
+#endif // SOCKET_OPTIONS_HPP
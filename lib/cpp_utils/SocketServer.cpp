@@ -5,9 +5,10 @@
 
 SocketServer::SocketServer ( StreamConnection  *connection,
                              const int          maxClients,
-                             const int          maxPendingQueueLen )
+                             const int          maxPendingQueueLen,
+                             const int          pollTimeOut )
   : m_connection(connection)
-  , m_poll( m_connection, maxClients)
+  , m_poll( m_connection, maxClients, pollTimeOut)
   , m_maxPendingQueueLen(maxPendingQueueLen)
 {
   TRACE;
@@ -41,3 +42,10 @@ void SocketServer::stop()
   TRACE;
   m_poll.stopPolling();
 }
+
+
+void SocketServer::setReclaimer( EpochReclaimer *reclaimer )
+{
+  TRACE;
+  m_poll.setReclaimer(reclaimer);
+}
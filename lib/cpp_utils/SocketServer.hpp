@@ -11,13 +11,17 @@ public:
 
   SocketServer ( StreamConnection  *connection,
                  const int          maxClients = 5,
-                 const int          maxPendingQueueLen = 10 );
+                 const int          maxPendingQueueLen = 10,
+                 const int          pollTimeOut = 10 * 1000 ); // stop() latency
 
   virtual ~SocketServer();
 
   bool start();
   void stop();
 
+  // before start(), see Poll::setReclaimer
+  void setReclaimer( EpochReclaimer *reclaimer );
+
 
 private:
 
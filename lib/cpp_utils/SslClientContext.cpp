@@ -0,0 +1,235 @@
+#include "SslClientContext.hpp"
+
+#include "ScopedLock.hpp"
+#include "Logger.hpp"
+
+#include <time.h> // time
+
+
+SslClientContext::SslClientContext( const size_t maxEntries )
+  : m_maxEntries(maxEntries)
+  , m_sslContext(0)
+  , m_mutex()
+  , m_sessions()
+  , m_hits(0)
+  , m_misses(0)
+{
+  TRACE;
+
+  m_sslContext = SSL_CTX_new(SSLv23_client_method());
+  if ( m_sslContext == 0 ) {
+    LOG( Logger::ERR, "Creating SSL client context failed." );
+    return;
+  }
+
+  SSL_CTX_set_options(m_sslContext, SSL_OP_NO_SSLv2);
+  SSL_CTX_set_options(m_sslContext, SSL_OP_NO_SSLv3);
+  SSL_CTX_set_options(m_sslContext, SSL_OP_NO_TLSv1);
+  SSL_CTX_set_options(m_sslContext, SSL_OP_NO_TLSv1_1);
+
+  SSL_CTX_set_ex_data(m_sslContext, contextIndex(), this);
+
+  // the internal store would be keyed by session id, not by peer
+  SSL_CTX_set_session_cache_mode(m_sslContext, SSL_SESS_CACHE_CLIENT |
+                                               SSL_SESS_CACHE_NO_INTERNAL_STORE);
+  SSL_CTX_sess_set_new_cb(m_sslContext, newSessionCallback);
+}
+
+
+SslClientContext::~SslClientContext()
+{
+  TRACE;
+
+  clear();
+  if ( m_sslContext != 0 )
+    SSL_CTX_free(m_sslContext);
+}
+
+
+SSL_CTX* SslClientContext::getContext() const
+{
+  TRACE;
+
+  return m_sslContext;
+}
+
+
+SSL* SslClientContext::newHandle( const std::string &host, const std::string &port )
+{
+  TRACE;
+
+  if ( m_sslContext == 0 )
+    return 0;
+
+  // before the handle, so its key gets freed with it
+  const int index = keyIndex();
+  SSL *ssl = SSL_new(m_sslContext);
+  if ( ssl == 0 ) {
+    LOG( Logger::ERR, "Creating SSL structure for connection failed." );
+    return 0;
+  }
+
+  const std::string key = host + ":" + port;
+  SSL_set_ex_data(ssl, index, new std::string(key));
+  SSL_set_tlsext_host_name(ssl, host.c_str());
+
+  SSL_SESSION *session = find(key);
+  if ( session != 0 ) {
+    SSL_set_session(ssl, session);
+    SSL_SESSION_free(session);
+  }
+
+  return ssl;
+}
+
+
+void SslClientContext::clear()
+{
+  TRACE;
+
+  ScopedLock sl(m_mutex);
+  std::map<std::string, SSL_SESSION*>::iterator it;
+  for ( it = m_sessions.begin(); it != m_sessions.end(); ++it )
+    SSL_SESSION_free(it->second);
+  m_sessions.clear();
+}
+
+
+size_t SslClientContext::size() const
+{
+  TRACE;
+
+  ScopedLock sl(m_mutex);
+  return m_sessions.size();
+}
+
+
+unsigned long SslClientContext::getHits() const
+{
+  TRACE;
+
+  ScopedLock sl(m_mutex);
+  return m_hits;
+}
+
+
+unsigned long SslClientContext::getMisses() const
+{
+  TRACE;
+
+  ScopedLock sl(m_mutex);
+  return m_misses;
+}
+
+
+void SslClientContext::store( const std::string &key, SSL_SESSION *session )
+{
+  TRACE;
+
+  ScopedLock sl(m_mutex);
+  std::map<std::string, SSL_SESSION*>::iterator it = m_sessions.find(key);
+  if ( it != m_sessions.end() ) {
+    SSL_SESSION_free(it->second);
+    it->second = session;
+    return;
+  }
+
+  if ( m_sessions.size() >= m_maxEntries )
+    evict();
+
+  if ( m_sessions.size() >= m_maxEntries ) {
+    LOG( Logger::DEBUG, "Client session cache is full." );
+    SSL_SESSION_free(session);
+    return;
+  }
+
+  m_sessions[key] = session;
+}
+
+
+SSL_SESSION* SslClientContext::find( const std::string &key )
+{
+  TRACE;
+
+  ScopedLock sl(m_mutex);
+  std::map<std::string, SSL_SESSION*>::iterator it = m_sessions.find(key);
+  if ( it == m_sessions.end() ) {
+    m_misses++;
+    return 0;
+  }
+
+  SSL_SESSION *session = it->second;
+  if ( SSL_SESSION_get_time(session) + SSL_SESSION_get_timeout(session) <= time(0) ) {
+    SSL_SESSION_free(session);
+    m_sessions.erase(it);
+    m_misses++;
+    return 0;
+  }
+
+  m_hits++;
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L
+  SSL_SESSION_up_ref(session);
+#else
+  CRYPTO_add(&session->references, 1, CRYPTO_LOCK_SSL_SESSION);
+#endif
+  return session;
+}
+
+
+void SslClientContext::evict()
+{
+  TRACE;
+
+  const long current = time(0);
+  std::map<std::string, SSL_SESSION*>::iterator it = m_sessions.begin();
+  while ( it != m_sessions.end() ) {
+    if ( SSL_SESSION_get_time(it->second) + SSL_SESSION_get_timeout(it->second) <= current ) {
+      SSL_SESSION_free(it->second);
+      m_sessions.erase(it++);
+    } else {
+      ++it;
+    }
+  }
+}
+
+
+int SslClientContext::contextIndex()
+{
+  TRACE_STATIC;
+
+  static const int index = SSL_CTX_get_ex_new_index(0, 0, 0, 0, 0);
+  return index;
+}
+
+
+int SslClientContext::keyIndex()
+{
+  TRACE_STATIC;
+
+  static const int index = SSL_get_ex_new_index(0, 0, 0, 0, freeKey);
+  return index;
+}
+
+
+int SslClientContext::newSessionCallback( SSL *ssl, SSL_SESSION *session )
+{
+  TRACE_STATIC;
+
+  SslClientContext *context = static_cast<SslClientContext*>(
+    SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl), contextIndex()) );
+  const std::string *key = static_cast<const std::string*>(
+    SSL_get_ex_data(ssl, keyIndex()) );
+  if ( context == 0 || key == 0 )
+    return 0;
+
+  context->store(*key, session);
+  return 1; // keeping the reference
+}
+
+
+void SslClientContext::freeKey( void*, void *ptr, CRYPTO_EX_DATA*, int, long, void* )
+{
+  TRACE_STATIC;
+
+  delete static_cast<std::string*>(ptr);
+}
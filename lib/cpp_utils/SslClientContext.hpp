@@ -0,0 +1,69 @@
+#ifndef SSL_CLIENT_CONTEXT_HPP
+#define SSL_CLIENT_CONTEXT_HPP
+
+#include "Mutex.hpp"
+
+#include <map>
+#include <string>
+#include <stddef.h> // size_t
+
+#include <openssl/ssl.h>
+
+
+/** @brief Client side SSL_CTX shared by connections, with their sessions.
+ *
+ * SslConnection::initClientContext creates a new context per connection,
+ * so every connect is a full handshake. Connections using one instance
+ * share its context, and the last session received from a host:port is
+ * offered on the next connect to it: reconnects and new pooled connections
+ * resume. With TLS 1.3 the session arrives after the handshake, it is
+ * picked up whenever the connection reads.
+ *
+ * Must outlive the connections using it.
+ */
+
+class SslClientContext
+{
+public:
+
+  SslClientContext( const size_t maxEntries = 1024 );
+
+  virtual ~SslClientContext();
+
+  // not 0 if construction succeeded
+  SSL_CTX* getContext() const;
+
+  // with the cached session of host:port set, if any
+  SSL* newHandle( const std::string &host, const std::string &port );
+
+  void clear();
+
+  size_t size() const;
+  unsigned long getHits() const;
+  unsigned long getMisses() const;
+
+private:
+
+  SslClientContext(const SslClientContext&);
+  SslClientContext& operator=(const SslClientContext&);
+
+  void store( const std::string &key, SSL_SESSION *session );
+  SSL_SESSION* find( const std::string &key );
+  void evict();
+
+  static int contextIndex();
+  static int keyIndex();
+  static int newSessionCallback( SSL *ssl, SSL_SESSION *session );
+  static void freeKey( void *parent, void *ptr, CRYPTO_EX_DATA *ad,
+                       int index, long argl, void *argp );
+
+  const size_t                          m_maxEntries;
+  SSL_CTX                              *m_sslContext;
+
+  mutable Mutex                         m_mutex;
+  std::map<std::string, SSL_SESSION*>   m_sessions;  // host:port, last one
+  unsigned long                         m_hits;
+  unsigned long                         m_misses;
+};
+
+#endif // SSL_CLIENT_CONTEXT_HPP
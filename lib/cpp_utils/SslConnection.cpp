@@ -2,11 +2,56 @@
 
 #include "Logger.hpp"
 #include "Common.hpp"
+#include "ScopedLock.hpp"
 
 #include <openssl/rand.h>
 #include <openssl/ssl.h>
 #include <openssl/err.h>
 
+#include <fcntl.h>
+#include <unistd.h> // pread
+#include <sys/uio.h> // writev
+#include <sys/socket.h> // recv, send, shutdown
+#include <errno.h>
+
+#include <algorithm> // min
+#include <vector>
+
+
+namespace {
+
+void upRef( SSL_CTX *context )
+{
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L
+  SSL_CTX_up_ref(context);
+#else
+  CRYPTO_add(&context->references, 1, CRYPTO_LOCK_SSL_CTX);
+#endif
+}
+
+bool setNonBlockingSocket( const int socket )
+{
+  const int flags = fcntl(socket, F_GETFL, 0);
+  return flags != -1 && fcntl(socket, F_SETFL, flags | O_NONBLOCK) != -1;
+}
+
+} // anonym namespace
+
+
+class SslConnection::CryptoTask : public Task
+{
+public:
+
+  CryptoTask( SslConnection *connection ) : m_connection(connection) {}
+  void run() { m_connection->runCrypto(); }
+
+private:
+
+  CryptoTask(const CryptoTask&);
+  CryptoTask& operator=(const CryptoTask&);
+
+  SslConnection *m_connection;
+};
 
 
 void SslConnection::init()
@@ -39,11 +84,34 @@ SslConnection::SslConnection (  const std::string   host,
   , m_bufferLength(bufferLength)
   , m_sslHandle(0)
   , m_sslContext(0)
+  , m_clientContext(0)
   , m_bidirectional_shutdown(bidirectional_shutdown)
+  , m_nonBlocking(false)
+  , m_readWant(SSL_ERROR_NONE)
+  , m_writeWant(SSL_ERROR_NONE)
+  , m_pendingOutput()
+  , m_pendingFileFd(-1)
+  , m_pendingFileOffset(0)
+  , m_pendingFileLength(0)
+  , m_kernelTls(false)
+  , m_kernelTlsSend(false)
+  , m_kernelTlsReceive(false)
+  , m_cryptoPool(0)
+  , m_networkBio(0)
+  , m_cryptoMutex()
+  , m_cryptoIdle(m_cryptoMutex)
+  , m_cipherIn()
+  , m_cipherOut()
+  , m_cryptoScheduled(false)
+  , m_cryptoClosed(false)
+  , m_bufferPool(0)
 {
   TRACE;
   m_buffer = new unsigned char[m_bufferLength];
   m_message->setConnection(this);
+
+  // handshake flights are several small writes, Nagle delays the last one
+  m_timedTcpConnection->setSocketOptions(SocketOptions().set(SocketOptions::NoDelay, 1));
 }
 
 
@@ -51,7 +119,12 @@ SslConnection::~SslConnection()
 {
   TRACE;
   disconnect();
-  delete m_buffer;
+  if ( m_sslContext != 0 )
+    SSL_CTX_free(m_sslContext);
+  if ( m_bufferPool != 0 )
+    m_bufferPool->release(m_buffer);
+  else
+    delete[] m_buffer;
   delete m_timedTcpConnection;
 }
 
@@ -62,11 +135,11 @@ Connection* SslConnection::clone(const int socket)
 
   Connection* conn = m_timedTcpConnection->clone(socket);
 
+  // own handle on the shared context, handshake on the first receive
   SslConnection *sslConn = new SslConnection(
                                         dynamic_cast<TimedTcpConnection*>(conn),
                                         m_message->clone(),
-                                        m_bufferLength);
-  sslConn->setHandle(m_sslHandle);
+                                        *this);
   return sslConn;
 }
 
@@ -75,12 +148,19 @@ bool SslConnection::connect()
 {
   TRACE;
 
+  if ( m_sslHandle == 0 && !initHandle() )
+    return false;
+
+  // the handshake goes on as receive() passes the server's flights
+  if ( m_cryptoPool != 0 )
+    return m_timedTcpConnection->connect() && startHandshake(false);
+
   if ( !m_timedTcpConnection->connect() )
     return false;
 
   if ( SSL_set_fd(m_sslHandle, m_timedTcpConnection->getSocket() ) == 0 ) {
     LOG( Logger::ERR, getSslError("SSL set connection socket failed. ").c_str() );
-    return -1;
+    return false;
   }
 
   if ( SSL_connect (m_sslHandle) != 1 ) {
@@ -89,11 +169,45 @@ bool SslConnection::connect()
   }
 
   showCertificates();
+  checkKernelTls();
+
+  if ( m_nonBlocking && !setNonBlockingSocket(m_timedTcpConnection->getSocket()) ) {
+    LOG( Logger::ERR, "Could not make socket non-blocking." );
+    return false;
+  }
 
   return true;
 }
 
 
+bool SslConnection::startConnect( bool &inProgress )
+{
+  TRACE;
+
+  if ( !m_nonBlocking )
+    return StreamConnection::startConnect(inProgress);
+
+  if ( m_sslHandle == 0 && !initHandle() )
+    return false;
+
+  if ( !m_timedTcpConnection->startConnect(inProgress) )
+    return false;
+
+  return inProgress ? true : startHandshake(false);
+}
+
+
+bool SslConnection::finishConnect()
+{
+  TRACE;
+
+  if ( !m_nonBlocking )
+    return true;
+
+  return m_timedTcpConnection->finishConnect() && startHandshake(false);
+}
+
+
 bool SslConnection::bind()
 {
   TRACE;
@@ -113,29 +227,79 @@ bool SslConnection::accept( int& client_socket )
 {
   TRACE;
 
-  if(!m_timedTcpConnection->accept(client_socket))
-    return false;
+  // the handshake is up to the clone
+  return m_timedTcpConnection->accept(client_socket);
+}
 
-  if ( SSL_set_fd(m_sslHandle, client_socket) == 0 ) {
-    LOG( Logger::ERR, getSslError("SSL set connection socket failed. ").c_str() );
-    return false;
+
+bool SslConnection::disconnect()
+{
+  TRACE;
+
+  // no new task, the running one finishes with the handle
+  if ( m_cryptoPool != 0 ) {
+    ScopedLock sl(m_cryptoMutex);
+    m_cryptoClosed = true;
+    while ( m_cryptoScheduled )
+      m_cryptoIdle.wait();
   }
 
-  if ( SSL_accept(m_sslHandle) == -1 ) {
-    LOG( Logger::ERR, getSslError("SSL accept failed. ").c_str() );
-    return false;
+  // the context stays for reconnecting, the destructor frees it
+  if ( m_sslHandle != 0 ) {
+    if ( SSL_is_init_finished(m_sslHandle) )
+      shutdown();
+
+    SSL_free(m_sslHandle);
+    m_sslHandle = 0;
   }
 
+  if ( m_networkBio != 0 ) {
+    BIO_free(m_networkBio);
+    m_networkBio = 0;
+  }
+  m_cipherIn.clear();
+  m_cipherOut.clear();
+  m_cryptoClosed = false;
+
+  m_readWant = SSL_ERROR_NONE;
+  m_writeWant = SSL_ERROR_NONE;
+  m_pendingOutput.clear();
+  m_pendingFileFd = -1;
+  m_pendingFileLength = 0;
+  m_kernelTlsSend = false;
+  m_kernelTlsReceive = false;
+
+  if ( m_timedTcpConnection->getSocket() != -1 )
+    m_timedTcpConnection->disconnect();
+
   return true;
 }
 
+
 /// @todo this function shall be refactored
-bool SslConnection::disconnect()
+void SslConnection::shutdown()
 {
   TRACE;
 
-  if ( m_sslHandle == 0 || m_sslContext == 0 )
-    return false;
+  // the alert goes to the socket if it takes it
+  if ( m_cryptoPool != 0 ) {
+    SSL_shutdown(m_sslHandle);
+    char buffer[256];
+    int ret;
+    while ( (ret = BIO_read(m_networkBio, buffer, sizeof(buffer))) > 0 )
+      m_cipherOut.append(buffer, ret);
+
+    ScopedLock sl(m_cryptoMutex);
+    writeCiphertext();
+    return;
+  }
+
+  // the reply would need another round on the event loop
+  if ( m_nonBlocking ) {
+    if ( SSL_shutdown(m_sslHandle) < 0 )
+      LOG( Logger::INFO, "Could not send \"close notify\" alert without blocking.");
+    return;
+  }
 
   int ret = SSL_shutdown(m_sslHandle);
   if ( ret == 0 ) {
@@ -162,27 +326,12 @@ bool SslConnection::disconnect()
 
     );
   }
-
-  /// @note I have to check the ref count?! This stinks
-  if (m_sslHandle && m_sslHandle->references > 0)
-    SSL_free(m_sslHandle);
-
-  if (m_sslHandle && m_sslContext->references > 0)
-    SSL_CTX_free(m_sslContext);
-
-  m_sslHandle = 0;
-  m_sslContext = 0;
-
-  /// @note do I have to call this?
-  if ( m_timedTcpConnection->getSocket() != -1 )
-    m_timedTcpConnection->disconnect();
-
-  return true;
 }
 
 
-bool SslConnection::initServerContext( const std::string certificateFile,
-                                       const std::string privateKeyFile )
+bool SslConnection::initServerContext( const std::string  certificateFile,
+                                       const std::string  privateKeyFile,
+                                       SslSessionCache   *sessionCache )
 {
   TRACE;
 
@@ -200,14 +349,28 @@ bool SslConnection::initServerContext( const std::string certificateFile,
   if ( !loadCertificates(certificateFile, privateKeyFile) )
     return false;
 
-  return initHandle();
+  if ( sessionCache != 0 && !sessionCache->attach(m_sslContext) )
+    return false;
+
+  // no handle, every accepted connection gets its own
+  return true;
 }
 
 
-bool SslConnection::initClientContext()
+bool SslConnection::initClientContext( SslClientContext *clientContext )
 {
   TRACE;
 
+  if ( clientContext != 0 ) {
+    if ( clientContext->getContext() == 0 )
+      return false;
+
+    m_clientContext = clientContext;
+    m_sslContext = clientContext->getContext();
+    upRef(m_sslContext);
+    return initHandle();
+  }
+
   m_sslContext = SSL_CTX_new (TLSv1_2_client_method ());
   if ( m_sslContext == NULL ) {
     LOG (Logger::ERR, getSslError("Creating SSL context failed. ").c_str() );
@@ -227,6 +390,27 @@ bool SslConnection::send( const void* message, const size_t length )
 {
   TRACE;
 
+  if ( m_sslHandle == 0 )
+    return false;
+
+  // encrypted by the next task
+  if ( m_cryptoPool != 0 ) {
+    {
+      ScopedLock sl(m_cryptoMutex);
+      if ( m_cryptoClosed )
+        return false;
+      m_pendingOutput.append( static_cast<const char*>(message), length );
+    }
+    schedule();
+    return true;
+  }
+
+  // queued until the handshake is done or the socket takes it
+  if ( m_nonBlocking ) {
+    m_pendingOutput.append( static_cast<const char*>(message), length );
+    return !SSL_is_init_finished(m_sslHandle) || flush();
+  }
+
   int ret = SSL_write(m_sslHandle, message, length);
 
   if ( ret > 0 )
@@ -247,6 +431,34 @@ bool SslConnection::receive()
 {
   TRACE;
 
+  if ( m_sslHandle == 0 )
+    return false;
+
+  if ( m_cryptoPool != 0 )
+    return receiveCiphertext();
+
+  acquireBuffer();
+  const bool received = receiveRecords();
+  releaseIdleBuffer();
+  return received;
+}
+
+
+bool SslConnection::receiveRecords()
+{
+  TRACE;
+
+  // accepted, the client hello is what woke us
+  if ( !SSL_is_init_finished(m_sslHandle) ) {
+    if ( !handshake() )
+      return false;
+    if ( !m_nonBlocking || !SSL_is_init_finished(m_sslHandle) )
+      return true;
+  }
+
+  if ( m_nonBlocking )
+    return flush() && receiveAvailable();
+
   int ret = SSL_read(m_sslHandle, m_buffer, m_bufferLength);
 
   if ( ret > 0 ) {
@@ -257,7 +469,16 @@ bool SslConnection::receive()
       LOG_PROP("Bytes", ret)
     LOG_END("Received message from peer.");
 
-    return m_message->buildMessage( (void*)m_buffer, (size_t)ret);
+    if ( !m_message->buildMessage( (void*)m_buffer, (size_t)ret) )
+      return false;
+
+    // the rest of a record longer than m_buffer would not wake the poller
+    while ( SSL_pending(m_sslHandle) > 0 &&
+            (ret = SSL_read(m_sslHandle, m_buffer, m_bufferLength)) > 0 )
+      if ( !m_message->buildMessage( (void*)m_buffer, (size_t)ret) )
+        return false;
+
+    return true;
   }
 
   unsigned long sslErrNo = ERR_get_error();
@@ -274,6 +495,93 @@ bool SslConnection::receive()
 }
 
 
+bool SslConnection::send( const struct iovec *iov, const int count )
+{
+  TRACE;
+
+  if ( m_sslHandle == 0 )
+    return false;
+
+  // the kernel makes the records, the buffers are not copied
+  if ( m_kernelTlsSend && !m_nonBlocking && m_pendingOutput.empty() ) {
+    std::vector<struct iovec> rest(iov, iov + count);
+    size_t first(0);
+    while ( first < rest.size() ) {
+      ssize_t ret = writev(m_timedTcpConnection->getSocket(), &rest[first],
+                           rest.size() - first);
+      if ( ret < 0 && errno == EINTR )
+        continue;
+      if ( ret < 0 ) {
+        LOG (Logger::ERR, errnoToString("Vectored write failed. ").c_str() );
+        return false;
+      }
+
+      for ( ; first < rest.size() && (size_t)ret >= rest[first].iov_len; ++first )
+        ret -= rest[first].iov_len;
+      if ( first < rest.size() ) {
+        rest[first].iov_base = static_cast<char*>(rest[first].iov_base) + ret;
+        rest[first].iov_len -= ret;
+      }
+    }
+    return true;
+  }
+
+  // one record instead of one per buffer
+  std::string message;
+  for ( int i = 0; i < count; ++i )
+    message.append( static_cast<const char*>(iov[i].iov_base), iov[i].iov_len );
+  return send(message.data(), message.length());
+}
+
+
+bool SslConnection::sendFile( const int fd, off_t offset, size_t length )
+{
+  TRACE;
+
+  if ( m_sslHandle == 0 )
+    return false;
+
+#ifdef SSL_OP_ENABLE_KTLS
+  // from the page cache into the socket, encrypted by the kernel
+  if ( m_kernelTlsSend && m_pendingOutput.empty() && m_pendingFileLength == 0 ) {
+    while ( length > 0 ) {
+      const ossl_ssize_t ret = SSL_sendfile(m_sslHandle, fd, offset, length, 0);
+      if ( ret <= 0 ) {
+        // flush() goes on from there, nothing is read into memory
+        if ( m_nonBlocking && retry(ret, m_writeWant) ) {
+          m_pendingFileFd = fd;
+          m_pendingFileOffset = offset;
+          m_pendingFileLength = length;
+          return true;
+        }
+        LOG (Logger::ERR, getSslError("SSL sendfile failed. ").c_str() );
+        return false;
+      }
+      offset += ret;
+      length -= ret;
+    }
+  }
+#endif
+
+  char buffer[16 * 1024];  // a full TLS record
+  while ( length > 0 ) {
+    const ssize_t ret = pread(fd, buffer, std::min(length, sizeof(buffer)), offset);
+    if ( ret < 0 && errno == EINTR )
+      continue;
+    if ( ret <= 0 ) {
+      LOG (Logger::ERR, errnoToString("Reading file to send failed. ").c_str() );
+      return false;
+    }
+    if ( !send(buffer, ret) )
+      return false;
+    offset += ret;
+    length -= ret;
+  }
+
+  return true;
+}
+
+
 bool SslConnection::closed() const
 {
   TRACE;
@@ -288,27 +596,139 @@ int SslConnection::getSocket() const
 }
 
 
-SslConnection::SslConnection(TimedTcpConnection* timedTcpConnection,
-                             Message*            message,
-                             const size_t        bufferLength,
-                             bool                bidirectional_shutdown
+bool SslConnection::setSocketOptions( const SocketOptions &options )
+{
+  TRACE;
+  return m_timedTcpConnection->setSocketOptions(options);
+}
+
+
+void SslConnection::setResolver( Resolver *resolver )
+{
+  TRACE;
+  m_timedTcpConnection->setResolver(resolver);
+}
+
+
+void SslConnection::setNonBlocking( const bool nonBlocking )
+{
+  TRACE;
+  m_nonBlocking = nonBlocking;
+}
+
+
+void SslConnection::setKernelTls( const bool kernelTls )
+{
+  TRACE;
+  m_kernelTls = kernelTls;
+}
+
+
+bool SslConnection::isKernelTlsSend() const
+{
+  TRACE;
+  return m_kernelTlsSend;
+}
+
+
+bool SslConnection::isKernelTlsReceive() const
+{
+  TRACE;
+  return m_kernelTlsReceive;
+}
+
+
+void SslConnection::setCryptoPool( ThreadPool *cryptoPool )
+{
+  TRACE;
+  m_cryptoPool = cryptoPool;
+  if ( m_cryptoPool != 0 )
+    m_nonBlocking = true;
+}
+
+
+void SslConnection::setBufferPool( BufferPool *bufferPool )
+{
+  TRACE;
+
+  if ( m_bufferPool != 0 )
+    m_bufferPool->release(m_buffer);
+  else
+    delete[] m_buffer;
+  m_buffer = 0;
+
+  m_bufferPool = bufferPool;
+  if ( m_bufferPool != 0 )
+    m_bufferLength = m_bufferPool->getBufferLength();
+  else
+    m_buffer = new unsigned char[m_bufferLength];
+}
+
+
+bool SslConnection::wantsWrite() const
+{
+  TRACE;
+
+  if ( m_cryptoPool != 0 ) {
+    ScopedLock sl(m_cryptoMutex);
+    return !m_cipherOut.empty();
+  }
+
+  return m_readWant == SSL_ERROR_WANT_WRITE || m_writeWant == SSL_ERROR_WANT_WRITE;
+}
+
+
+SslConnection::SslConnection(TimedTcpConnection*   timedTcpConnection,
+                             Message*              message,
+                             const SslConnection  &listener
                             )
   : StreamConnection("invalid", "invalid")
   , m_timedTcpConnection(timedTcpConnection)
   , m_message(message)
   , m_buffer(0)
-  , m_bufferLength(bufferLength)
+  , m_bufferLength(listener.m_bufferLength)
   , m_sslHandle(0)
-  , m_sslContext(0)
-  , m_bidirectional_shutdown(bidirectional_shutdown)
+  , m_sslContext(listener.m_sslContext)
+  , m_clientContext(0)
+  , m_bidirectional_shutdown(listener.m_bidirectional_shutdown)
+  , m_nonBlocking(listener.m_nonBlocking)
+  , m_readWant(SSL_ERROR_NONE)
+  , m_writeWant(SSL_ERROR_NONE)
+  , m_pendingOutput()
+  , m_pendingFileFd(-1)
+  , m_pendingFileOffset(0)
+  , m_pendingFileLength(0)
+  , m_kernelTls(listener.m_kernelTls)
+  , m_kernelTlsSend(false)
+  , m_kernelTlsReceive(false)
+  , m_cryptoPool(listener.m_cryptoPool)
+  , m_networkBio(0)
+  , m_cryptoMutex()
+  , m_cryptoIdle(m_cryptoMutex)
+  , m_cipherIn()
+  , m_cipherOut()
+  , m_cryptoScheduled(false)
+  , m_cryptoClosed(false)
+  , m_bufferPool(listener.m_bufferPool)
 {
   TRACE;
 
   setHost(m_timedTcpConnection->getHost());
   setPort(m_timedTcpConnection->getPort());
 
-  m_buffer = new unsigned char[m_bufferLength];
+  // with a pool, the first read takes one
+  if ( m_bufferPool == 0 )
+    m_buffer = new unsigned char[m_bufferLength];
   m_message->setConnection(this);
+
+  if ( m_sslContext == 0 )
+    return;
+
+  upRef(m_sslContext);
+  if ( initHandle() && !startHandshake(true) ) {
+    SSL_free(m_sslHandle);
+    m_sslHandle = 0;
+  }
 }
 
 
@@ -316,21 +736,426 @@ bool SslConnection::initHandle()
 {
   TRACE;
 
-  m_sslHandle = SSL_new (m_sslContext);
+  m_sslHandle = m_clientContext != 0 ?
+                  m_clientContext->newHandle(getHost(), getPort()) :
+                  SSL_new (m_sslContext);
   if ( m_sslHandle == NULL ) {
     LOG (Logger::ERR, getSslError("Creating SSL structure for connection failed. ").c_str() );
     return false;
   }
 
+  // send() keeps the rest of a partial write in m_pendingOutput
+  if ( m_nonBlocking )
+    SSL_set_mode(m_sslHandle, SSL_MODE_ENABLE_PARTIAL_WRITE |
+                              SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+
+  // record buffers only while there is something to read or write
+  if ( m_bufferPool != 0 )
+    SSL_set_mode(m_sslHandle, SSL_MODE_RELEASE_BUFFERS);
+
+  // the socket is never handed to OpenSSL
+  if ( m_cryptoPool != 0 ) {
+    BIO *internalBio(0);
+    if ( BIO_new_bio_pair(&internalBio, 0, &m_networkBio, 0) != 1 ) {
+      LOG( Logger::ERR, getSslError("Creating BIO pair failed. ").c_str() );
+      SSL_free(m_sslHandle);
+      m_sslHandle = 0;
+      return false;
+    }
+    SSL_set_bio(m_sslHandle, internalBio, internalBio);
+  }
+
+#ifdef SSL_OP_ENABLE_KTLS
+  // takes effect, if at all, when the handshake is done
+  if ( m_kernelTls && m_cryptoPool == 0 )
+    SSL_set_options(m_sslHandle, SSL_OP_ENABLE_KTLS);
+#endif
+
+  return true;
+}
+
+
+bool SslConnection::startHandshake( const bool accepting )
+{
+  TRACE;
+
+  const int socket = m_timedTcpConnection->getSocket();
+  if ( m_nonBlocking && !setNonBlockingSocket(socket) ) {
+    LOG( Logger::ERR, "Could not make socket non-blocking." );
+    return false;
+  }
+
+  if ( m_cryptoPool == 0 && SSL_set_fd(m_sslHandle, socket) == 0 ) {
+    LOG( Logger::ERR, getSslError("SSL set connection socket failed. ").c_str() );
+    return false;
+  }
+
+  if ( accepting ) {
+    SSL_set_accept_state(m_sslHandle);
+    return true;
+  }
+
+  // the server waits for our hello
+  SSL_set_connect_state(m_sslHandle);
+  if ( m_cryptoPool != 0 ) {
+    schedule();
+    return true;
+  }
+  return handshake();
+}
+
+
+bool SslConnection::handshake()
+{
+  TRACE;
+
+  const int ret = SSL_do_handshake(m_sslHandle);
+  if ( ret != 1 && retry(ret, m_readWant) )
+    return true;
+
+  if ( ret != 1 ) {
+    LOG( Logger::ERR, getSslError("SSL handshake failed. ").c_str() );
+    return false;
+  }
+
+  m_readWant = SSL_ERROR_NONE;
+
+  LOG_BEGIN(Logger::DEBUG)
+    LOG_PROP("Host", m_timedTcpConnection->getHost())
+    LOG_PROP("Port", m_timedTcpConnection->getPort())
+    LOG_PROP("Resumed", SSL_session_reused(m_sslHandle))
+  LOG_END("SSL handshake done.");
+
+  checkKernelTls();
+  return true;
+}
+
+
+void SslConnection::checkKernelTls()
+{
+  TRACE;
+
+#ifdef SSL_OP_ENABLE_KTLS
+  if ( !m_kernelTls )
+    return;
+
+  // OpenSSL falls back silently: no tls module, cipher or TLS version
+  m_kernelTlsSend = BIO_get_ktls_send(SSL_get_wbio(m_sslHandle));
+  m_kernelTlsReceive = BIO_get_ktls_recv(SSL_get_rbio(m_sslHandle));
+
+  LOG_BEGIN(Logger::DEBUG)
+    LOG_PROP("Socket", m_timedTcpConnection->getSocket())
+    LOG_PROP("Send", m_kernelTlsSend)
+    LOG_PROP("Receive", m_kernelTlsReceive)
+    LOG_PROP("Cipher", SSL_get_cipher(m_sslHandle))
+  LOG_END("Kernel TLS.");
+#endif
+}
+
+
+bool SslConnection::flush()
+{
+  TRACE;
+
+#ifdef SSL_OP_ENABLE_KTLS
+  while ( m_pendingFileLength > 0 ) {
+    const ossl_ssize_t ret = SSL_sendfile(m_sslHandle, m_pendingFileFd,
+                                          m_pendingFileOffset, m_pendingFileLength, 0);
+    if ( ret > 0 ) {
+      m_pendingFileOffset += ret;
+      m_pendingFileLength -= ret;
+      continue;
+    }
+
+    if ( retry(ret, m_writeWant) )
+      return true;
+
+    LOG (Logger::ERR, getSslError("SSL sendfile failed. ").c_str() );
+    return false;
+  }
+  m_pendingFileFd = -1;
+#endif
+
+  while ( !m_pendingOutput.empty() ) {
+    const int ret = SSL_write(m_sslHandle, m_pendingOutput.data(),
+                              m_pendingOutput.length());
+    if ( ret > 0 ) {
+      m_pendingOutput.erase(0, ret);
+      continue;
+    }
+
+    if ( retry(ret, m_writeWant) )
+      return true;
+
+    LOG (Logger::ERR, getSslError("SSL write failed. ").c_str() );
+    return false;
+  }
+
+  m_writeWant = SSL_ERROR_NONE;
+  if ( m_bufferPool != 0 )
+    std::string().swap(m_pendingOutput);  // clear() keeps the capacity
+  return true;
+}
+
+
+bool SslConnection::receiveAvailable()
+{
+  TRACE;
+
+  // records already decrypted do not wake the poller again
+  while ( true ) {
+    const int ret = SSL_read(m_sslHandle, m_buffer, m_bufferLength);
+    if ( ret > 0 ) {
+      if ( !m_message->buildMessage( (void*)m_buffer, (size_t)ret) )
+        return false;
+      continue;
+    }
+
+    if ( retry(ret, m_readWant) )
+      return true;
+
+    if ( SSL_get_error(m_sslHandle, ret) == SSL_ERROR_ZERO_RETURN ) {
+      LOG( Logger::INFO, "SSL connection has been closed, cannot read.");
+      return false;
+    }
+
+    LOG (Logger::ERR, getSslError("SSL read failed. ").c_str() );
+    return false;
+  }
+}
+
+
+bool SslConnection::retry( const int ret, int &want )
+{
+  TRACE;
+
+  const int error = SSL_get_error(m_sslHandle, ret);
+  if ( error != SSL_ERROR_WANT_READ && error != SSL_ERROR_WANT_WRITE )
+    return false;
+
+  want = error;
   return true;
 }
 
 
-void SslConnection::setHandle(SSL *handle)
+void SslConnection::acquireBuffer()
+{
+  TRACE;
+
+  if ( m_buffer == 0 && m_bufferPool != 0 )
+    m_buffer = m_bufferPool->acquire();
+}
+
+
+void SslConnection::releaseIdleBuffer()
+{
+  TRACE;
+
+  // a record decrypted but not yet read would be lost
+  if ( m_bufferPool == 0 || m_buffer == 0 ||
+       (m_sslHandle != 0 && SSL_pending(m_sslHandle) > 0) )
+    return;
+
+  m_bufferPool->release(m_buffer);
+  m_buffer = 0;
+}
+
+
+bool SslConnection::receiveCiphertext()
 {
   TRACE;
 
-  m_sslHandle = handle;
+  // m_buffer belongs to the task
+  char buffer[16 * 1024];
+  std::string cipher;
+  bool open(true);
+  while ( true ) {
+    const ssize_t ret = ::recv(getSocket(), buffer, sizeof(buffer), 0);
+    if ( ret > 0 ) {
+      cipher.append(buffer, ret);
+      continue;
+    }
+    if ( ret < 0 && errno == EINTR )
+      continue;
+    if ( ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) )
+      break;
+    if ( ret < 0 )
+      LOG (Logger::ERR, errnoToString("Receiving ciphertext failed. ").c_str() );
+    open = false;
+    break;
+  }
+
+  {
+    ScopedLock sl(m_cryptoMutex);
+    if ( m_cryptoClosed )
+      return false;
+    m_cipherIn += cipher;
+
+    // what the tasks could not write, on POLLOUT
+    if ( !writeCiphertext() )
+      return false;
+  }
+
+  // the records before a close still get to the message
+  if ( !cipher.empty() )
+    schedule();
+  return open;
+}
+
+
+void SslConnection::schedule()
+{
+  TRACE;
+
+  {
+    ScopedLock sl(m_cryptoMutex);
+    if ( m_cryptoScheduled || m_cryptoClosed )
+      return;
+    m_cryptoScheduled = true;
+  }
+
+  CryptoTask *task = new CryptoTask(this);
+  try {
+    m_cryptoPool->pushTask(task);
+  } catch (CancelledException) {
+    LOG( Logger::ERR, "Crypto pool is stopped." );
+    delete task;
+    ScopedLock sl(m_cryptoMutex);
+    m_cryptoScheduled = false;
+    closeCrypto();
+    m_cryptoIdle.broadcast();
+  }
+}
+
+
+void SslConnection::runCrypto()
+{
+  TRACE;
+
+  std::string cipherIn, plainOut, cipherOut;
+  bool more(true);
+  while ( more ) {
+    {
+      ScopedLock sl(m_cryptoMutex);
+      cipherIn.swap(m_cipherIn);
+      plainOut.swap(m_pendingOutput);
+    }
+
+    bool progress(false);
+    const bool ok = processRecords(cipherIn, plainOut, cipherOut, progress);
+
+    ScopedLock sl(m_cryptoMutex);
+    const bool arrived = !m_cipherIn.empty() || !m_pendingOutput.empty();
+
+    // what the handle did not take yet stays ahead of what came meanwhile
+    m_cipherIn.insert(0, cipherIn);
+    m_pendingOutput.insert(0, plainOut);
+    cipherIn.clear();
+    plainOut.clear();
+
+    // straight to the socket, no need to wake the event loop
+    m_cipherOut += cipherOut;
+    cipherOut.clear();
+    if ( !writeCiphertext() || !ok )
+      closeCrypto();
+
+    more = !m_cryptoClosed && (progress || arrived);
+    if ( !more ) {
+      m_cryptoScheduled = false;
+      m_cryptoIdle.broadcast();
+    }
+  }
+}
+
+
+bool SslConnection::processRecords( std::string &cipherIn,
+                                    std::string &plainOut,
+                                    std::string &cipherOut,
+                                    bool        &progress )
+{
+  TRACE;
+
+  progress = false;
+  int ret;
+
+  // as much as the pair takes, the rest in the next round
+  while ( !cipherIn.empty() &&
+          (ret = BIO_write(m_networkBio, cipherIn.data(), cipherIn.length())) > 0 ) {
+    cipherIn.erase(0, ret);
+    progress = true;
+  }
+
+  if ( !SSL_is_init_finished(m_sslHandle) && !handshake() )
+    return false;
+
+  if ( SSL_is_init_finished(m_sslHandle) ) {
+    acquireBuffer();
+    const bool received = receiveAvailable();
+    releaseIdleBuffer();
+    if ( !received )
+      return false;
+
+    while ( !plainOut.empty() ) {
+      ret = SSL_write(m_sslHandle, plainOut.data(), plainOut.length());
+      if ( ret > 0 ) {
+        plainOut.erase(0, ret);
+        progress = true;
+        continue;
+      }
+      if ( retry(ret, m_writeWant) )
+        break;  // the pair is full
+
+      LOG (Logger::ERR, getSslError("SSL write failed. ").c_str() );
+      return false;
+    }
+  }
+
+  char buffer[16 * 1024];
+  while ( (ret = BIO_read(m_networkBio, buffer, sizeof(buffer))) > 0 ) {
+    cipherOut.append(buffer, ret);
+    progress = true;
+  }
+
+  return true;
+}
+
+
+bool SslConnection::writeCiphertext()
+{
+  TRACE;
+
+  while ( !m_cipherOut.empty() ) {
+    const ssize_t ret = ::send(getSocket(), m_cipherOut.data(),
+                               m_cipherOut.length(), MSG_NOSIGNAL);
+    if ( ret > 0 ) {
+      m_cipherOut.erase(0, ret);
+      continue;
+    }
+    if ( ret < 0 && errno == EINTR )
+      continue;
+    if ( ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) )
+      return true;
+
+    LOG (Logger::INFO, errnoToString("Sending ciphertext failed. ").c_str() );
+    return false;
+  }
+
+  if ( m_bufferPool != 0 )
+    std::string().swap(m_cipherOut);
+  return true;
+}
+
+
+void SslConnection::closeCrypto()
+{
+  TRACE;
+
+  if ( m_cryptoClosed )
+    return;
+
+  // the event loop finds the socket readable and its receive() fails
+  m_cryptoClosed = true;
+  ::shutdown(getSocket(), SHUT_RDWR);
 }
 
 
@@ -4,8 +4,16 @@
 
 #include "StreamConnection.hpp"
 #include "TimedTcpConnection.hpp"
+#include "SslSessionCache.hpp"
+#include "SslClientContext.hpp"
+#include "BufferPool.hpp"
+#include "SocketOptions.hpp"
+#include "ThreadPool.hpp"
+#include "Mutex.hpp"
+#include "ConditionVariable.hpp"
 
 #include <string>
+#include <sys/types.h> // off_t
 #include <openssl/ssl.h>
 
 
@@ -31,13 +39,26 @@ public:
   bool connect();
   bool disconnect();
 
-  bool initServerContext( const std::string certificateFile,
-                          const std::string privateKeyFile );
-  bool initClientContext();
+  // with setNonBlocking(true), the TLS handshake follows the TCP one
+  bool startConnect( bool &inProgress );
+  bool finishConnect();
+
+  // with a session cache reconnecting clients can resume
+  bool initServerContext( const std::string  certificateFile,
+                          const std::string  privateKeyFile,
+                          SslSessionCache   *sessionCache = 0 );
+  // sharing a client context, reconnects resume the previous session
+  bool initClientContext( SslClientContext *clientContext = 0 );
 
   bool send( const void* message, const size_t length );
   bool receive();
 
+  // with kernel TLS these skip the copies into OpenSSL's record buffers
+  bool send( const struct iovec *iov, const int count );
+  // non-blocking with kernel TLS, what the socket does not take is sent
+  // from the file as it becomes writable: fd has to stay open until then
+  bool sendFile( const int fd, off_t offset, size_t length );
+
   bool bind();
   bool listen( const int maxPendingQueueLen = 64 );
   bool accept( int& client_socket );
@@ -45,19 +66,78 @@ public:
   bool closed() const;
   int getSocket() const;
 
+  // of the underlying TCP connection, NoDelay by default
+  bool setSocketOptions( const SocketOptions &options );
+  void setResolver( Resolver *resolver );
+
+  /** For event loops: handshake, read, write and shutdown return instead
+   * of blocking, receive() resumes them when the socket is ready and
+   * wantsWrite() tells when that has to be writable. Accepted connections
+   * inherit it from the listener. send() queues what does not fit yet.
+   */
+  void setNonBlocking( const bool nonBlocking );
+  bool wantsWrite() const;
+
+  /** Before connecting or accepting: once the handshake is done the kernel
+   * encrypts and decrypts, where OpenSSL and the kernel (tls module,
+   * cipher, TLS version) support it, otherwise OpenSSL keeps doing it.
+   * Accepted connections inherit it from the listener.
+   */
+  void setKernelTls( const bool kernelTls );
+  bool isKernelTlsSend() const;
+  bool isKernelTlsReceive() const;
+
+  /** Before connecting or accepting: the event loop only moves ciphertext
+   * between the socket and a memory BIO pair, handshake and records are
+   * done by tasks on the pool, one at a time per connection, so the
+   * message is built on a worker. Implies non-blocking, not kernel TLS.
+   * Accepted connections inherit it, the pool has to outlive them.
+   */
+  void setCryptoPool( ThreadPool *cryptoPool );
+
+  /** Before connecting or accepting: the read buffer is taken from the
+   * pool for each read and given back when nothing is left in the handle,
+   * OpenSSL frees its record buffers likewise (SSL_MODE_RELEASE_BUFFERS).
+   * Idle connections keep neither. The pool's buffer length replaces
+   * bufferLength, accepted connections inherit it.
+   * An idle accepted connection still takes about 14 KB of heap: the SSL
+   * handle is 8.5 KB as SSL_new makes it, the session and cipher state
+   * another 5 KB, these wrappers and the Message clone under 1 KB.
+   */
+  void setBufferPool( BufferPool *bufferPool );
+
 private:
 
-  SslConnection ( TimedTcpConnection* timedTcpConnection,
-                  Message*            message,
-                  const size_t        bufferLength = 1024,
-                  bool                bidirectional_shutdown = true
-                );
+  class CryptoTask;
+
+  // accepted connection, sharing the listener's context and settings
+  SslConnection ( TimedTcpConnection*   timedTcpConnection,
+                  Message*              message,
+                  const SslConnection  &listener );
 
   SslConnection(const SslConnection&);
   SslConnection& operator=(const SslConnection&);
 
   bool initHandle();
-  void setHandle(SSL *handle);
+  bool startHandshake( const bool accepting );
+  bool handshake();
+  void checkKernelTls();
+  void shutdown();
+  bool flush();
+  bool receiveAvailable();
+  bool receiveRecords();
+  void acquireBuffer();
+  void releaseIdleBuffer();
+  bool retry( const int ret, int &want );
+  bool receiveCiphertext();
+  void schedule();
+  void runCrypto();
+  bool processRecords( std::string &cipherIn,
+                       std::string &plainOut,
+                       std::string &cipherOut,
+                       bool        &progress );
+  bool writeCiphertext();
+  void closeCrypto();
   std::string getSslError(const std::string &msg);
   bool loadCertificates( const std::string certificateFile,
                          const std::string keyFile );
@@ -70,7 +150,28 @@ private:
   size_t m_bufferLength;
   SSL *m_sslHandle;
   SSL_CTX *m_sslContext;
+  SslClientContext *m_clientContext;
   bool m_bidirectional_shutdown;
+  bool m_nonBlocking;
+  int m_readWant;   // SSL_ERROR_WANT_* of handshake and read
+  int m_writeWant;  // of the pending write
+  std::string m_pendingOutput;
+  // the rest of a blocked kernel TLS sendFile(), before m_pendingOutput
+  int m_pendingFileFd;
+  off_t m_pendingFileOffset;
+  size_t m_pendingFileLength;
+  bool m_kernelTls;
+  bool m_kernelTlsSend;
+  bool m_kernelTlsReceive;
+  ThreadPool *m_cryptoPool;
+  BIO *m_networkBio;           // the socket's side of the pair
+  mutable Mutex m_cryptoMutex; // guards the rest and m_pendingOutput
+  ConditionVariable m_cryptoIdle;
+  std::string m_cipherIn;
+  std::string m_cipherOut;
+  bool m_cryptoScheduled;
+  bool m_cryptoClosed;
+  BufferPool *m_bufferPool;
 };
 
 
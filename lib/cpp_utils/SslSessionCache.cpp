@@ -0,0 +1,398 @@
+#include "SslSessionCache.hpp"
+
+#include "ScopedLock.hpp"
+#include "Logger.hpp"
+
+#include <string.h> // memcpy, memcmp
+
+#include <openssl/rand.h>
+#include <openssl/evp.h>
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+#include <openssl/core_names.h>
+#include <openssl/params.h>
+#endif
+
+
+namespace {
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+bool initMac( EVP_MAC_CTX *macContext, unsigned char *key, const size_t length )
+{
+  char digest[] = "SHA256";
+  OSSL_PARAM params[3];
+  params[0] = OSSL_PARAM_construct_octet_string(OSSL_MAC_PARAM_KEY, key, length);
+  params[1] = OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, digest, 0);
+  params[2] = OSSL_PARAM_construct_end();
+  return EVP_MAC_CTX_set_params(macContext, params) == 1;
+}
+#else
+bool initMac( HMAC_CTX *macContext, unsigned char *key, const size_t length )
+{
+  return HMAC_Init_ex(macContext, key, length, EVP_sha256(), 0) == 1;
+}
+#endif
+
+} // anonym namespace
+
+
+SslSessionCache::Entry::Entry( const std::string &session, const time_t expires )
+  : m_session(session)
+  , m_expires(expires)
+{
+}
+
+
+SslSessionCache::SslSessionCache( const size_t  maxEntries,
+                                  const long    timeoutSec,
+                                  const long    ticketKeyLifetimeSec )
+  : m_maxEntries(maxEntries)
+  , m_timeoutSec(timeoutSec)
+  , m_ticketKeyLifetimeSec(ticketKeyLifetimeSec)
+  , m_mutex()
+  , m_sessions()
+  , m_order()
+  , m_ticketKeys()
+  , m_hits(0)
+  , m_misses(0)
+{
+  TRACE;
+
+  ScopedLock sl(m_mutex);
+  newTicketKey();
+}
+
+
+SslSessionCache::~SslSessionCache()
+{
+  TRACE;
+
+  // keys are secrets
+  ScopedLock sl(m_mutex);
+  std::deque<TicketKey>::iterator it;
+  for ( it = m_ticketKeys.begin(); it != m_ticketKeys.end(); ++it )
+    OPENSSL_cleanse(&(*it), sizeof(TicketKey));
+}
+
+
+bool SslSessionCache::attach( SSL_CTX *context )
+{
+  TRACE;
+
+  if ( context == 0 || SSL_CTX_set_ex_data(context, exDataIndex(), this) != 1 ) {
+    LOG( Logger::ERR, "Could not attach session cache to SSL context." );
+    return false;
+  }
+
+  // external cache only: shared by every context attached
+  SSL_CTX_set_session_cache_mode(context, SSL_SESS_CACHE_SERVER |
+                                          SSL_SESS_CACHE_NO_INTERNAL);
+  SSL_CTX_set_timeout(context, m_timeoutSec);
+
+  static const unsigned char sessionIdContext[] = "cpp_utils";
+  SSL_CTX_set_session_id_context(context, sessionIdContext,
+                                 sizeof(sessionIdContext) - 1);
+
+  SSL_CTX_sess_set_new_cb(context, newSessionCallback);
+  SSL_CTX_sess_set_get_cb(context, getSessionCallback);
+  SSL_CTX_sess_set_remove_cb(context, removeSessionCallback);
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+  SSL_CTX_set_tlsext_ticket_key_evp_cb(context, ticketKeyCallback);
+#else
+  SSL_CTX_set_tlsext_ticket_key_cb(context, ticketKeyCallback);
+#endif
+
+  return true;
+}
+
+
+bool SslSessionCache::rotateTicketKeys()
+{
+  TRACE;
+
+  ScopedLock sl(m_mutex);
+  return newTicketKey();
+}
+
+
+void SslSessionCache::clear()
+{
+  TRACE;
+
+  ScopedLock sl(m_mutex);
+  m_sessions.clear();
+  m_order.clear();
+}
+
+
+size_t SslSessionCache::size() const
+{
+  TRACE;
+
+  ScopedLock sl(m_mutex);
+  return m_sessions.size();
+}
+
+
+unsigned long SslSessionCache::getHits() const
+{
+  TRACE;
+
+  ScopedLock sl(m_mutex);
+  return m_hits;
+}
+
+
+unsigned long SslSessionCache::getMisses() const
+{
+  TRACE;
+
+  ScopedLock sl(m_mutex);
+  return m_misses;
+}
+
+
+bool SslSessionCache::store( SSL_SESSION *session )
+{
+  TRACE;
+
+  unsigned int idLength;
+  const unsigned char *id = SSL_SESSION_get_id(session, &idLength);
+
+  const int length = i2d_SSL_SESSION(session, 0);
+  if ( idLength == 0 || length <= 0 )
+    return false;
+
+  std::string der(length, '\0');
+  unsigned char *p = reinterpret_cast<unsigned char*>(&der[0]);
+  i2d_SSL_SESSION(session, &p);
+
+  const time_t current = time(0);
+  const Entry entry(der, current + m_timeoutSec);
+  const std::string key( reinterpret_cast<const char*>(id), idLength );
+
+  ScopedLock sl(m_mutex);
+  m_sessions.erase(key);
+  m_sessions.insert( std::make_pair(key, entry) );
+  m_order.push_back( std::make_pair(entry.m_expires, key) );
+  evict(current);
+  return true;
+}
+
+
+SSL_SESSION* SslSessionCache::find( const std::string &id )
+{
+  TRACE;
+
+  std::string der;
+  {
+    ScopedLock sl(m_mutex);
+    std::map<std::string, Entry>::iterator it = m_sessions.find(id);
+    if ( it == m_sessions.end() || it->second.m_expires <= time(0) ) {
+      if ( it != m_sessions.end() )
+        m_sessions.erase(it);
+      m_misses++;
+      return 0;
+    }
+
+    m_hits++;
+    der = it->second.m_session;
+  }
+
+  const unsigned char *p = reinterpret_cast<const unsigned char*>(der.data());
+  return d2i_SSL_SESSION(0, &p, der.length());
+}
+
+
+void SslSessionCache::remove( const std::string &id )
+{
+  TRACE;
+
+  ScopedLock sl(m_mutex);
+  m_sessions.erase(id);
+}
+
+
+void SslSessionCache::evict( const time_t current )
+{
+  TRACE;
+
+  // m_order is in insertion, so expiry order; entries of removed or
+  // re-stored sessions are stale and just dropped
+  while ( !m_order.empty() &&
+          ( m_order.front().first <= current || m_sessions.size() > m_maxEntries ) ) {
+    std::map<std::string, Entry>::iterator it = m_sessions.find(m_order.front().second);
+    if ( it != m_sessions.end() && it->second.m_expires == m_order.front().first )
+      m_sessions.erase(it);
+    m_order.pop_front();
+  }
+}
+
+
+bool SslSessionCache::newTicketKey()
+{
+  TRACE;
+
+  TicketKey key;
+  if ( RAND_bytes(key.m_name, sizeof(key.m_name)) != 1 ||
+       RAND_bytes(key.m_aesKey, sizeof(key.m_aesKey)) != 1 ||
+       RAND_bytes(key.m_hmacKey, sizeof(key.m_hmacKey)) != 1 ) {
+    LOG( Logger::ERR, "Could not generate session ticket key." );
+    return false;
+  }
+  key.m_created = time(0);
+
+  m_ticketKeys.push_front(key);
+  if ( m_ticketKeys.size() > MAX_TICKET_KEYS ) {
+    OPENSSL_cleanse(&m_ticketKeys.back(), sizeof(TicketKey));
+    m_ticketKeys.pop_back();
+  }
+
+  LOG( Logger::DEBUG, "New session ticket key." );
+  return true;
+}
+
+
+bool SslSessionCache::findTicketKey( const unsigned char *name,
+                                     TicketKey &key,
+                                     bool &current )
+{
+  TRACE;
+
+  ScopedLock sl(m_mutex);
+  std::deque<TicketKey>::iterator it;
+  for ( it = m_ticketKeys.begin(); it != m_ticketKeys.end(); ++it )
+    if ( memcmp(it->m_name, name, sizeof(it->m_name)) == 0 ) {
+      key = *it;
+      current = it == m_ticketKeys.begin();
+      return true;
+    }
+
+  return false;
+}
+
+
+bool SslSessionCache::currentTicketKey( TicketKey &key )
+{
+  TRACE;
+
+  ScopedLock sl(m_mutex);
+  if ( ( m_ticketKeys.empty() ||
+         m_ticketKeys.front().m_created + m_ticketKeyLifetimeSec <= time(0) ) &&
+       !newTicketKey() && m_ticketKeys.empty() )
+    return false;
+
+  key = m_ticketKeys.front();
+  return true;
+}
+
+
+int SslSessionCache::exDataIndex()
+{
+  TRACE_STATIC;
+
+  static const int index = SSL_CTX_get_ex_new_index(0, 0, 0, 0, 0);
+  return index;
+}
+
+
+SslSessionCache* SslSessionCache::fromContext( SSL_CTX *context )
+{
+  TRACE_STATIC;
+
+  return static_cast<SslSessionCache*>(SSL_CTX_get_ex_data(context, exDataIndex()));
+}
+
+
+int SslSessionCache::newSessionCallback( SSL *ssl, SSL_SESSION *session )
+{
+  TRACE_STATIC;
+
+  SslSessionCache *cache = fromContext(SSL_get_SSL_CTX(ssl));
+  if ( cache != 0 )
+    cache->store(session);
+
+  return 0; // not keeping a reference, stored serialized
+}
+
+
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+SSL_SESSION* SslSessionCache::getSessionCallback( SSL *ssl, unsigned char *id,
+                                                  int length, int *copy )
+#else
+SSL_SESSION* SslSessionCache::getSessionCallback( SSL *ssl, const unsigned char *id,
+                                                  int length, int *copy )
+#endif
+{
+  TRACE_STATIC;
+
+  *copy = 0; // the returned one is ours to give away
+  SslSessionCache *cache = fromContext(SSL_get_SSL_CTX(ssl));
+  if ( cache == 0 )
+    return 0;
+
+  return cache->find( std::string(reinterpret_cast<const char*>(id), length) );
+}
+
+
+void SslSessionCache::removeSessionCallback( SSL_CTX *context, SSL_SESSION *session )
+{
+  TRACE_STATIC;
+
+  SslSessionCache *cache = fromContext(context);
+  if ( cache == 0 )
+    return;
+
+  unsigned int idLength;
+  const unsigned char *id = SSL_SESSION_get_id(session, &idLength);
+  cache->remove( std::string(reinterpret_cast<const char*>(id), idLength) );
+}
+
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+int SslSessionCache::ticketKeyCallback( SSL *ssl, unsigned char *name, unsigned char *iv,
+                                        EVP_CIPHER_CTX *cipherContext,
+                                        EVP_MAC_CTX *macContext, int encrypt )
+#else
+int SslSessionCache::ticketKeyCallback( SSL *ssl, unsigned char *name, unsigned char *iv,
+                                        EVP_CIPHER_CTX *cipherContext,
+                                        HMAC_CTX *macContext, int encrypt )
+#endif
+{
+  TRACE_STATIC;
+
+  SslSessionCache *cache = fromContext(SSL_get_SSL_CTX(ssl));
+  if ( cache == 0 )
+    return -1;
+
+  TicketKey key;
+
+  if ( encrypt ) {
+    if ( !cache->currentTicketKey(key) ||
+         RAND_bytes(iv, EVP_CIPHER_iv_length(EVP_aes_128_cbc())) != 1 )
+      return -1;
+
+    memcpy(name, key.m_name, sizeof(key.m_name));
+    if ( EVP_EncryptInit_ex(cipherContext, EVP_aes_128_cbc(), 0, key.m_aesKey, iv) != 1 ||
+         !initMac(macContext, key.m_hmacKey, sizeof(key.m_hmacKey)) )
+      return -1;
+
+    OPENSSL_cleanse(&key, sizeof(key));
+    return 1;
+  }
+
+  // unknown (expired) key: full handshake
+  bool current(false);
+  if ( !cache->findTicketKey(name, key, current) )
+    return 0;
+
+  const bool ok = initMac(macContext, key.m_hmacKey, sizeof(key.m_hmacKey)) &&
+                  EVP_DecryptInit_ex(cipherContext, EVP_aes_128_cbc(), 0,
+                                     key.m_aesKey, iv) == 1;
+  OPENSSL_cleanse(&key, sizeof(key));
+  if ( !ok )
+    return -1;
+
+  // 2: valid, but renew it with the current key
+  return current ? 1 : 2;
+}
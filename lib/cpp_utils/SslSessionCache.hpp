@@ -0,0 +1,114 @@
+#ifndef SSL_SESSION_CACHE_HPP
+#define SSL_SESSION_CACHE_HPP
+
+#include "Mutex.hpp"
+
+#include <deque>
+#include <map>
+#include <string>
+#include <time.h> // time_t
+#include <stddef.h> // size_t
+
+#include <openssl/ssl.h>
+#include <openssl/hmac.h>
+
+
+/** @brief Server side TLS session cache and session ticket keys.
+ *
+ * Replaces OpenSSL's per SSL_CTX internal cache: one instance can be
+ * attached to the contexts of several listeners or reactor threads, so a
+ * client resumes wherever it reconnects. Sessions are stored serialized,
+ * the oldest ones are evicted above maxEntries.
+ *
+ * Session tickets are encrypted with the current key, which is replaced
+ * after ticketKeyLifetimeSec. The previous keys are kept for decryption,
+ * tickets of those get renewed.
+ *
+ * Must outlive the attached contexts.
+ */
+
+class SslSessionCache
+{
+public:
+
+  SslSessionCache( const size_t  maxEntries = 20 * 1024,
+                   const long    timeoutSec = 300,
+                   const long    ticketKeyLifetimeSec = 3600 );
+
+  virtual ~SslSessionCache();
+
+  // call on a server context before any handshake
+  bool attach( SSL_CTX *context );
+
+  // new encryption key now, for example after a key leak
+  bool rotateTicketKeys();
+
+  void clear();
+
+  size_t size() const;
+  unsigned long getHits() const;
+  unsigned long getMisses() const;
+
+private:
+
+  SslSessionCache(const SslSessionCache&);
+  SslSessionCache& operator=(const SslSessionCache&);
+
+  struct Entry {
+    Entry( const std::string &session, const time_t expires );
+    std::string  m_session;  // DER
+    time_t       m_expires;
+  };
+
+  struct TicketKey {
+    unsigned char  m_name[16];
+    unsigned char  m_aesKey[16];
+    unsigned char  m_hmacKey[32];
+    time_t         m_created;
+  };
+
+  static const size_t MAX_TICKET_KEYS = 3;  // current and two previous
+
+  bool store( SSL_SESSION *session );
+  SSL_SESSION* find( const std::string &id );
+  void remove( const std::string &id );
+  void evict( const time_t current );
+
+  bool newTicketKey();
+  bool findTicketKey( const unsigned char *name, TicketKey &key, bool &current );
+  bool currentTicketKey( TicketKey &key );
+
+  static int exDataIndex();
+  static SslSessionCache* fromContext( SSL_CTX *context );
+  static int newSessionCallback( SSL *ssl, SSL_SESSION *session );
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+  static SSL_SESSION* getSessionCallback( SSL *ssl, unsigned char *id,
+                                          int length, int *copy );
+#else
+  static SSL_SESSION* getSessionCallback( SSL *ssl, const unsigned char *id,
+                                          int length, int *copy );
+#endif
+  static void removeSessionCallback( SSL_CTX *context, SSL_SESSION *session );
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+  static int ticketKeyCallback( SSL *ssl, unsigned char *name, unsigned char *iv,
+                                EVP_CIPHER_CTX *cipherContext,
+                                EVP_MAC_CTX *macContext, int encrypt );
+#else
+  static int ticketKeyCallback( SSL *ssl, unsigned char *name, unsigned char *iv,
+                                EVP_CIPHER_CTX *cipherContext,
+                                HMAC_CTX *macContext, int encrypt );
+#endif
+
+  const size_t                   m_maxEntries;
+  const long                     m_timeoutSec;
+  const long                     m_ticketKeyLifetimeSec;
+
+  mutable Mutex                  m_mutex;
+  std::map<std::string, Entry>   m_sessions;
+  std::deque< std::pair<time_t, std::string> > m_order;  // expiry, id
+  std::deque<TicketKey>          m_ticketKeys;  // current first
+  unsigned long                  m_hits;
+  unsigned long                  m_misses;
+};
+
+#endif // SSL_SESSION_CACHE_HPP
@@ -6,6 +6,8 @@
 
 #include <string>
 
+class Resolver;
+
 class StreamConnection : public Connection
 {
 public:
@@ -16,6 +18,24 @@ public:
   virtual bool connect() = 0;
   virtual bool disconnect() = 0;
 
+  /** Non-blocking connect for event loops. Returns false on failure,
+   * inProgress tells whether finishConnect() has to be called once the
+   * socket becomes writable. Defaults to the blocking connect().
+   */
+  virtual bool startConnect( bool &inProgress )
+  {
+    inProgress = false;
+    return connect();
+  }
+
+  virtual bool finishConnect() { return true; }
+
+  /// Whether the event loop has to wait for writability too, before receive()
+  virtual bool wantsWrite() const { return false; }
+
+  /// Resolving through it, startConnect() does not block on a cached name
+  virtual void setResolver( Resolver * ) {}
+
   virtual bool listen( const int maxPendingQueueLen = 64 ) = 0;
 
   /// @todo move accept and poll here
@@ -0,0 +1,137 @@
+#include "TaskGroup.hpp"
+
+#include "Futex.hpp"
+#include "Common.hpp"
+
+#include <sched.h> // sched_yield
+
+
+class TaskGroup::GroupTask : public Task
+{
+public:
+
+  GroupTask( TaskGroup &group, Task *task ) : m_group(group), m_task(task) {}
+
+  // not run, dropped by a stopped pool
+  ~GroupTask()
+  {
+    TRACE;
+    if ( m_task != 0 ) {
+      delete m_task;
+      m_group.done();
+    }
+  }
+
+  void run()
+  {
+    TRACE;
+
+    Task *task = m_task;
+    m_task = 0;
+    try {
+      task->run();
+    } catch ( ... ) {
+      delete task;
+      m_group.done();
+      throw;
+    }
+    delete task;
+    m_group.done();
+  }
+
+private:
+
+  GroupTask(const GroupTask&);
+  GroupTask& operator=(const GroupTask&);
+
+  TaskGroup &m_group;
+  Task *m_task;
+};
+
+
+TaskGroup::TaskGroup( ThreadPool &pool )
+  : m_pool(pool)
+  , m_pending(0)
+  , m_waiters(0)
+  , m_finishing(0)
+{
+  TRACE;
+}
+
+
+TaskGroup::~TaskGroup()
+{
+  TRACE;
+  wait();
+}
+
+
+void TaskGroup::run( Task *task )
+{
+  TRACE;
+
+  m_pending++;
+  GroupTask *groupTask = new GroupTask(*this, task);
+  try {
+    m_pool.pushTask(groupTask);
+  } catch ( CancelledException& ) {
+    delete groupTask;
+    throw;
+  }
+}
+
+
+void TaskGroup::wait()
+{
+  TRACE;
+
+  m_waiters++;
+  for (;;) {
+    const int pending = m_pending.load();
+    if ( pending == 0 )
+      break;
+
+    Task *task(0);
+    try {
+      task = m_pool.tryPopTask();
+    } catch ( CancelledException& ) {
+      // stopped, the workers finish what they took, the rest is dropped
+    }
+
+    if ( task != 0 ) {
+      try {
+        task->run();
+      } catch ( CancelledException& ) {
+        // stopped meanwhile, it could not fork
+      }
+      delete task;
+    } else {
+      futexWait(&m_pending, pending);
+    }
+  }
+  m_waiters--;
+
+  // the group may be destroyed after return
+  for ( int spins = 0; m_finishing.load() != 0; ++spins )
+    spins < 100 ? cpuRelax() : (void)sched_yield();
+}
+
+
+int TaskGroup::getPending() const
+{
+  TRACE;
+  return m_pending.load();
+}
+
+
+void TaskGroup::done()
+{
+  TRACE;
+
+  // every one, a waiter may find a task to help with since
+  m_finishing++;
+  m_pending--;
+  if ( m_waiters.load() != 0 )
+    futexWake(&m_pending);
+  m_finishing--;
+}
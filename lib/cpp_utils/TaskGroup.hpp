@@ -0,0 +1,50 @@
+#ifndef TASK_GROUP_HPP
+#define TASK_GROUP_HPP
+
+#include "ThreadPool.hpp"
+#include "Task.hpp"
+
+#include <atomic>
+
+
+/** @brief A batch of tasks on a ThreadPool, waited for together.
+ *
+ * wait() runs queued tasks of the pool, of this group or not, until the
+ * group is done, and sleeps only when the queue is empty. So a task can
+ * fork a group of its own and wait for it without leaving a worker idle,
+ * nor deadlocking a small pool.
+ *
+ * Tasks are deleted after running, as by WorkerThread. Those still queued
+ * when the pool is stopped are deleted without running, and no longer
+ * waited for.
+ */
+
+class TaskGroup
+{
+public:
+
+  TaskGroup( ThreadPool &pool );
+  // waits for the tasks still running
+  ~TaskGroup();
+
+  // throws CancelledException if the pool is stopped, task is deleted then
+  void run( Task *task );
+  void wait();
+
+  int getPending() const;
+
+private:
+
+  TaskGroup(const TaskGroup&);
+  TaskGroup& operator=(const TaskGroup&);
+
+  class GroupTask;
+  void done();
+
+  ThreadPool &m_pool;
+  std::atomic<int> m_pending;  // futex word
+  std::atomic<int> m_waiters;
+  std::atomic<int> m_finishing;  // in done(), after the decrement too
+};
+
+#endif // TASK_GROUP_HPP
@@ -16,6 +16,8 @@ TcpConnection::TcpConnection (  const std::string   host,
   , m_buffer(0)
   , m_bufferLength(bufferLength)
   , m_state(CLOSED)
+  , m_socketOptions()
+  , m_resolver(0)
 {
   TRACE;
   m_socket.createSocket();
@@ -28,7 +30,7 @@ TcpConnection::~TcpConnection()
 {
   TRACE;
 
-  if (m_state == OPEN)
+  if (m_state != CLOSED)
     disconnect();
 
   delete[] m_buffer;
@@ -41,6 +43,10 @@ Connection* TcpConnection::clone(const int socket)
                                                    m_message->clone(),
                                                    m_bufferLength );
 
+  // accepted sockets inherit only some of the listener's options
+  if ( !m_socketOptions.empty() )
+    tcpConnection->setSocketOptions(m_socketOptions);
+
   return tcpConnection;
 }
 
@@ -49,22 +55,25 @@ bool TcpConnection::connect()
 {
   TRACE;
 
-  if (m_state == OPEN) {
+  if (m_state != CLOSED) {
     LOG(Logger::ERR, "Connection is open already.");
     return false;
   }
 
-  AddrInfo addrInfo;
-  if (!addrInfo.getHostInfo(m_host, m_port))
+  if (!prepareSocket())
     return false;
 
-  addrInfo.printHostDetails();
+  AddrInfo addrInfo;
+  Resolver::Result cached;
+  addrinfo *info(0);
+  if (!resolve(addrInfo, cached, info))
+    return false;
 
-  if (!m_socket.connect(addrInfo[0]))
+  if (!m_socket.connect(info))
     return false;
 
   std::string address, service;
-  if ( AddrInfo::convertNameInfo( addrInfo[0], address, service) ) {
+  if ( AddrInfo::convertNameInfo( info, address, service) ) {
     LOG_BEGIN(Logger::INFO)
       LOG_PROP("Host", address)
       LOG_PROP("Port", service)
@@ -77,6 +86,62 @@ bool TcpConnection::connect()
 }
 
 
+bool TcpConnection::startConnect( bool &inProgress )
+{
+  TRACE;
+
+  if (m_state != CLOSED) {
+    LOG(Logger::ERR, "Connection is open already.");
+    return false;
+  }
+
+  if (!prepareSocket())
+    return false;
+
+  /// @note resolving blocks unless a Resolver is set and has it cached
+  AddrInfo addrInfo;
+  Resolver::Result cached;
+  addrinfo *info(0);
+  if (!resolve(addrInfo, cached, info))
+    return false;
+
+  // a failed connect leaves the socket unusable, the next try needs a new one
+  if (!m_socket.setNonBlocking(true) ||
+      !m_socket.startConnect(info->ai_addr, info->ai_addrlen, inProgress)) {
+    m_socket.closeSocket();
+    return false;
+  }
+
+  m_state = CONNECTING;
+  return inProgress ? true : finishConnect();
+}
+
+
+bool TcpConnection::finishConnect()
+{
+  TRACE;
+
+  if (m_state != CONNECTING)
+    return false;
+
+  // receive/send stay blocking calls, as with connect()
+  if (!m_socket.finishConnect() || !m_socket.setNonBlocking(false)) {
+    m_state = CLOSED;
+    m_socket.closeSocket();
+    return false;
+  }
+
+  LOG_BEGIN(Logger::INFO)
+    LOG_PROP("Host", m_host)
+    LOG_PROP("Port", m_port)
+    LOG_PROP("Socket", m_socket.getSocket())
+  LOG_END("Connected to peer.");
+
+  m_state = OPEN;
+  return true;
+}
+
+
 bool TcpConnection::bind()
 {
   TRACE;
@@ -86,17 +151,20 @@ bool TcpConnection::bind()
     return false;
   }
 
-  AddrInfo addrInfo;
-  if (!addrInfo.getHostInfo(m_host, m_port))
+  if (!prepareSocket())
     return false;
 
-  addrInfo.printHostDetails();
+  AddrInfo addrInfo;
+  Resolver::Result cached;
+  addrinfo *info(0);
+  if (!resolve(addrInfo, cached, info))
+    return false;
 
-  if (!m_socket.bind(addrInfo[0]))
+  if (!m_socket.bind(info))
     return false;
 
   std::string address, service;
-  if ( AddrInfo::convertNameInfo( addrInfo[0], address, service) ) {
+  if ( AddrInfo::convertNameInfo( info, address, service) ) {
     LOG_BEGIN(Logger::INFO)
       LOG_PROP("Host", address)
       LOG_PROP("Port", service)
@@ -148,7 +216,7 @@ bool TcpConnection::disconnect()
 bool TcpConnection::send( const void* message, const size_t length )
 {
   TRACE;
-  if (m_state == CLOSED)
+  if (m_state != OPEN)
     return false;
 
   return m_socket.send( message, length );
@@ -159,7 +227,7 @@ bool TcpConnection::receive()
 {
   TRACE;
 
-  if (m_state == CLOSED)
+  if (m_state != OPEN)
     return false;
 
   ssize_t length;
@@ -200,6 +268,28 @@ void TcpConnection::setState(const State state)
 }
 
 
+bool TcpConnection::setSocketOptions( const SocketOptions &options )
+{
+  TRACE;
+  m_socketOptions = options;
+  return m_socket.setOptions(m_socketOptions);
+}
+
+
+const SocketOptions& TcpConnection::getSocketOptions() const
+{
+  TRACE;
+  return m_socketOptions;
+}
+
+
+void TcpConnection::setResolver( Resolver *resolver )
+{
+  TRACE;
+  m_resolver = resolver;
+}
+
+
 bool TcpConnection::closed() const
 {
   TRACE;
@@ -230,6 +320,8 @@ TcpConnection::TcpConnection (  const int      socket,
   , m_buffer(0)
   , m_bufferLength(bufferLength)
   , m_state(OPEN)  /// @todo can clone only open ones?
+  , m_socketOptions()
+  , m_resolver(0)
 {
   TRACE;
 
@@ -241,3 +333,44 @@ TcpConnection::TcpConnection (  const int      socket,
   m_buffer = new unsigned char[m_bufferLength];
   m_message->setConnection(this);
 }
+
+
+bool TcpConnection::prepareSocket()
+{
+  TRACE;
+
+  if (m_socket.getSocket() != -1)
+    return true;
+
+  if (!m_socket.createSocket())
+    return false;
+
+  if (!m_socketOptions.empty())
+    m_socket.setOptions(m_socketOptions);
+
+  return true;
+}
+
+
+bool TcpConnection::resolve( AddrInfo &addrInfo,
+                             Resolver::Result &cached,
+                             addrinfo *&address )
+{
+  TRACE;
+
+  if (m_resolver != 0) {
+    cached = m_resolver->resolve(m_host, m_port).get();
+    if (!cached)
+      return false;
+
+    address = (*cached)[0];
+    return true;
+  }
+
+  if (!addrInfo.getHostInfo(m_host, m_port))
+    return false;
+
+  addrInfo.printHostDetails();
+  address = addrInfo[0];
+  return true;
+}
@@ -5,6 +5,8 @@
 #include "StreamConnection.hpp"
 #include "Message.hpp"
 #include "Socket.hpp"
+#include "SocketOptions.hpp"
+#include "Resolver.hpp"
 
 #include <string>
 
@@ -15,6 +17,7 @@ public:
 
   enum State {
     OPEN,
+    CONNECTING, // non-blocking connect in progress
     CLOSED
   };
 
@@ -31,6 +34,9 @@ public:
   bool connect();
   bool disconnect();
 
+  bool startConnect( bool &inProgress );
+  bool finishConnect();
+
   bool send( const void* message, const size_t length );
   bool receive();
 
@@ -41,6 +47,13 @@ public:
   int getSocket() const;
   void setState(const State state);
 
+  // applied now and to every connection clone() creates
+  bool setSocketOptions( const SocketOptions &options );
+  const SocketOptions& getSocketOptions() const;
+
+  // connect/bind resolve through it instead of a getaddrinfo call each time
+  void setResolver( Resolver *resolver );
+
   bool closed() const;
   Message *getMessage() const;
   size_t getBufferLength() const;
@@ -54,11 +67,17 @@ private:
   TcpConnection(const TcpConnection&);
   TcpConnection& operator=(const TcpConnection&);
 
+  bool resolve( AddrInfo &addrInfo, Resolver::Result &cached, addrinfo *&address );
+  // a new socket is needed after disconnect
+  bool prepareSocket();
+
   Socket          m_socket;
   Message        *m_message;
   unsigned char  *m_buffer;
   size_t          m_bufferLength;
   State           m_state;
+  SocketOptions   m_socketOptions;
+  Resolver       *m_resolver;
 };
 
 
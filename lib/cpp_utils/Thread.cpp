@@ -1,6 +1,8 @@
 #include "Thread.hpp"
 
 #include "Logger.hpp"
+#include "Common.hpp"
+#include "CpuTopology.hpp"
 
 #include <signal.h> // pthread_kill
 
@@ -9,6 +11,11 @@
 Thread::Thread()
   : m_isRunning(false)
   , m_threadHandler( 0 )
+  , m_cpus()
+  , m_name()
+  , m_stackSize( 0 )
+  , m_policy( SCHED_OTHER )
+  , m_priority( 0 )
 {
   TRACE;
 }
@@ -20,11 +27,46 @@ Thread::~Thread()
 }
 
 
-void Thread::start()
+bool Thread::start()
 {
   TRACE;
+
+  pthread_attr_t attr;
+  pthread_attr_init( &attr );
+
+  if ( m_stackSize != 0 )
+    pthread_attr_setstacksize( &attr, m_stackSize );
+
+  if ( !m_cpus.empty() ) {
+    cpu_set_t cpuSet;
+    CPU_ZERO( &cpuSet );
+    for ( size_t i = 0; i < m_cpus.size(); ++i )
+      CPU_SET( m_cpus[i], &cpuSet );
+    pthread_attr_setaffinity_np( &attr, sizeof(cpuSet), &cpuSet );
+  }
+
+  if ( m_policy != SCHED_OTHER ) {
+    sched_param param;
+    param.sched_priority = m_priority;
+    pthread_attr_setinheritsched( &attr, PTHREAD_EXPLICIT_SCHED );
+    pthread_attr_setschedpolicy( &attr, m_policy );
+    pthread_attr_setschedparam( &attr, &param );
+  }
+
   m_isRunning = true;
-  pthread_create( &m_threadHandler, 0, threadStarter, ( void* )this );
+  const int ret = pthread_create( &m_threadHandler, &attr, threadStarter, ( void* )this );
+  pthread_attr_destroy( &attr );
+
+  if ( ret != 0 ) {
+    LOG_BEGIN(Logger::ERR)
+      LOG_PROP("name", m_name)
+      LOG_PROP("error", strerror(ret))
+    LOG_END("Could not start thread.");
+    m_isRunning = false;
+    m_threadHandler = 0;
+    return false;
+  }
+  return true;
 }
 
 
@@ -32,11 +74,14 @@ void* Thread::join() const
 {
   TRACE;
 
-  if ( !m_isRunning )
+  // stop() clears m_isRunning before the usual join(), so that can not
+  // tell whether there is a thread to wait for
+  if ( m_threadHandler == 0 )
     return 0;
 
   void* retVal;
   pthread_join( m_threadHandler, &retVal );
+  m_threadHandler = 0;
   return retVal;
 }
 
@@ -61,8 +106,76 @@ bool Thread::isRunning() const
 }
 
 
+void Thread::setCpus( const std::vector<int> &cpus )
+{
+  TRACE;
+  m_cpus = cpus;
+}
+
+
+bool Thread::setNumaNode( const int node )
+{
+  TRACE;
+
+  // an empty list would start it anywhere
+  const std::vector<int> cpus = CpuTopology().getNodeCpus(node);
+  if ( cpus.empty() ) {
+    LOG_BEGIN(Logger::ERR)
+      LOG_PROP("name", m_name)
+      LOG_PROP("node", node)
+    LOG_END("No usable CPU on NUMA node.");
+    return false;
+  }
+
+  m_cpus = cpus;
+  return true;
+}
+
+
+void Thread::setName( const std::string &name )
+{
+  TRACE;
+  m_name = name;
+}
+
+
+void Thread::setStackSize( const size_t stackSize )
+{
+  TRACE;
+  m_stackSize = stackSize;
+}
+
+
+void Thread::setScheduling( const int policy, const int priority )
+{
+  TRACE;
+  m_policy = policy;
+  m_priority = priority;
+}
+
+
+const std::vector<int>& Thread::getCpus() const
+{
+  TRACE;
+  return m_cpus;
+}
+
+
+const std::string& Thread::getName() const
+{
+  TRACE;
+  return m_name;
+}
+
+
 void* Thread::threadStarter( void* pData )
 {
   TRACE_STATIC;
-  return static_cast<Thread *>(pData)->run();
+  Thread *thread = static_cast<Thread *>(pData);
+
+  // shown by top -H and gdb; the kernel keeps 15 characters
+  if ( !thread->m_name.empty() )
+    pthread_setname_np( pthread_self(), thread->m_name.substr(0, 15).c_str() );
+
+  return thread->run();
 }
@@ -2,6 +2,10 @@
 #define THREAD_HPP
 
 #include <pthread.h>
+#include <sched.h> // SCHED_OTHER
+#include <string>
+#include <vector>
+#include <stddef.h> // size_t
 
 
 class Thread
@@ -11,12 +15,25 @@ public:
   Thread();
   virtual ~Thread();
 
-  void start();
+  // false if the attributes were refused, e.g. SCHED_FIFO unprivileged
+  bool start();
   void* join() const;
   virtual void stop();
   void sendSignal( const int nSignal ) const;
   bool isRunning() const;
 
+  // attributes, set before start(), an empty/0 value leaves the default
+  void setCpus( const std::vector<int> &cpus );
+  // pins to the node's CPUs, memory follows by first touch; false, and
+  // the CPUs left as they were, if none of the node's is ours to use
+  bool setNumaNode( const int node );
+  void setName( const std::string &name );  // 15 characters are kept
+  void setStackSize( const size_t stackSize );
+  void setScheduling( const int policy, const int priority = 0 );
+
+  const std::vector<int>& getCpus() const;
+  const std::string& getName() const;
+
 protected:
 
   volatile bool m_isRunning;
@@ -26,8 +43,13 @@ private:
   virtual void* run() = 0;
   static void* threadStarter( void* pData );
 
-  pthread_t m_threadHandler;
+  mutable pthread_t m_threadHandler;
 
+  std::vector<int> m_cpus;
+  std::string m_name;
+  size_t m_stackSize;
+  int m_policy;
+  int m_priority;
 };
 
 
@@ -1,9 +1,36 @@
 #include "ThreadPool.hpp"
+#include "WorkerThread.hpp"
+#include "ScopedLock.hpp"
 #include "Common.hpp"
+#include "CpuTopology.hpp"
+
+#include <algorithm> // find
+
+
+namespace {
+
+__thread ThreadPool* currentPool = 0;
+
+} // anonym namespace
 
 
 ThreadPool::ThreadPool()
- : m_threads()
+ : m_threadsMutex()
+ , m_threads()
+ , m_exited()
+ , m_started(false)
+ , m_stopped(false)
+ , m_placement(Unpinned)
+ , m_placementOrder()
+ , m_elastic(false)
+ , m_minThreads(0)
+ , m_maxThreads(0)
+ , m_queueWaitTargetNs(0)
+ , m_idleTimeoutMs(0)
+ , m_live(0)
+ , m_idle(0)
+ , m_blocked(0)
+ , m_lastPop(0)
  , m_tasks()
 {
   TRACE;
@@ -23,54 +50,300 @@ ThreadPool::~ThreadPool()
 void ThreadPool::pushTask( Task* task )
 {
   TRACE;
-  m_tasks.push(task);
+  const uint64_t queuedAt = monotonicNs();
+  const QueuedTask queued = { task, queuedAt };
+  m_tasks.push(queued);
+
+  // everybody busy, and none of them got to the queue for a while;
+  // a worker may have popped since queuedAt was taken
+  const uint64_t lastPop = m_lastPop.load();
+  if ( m_elastic && m_idle.load() == 0 && queuedAt > lastPop &&
+       queuedAt - lastPop > m_queueWaitTargetNs )
+    grow();
 }
 
 
 Task* ThreadPool::popTask()
 {
   TRACE;
-  return m_tasks.waitAndPop();
+  return m_tasks.waitAndPop().m_task;
+}
+
+
+Task* ThreadPool::popTask( Thread* worker )
+{
+  TRACE;
+
+  if ( !m_elastic )
+    return popTask();
+
+  currentPool = this;
+  QueuedTask queued;
+  for (;;) {
+    m_idle++;
+    bool popped = false;
+    try {
+      popped = m_tasks.waitAndPop(queued, m_idleTimeoutMs);
+    } catch ( CancelledException& ) {
+      m_idle--;
+      throw;
+    }
+    m_idle--;
+
+    if ( popped )
+      break;
+    if ( retire(worker) )
+      return 0;
+  }
+
+  const uint64_t poppedAt = monotonicNs();
+  m_lastPop.store(poppedAt);
+  if ( poppedAt - queued.m_queuedAt > m_queueWaitTargetNs && m_idle.load() == 0 )
+    grow();
+
+  return queued.m_task;
+}
+
+
+Task* ThreadPool::tryPopTask()
+{
+  TRACE;
+  QueuedTask queued;
+  return m_tasks.tryPop(queued) ? queued.m_task : 0;
 }
 
 
 void ThreadPool::pushWorkerThread( Thread * thread)
 {
   TRACE;
+  ScopedLock sl(m_threadsMutex);
   m_threads.push_back( thread );
 }
 
 
-void ThreadPool::startWorkerThreads()
+size_t ThreadPool::getWorkerCount() const
 {
   TRACE;
-  std::vector<Thread*>::iterator it;
-  for( it = m_threads.begin() ; it != m_threads.end(); it++ )
+  ScopedLock sl(m_threadsMutex);
+  return m_threads.size() - m_exited.size();
+}
+
+
+void ThreadPool::setPlacement( Placement placement )
+{
+  TRACE;
+  m_placement = placement;
+}
+
+
+void ThreadPool::setElastic( const size_t minThreads,
+                             const size_t maxThreads,
+                             const long int queueWaitTargetMs,
+                             const long int idleTimeoutMs )
+{
+  TRACE;
+  m_elastic = true;
+  m_minThreads = minThreads;
+  m_maxThreads = maxThreads > minThreads ? maxThreads : minThreads;
+  m_queueWaitTargetNs = (uint64_t)queueWaitTargetMs * 1000000;
+  m_idleTimeoutMs = idleTimeoutMs;
+}
+
+
+bool ThreadPool::startWorkerThreads()
+{
+  TRACE;
+
+  ScopedLock sl(m_threadsMutex);
+  m_started = true;
+
+  if ( m_placement != Unpinned ) {
+    const CpuTopology topology;
+    m_placementOrder = m_placement == Compact ? topology.compactOrder() :
+                       m_placement == Scatter ? topology.scatterOrder() :
+                                                topology.physicalCoreOrder();
+  }
+
+  if ( m_elastic ) {
+    while ( m_threads.size() < m_minThreads )
+      m_threads.push_back(new WorkerThread(*this));
+    m_lastPop = monotonicNs();
+  }
+
+  // the ones not started are dropped, they would be counted as workers
+  std::vector<Thread*> started;
+  for ( size_t i = 0; i < m_threads.size(); ++i )
   {
-    (*it)->start();
+    place(m_threads[i], i);
+    if ( m_threads[i]->start() )
+      started.push_back(m_threads[i]);
+    else
+      delete m_threads[i];
   }
 
+  const size_t failed = m_threads.size() - started.size();
+  m_threads.swap(started);
+  if ( m_elastic )
+    m_live = m_threads.size();
+
+  if ( failed != 0 ) {
+    LOG_BEGIN(Logger::ERR)
+      LOG_PROP("failed", failed)
+      LOG_PROP("started", m_threads.size())
+    LOG_END("Could not start every worker.");
+    return false;
+  }
+  return true;
 }
 
 void ThreadPool::stop()
 {
   TRACE;
-  std::vector<Thread*>::iterator it;
-  for( it = m_threads.begin() ; it != m_threads.end(); it++ ) 
   {
-    (*it)->stop();
+    ScopedLock sl(m_threadsMutex);
+    m_stopped = true;
+    std::vector<Thread*>::iterator it;
+    for( it = m_threads.begin() ; it != m_threads.end(); it++ ) 
+    {
+      (*it)->stop();
+    }
   }
 
   m_tasks.cancel();
+
+  // nobody pops them any more, their groups must not wait for them
+  const std::deque<QueuedTask> left = m_tasks.drain();
+  std::deque<QueuedTask>::const_iterator it;
+  for ( it = left.begin(); it != left.end(); ++it )
+    delete it->m_task;
+  if ( !left.empty() ) {
+    LOG_BEGIN(Logger::DEBUG)
+      LOG_PROP("tasks", left.size())
+    LOG_END("Queued tasks dropped.");
+  }
 }
 
 
 void ThreadPool::join() const
 {
   TRACE;
+
+  // a worker may still take the lock, to leave
+  std::vector<Thread*> threads;
+  {
+    ScopedLock sl(m_threadsMutex);
+    threads = m_threads;
+  }
+
   std::vector<Thread*>::const_iterator it;
-  for( it = m_threads.begin() ; it != m_threads.end(); it++ ) 
+  for( it = threads.begin() ; it != threads.end(); it++ ) 
+  {
+    (*it)->join();
+  }
+}
+
+
+void ThreadPool::beginBlocking()
+{
+  TRACE;
+  m_blocked++;
+
+  // an idle one takes the queued tasks anyway
+  if ( m_elastic && m_idle.load() == 0 )
+    grow();
+}
+
+
+void ThreadPool::endBlocking()
+{
+  TRACE;
+  // the extra worker leaves once idle
+  m_blocked--;
+}
+
+
+ThreadPool* ThreadPool::current()
+{
+  TRACE_STATIC;
+  return currentPool;
+}
+
+
+void ThreadPool::grow()
+{
+  TRACE;
+
+  reapExited();
+
+  ScopedLock sl(m_threadsMutex);
+  if ( !m_started || m_stopped )
+    return;
+
+  if ( m_live.load() - m_blocked.load() >= (int)m_maxThreads )
+    return;
+
+  Thread* worker = new WorkerThread(*this);
+  place(worker, m_threads.size());
+  if ( !worker->start() ) {
+    delete worker;
+    return;
+  }
+
+  m_threads.push_back(worker);
+  m_live++;
+  LOG_BEGIN(Logger::DEBUG)
+    LOG_PROP("workers", m_live.load())
+    LOG_PROP("blocked", m_blocked.load())
+  LOG_END("Worker added.");
+}
+
+
+bool ThreadPool::retire( Thread* worker )
+{
+  TRACE;
+
+  ScopedLock sl(m_threadsMutex);
+  if ( m_live.load() <= (int)m_minThreads )
+    return false;
+
+  m_live--;
+  worker->stop();
+  m_exited.push_back(worker);
+  LOG_BEGIN(Logger::DEBUG)
+    LOG_PROP("workers", m_live.load())
+  LOG_END("Idle worker left.");
+  return true;
+}
+
+
+void ThreadPool::reapExited()
+{
+  TRACE;
+
+  std::vector<Thread*> exited;
   {
+    // stopped: join() waits for them, with the others
+    ScopedLock sl(m_threadsMutex);
+    if ( m_stopped )
+      return;
+    exited.swap(m_exited);
+    std::vector<Thread*>::iterator it;
+    for ( it = exited.begin(); it != exited.end(); ++it )
+      m_threads.erase(std::find(m_threads.begin(), m_threads.end(), *it));
+  }
+
+  // they left the loop already, join does not wait long, nor holds the lock
+  std::vector<Thread*>::iterator it;
+  for ( it = exited.begin(); it != exited.end(); ++it ) {
     (*it)->join();
+    delete *it;
   }
 }
+
+
+void ThreadPool::place( Thread* thread, const size_t index ) const
+{
+  TRACE;
+  if ( !m_placementOrder.empty() && thread->getCpus().empty() )
+    thread->setCpus(std::vector<int>(1, m_placementOrder[index % m_placementOrder.size()]));
+}
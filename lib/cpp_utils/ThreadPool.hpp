@@ -2,6 +2,8 @@
 #define THREADPOOL_HPP
 
 #include <vector>
+#include <atomic>
+#include <stdint.h> // uint64_t
 
 #include "ConcurrentDeque.hpp"
 #include "Task.hpp"
@@ -9,30 +11,118 @@
 #include "Mutex.hpp"
 
 
+/** @brief Worker threads taking tasks from a queue.
+ *
+ * The workers are pushed by hand, or with setElastic() the pool makes
+ * them itself: at least minThreads, more while a task waited longer than
+ * the target in the queue, up to maxThreads not blocked ones. A worker
+ * idle for idleTimeout leaves, down to minThreads.
+ *
+ * A task about to block, e.g. on a database, says so with ScopedBlocking:
+ * while it blocks it does not count against maxThreads, so a
+ * compensating worker can be started for the others in the queue.
+ *
+ * Tasks still queued at stop() are deleted without running.
+ */
+
 class ThreadPool
 {
 
   public:
 
+    // see CpuTopology for the orders, workers with CPUs set are left alone
+    enum Placement {
+      Unpinned,
+      Compact,        // next to each other, sharing caches
+      Scatter,        // over packages and cores, for memory bandwidth
+      PhysicalCores   // one per core, no hyperthread shared
+    };
+
     ThreadPool();
     ~ThreadPool();
 
     void pushTask(Task* task);
     Task* popTask();
+    // 0 when the worker has to leave, WorkerThread's
+    Task* popTask(Thread* worker);
+    // 0 if none is queued, for threads helping while they wait
+    Task* tryPopTask();
 
     void pushWorkerThread(Thread * thread);
-    void startWorkerThreads();
+    size_t getWorkerCount() const;
+    // false if a worker could not be started, it is deleted then
+    bool startWorkerThreads();
+    // before startWorkerThreads()
+    void setPlacement(Placement placement);
+    void setElastic(const size_t minThreads,
+                    const size_t maxThreads,
+                    const long int queueWaitTargetMs = 10,
+                    const long int idleTimeoutMs = 10 * 1000);
 
     void stop();
     void join() const;
 
+    // ScopedBlocking's
+    void beginBlocking();
+    void endBlocking();
+
+    // of the worker calling it, 0 on other threads
+    static ThreadPool* current();
+
   private:
 
     ThreadPool(const ThreadPool&);
     ThreadPool& operator=(const ThreadPool&);
 
+    struct QueuedTask
+    {
+      Task* m_task;
+      uint64_t m_queuedAt;  // ns, CLOCK_MONOTONIC
+    };
+
+    void grow();
+    bool retire(Thread* worker);
+    // joins the retired workers, without m_threadsMutex held
+    void reapExited();
+    void place(Thread* thread, const size_t index) const;
+
+    mutable Mutex m_threadsMutex;  // for m_threads and m_exited
     std::vector<Thread*> m_threads;
-    ConcurrentDeque<Task*> m_tasks;
+    std::vector<Thread*> m_exited;
+    bool m_started;
+    bool m_stopped;
+    Placement m_placement;
+    std::vector<int> m_placementOrder;
+
+    bool m_elastic;
+    size_t m_minThreads;
+    size_t m_maxThreads;
+    uint64_t m_queueWaitTargetNs;
+    long int m_idleTimeoutMs;
+    std::atomic<int> m_live;     // elastic workers not left
+    std::atomic<int> m_idle;
+    std::atomic<int> m_blocked;
+    std::atomic<uint64_t> m_lastPop;
+
+    ConcurrentDeque<QueuedTask> m_tasks;
+};
+
+
+class ScopedBlocking
+{
+public:
+
+  // the pool of the calling worker, nothing on other threads
+  ScopedBlocking() : m_pool(ThreadPool::current()) { if ( m_pool ) m_pool->beginBlocking(); }
+  ScopedBlocking(ThreadPool& pool) : m_pool(&pool) { m_pool->beginBlocking(); }
+  ~ScopedBlocking() { if ( m_pool ) m_pool->endBlocking(); }
+
+private:
+
+  ScopedBlocking(const ScopedBlocking&);
+  ScopedBlocking& operator=(const ScopedBlocking&);
+
+  ThreadPool* m_pool;
 };
 
 
@@ -52,6 +52,22 @@ bool TimedTcpConnection::connect()
 }
 
 
+bool TimedTcpConnection::startConnect( bool &inProgress )
+{
+  TRACE;
+
+  startTimer(m_timeOutSec);
+  return m_tcpConnection->startConnect(inProgress);
+}
+
+
+bool TimedTcpConnection::finishConnect()
+{
+  TRACE;
+  return m_tcpConnection->finishConnect();
+}
+
+
 bool TimedTcpConnection::bind()
 {
   TRACE;
@@ -114,6 +130,27 @@ bool TimedTcpConnection::closed() const
 }
 
 
+bool TimedTcpConnection::setSocketOptions( const SocketOptions &options )
+{
+  TRACE;
+  return m_tcpConnection->setSocketOptions(options);
+}
+
+
+const SocketOptions& TimedTcpConnection::getSocketOptions() const
+{
+  TRACE;
+  return m_tcpConnection->getSocketOptions();
+}
+
+
+void TimedTcpConnection::setResolver( Resolver *resolver )
+{
+  TRACE;
+  m_tcpConnection->setResolver(resolver);
+}
+
+
 TimedTcpConnection::TimedTcpConnection(TcpConnection *tcpConnection,
                                        const unsigned long timeOutSec)
   : StreamConnection("invalid", "invalid")
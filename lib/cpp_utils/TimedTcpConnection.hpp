@@ -10,7 +10,7 @@
 /** @brief Inactivity monitored TCP connection.
  *
  * The timer is created at:
- * - ctor, clone
+ * - its first start, so idle accepted connections have none
  *
  * The timer is restarted after:
  * - connect, send, receive
@@ -41,6 +41,9 @@ public:
   bool connect();
   bool disconnect();
 
+  bool startConnect( bool &inProgress );
+  bool finishConnect();
+
   bool send( const void* message, const size_t length );
   bool receive();
 
@@ -52,6 +55,11 @@ public:
 
   bool closed() const;
 
+  bool setSocketOptions( const SocketOptions &options );
+  const SocketOptions& getSocketOptions() const;
+
+  void setResolver( Resolver *resolver );
+
 private:
 
   TimedTcpConnection(TcpConnection *tcpConnection,
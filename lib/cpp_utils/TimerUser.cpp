@@ -9,7 +9,9 @@
 
 
 TimerUser::TimerUser(const clockid_t clockId)
-  : m_timerId(Timer::createTimer(this, clockId))
+  : m_clockId(clockId)
+  , m_timerCreated(false)
+  , m_timerId(0)
 {
   TRACE;
 }
@@ -19,7 +21,8 @@ TimerUser::~TimerUser()
 {
   TRACE;
 
-  Timer::deleteTimer(m_timerId);
+  if ( m_timerCreated )
+    Timer::deleteTimer(m_timerId);
 }
 
 
@@ -30,6 +33,11 @@ bool TimerUser::startTimer(const time_t interval_sec,
 {
   TRACE;
 
+  if ( !m_timerCreated ) {
+    m_timerId = Timer::createTimer(this, m_clockId);
+    m_timerCreated = true;
+  }
+
   return Timer::setTimer(m_timerId, interval_sec, interval_nsec, initExpr_sec, initExpr_nsec);
 }
 
@@ -38,5 +46,9 @@ bool TimerUser::stopTimer()
 {
   TRACE;
 
+  // never started, nothing to stop
+  if ( !m_timerCreated )
+    return true;
+
   return Timer::setTimer(m_timerId, 0);
 }
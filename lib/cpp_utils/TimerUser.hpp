@@ -29,6 +29,9 @@ private:
   TimerUser(const TimerUser&);
   TimerUser& operator=(const TimerUser&);
 
+  // created on the first start, idle users cost no kernel timer
+  clockid_t m_clockId;
+  bool m_timerCreated;
   timer_t m_timerId;
 
 }; // class TimerUser
@@ -0,0 +1,376 @@
+#include "UnixStreamConnection.hpp"
+
+#include "Logger.hpp"
+#include "Common.hpp"
+
+#include <sys/socket.h>
+#include <sys/uio.h> // iovec
+#include <stddef.h> // offsetof
+#include <unistd.h> // unlink, close
+
+
+UnixStreamConnection::UnixStreamConnection ( const std::string   path,
+                                             Message            *message,
+                                             const size_t        bufferLength )
+  : StreamConnection(path, "")
+  , m_socket(AF_UNIX, SOCK_STREAM)
+  , m_message(message)
+  , m_buffer(0)
+  , m_bufferLength(bufferLength)
+  , m_state(CLOSED)
+  , m_unlinkOnClose(false)
+  , m_receivedFds()
+{
+  TRACE;
+  m_socket.createSocket();
+  m_buffer = new unsigned char[m_bufferLength];
+  m_message->setConnection(this);
+}
+
+
+UnixStreamConnection::~UnixStreamConnection()
+{
+  TRACE;
+
+  if (m_state == OPEN)
+    disconnect();
+
+  while ( !m_receivedFds.empty() ) {
+    close(m_receivedFds.front());
+    m_receivedFds.pop_front();
+  }
+
+  delete[] m_buffer;
+}
+
+
+Connection* UnixStreamConnection::clone(const int socket)
+{
+  TRACE;
+
+  UnixStreamConnection *unixConnection = new UnixStreamConnection(
+                                                      socket,
+                                                      m_host,
+                                                      m_message->clone(),
+                                                      m_bufferLength );
+  return unixConnection;
+}
+
+
+bool UnixStreamConnection::connect()
+{
+  TRACE;
+
+  if (m_state == OPEN) {
+    LOG(Logger::ERR, "Connection is open already.");
+    return false;
+  }
+
+  sockaddr_un address;
+  socklen_t addressLength;
+  if ( !fillAddress(address, addressLength) )
+    return false;
+
+  if ( !m_socket.connect((sockaddr*)&address, addressLength) )
+    return false;
+
+  LOG_BEGIN(Logger::INFO)
+    LOG_PROP("Path", m_host)
+    LOG_PROP("Socket", m_socket.getSocket())
+  LOG_END("Connected to peer.");
+
+  m_state = OPEN;
+  return true;
+}
+
+
+bool UnixStreamConnection::bind()
+{
+  TRACE;
+
+  if (m_state == OPEN) {
+    LOG(Logger::ERR, "Connection is open already.");
+    return false;
+  }
+
+  sockaddr_un address;
+  socklen_t addressLength;
+  if ( !fillAddress(address, addressLength) )
+    return false;
+
+  if ( !m_socket.bind((sockaddr*)&address, addressLength) )
+    return false;
+
+  m_unlinkOnClose = !isAbstract();
+
+  LOG_BEGIN(Logger::INFO)
+    LOG_PROP("Path", m_host)
+  LOG_END("Binded to socket.");
+  return true;
+}
+
+
+bool UnixStreamConnection::listen( const int maxPendingQueueLen )
+{
+  TRACE;
+
+  if (m_state == OPEN) {
+    LOG(Logger::ERR, "Connection is open already.");
+    return false;
+  }
+
+  if (m_socket.listen(maxPendingQueueLen)) {
+    m_state = OPEN;
+    return true;
+  }
+
+  return false;
+}
+
+
+bool UnixStreamConnection::accept(int& client_socket)
+{
+  TRACE;
+  if (m_state == CLOSED)
+    return false;
+
+  return m_socket.accept(client_socket);
+}
+
+
+bool UnixStreamConnection::disconnect()
+{
+  TRACE;
+
+  if (m_unlinkOnClose) {
+    unlink(m_host.c_str());
+    m_unlinkOnClose = false;
+  }
+
+  if (m_state == CLOSED)
+    return false;
+
+  m_state = CLOSED;
+  return m_socket.closeSocket();
+}
+
+
+bool UnixStreamConnection::send( const void* message, const size_t length )
+{
+  TRACE;
+  if (m_state == CLOSED)
+    return false;
+
+  return m_socket.send( message, length );
+}
+
+
+bool UnixStreamConnection::sendFd( const int fd,
+                                   const void* message,
+                                   const size_t length )
+{
+  TRACE;
+  if (m_state == CLOSED)
+    return false;
+
+  if (length == 0) {
+    LOG(Logger::ERR, "Cannot pass file descriptor with an empty message.");
+    return false;
+  }
+
+  iovec iov;
+  iov.iov_base = const_cast<void*>(message);
+  iov.iov_len = length;
+
+  union {
+    char buffer[CMSG_SPACE(sizeof(int))];
+    cmsghdr align;
+  } control;
+  memset(&control, 0, sizeof(control));
+
+  msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buffer;
+  msg.msg_controllen = sizeof(control.buffer);
+
+  cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+  memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+
+  return m_socket.sendMsg(&msg);
+}
+
+
+bool UnixStreamConnection::popReceivedFd( int& fd )
+{
+  TRACE;
+
+  if ( m_receivedFds.empty() )
+    return false;
+
+  fd = m_receivedFds.front();
+  m_receivedFds.pop_front();
+  return true;
+}
+
+
+bool UnixStreamConnection::receive()
+{
+  TRACE;
+
+  if (m_state == CLOSED)
+    return false;
+
+  iovec iov;
+  iov.iov_base = m_buffer;
+  iov.iov_len = m_bufferLength;
+
+  union {
+    char buffer[CMSG_SPACE(sizeof(int) * MAX_FDS_PER_MESSAGE)];
+    cmsghdr align;
+  } control;
+
+  msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buffer;
+  msg.msg_controllen = sizeof(control.buffer);
+
+  ssize_t length;
+  if (!m_socket.receiveMsg(&msg, &length))
+    return false;
+
+  storeReceivedFds(&msg);
+
+  if (length == 0) {
+    LOG_BEGIN(Logger::INFO)
+      LOG_PROP("Path", m_host)
+      LOG_PROP("Socket", m_socket.getSocket())
+    LOG_END("Connection closed by peer.");
+    return false;
+  }
+
+  LOG_BEGIN(Logger::INFO)
+    LOG_PROP("Path", m_host)
+    LOG_PROP("Socket", m_socket.getSocket())
+    LOG_PROP("Bytes", length)
+  LOG_END("Received message from peer.");
+
+  return m_message->buildMessage( (void*)m_buffer, (size_t)length);
+}
+
+
+int UnixStreamConnection::getSocket() const
+{
+  TRACE;
+  return m_socket.getSocket();
+}
+
+
+bool UnixStreamConnection::closed() const
+{
+  TRACE;
+  return m_state == CLOSED;
+}
+
+
+Message* UnixStreamConnection::getMessage() const
+{
+  TRACE;
+  return m_message;
+}
+
+
+size_t UnixStreamConnection::getBufferLength() const
+{
+  TRACE;
+  return m_bufferLength;
+}
+
+
+bool UnixStreamConnection::isAbstract() const
+{
+  TRACE;
+  return !m_host.empty() && m_host[0] == '@';
+}
+
+
+UnixStreamConnection::UnixStreamConnection ( const int           socket,
+                                             const std::string   path,
+                                             Message            *message,
+                                             const size_t        bufferLength )
+  : StreamConnection(path, "")
+  , m_socket(socket)
+  , m_message(message)
+  , m_buffer(0)
+  , m_bufferLength(bufferLength)
+  , m_state(OPEN)
+  , m_unlinkOnClose(false)
+  , m_receivedFds()
+{
+  TRACE;
+
+  m_buffer = new unsigned char[m_bufferLength];
+  m_message->setConnection(this);
+}
+
+
+bool UnixStreamConnection::fillAddress( sockaddr_un &address,
+                                        socklen_t &addressLength ) const
+{
+  TRACE;
+
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+
+  // abstract names have no terminating null, the leading '@' becomes '\0'
+  const size_t maxLength = sizeof(address.sun_path) - (isAbstract() ? 0 : 1);
+  if ( m_host.empty() || m_host.length() > maxLength ) {
+    LOG_BEGIN(Logger::ERR)
+      LOG_PROP("Path", m_host)
+      LOG_PROP("Max length", maxLength)
+    LOG_END("Invalid unix socket path.");
+    return false;
+  }
+
+  memcpy(address.sun_path, m_host.c_str(), m_host.length());
+  if ( isAbstract() ) {
+    address.sun_path[0] = '\0';
+    addressLength = offsetof(sockaddr_un, sun_path) + m_host.length();
+  } else {
+    addressLength = sizeof(address);
+  }
+
+  return true;
+}
+
+
+void UnixStreamConnection::storeReceivedFds( msghdr *message )
+{
+  TRACE;
+
+  if ( message->msg_flags & MSG_CTRUNC ) {
+    LOG( Logger::WARNING, "Ancillary data truncated, file descriptors lost.");
+  }
+
+  for ( cmsghdr *cmsg = CMSG_FIRSTHDR(message);
+        cmsg != 0;
+        cmsg = CMSG_NXTHDR(message, cmsg) ) {
+
+    if ( cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS )
+      continue;
+
+    const size_t numberOfFds = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+    const unsigned char *data = CMSG_DATA(cmsg);
+    for ( size_t i = 0; i < numberOfFds; ++i ) {
+      int fd;
+      memcpy(&fd, data + i * sizeof(int), sizeof(int));
+      m_receivedFds.push_back(fd);
+    }
+  }
+}
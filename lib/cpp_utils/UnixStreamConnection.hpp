@@ -0,0 +1,88 @@
+#ifndef UNIX_STREAM_CONNECTION_HPP
+#define UNIX_STREAM_CONNECTION_HPP
+
+
+#include "StreamConnection.hpp"
+#include "Message.hpp"
+#include "Socket.hpp"
+
+#include <string>
+#include <deque>
+#include <sys/un.h> // sockaddr_un
+
+
+/** @brief Local (AF_UNIX, SOCK_STREAM) connection for same-host IPC.
+ *
+ * The host is the socket path, the port is unused. A path starting with
+ * '@' names a socket in the abstract namespace (no filesystem entry).
+ *
+ * File descriptors can be passed with sendFd(). The received ones are
+ * queued and can be fetched with popReceivedFd(), the caller owns them.
+ */
+
+class UnixStreamConnection : public StreamConnection
+{
+public:
+
+  enum State {
+    OPEN,
+    CLOSED
+  };
+
+  // max number of descriptors read along with one receive()
+  static const size_t MAX_FDS_PER_MESSAGE = 16;
+
+  UnixStreamConnection ( const std::string   path,
+                         Message            *message,
+                         const size_t        bufferLength = 1024 );
+
+  virtual ~UnixStreamConnection();
+
+  Connection* clone(const int socket);
+
+  bool connect();
+  bool disconnect();
+
+  bool send( const void* message, const size_t length );
+  bool receive();
+
+  // message shall not be empty: ancillary data needs at least one byte
+  bool sendFd( const int fd, const void* message, const size_t length );
+  bool popReceivedFd( int& fd );
+
+  bool bind();
+  bool listen( const int maxPendingQueueLen = 64 );
+  bool accept(int& client_socket);
+
+  int getSocket() const;
+
+  bool closed() const;
+  Message *getMessage() const;
+  size_t getBufferLength() const;
+
+  bool isAbstract() const;
+
+private:
+
+  UnixStreamConnection ( const int           socket,
+                         const std::string   path,
+                         Message            *message,
+                         const size_t        bufferLength = 1024 );
+
+  UnixStreamConnection(const UnixStreamConnection&);
+  UnixStreamConnection& operator=(const UnixStreamConnection&);
+
+  bool fillAddress( sockaddr_un &address, socklen_t &addressLength ) const;
+  void storeReceivedFds( msghdr *message );
+
+  Socket           m_socket;
+  Message         *m_message;
+  unsigned char   *m_buffer;
+  size_t           m_bufferLength;
+  State            m_state;
+  bool             m_unlinkOnClose;
+  std::deque<int>  m_receivedFds;
+};
+
+
+#endif // UNIX_STREAM_CONNECTION_HPP
@@ -17,7 +17,9 @@ void* WorkerThread::run()
   {
     Task* task(0);
     try {
-      task = m_tp.popTask();
+      task = m_tp.popTask(this);
+      if ( task == 0 )
+        break;  // the elastic pool has enough without this one
       task->run();
       delete task;
     } catch (CancelledException) {
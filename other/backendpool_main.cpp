@@ -0,0 +1,147 @@
+#include <cpp_utils/Logger.hpp>
+#include <cpp_utils/Common.hpp>
+#include <cpp_utils/Thread.hpp>
+#include <cpp_utils/TcpConnection.hpp>
+#include <cpp_utils/BackendPool.hpp>
+
+#include <atomic>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <stdlib.h> // atoi
+
+
+/// @brief stores the last reply, enough for a request-response echo
+class ReplyMessage : public Message
+{
+public:
+
+  ReplyMessage( void *msgParam = 0 )
+    : Message(msgParam)
+  {
+    TRACE;
+  }
+
+  bool buildMessage( const void *msgPart, const size_t msgLen )
+  {
+    TRACE;
+    m_buffer.assign( (const char*)msgPart, msgLen );
+    return true;
+  }
+
+  void onMessageReady() {}
+  Message* clone() { return new ReplyMessage(m_param); }
+
+protected:
+
+  size_t getExpectedLength() { return 0; }
+};
+
+
+/// @brief owns its message, so the pool can delete it with the connection
+class PooledConnection : private std::unique_ptr<ReplyMessage>
+                       , public TcpConnection
+{
+public:
+
+  PooledConnection( const std::string &host, const std::string &port )
+    : std::unique_ptr<ReplyMessage>(new ReplyMessage)
+    , TcpConnection(host, port, get())
+  {
+  }
+};
+
+
+class RequestThread : public Thread
+{
+public:
+
+  RequestThread( BackendPool &pool, const int requests, std::atomic<int> &failures )
+    : m_pool(pool)
+    , m_requests(requests)
+    , m_failures(failures)
+  {
+  }
+
+private:
+
+  void* run()
+  {
+    const std::string request("ping");
+    for ( int i = 0; i < m_requests; ++i ) {
+      StreamConnection *connection = m_pool.acquire();
+      if ( connection == 0 ) {
+        m_failures++;
+        continue;
+      }
+
+      const bool ok = connection->send(request.c_str(), request.length()) &&
+                      connection->receive();
+      if ( !ok )
+        m_failures++;
+      m_pool.release(connection, ok);
+    }
+    return 0;
+  }
+
+  BackendPool       &m_pool;
+  const int          m_requests;
+  std::atomic<int>  &m_failures;
+};
+
+
+int main(int argc, char* argv[] )
+{
+  if ( argc < 4 ) {
+    std::cerr << "Fans out echo requests to tcpserver instances." << std::endl
+              << "Usage: " << argv[0]
+              << " <THREADS> <REQUESTS PER THREAD> <HOST:PORT>..." << std::endl;
+    return 1;
+  }
+
+  Logger::createInstance();
+  Logger::init(std::cout);
+  Logger::setLogLevel(Logger::WARNING);
+
+  const int threads = atoi(argv[1]);
+  const int requests = atoi(argv[2]);
+
+  BackendPool pool( [](const std::string &host, const std::string &port)
+                    { return new PooledConnection(host, port); },
+                    BackendPool::POWER_OF_TWO_CHOICES, 1, threads );
+
+  for ( int i = 3; i < argc; ++i ) {
+    const std::string backend(argv[i]);
+    const size_t colon = backend.rfind(':');
+    if ( colon == std::string::npos ) {
+      std::cerr << "Not HOST:PORT: " << backend << std::endl;
+      Logger::destroy();
+      return 1;
+    }
+    pool.addBackend(backend.substr(0, colon), backend.substr(colon + 1));
+  }
+
+  std::cout << "Healthy backends: " << pool.getNumberOfHealthyBackends()
+            << "/" << pool.getNumberOfBackends() << std::endl;
+
+  std::atomic<int> failures(0);
+  std::vector<RequestThread*> workers;
+  for ( int i = 0; i < threads; ++i ) {
+    workers.push_back(new RequestThread(pool, requests, failures));
+    workers.back()->start();
+  }
+
+  for ( int i = 0; i < threads; ++i ) {
+    workers[i]->join();
+    delete workers[i];
+  }
+
+  std::cout << "Requests: " << threads * requests
+            << " failed: " << failures << std::endl;
+
+  Logger::destroy();
+  return 0;
+}
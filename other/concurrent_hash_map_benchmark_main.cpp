@@ -0,0 +1,183 @@
+// run with
+// ./concurrent_hash_map_benchmark 8 1000000
+
+
+#include <cpp_utils/Logger.hpp>
+#include <cpp_utils/Common.hpp>
+#include <cpp_utils/Thread.hpp>
+#include <cpp_utils/Mutex.hpp>
+#include <cpp_utils/ScopedLock.hpp>
+#include <cpp_utils/ConcurrentHashMap.hpp>
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <map>
+
+#include <time.h> // clock_gettime
+#include <stdint.h> // uint32_t
+
+
+const int KEYS = 100000;
+
+
+/// @brief what the library had: one lock for the whole map
+class LockedMap
+{
+public:
+
+  LockedMap() : m_mutex(), m_map() {}
+
+  bool find( const int key, int &value ) const
+  {
+    ScopedLock sl(m_mutex);
+    std::map<int, int>::const_iterator it = m_map.find(key);
+    if ( it == m_map.end() )
+      return false;
+    value = it->second;
+    return true;
+  }
+
+  bool insert( const int key, const int value )
+  {
+    ScopedLock sl(m_mutex);
+    return m_map.insert(std::make_pair(key, value)).second;
+  }
+
+  bool erase( const int key )
+  {
+    ScopedLock sl(m_mutex);
+    return m_map.erase(key) > 0;
+  }
+
+private:
+
+  LockedMap(const LockedMap&);
+  LockedMap& operator=(const LockedMap&);
+
+  mutable Mutex m_mutex;
+  std::map<int, int> m_map;
+};
+
+
+/// @brief 90% finds, 10% erase and insert of random keys
+template <typename Map>
+class BenchmarkThread : public Thread
+{
+public:
+
+  BenchmarkThread( Map &map, const int operations, const uint32_t seed )
+    : m_map(map)
+    , m_operations(operations)
+    , m_seed(seed)
+    , m_found(0)
+  {
+    TRACE;
+  }
+
+  int getFound() const { return m_found; }
+
+private:
+
+  BenchmarkThread(const BenchmarkThread&);
+  BenchmarkThread& operator=(const BenchmarkThread&);
+
+  void* run()
+  {
+    TRACE;
+    int value;
+    for ( int i = 0; i < m_operations; ++i ) {
+      // xorshift, rand() has a lock of its own
+      m_seed ^= m_seed << 13;
+      m_seed ^= m_seed >> 17;
+      m_seed ^= m_seed << 5;
+      const int key = m_seed % KEYS;
+
+      if ( m_seed % 10 != 0 ) {
+        m_found += m_map.find(key, value);
+      } else if ( !m_map.erase(key) ) {
+        m_map.insert(key, key);
+      }
+    }
+    return 0;
+  }
+
+  Map        &m_map;
+  const int   m_operations;
+  uint32_t    m_seed;
+  int         m_found;
+};
+
+
+double now()
+{
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+template <typename Map>
+double run( Map &map, const int threads, const int operations )
+{
+  for ( int key = 0; key < KEYS; key += 2 )
+    map.insert(key, key);
+
+  std::vector<BenchmarkThread<Map>*> workers;
+  for ( int i = 0; i < threads; ++i )
+    workers.push_back(new BenchmarkThread<Map>(map, operations / threads, 2463534242u + i));
+
+  const double start = now();
+  for ( int i = 0; i < threads; ++i )
+    workers[i]->start();
+  for ( int i = 0; i < threads; ++i )
+    workers[i]->join();
+  const double seconds = now() - start;
+
+  for ( int i = 0; i < threads; ++i )
+    delete workers[i];
+  return seconds;
+}
+
+
+void report( const std::string &name,
+             const int threads,
+             const int operations,
+             const double seconds )
+{
+  std::cout << std::left << std::setw(20) << name
+            << std::right << std::setw(4) << threads << " threads "
+            << std::setw(12) << std::fixed << std::setprecision(0)
+            << operations / seconds << " ops/s" << std::endl;
+}
+
+
+int main(int argc, char* argv[] )
+{
+  if ( argc != 3 ) {
+    std::cerr << "Usage: " << argv[0]
+              << " <MAX_THREADS> <OPERATIONS>" << std::endl;
+    return 1;
+  }
+
+  Logger::createInstance();
+  Logger::init(std::cout);
+  Logger::setLogLevel(Logger::ERR);
+
+  const int maxThreads = StrToT<int>(argv[1]);
+  const int operations = StrToT<int>(argv[2]);
+
+  for ( int threads = 1; threads <= maxThreads; threads *= 2 ) {
+    LockedMap lockedMap;
+    report("std::map + Mutex", threads, operations,
+           run(lockedMap, threads, operations));
+
+    ConcurrentHashMap<int, int> hashMap(64);
+    report("ConcurrentHashMap", threads, operations,
+           run(hashMap, threads, operations));
+  }
+
+  Logger::destroy();
+  return 0;
+}
@@ -0,0 +1,206 @@
+// run with
+// ./rwlock_benchmark 8 1000000 99
+
+
+#include <cpp_utils/Logger.hpp>
+#include <cpp_utils/Common.hpp>
+#include <cpp_utils/Thread.hpp>
+#include <cpp_utils/Mutex.hpp>
+#include <cpp_utils/RWLock.hpp>
+#include <cpp_utils/ScopedLock.hpp>
+#include <cpp_utils/PerCpuRWLock.hpp>
+#include <cpp_utils/SeqLock.hpp>
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+#include <time.h> // clock_gettime
+#include <stdint.h> // uint32_t
+
+
+/// @brief the read-mostly data: a few counters updated together
+struct Stats
+{
+  long requests;
+  long bytes;
+  long errors;
+  long latency;
+};
+
+
+class MutexStats
+{
+public:
+
+  MutexStats() : m_mutex(), m_stats() {}
+  Stats read() { ScopedLock sl(m_mutex); return m_stats; }
+  void write( const Stats &stats ) { ScopedLock sl(m_mutex); m_stats = stats; }
+
+private:
+
+  Mutex m_mutex;
+  Stats m_stats;
+};
+
+
+class RWLockStats
+{
+public:
+
+  RWLockStats() : m_rwLock(), m_stats() {}
+  Stats read() { ScopedReadLock rl(m_rwLock); return m_stats; }
+  void write( const Stats &stats ) { ScopedWriteLock wl(m_rwLock); m_stats = stats; }
+
+private:
+
+  RWLock m_rwLock;
+  Stats m_stats;
+};
+
+
+class PerCpuStats
+{
+public:
+
+  PerCpuStats() : m_rwLock(), m_stats() {}
+  Stats read() { ScopedPerCpuReadLock rl(m_rwLock); return m_stats; }
+  void write( const Stats &stats ) { ScopedPerCpuWriteLock wl(m_rwLock); m_stats = stats; }
+
+private:
+
+  PerCpuRWLock m_rwLock;
+  Stats m_stats;
+};
+
+
+class SeqLockStats
+{
+public:
+
+  SeqLockStats() : m_stats() {}
+  Stats read() { return m_stats.read(); }
+  void write( const Stats &stats ) { m_stats.write(stats); }
+
+private:
+
+  SeqLock<Stats> m_stats;
+};
+
+
+/// @brief reads, writes in every (100 - readPercent)%
+template <typename Protected>
+class BenchmarkThread : public Thread
+{
+public:
+
+  BenchmarkThread( Protected &data,
+                   const int operations,
+                   const int readPercent,
+                   const uint32_t seed )
+    : m_data(data)
+    , m_operations(operations)
+    , m_readPercent(readPercent)
+    , m_seed(seed)
+    , m_sum(0)
+  {
+    TRACE;
+  }
+
+  long getSum() const { return m_sum; }
+
+private:
+
+  BenchmarkThread(const BenchmarkThread&);
+  BenchmarkThread& operator=(const BenchmarkThread&);
+
+  void* run()
+  {
+    TRACE;
+    for ( int i = 0; i < m_operations; ++i ) {
+      m_seed ^= m_seed << 13;
+      m_seed ^= m_seed >> 17;
+      m_seed ^= m_seed << 5;
+
+      if ( (int)(m_seed % 100) < m_readPercent ) {
+        m_sum += m_data.read().requests;
+      } else {
+        const Stats stats = { i, i, i, i };
+        m_data.write(stats);
+      }
+    }
+    return 0;
+  }
+
+  Protected  &m_data;
+  const int   m_operations;
+  const int   m_readPercent;
+  uint32_t    m_seed;
+  long        m_sum;
+};
+
+
+double now()
+{
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+template <typename Protected>
+void run( const std::string &name,
+          const int threads,
+          const int operations,
+          const int readPercent )
+{
+  Protected data;
+  std::vector<BenchmarkThread<Protected>*> workers;
+  for ( int i = 0; i < threads; ++i )
+    workers.push_back(new BenchmarkThread<Protected>(data, operations / threads,
+                                                     readPercent, 2463534242u + i));
+
+  const double start = now();
+  for ( int i = 0; i < threads; ++i )
+    workers[i]->start();
+  for ( int i = 0; i < threads; ++i )
+    workers[i]->join();
+  const double seconds = now() - start;
+
+  for ( int i = 0; i < threads; ++i )
+    delete workers[i];
+
+  std::cout << std::left << std::setw(14) << name
+            << std::right << std::setw(4) << threads << " threads "
+            << std::setw(12) << std::fixed << std::setprecision(0)
+            << operations / seconds << " ops/s" << std::endl;
+}
+
+
+int main(int argc, char* argv[] )
+{
+  if ( argc != 4 ) {
+    std::cerr << "Usage: " << argv[0]
+              << " <MAX_THREADS> <OPERATIONS> <READ_PERCENT>" << std::endl;
+    return 1;
+  }
+
+  Logger::createInstance();
+  Logger::init(std::cout);
+  Logger::setLogLevel(Logger::ERR);
+
+  const int maxThreads = StrToT<int>(argv[1]);
+  const int operations = StrToT<int>(argv[2]);
+  const int readPercent = StrToT<int>(argv[3]);
+
+  for ( int threads = 1; threads <= maxThreads; threads *= 2 ) {
+    run<MutexStats>("Mutex", threads, operations, readPercent);
+    run<RWLockStats>("RWLock", threads, operations, readPercent);
+    run<PerCpuStats>("PerCpuRWLock", threads, operations, readPercent);
+    run<SeqLockStats>("SeqLock", threads, operations, readPercent);
+  }
+
+  Logger::destroy();
+  return 0;
+}
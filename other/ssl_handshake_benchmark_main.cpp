@@ -0,0 +1,191 @@
+// run with
+// ./ssl_handshake_benchmark 1000 ./cert.pem ./key.pem
+
+
+#include <cpp_utils/Logger.hpp>
+#include <cpp_utils/Common.hpp>
+#include <cpp_utils/Thread.hpp>
+#include <cpp_utils/TcpConnection.hpp>
+#include <cpp_utils/SocketOptions.hpp>
+#include <cpp_utils/SslConnection.hpp>
+#include <cpp_utils/SslClientContext.hpp>
+#include <cpp_utils/SslSessionCache.hpp>
+
+#include "PrintMessage.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+
+#include <time.h> // clock_gettime
+#include <unistd.h> // close
+
+#include <openssl/ssl.h>
+
+
+/// @brief handshakes, then waits for the close notify
+class HandshakeServerThread : public Thread
+{
+public:
+
+  HandshakeServerThread( TcpConnection &listener,
+                         SSL_CTX *context,
+                         const int connections )
+    : m_listener(listener)
+    , m_context(context)
+    , m_connections(connections)
+  {
+    TRACE;
+  }
+
+private:
+
+  HandshakeServerThread(const HandshakeServerThread&);
+  HandshakeServerThread& operator=(const HandshakeServerThread&);
+
+  void* run()
+  {
+    TRACE;
+    for ( int i = 0; i < m_connections; ++i ) {
+      int socket;
+      if ( !m_listener.accept(socket) )
+        break;
+
+      SSL *ssl = SSL_new(m_context);
+      SSL_set_fd(ssl, socket);
+      if ( SSL_accept(ssl) == 1 ) {
+        char buffer[16];
+        while ( SSL_read(ssl, buffer, sizeof(buffer)) > 0 )
+          ;
+        SSL_shutdown(ssl);
+      }
+      SSL_free(ssl);
+      close(socket);
+    }
+    return 0;
+  }
+
+  TcpConnection  &m_listener;
+  SSL_CTX        *m_context;
+  const int       m_connections;
+};
+
+
+double now()
+{
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+void report( const std::string &name,
+             const int handshakes,
+             const double seconds )
+{
+  std::cout << std::left << std::setw(16) << name
+            << std::right << std::setw(10) << std::fixed << std::setprecision(2)
+            << seconds * 1e6 / handshakes << " us/handshake "
+            << std::setw(10) << std::setprecision(0)
+            << handshakes / seconds << " handshakes/s" << std::endl;
+}
+
+
+/// @note a new connection and context each time, as without SslClientContext
+double fullHandshakes( const std::string &port, const int handshakes )
+{
+  PrintMessage msg;
+  const double start = now();
+  for ( int i = 0; i < handshakes; ++i ) {
+    SslConnection conn("localhost", port, &msg);
+    if ( !conn.initClientContext() || !conn.connect() )
+      return -1;
+    conn.disconnect();
+  }
+  return now() - start;
+}
+
+
+double resumedHandshakes( const std::string &port, const int handshakes )
+{
+  PrintMessage msg;
+  SslClientContext clientContext;
+  const double start = now();
+  for ( int i = 0; i < handshakes; ++i ) {
+    SslConnection conn("localhost", port, &msg);
+    if ( !conn.initClientContext(&clientContext) || !conn.connect() )
+      return -1;
+    conn.disconnect();
+  }
+  const double seconds = now() - start;
+
+  // the first one is full
+  std::cout << "resumed " << clientContext.getHits() << "/" << handshakes << std::endl;
+  return seconds;
+}
+
+
+int main(int argc, char* argv[] )
+{
+  if ( argc != 4 && argc != 5 ) {
+    std::cerr << "Usage: " << argv[0]
+              << " <HANDSHAKES> <CERT> <PRIVKEY> [TCP_PORT]" << std::endl;
+    return 1;
+  }
+
+  Logger::createInstance();
+  Logger::init(std::cout);
+  Logger::setLogLevel(Logger::ERR);
+  SslConnection::init();
+
+  const int handshakes = StrToT<int>(argv[1]);
+  const std::string port(argc == 5 ? argv[4] : "4456");
+
+  SslSessionCache sessionCache;
+  SSL_CTX *context = SSL_CTX_new(SSLv23_server_method());
+  if ( context == 0 ||
+       SSL_CTX_use_certificate_file(context, argv[2], SSL_FILETYPE_PEM) != 1 ||
+       SSL_CTX_use_PrivateKey_file(context, argv[3], SSL_FILETYPE_PEM) != 1 ||
+       !sessionCache.attach(context) ) {
+    LOG_STATIC( Logger::ERR, "Failed to init SSL context, exiting...");
+    SSL_CTX_free(context);
+    SslConnection::destroy();
+    Logger::destroy();
+    return 1;
+  }
+
+  PrintMessage serverMessage;
+  TcpConnection listener("localhost", port, &serverMessage);
+  listener.setSocketOptions(SocketOptions().set(SocketOptions::ReuseAddress, 1));
+  if ( !listener.bind() || !listener.listen() ) {
+    LOG_STATIC( Logger::ERR, "Failed to listen, exiting...");
+    SSL_CTX_free(context);
+    SslConnection::destroy();
+    Logger::destroy();
+    return 1;
+  }
+
+  HandshakeServerThread server(listener, context, 2 * handshakes);
+  server.start();
+
+  const double full = fullHandshakes(port, handshakes);
+  if ( full < 0 ) {
+    LOG_STATIC( Logger::ERR, "Full handshake benchmark failed.");
+  } else {
+    report("full", handshakes, full);
+  }
+
+  const double resumed = resumedHandshakes(port, handshakes);
+  if ( resumed < 0 ) {
+    LOG_STATIC( Logger::ERR, "Resumed handshake benchmark failed.");
+  } else {
+    report("resumed", handshakes, resumed);
+  }
+
+  server.join();
+  listener.disconnect();
+  SSL_CTX_free(context);
+  SslConnection::destroy();
+  Logger::destroy();
+  return 0;
+}
@@ -0,0 +1,219 @@
+#include <cpp_utils/Logger.hpp>
+#include <cpp_utils/Common.hpp>
+#include <cpp_utils/Thread.hpp>
+#include <cpp_utils/TcpConnection.hpp>
+#include <cpp_utils/UnixStreamConnection.hpp>
+#include <cpp_utils/ShmConnection.hpp>
+
+#include "EchoMessage.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+
+#include <time.h> // clock_gettime
+#include <unistd.h> // getpid
+
+
+/// @brief counts the echoed bytes, the sender waits until a full reply
+class CountMessage : public Message
+{
+public:
+
+  CountMessage( void *msgParam = 0 )
+    : Message(msgParam)
+    , m_received(0)
+  {
+    TRACE;
+  }
+
+  bool buildMessage( const void*, const size_t msgLen )
+  {
+    TRACE;
+    m_received += msgLen;
+    return true;
+  }
+
+  void onMessageReady() {}
+  Message* clone() { return new CountMessage(m_param); }
+
+  size_t m_received;
+
+protected:
+
+  size_t getExpectedLength() { return 0; }
+};
+
+
+/// @brief echoes everything back until the peer goes away
+class EchoThread : public Thread
+{
+public:
+
+  EchoThread( Connection *connection )
+    : m_connection(connection)
+  {
+    TRACE;
+  }
+
+private:
+
+  EchoThread(const EchoThread&);
+  EchoThread& operator=(const EchoThread&);
+
+  void* run()
+  {
+    TRACE;
+    while ( m_isRunning && m_connection->receive() )
+      ;
+    return 0;
+  }
+
+  Connection *m_connection;
+};
+
+
+double now()
+{
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+void report( const std::string &name,
+             const int roundTrips,
+             const size_t messageLength,
+             const double seconds )
+{
+  std::cout << std::left << std::setw(16) << name
+            << std::right << std::setw(8) << messageLength << " B "
+            << std::setw(10) << std::fixed << std::setprecision(2)
+            << seconds * 1e6 / roundTrips << " us/rtt "
+            << std::setw(12) << std::setprecision(0)
+            << roundTrips / seconds << " rtt/s" << std::endl;
+}
+
+
+/// @note ping-pong, only one message is in flight
+double pingPong( Connection *client,
+                 CountMessage &clientMessage,
+                 const int roundTrips,
+                 const std::string &payload )
+{
+  const double start = now();
+  for ( int i = 0; i < roundTrips; ++i ) {
+    clientMessage.m_received = 0;
+    client->send(payload.c_str(), payload.length());
+    while ( clientMessage.m_received < payload.length() )
+      if ( !client->receive() )
+        return -1;
+  }
+  return now() - start;
+}
+
+
+template <typename T>
+bool benchmarkStream( const std::string &name,
+                      T &server,
+                      T &client,
+                      CountMessage &clientMessage,
+                      const int roundTrips,
+                      const std::string &payload )
+{
+  if ( !server.bind() || !server.listen() || !client.connect() )
+    return false;
+
+  int clientSocket;
+  if ( !server.accept(clientSocket) )
+    return false;
+
+  Connection *peer = server.clone(clientSocket);
+  EchoThread echo(peer);
+  echo.start();
+
+  const double seconds = pingPong(&client, clientMessage, roundTrips, payload);
+
+  client.disconnect();
+  echo.join();
+  delete peer;
+  server.disconnect();
+
+  report(name, roundTrips, payload.length(), seconds);
+  return seconds > 0;
+}
+
+
+bool benchmarkShm( const int roundTrips, const std::string &payload )
+{
+  const std::string name = "/cpp_utils_bench_" + TToStr(getpid());
+
+  EchoMessage serverMessage;
+  CountMessage clientMessage;
+  ShmConnection server(name, &serverMessage);
+  ShmConnection client(name, &clientMessage);
+
+  if ( !server.bind() || !client.connect() )
+    return false;
+
+  EchoThread echo(&server);
+  echo.start();
+
+  const double seconds = pingPong(&client, clientMessage, roundTrips, payload);
+
+  client.disconnect();
+  echo.join();
+  server.disconnect();
+
+  report("shared memory", roundTrips, payload.length(), seconds);
+  return seconds > 0;
+}
+
+
+int main(int argc, char* argv[] )
+{
+  if ( argc != 3 && argc != 4 ) {
+    std::cerr << "Usage: " << argv[0]
+              << " <ROUND_TRIPS> <MSG_LENGTH> [TCP_PORT]" << std::endl;
+    return 1;
+  }
+
+  Logger::createInstance();
+  Logger::init(std::cout);
+  Logger::setLogLevel(Logger::ERR);
+
+  const int roundTrips = StrToT<int>(argv[1]);
+  const std::string payload(StrToT<size_t>(argv[2]), 'x');
+  const std::string port(argc == 4 ? argv[3] : "4455");
+
+  {
+    EchoMessage serverMessage;
+    CountMessage clientMessage;
+    TcpConnection server("localhost", port, &serverMessage,
+                         payload.length() + 1024);
+    TcpConnection client("localhost", port, &clientMessage,
+                         payload.length() + 1024);
+    if ( !benchmarkStream("tcp loopback", server, client, clientMessage,
+                          roundTrips, payload) )
+      LOG_STATIC( Logger::ERR, "TCP benchmark failed.");
+  }
+
+  {
+    const std::string path = "@cpp_utils_bench_" + TToStr(getpid());
+    EchoMessage serverMessage;
+    CountMessage clientMessage;
+    UnixStreamConnection server(path, &serverMessage,
+                                payload.length() + 1024);
+    UnixStreamConnection client(path, &clientMessage,
+                                payload.length() + 1024);
+    if ( !benchmarkStream("unix socket", server, client, clientMessage,
+                          roundTrips, payload) )
+      LOG_STATIC( Logger::ERR, "Unix socket benchmark failed.");
+  }
+
+  if ( !benchmarkShm(roundTrips, payload) )
+    LOG_STATIC( Logger::ERR, "Shared memory benchmark failed.");
+
+  Logger::destroy();
+  return 0;
+}
@@ -0,0 +1,272 @@
+#include <cxxtest/TestSuite.h>
+
+#include "Fixture.hpp"
+
+#include <cpp_utils/BackendPool.hpp>
+#include <cpp_utils/TcpConnection.hpp>
+#include <cpp_utils/SocketServer.hpp>
+#include <cpp_utils/SocketOptions.hpp>
+#include <cpp_utils/Thread.hpp>
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <unistd.h> // usleep, close
+#include <string.h> // memset
+#include <time.h> // clock_gettime
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+class TestBackendPool : public CxxTest::TestSuite
+{
+private:
+
+  class EchoMessage : public Message
+  {
+  public:
+
+    EchoMessage() : Message() {}
+
+    bool buildMessage( const void *msgPart, const size_t msgLen )
+    {
+      m_buffer = std::string( (const char*) msgPart, msgLen );
+      onMessageReady();
+      return true;
+    }
+    void onMessageReady() { m_connection->send(m_buffer.c_str(), m_buffer.length()); }
+    Message* clone() { return new EchoMessage; }
+
+  protected:
+
+    size_t getExpectedLength() { return 0; }
+
+  }; // EchoMessage
+
+  class StoreMessage : public Message
+  {
+  public:
+
+    StoreMessage() : Message() {}
+
+    bool buildMessage( const void *msgPart, const size_t msgLen )
+    {
+      m_buffer = std::string( (const char*) msgPart, msgLen );
+      return true;
+    }
+    void onMessageReady() {}
+    Message* clone() { return new StoreMessage; }
+    std::string get() const { return m_buffer; }
+
+  protected:
+
+    size_t getExpectedLength() { return 0; }
+
+  }; // StoreMessage
+
+  // the echo server of other/tcpserver_main.cpp, on a thread
+  class EchoServerThread : public Thread
+  {
+  public:
+
+    EchoServerThread( const std::string port )
+      : m_message()
+      , m_connection("localhost", port, &m_message)
+      , m_server(&m_connection, 8, 10, 100)
+    {
+      m_connection.setSocketOptions(SocketOptions().set(SocketOptions::ReuseAddress, 1));
+      start();
+    }
+
+    ~EchoServerThread()
+    {
+      m_server.stop();
+      join();
+    }
+
+  private:
+
+    void* run()
+    {
+      m_server.start();
+      return 0;
+    }
+
+    EchoMessage    m_message;
+    TcpConnection  m_connection;
+    SocketServer   m_server;
+  };
+
+  // the pool owns the connections, the test their messages
+  static BackendPool::Factory factory( std::vector< std::shared_ptr<StoreMessage> > &messages )
+  {
+    return [&messages](const std::string &host, const std::string &port)
+      {
+        messages.push_back( std::make_shared<StoreMessage>() );
+        return new TcpConnection(host, port, messages.back().get());
+      };
+  }
+
+  static std::string echo( StreamConnection *connection, const std::string &msg )
+  {
+    if ( !connection->send(msg.c_str(), msg.length()) || !connection->receive() )
+      return std::string();
+
+    TcpConnection *tcpConnection = static_cast<TcpConnection*>(connection);
+    return static_cast<StoreMessage*>(tcpConnection->getMessage())->get();
+  }
+
+  static bool waitForHealthy( const BackendPool &pool, const size_t healthy )
+  {
+    for ( int i = 0; i < 300 && pool.getNumberOfHealthyBackends() != healthy; ++i )
+      usleep(10000);
+    return pool.getNumberOfHealthyBackends() == healthy;
+  }
+
+public:
+
+  void testLeastOutstanding()
+  {
+    TEST_HEADER;
+
+    EchoServerThread server1("4501");
+    EchoServerThread server2("4502");
+    usleep(100000);
+
+    std::vector< std::shared_ptr<StoreMessage> > messages;
+    BackendPool pool(factory(messages), BackendPool::LEAST_OUTSTANDING, 1, 2);
+    TS_ASSERT_EQUALS(pool.addBackend("localhost", "4501"), true);
+    TS_ASSERT_EQUALS(pool.addBackend("localhost", "4502"), true);
+    TS_ASSERT_EQUALS(pool.addBackend("localhost", "4502"), false);
+    TS_ASSERT_EQUALS(pool.getNumberOfHealthyBackends(), 2u);
+
+    // spread evenly while requests are outstanding
+    StreamConnection *c1 = pool.acquire();
+    StreamConnection *c2 = pool.acquire();
+    TS_ASSERT_EQUALS(pool.getOutstanding("localhost", "4501"), 1);
+    TS_ASSERT_EQUALS(pool.getOutstanding("localhost", "4502"), 1);
+    StreamConnection *c3 = pool.acquire();
+    StreamConnection *c4 = pool.acquire();
+    TS_ASSERT_EQUALS(pool.getOutstanding("localhost", "4501"), 2);
+    TS_ASSERT_EQUALS(pool.getOutstanding("localhost", "4502"), 2);
+
+    // maxConnections reached everywhere
+    TS_ASSERT_EQUALS(pool.acquire() == 0, true);
+
+    TS_ASSERT_EQUALS(echo(c1, "one"), std::string("one"));
+    TS_ASSERT_EQUALS(echo(c4, "four"), std::string("four"));
+
+    pool.release(c1);
+    pool.release(c2);
+    pool.release(c3);
+    pool.release(c4);
+    TS_ASSERT_EQUALS(pool.getOutstanding("localhost", "4501"), 0);
+    TS_ASSERT_EQUALS(pool.getOutstanding("localhost", "4502"), 0);
+
+    // reused, no new connection
+    const size_t created = messages.size();
+    pool.release(pool.acquire());
+    TS_ASSERT_EQUALS(messages.size(), created);
+
+    TS_ASSERT_EQUALS(pool.removeBackend("localhost", "4501"), true);
+    TS_ASSERT_EQUALS(pool.getNumberOfBackends(), 1u);
+    TS_ASSERT_EQUALS(pool.getOutstanding("localhost", "4501"), -1);
+  }
+
+  void testDestroyWithRemovedInUse()
+  {
+    TEST_HEADER;
+
+    EchoServerThread server("4505");
+    usleep(100000);
+
+    // the removed backend goes with the pool, not released
+    std::vector< std::shared_ptr<StoreMessage> > messages;
+    {
+      BackendPool pool(factory(messages), BackendPool::LEAST_OUTSTANDING, 1, 2);
+      TS_ASSERT_EQUALS(pool.addBackend("localhost", "4505"), true);
+      StreamConnection *c = pool.acquire();
+      TS_ASSERT_EQUALS(c == 0, false);
+      TS_ASSERT_EQUALS(pool.removeBackend("localhost", "4505"), true);
+      TS_ASSERT_EQUALS(pool.getNumberOfBackends(), 0u);
+    }
+  }
+
+  void testConnectTimeout()
+  {
+    TEST_HEADER;
+
+    // a listener with its backlog full drops the SYNs
+    const int listener = socket(AF_INET, SOCK_STREAM, 0);
+    const int one(1);
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(4506);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    TS_ASSERT_EQUALS(bind(listener, (sockaddr*)&address, sizeof(address)), 0);
+    TS_ASSERT_EQUALS(listen(listener, 0), 0);
+
+    std::vector<int> pending;
+    for ( int i = 0; i < 4; ++i ) {
+      pending.push_back(socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0));
+      connect(pending.back(), (sockaddr*)&address, sizeof(address));
+    }
+    usleep(100000);
+
+    std::vector< std::shared_ptr<StoreMessage> > messages;
+    BackendPool pool(factory(messages), BackendPool::POWER_OF_TWO_CHOICES, 1, 4, 3, 50, 100);
+
+    timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    TS_ASSERT_EQUALS(pool.addBackend("127.0.0.1", "4506"), true);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    TS_ASSERT( end.tv_sec - start.tv_sec < 2 );
+    TS_ASSERT_EQUALS(pool.getNumberOfHealthyBackends(), 0u);
+    TS_ASSERT_EQUALS(pool.acquire() == 0, true);
+
+    for ( size_t i = 0; i < pending.size(); ++i )
+      close(pending[i]);
+    close(listener);
+  }
+
+  void testEjectAndProbe()
+  {
+    TEST_HEADER;
+
+    EchoServerThread server1("4503");
+    usleep(100000);
+
+    std::vector< std::shared_ptr<StoreMessage> > messages;
+    BackendPool pool(factory(messages), BackendPool::POWER_OF_TWO_CHOICES, 1, 4, 2, 50);
+    TS_ASSERT_EQUALS(pool.addBackend("localhost", "4503"), true);
+
+    // nobody listens yet
+    TS_ASSERT_EQUALS(pool.addBackend("localhost", "4504"), true);
+    TS_ASSERT_EQUALS(pool.getNumberOfHealthyBackends(), 1u);
+
+    for ( int i = 0; i < 10; ++i ) {
+      StreamConnection *c = pool.acquire();
+      TS_ASSERT_EQUALS(c->getPort(), std::string("4503"));
+      pool.release(c);
+    }
+
+    // reinstated by the prober once it is up
+    {
+      EchoServerThread server2("4504");
+      TS_ASSERT_EQUALS(waitForHealthy(pool, 2), true);
+
+      // failures eject again, then probing brings it back
+      bool ejected(false);
+      for ( int i = 0; i < 100 && !ejected; ++i ) {
+        StreamConnection *c = pool.acquire();
+        const bool fail = c->getPort() == "4504";
+        pool.release(c, !fail);
+        ejected = fail && pool.getNumberOfHealthyBackends() == 1;
+      }
+      TS_ASSERT_EQUALS(ejected, true);
+      TS_ASSERT_EQUALS(waitForHealthy(pool, 2), true);
+    }
+  }
+
+};
@@ -0,0 +1,75 @@
+#include <cxxtest/TestSuite.h>
+
+#include <cpp_utils/Barrier.hpp>
+#include <cpp_utils/Thread.hpp>
+#include <cpp_utils/Common.hpp>
+
+#include "Fixture.hpp"
+
+#include <atomic>
+
+class TestBarrier : public CxxTest::TestSuite
+{
+
+private:
+
+  // counts in each phase, checks that all of the previous one were done
+  class PhaseThread : public Thread
+  {
+  public:
+
+    PhaseThread( Barrier &barrier, std::atomic<int> &counter, const int phases )
+      : m_barrier(barrier), m_counter(counter), m_phases(phases)
+      , m_completions(0), m_mismatches(0) {}
+
+    int getCompletions() const { return m_completions; }
+    int getMismatches() const { return m_mismatches; }
+
+  private:
+
+    PhaseThread(const PhaseThread&);
+    PhaseThread& operator=(const PhaseThread&);
+
+    void* run( void ) {
+      TRACE;
+      for ( int phase = 0; phase < m_phases; ++phase ) {
+        m_counter++;
+        if ( m_barrier.arriveAndWait() )
+          m_completions++;
+        if ( m_counter.load() < (phase + 1) * m_barrier.getCount() )
+          m_mismatches++;
+        m_barrier.arriveAndWait();
+      }
+      return 0;
+    }
+
+    Barrier &m_barrier;
+    std::atomic<int> &m_counter;
+    const int m_phases;
+    int m_completions;
+    int m_mismatches;
+  };
+
+  static void complete( std::atomic<int> *completions ) { (*completions)++; }
+
+public:
+
+  void testPhases( void )
+  {
+    TEST_HEADER;
+
+    std::atomic<int> completions(0);
+    Barrier barrier(3, std::bind(&complete, &completions));
+    std::atomic<int> counter(0);
+    PhaseThread t1(barrier, counter, 100), t2(barrier, counter, 100), t3(barrier, counter, 100);
+    t1.start(); t2.start(); t3.start();
+    t1.join(); t2.join(); t3.join();
+
+    TS_ASSERT_EQUALS( counter.load(), 300 );
+    TS_ASSERT_EQUALS( barrier.getPhase(), 200 );
+    TS_ASSERT_EQUALS( completions.load(), 200 );
+    TS_ASSERT_EQUALS( t1.getCompletions() + t2.getCompletions() + t3.getCompletions(), 100 );
+    TS_ASSERT_EQUALS( t1.getMismatches() + t2.getMismatches() + t3.getMismatches(), 0 );
+  }
+
+};
@@ -0,0 +1,48 @@
+#include <cxxtest/TestSuite.h>
+
+#include "Fixture.hpp"
+
+#include <cpp_utils/BufferPool.hpp>
+
+class TestBufferPool : public CxxTest::TestSuite
+{
+
+public:
+
+  void testReuse()
+  {
+    TEST_HEADER;
+
+    BufferPool pool(1024, 2);
+    TS_ASSERT_EQUALS(pool.getBufferLength(), 1024u);
+
+    unsigned char *buffer = pool.acquire();
+    TS_ASSERT_DIFFERS(buffer, (unsigned char*)0);
+    TS_ASSERT_EQUALS(pool.getUsed(), 1u);
+    TS_ASSERT_EQUALS(pool.getFree(), 0u);
+
+    pool.release(buffer);
+    TS_ASSERT_EQUALS(pool.getUsed(), 0u);
+    TS_ASSERT_EQUALS(pool.getFree(), 1u);
+
+    // the released one again
+    TS_ASSERT_EQUALS(pool.acquire(), buffer);
+    pool.release(buffer);
+  }
+
+  void testMaxFree()
+  {
+    TEST_HEADER;
+
+    BufferPool pool(1024, 2);
+    unsigned char *buffers[3] = { pool.acquire(), pool.acquire(), pool.acquire() };
+    TS_ASSERT_EQUALS(pool.getUsed(), 3u);
+
+    // the third one is freed
+    for ( int i = 0; i < 3; ++i )
+      pool.release(buffers[i]);
+    TS_ASSERT_EQUALS(pool.getUsed(), 0u);
+    TS_ASSERT_EQUALS(pool.getFree(), 2u);
+  }
+
+};
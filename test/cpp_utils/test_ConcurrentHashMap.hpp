@@ -0,0 +1,147 @@
+#include <cxxtest/TestSuite.h>
+
+#include "Fixture.hpp"
+
+#include <cpp_utils/ConcurrentHashMap.hpp>
+#include <cpp_utils/Thread.hpp>
+
+#include <string>
+
+class TestConcurrentHashMap : public CxxTest::TestSuite
+{
+private:
+
+  typedef ConcurrentHashMap<int, int> IntMap;
+
+  // its own range of keys, and a counter shared by all
+  class InserterThread : public Thread
+  {
+  public:
+
+    InserterThread( IntMap &map, const int first, const int count )
+      : m_map(map)
+      , m_first(first)
+      , m_count(count)
+    {}
+
+  private:
+
+    InserterThread(const InserterThread&);
+    InserterThread& operator=(const InserterThread&);
+
+    void* run()
+    {
+      for ( int i = m_first; i < m_first + m_count; ++i ) {
+        m_map.insert(i, i * 2);
+        m_map.compute(-1, [](int &value, const bool) { ++value; return true; });
+      }
+      return 0;
+    }
+
+    IntMap     &m_map;
+    const int   m_first;
+    const int   m_count;
+  };
+
+public:
+
+  void testBasic()
+  {
+    TEST_HEADER;
+
+    ConcurrentHashMap<std::string, int> map;
+    int value(0);
+    TS_ASSERT_EQUALS(map.find("one", value), false);
+
+    TS_ASSERT_EQUALS(map.insert("one", 1), true);
+    TS_ASSERT_EQUALS(map.insert("two", 2), true);
+    TS_ASSERT_EQUALS(map.insert("one", 3), false);
+    TS_ASSERT_EQUALS(map.size(), 2u);
+
+    TS_ASSERT_EQUALS(map.find("one", value), true);
+    TS_ASSERT_EQUALS(value, 1);
+    TS_ASSERT_EQUALS(map.contains("two"), true);
+
+    TS_ASSERT_EQUALS(map.erase("one"), true);
+    TS_ASSERT_EQUALS(map.erase("one"), false);
+    TS_ASSERT_EQUALS(map.contains("one"), false);
+    TS_ASSERT_EQUALS(map.size(), 1u);
+
+    map.clear();
+    TS_ASSERT_EQUALS(map.size(), 0u);
+  }
+
+  void testCompute()
+  {
+    TEST_HEADER;
+
+    IntMap map;
+
+    // inserts
+    TS_ASSERT_EQUALS(map.compute(1, [](int &value, const bool found)
+                                    { value = found ? value + 1 : 10; return true; }),
+                     true);
+    TS_ASSERT_EQUALS(map.compute(1, [](int &value, const bool found)
+                                    { value = found ? value + 1 : 10; return true; }),
+                     true);
+    int value(0);
+    TS_ASSERT_EQUALS(map.find(1, value), true);
+    TS_ASSERT_EQUALS(value, 11);
+
+    // erases
+    TS_ASSERT_EQUALS(map.compute(1, [](int&, const bool) { return false; }), false);
+    TS_ASSERT_EQUALS(map.contains(1), false);
+
+    // neither
+    TS_ASSERT_EQUALS(map.compute(2, [](int&, const bool) { return false; }), false);
+    TS_ASSERT_EQUALS(map.size(), 0u);
+  }
+
+  void testGrowAndReuse()
+  {
+    TEST_HEADER;
+
+    IntMap map(4, 8);
+    for ( int i = 0; i < 10000; ++i )
+      map.insert(i, i);
+    TS_ASSERT_EQUALS(map.size(), 10000u);
+
+    // deleted slots do not fill the shards up
+    for ( int round = 0; round < 10; ++round )
+      for ( int i = 0; i < 10000; ++i ) {
+        map.erase(i);
+        map.insert(i, round);
+      }
+    TS_ASSERT_EQUALS(map.size(), 10000u);
+
+    int value(0), sum(0);
+    for ( int i = 0; i < 10000; ++i )
+      if ( map.find(i, value) )
+        sum += value;
+    TS_ASSERT_EQUALS(sum, 9 * 10000);
+
+    size_t visited(0);
+    map.forEach([&visited](const int&, const int&) { ++visited; });
+    TS_ASSERT_EQUALS(visited, 10000u);
+  }
+
+  void testConcurrentInserts()
+  {
+    TEST_HEADER;
+
+    IntMap map;
+    InserterThread t1(map, 0, 20000), t2(map, 20000, 20000),
+                   t3(map, 40000, 20000), t4(map, 60000, 20000);
+    t1.start(); t2.start(); t3.start(); t4.start();
+    t1.join(); t2.join(); t3.join(); t4.join();
+
+    // plus the counter
+    TS_ASSERT_EQUALS(map.size(), 80001u);
+    int value(0);
+    TS_ASSERT_EQUALS(map.find(-1, value), true);
+    TS_ASSERT_EQUALS(value, 80000);
+    TS_ASSERT_EQUALS(map.find(79999, value), true);
+    TS_ASSERT_EQUALS(value, 2 * 79999);
+  }
+
+};
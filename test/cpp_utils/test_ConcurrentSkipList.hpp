@@ -0,0 +1,227 @@
+#include <cxxtest/TestSuite.h>
+
+#include "Fixture.hpp"
+
+#include <cpp_utils/ConcurrentSkipList.hpp>
+#include <cpp_utils/Thread.hpp>
+
+#include <vector>
+#include <utility>
+
+class TestConcurrentSkipList : public CxxTest::TestSuite
+{
+private:
+
+  typedef ConcurrentSkipListMap<int, int> IntMap;
+  typedef ConcurrentSkipListMultiMap<int, int> IntMultiMap;
+
+  struct Collect
+  {
+    Collect( std::vector< std::pair<int, int> > &entries ) : m_entries(entries) {}
+    void operator()( const int key, const int value ) { m_entries.push_back(std::make_pair(key, value)); }
+    std::vector< std::pair<int, int> > &m_entries;
+  };
+
+  // its own range of keys, every second erased again
+  class InserterThread : public Thread
+  {
+  public:
+
+    InserterThread( IntMap &map, const int first, const int count )
+      : m_map(map), m_first(first), m_count(count) {}
+
+  private:
+
+    InserterThread(const InserterThread&);
+    InserterThread& operator=(const InserterThread&);
+
+    void* run()
+    {
+      for ( int i = m_first; i < m_first + m_count; ++i )
+        m_map.insert(i, i * 2);
+      for ( int i = m_first; i < m_first + m_count; i += 2 )
+        m_map.erase(i);
+      return 0;
+    }
+
+    IntMap &m_map;
+    const int m_first;
+    const int m_count;
+  };
+
+  class PopperThread : public Thread
+  {
+  public:
+
+    PopperThread( IntMultiMap &map )
+      : m_map(map), m_popped(0), m_ordered(true) {}
+
+    int getPopped() const { return m_popped; }
+    bool isOrdered() const { return m_ordered; }
+
+  private:
+
+    PopperThread(const PopperThread&);
+    PopperThread& operator=(const PopperThread&);
+
+    void* run()
+    {
+      int key, value;
+      try {
+        while ( m_map.waitForFirst(key, value) ) {
+          int last = -1;
+          while ( m_map.popFirst(key, value) ) {
+            // others pop as well, yet what one sees grows
+            if ( key < last )
+              m_ordered = false;
+            last = key;
+            ++m_popped;
+          }
+        }
+      } catch ( CancelledException& ) {
+      }
+      return 0;
+    }
+
+    IntMultiMap &m_map;
+    int m_popped;
+    bool m_ordered;
+  };
+
+public:
+
+  void testMap( void )
+  {
+    TEST_HEADER;
+
+    IntMap map;
+    TS_ASSERT_EQUALS( map.empty(), true );
+    TS_ASSERT_EQUALS( map.insert(3, 30), true );
+    TS_ASSERT_EQUALS( map.insert(1, 10), true );
+    TS_ASSERT_EQUALS( map.insert(2, 20), true );
+    TS_ASSERT_EQUALS( map.insert(2, 21), false );
+    TS_ASSERT_EQUALS( map.size(), 3u );
+
+    int value;
+    TS_ASSERT_EQUALS( map.find(2, value), true );
+    TS_ASSERT_EQUALS( value, 20 );
+    TS_ASSERT_EQUALS( map.find(4, value), false );
+    TS_ASSERT_EQUALS( map.contains(1), true );
+
+    TS_ASSERT_EQUALS( map.erase(1), 1u );
+    TS_ASSERT_EQUALS( map.erase(1), 0u );
+    TS_ASSERT_EQUALS( map.contains(1), false );
+    TS_ASSERT_EQUALS( map.size(), 2u );
+
+    int key;
+    TS_ASSERT_EQUALS( map.first(key, value), true );
+    TS_ASSERT_EQUALS( key, 2 );
+    TS_ASSERT_EQUALS( map.popFirst(key, value), true );
+    TS_ASSERT_EQUALS( key, 2 );
+    TS_ASSERT_EQUALS( map.popFirst(key, value), true );
+    TS_ASSERT_EQUALS( key, 3 );
+    TS_ASSERT_EQUALS( value, 30 );
+    TS_ASSERT_EQUALS( map.popFirst(key, value), false );
+    TS_ASSERT_EQUALS( map.empty(), true );
+  }
+
+  void testMultiMap( void )
+  {
+    TEST_HEADER;
+
+    IntMultiMap map;
+    map.insert(2, 1);
+    map.insert(1, 1);
+    map.insert(2, 2);
+    map.insert(2, 3);
+    map.insert(3, 1);
+    TS_ASSERT_EQUALS( map.size(), 5u );
+
+    int value;
+    TS_ASSERT_EQUALS( map.find(2, value), true );
+    TS_ASSERT_EQUALS( value, 1 );
+
+    TS_ASSERT_EQUALS( map.erase(2, 2), true );
+    TS_ASSERT_EQUALS( map.erase(2, 2), false );
+
+    std::vector< std::pair<int, int> > entries;
+    map.forEach(Collect(entries));
+    TS_ASSERT_EQUALS( entries.size(), 4u );
+    TS_ASSERT( entries[0] == std::make_pair(1, 1) );
+    TS_ASSERT( entries[1] == std::make_pair(2, 1) );
+    TS_ASSERT( entries[2] == std::make_pair(2, 3) );
+    TS_ASSERT( entries[3] == std::make_pair(3, 1) );
+
+    entries.clear();
+    map.forRange(2, 3, Collect(entries));
+    TS_ASSERT_EQUALS( entries.size(), 2u );
+
+    TS_ASSERT_EQUALS( map.erase(2), 2u );
+    TS_ASSERT_EQUALS( map.size(), 2u );
+  }
+
+  void testWaitForFirst( void )
+  {
+    TEST_HEADER;
+
+    IntMultiMap map;
+    int key, value;
+    TS_ASSERT_EQUALS( map.waitForFirst(key, value, 0, 100000000), false );
+
+    map.insert(5, 50);
+    TS_ASSERT_EQUALS( map.waitForFirst(key, value, 1), true );
+    TS_ASSERT_EQUALS( key, 5 );
+    TS_ASSERT_EQUALS( map.size(), 1u );
+
+    map.cancel();
+    TS_ASSERT_THROWS( map.waitForFirst(key, value), CancelledException );
+    TS_ASSERT_THROWS( map.insert(1, 1), CancelledException );
+  }
+
+  void testConcurrentInsertErase( void )
+  {
+    TEST_HEADER;
+
+    IntMap map;
+    std::vector<InserterThread*> threads;
+    for ( int i = 0; i < 4; ++i )
+      threads.push_back(new InserterThread(map, i * 5000, 5000));
+    for ( size_t i = 0; i < threads.size(); ++i )
+      threads[i]->start();
+    for ( size_t i = 0; i < threads.size(); ++i ) {
+      threads[i]->join();
+      delete threads[i];
+    }
+
+    TS_ASSERT_EQUALS( map.size(), 10000u );
+    std::vector< std::pair<int, int> > entries;
+    map.forEach(Collect(entries));
+    TS_ASSERT_EQUALS( entries.size(), 10000u );
+    for ( size_t i = 0; i < entries.size(); ++i ) {
+      TS_ASSERT_EQUALS( entries[i].first, (int)i * 2 + 1 );
+      TS_ASSERT_EQUALS( entries[i].second, entries[i].first * 2 );
+    }
+  }
+
+  void testConcurrentPop( void )
+  {
+    TEST_HEADER;
+
+    IntMultiMap map;
+    PopperThread p1(map), p2(map);
+    p1.start();
+    p2.start();
+
+    for ( int i = 0; i < 20000; ++i )
+      map.insert(i % 100, i);
+
+    while ( !map.empty() )
+      usleep(1000);
+    map.cancel();
+    p1.join();
+    p2.join();
+
+    TS_ASSERT_EQUALS( p1.getPopped() + p2.getPopped(), 20000 );
+  }
+
+};
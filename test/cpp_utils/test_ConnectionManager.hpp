@@ -0,0 +1,238 @@
+#include <cxxtest/TestSuite.h>
+
+#include "Fixture.hpp"
+
+#include <cpp_utils/ConnectionManager.hpp>
+#include <cpp_utils/TcpConnection.hpp>
+#include <cpp_utils/SocketOptions.hpp>
+#include <cpp_utils/Thread.hpp>
+
+#include <atomic>
+#include <string>
+#include <vector>
+#include <unistd.h> // usleep
+
+class TestConnectionManager : public CxxTest::TestSuite
+{
+private:
+
+  class StringMessage : public Message
+  {
+  public:
+
+    StringMessage() : Message(), m_received() {}
+
+    bool buildMessage( const void *msgPart, const size_t msgLen )
+    {
+      m_received.append((const char*)msgPart, msgLen);
+      return true;
+    }
+    void onMessageReady() {}
+    Message* clone() { return new StringMessage; }
+
+    std::string m_received;
+
+  protected:
+
+    size_t getExpectedLength() { return 0; }
+
+  }; // StringMessage
+
+  struct Counters {
+    Counters() : connected(0), received(0), disconnected(0) {}
+
+    std::atomic<int> connected;
+    std::atomic<int> received;
+    std::atomic<int> disconnected;
+  };
+
+  static ConnectionManager::Callbacks counting( Counters &counters )
+  {
+    ConnectionManager::Callbacks callbacks;
+    callbacks.onConnected = [&counters](StreamConnection*) { counters.connected++; };
+    callbacks.onReceived = [&counters](StreamConnection*) { counters.received++; };
+    callbacks.onDisconnected = [&counters](StreamConnection*) { counters.disconnected++; };
+    return callbacks;
+  }
+
+  class RemoverThread : public Thread
+  {
+  public:
+
+    RemoverThread( ConnectionManager &manager, std::vector<TcpConnection*> &connections )
+      : m_manager(manager), m_connections(connections) {}
+
+  private:
+
+    RemoverThread(const RemoverThread&);
+    RemoverThread& operator=(const RemoverThread&);
+
+    void* run()
+    {
+      for ( size_t i = 0; i < m_connections.size(); ++i )
+        m_manager.removeConnection(m_connections[i]);
+      return 0;
+    }
+
+    ConnectionManager &m_manager;
+    std::vector<TcpConnection*> &m_connections;
+  };
+
+  static bool waitFor( const std::atomic<int> &counter, const int value )
+  {
+    for ( int i = 0; i < 300 && counter < value; ++i )
+      usleep(10000);
+    return counter >= value;
+  }
+
+public:
+
+  void testConnectReceiveReconnect()
+  {
+    TEST_HEADER;
+
+    StringMessage serverMessage;
+    TcpConnection server("localhost", "4481", &serverMessage);
+    server.setSocketOptions(SocketOptions().set(SocketOptions::ReuseAddress, 1));
+    TS_ASSERT_EQUALS(server.bind(), true);
+    TS_ASSERT_EQUALS(server.listen(), true);
+
+    StringMessage clientMessage;
+    TcpConnection client("localhost", "4481", &clientMessage);
+
+    Counters counters;
+    ConnectionManager manager(1, 1000, 10, 100);
+    TS_ASSERT_EQUALS(manager.start(), true);
+    TS_ASSERT_EQUALS(manager.addConnection(&client, counting(counters)), true);
+    TS_ASSERT_EQUALS(manager.addConnection(&client), false);
+    TS_ASSERT_EQUALS(manager.getNumberOfConnections(), 1u);
+
+    int socket;
+    TS_ASSERT_EQUALS(server.accept(socket), true);
+    TS_ASSERT_EQUALS(waitFor(counters.connected, 1), true);
+    TS_ASSERT_EQUALS(manager.isConnected(&client), true);
+
+    Connection *accepted = server.clone(socket);
+    TS_ASSERT_EQUALS(accepted->send("hello", 5), true);
+    TS_ASSERT_EQUALS(waitFor(counters.received, 1), true);
+    TS_ASSERT_EQUALS(clientMessage.m_received, std::string("hello"));
+
+    // server side close: disconnected, then connected again
+    delete accepted;
+    TS_ASSERT_EQUALS(waitFor(counters.disconnected, 1), true);
+    TS_ASSERT_EQUALS(server.accept(socket), true);
+    TS_ASSERT_EQUALS(waitFor(counters.connected, 2), true);
+
+    accepted = server.clone(socket);
+    TS_ASSERT_EQUALS(manager.send(&client, "back", 4), true);
+    TS_ASSERT_EQUALS(accepted->receive(), true);
+
+    TS_ASSERT_EQUALS(manager.removeConnection(&client), true);
+    TS_ASSERT_EQUALS(manager.removeConnection(&client), false);
+    TS_ASSERT_EQUALS(manager.getNumberOfConnections(), 0u);
+    TS_ASSERT_EQUALS(client.closed(), true);
+
+    delete accepted;
+    manager.stop();
+  }
+
+  void testBackoffUntilServerIsUp()
+  {
+    TEST_HEADER;
+
+    StringMessage clientMessage;
+    TcpConnection client("localhost", "4482", &clientMessage);
+
+    Counters counters;
+    ConnectionManager manager(2, 1000, 10, 50);
+    TS_ASSERT_EQUALS(manager.start(), true);
+    TS_ASSERT_EQUALS(manager.addConnection(&client, counting(counters)), true);
+
+    // refused attempts are retried quietly
+    usleep(200000);
+    TS_ASSERT_EQUALS(counters.connected, 0);
+    TS_ASSERT_EQUALS(counters.disconnected, 0);
+    TS_ASSERT_EQUALS(manager.isConnected(&client), false);
+    TS_ASSERT_EQUALS(manager.send(&client, "x", 1), false);
+
+    StringMessage serverMessage;
+    TcpConnection server("localhost", "4482", &serverMessage);
+    server.setSocketOptions(SocketOptions().set(SocketOptions::ReuseAddress, 1));
+    TS_ASSERT_EQUALS(server.bind(), true);
+    TS_ASSERT_EQUALS(server.listen(), true);
+
+    int socket;
+    TS_ASSERT_EQUALS(server.accept(socket), true);
+    TS_ASSERT_EQUALS(waitFor(counters.connected, 1), true);
+
+    Connection *accepted = server.clone(socket);
+    manager.stop();
+    TS_ASSERT_EQUALS(manager.getNumberOfConnections(), 0u);
+    TS_ASSERT_EQUALS(client.closed(), true);
+    delete accepted;
+  }
+
+  void testUnresolvedHost()
+  {
+    TEST_HEADER;
+
+    StringMessage serverMessage;
+    TcpConnection server("localhost", "4484", &serverMessage);
+    server.setSocketOptions(SocketOptions().set(SocketOptions::ReuseAddress, 1));
+    TS_ASSERT_EQUALS(server.bind(), true);
+    TS_ASSERT_EQUALS(server.listen(), true);
+
+    // on one reactor: the lookup does not hold up the other connection
+    StringMessage message;
+    TcpConnection unresolved("no-such-host.invalid", "4484", &message);
+    TcpConnection client("localhost", "4484", &message);
+
+    Counters counters;
+    ConnectionManager manager(1, 1000, 10, 50);
+    TS_ASSERT_EQUALS(manager.start(), true);
+    TS_ASSERT_EQUALS(manager.addConnection(&unresolved), true);
+    TS_ASSERT_EQUALS(manager.addConnection(&client, counting(counters)), true);
+
+    int socket;
+    TS_ASSERT_EQUALS(server.accept(socket), true);
+    TS_ASSERT_EQUALS(waitFor(counters.connected, 1), true);
+    TS_ASSERT_EQUALS(manager.isConnected(&unresolved), false);
+    TS_ASSERT_EQUALS(manager.send(&unresolved, "x", 1), false);
+
+    Connection *accepted = server.clone(socket);
+    TS_ASSERT_EQUALS(manager.send(&client, "hello", 5), true);
+    TS_ASSERT_EQUALS(accepted->receive(), true);
+
+    TS_ASSERT_EQUALS(manager.removeConnection(&unresolved), true);
+    manager.stop();
+    delete accepted;
+  }
+
+  void testRemoveWhileStopping()
+  {
+    TEST_HEADER;
+
+    // the removers must not wait for a reactor gone meanwhile
+    StringMessage message;
+    for ( int round = 0; round < 50; ++round ) {
+      std::vector<TcpConnection*> connections;
+      for ( int i = 0; i < 50; ++i )
+        connections.push_back(new TcpConnection("localhost", "4483", &message));
+
+      ConnectionManager manager(2, 1000, 10, 50);
+      TS_ASSERT_EQUALS(manager.start(), true);
+      for ( size_t i = 0; i < connections.size(); ++i )
+        manager.addConnection(connections[i]);
+
+      RemoverThread remover(manager, connections);
+      remover.start();
+      manager.stop();
+      remover.join();
+      TS_ASSERT_EQUALS(manager.getNumberOfConnections(), 0u);
+
+      for ( size_t i = 0; i < connections.size(); ++i )
+        delete connections[i];
+    }
+  }
+
+};
@@ -0,0 +1,55 @@
+#include <cxxtest/TestSuite.h>
+
+#include <cpp_utils/CpuTopology.hpp>
+
+#include "Fixture.hpp"
+
+#include <algorithm>
+#include <sched.h> // sched_getaffinity
+
+class TestCpuTopology : public CxxTest::TestSuite
+{
+
+public:
+
+  void testParseCpuList( void )
+  {
+    TEST_HEADER;
+
+    const std::vector<int> cpus = CpuTopology::parseCpuList("0-3,8,10-11");
+    TS_ASSERT_EQUALS( cpus.size(), 7u );
+    TS_ASSERT_EQUALS( cpus[0], 0 );
+    TS_ASSERT_EQUALS( cpus[3], 3 );
+    TS_ASSERT_EQUALS( cpus[4], 8 );
+    TS_ASSERT_EQUALS( cpus[6], 11 );
+    TS_ASSERT_EQUALS( CpuTopology::parseCpuList("").size(), 0u );
+  }
+
+  void testOrders( void )
+  {
+    TEST_HEADER;
+
+    // the ones the process may run on
+    cpu_set_t allowed;
+    TS_ASSERT_EQUALS( sched_getaffinity(0, sizeof(allowed), &allowed), 0 );
+
+    const CpuTopology topology;
+    const size_t cpus = topology.getCpus().size();
+    TS_ASSERT_EQUALS( cpus, (size_t)CPU_COUNT(&allowed) );
+    for ( size_t i = 0; i < cpus; ++i )
+      TS_ASSERT( CPU_ISSET(topology.getCpus()[i].m_id, &allowed) );
+
+    // the same CPUs, in other orders
+    std::vector<int> compact = topology.compactOrder();
+    std::vector<int> scatter = topology.scatterOrder();
+    TS_ASSERT_EQUALS( compact.size(), cpus );
+    std::sort(compact.begin(), compact.end());
+    std::sort(scatter.begin(), scatter.end());
+    TS_ASSERT( compact == scatter );
+
+    TS_ASSERT( topology.getPhysicalCoreCount() > 0 );
+    TS_ASSERT( topology.getPhysicalCoreCount() <= cpus );
+    TS_ASSERT_EQUALS( topology.getNodeCpus(topology.getCpus()[0].m_node).empty(), false );
+  }
+
+};
@@ -0,0 +1,128 @@
+#include <cxxtest/TestSuite.h>
+
+#include <cpp_utils/EpochReclaimer.hpp>
+#include <cpp_utils/Thread.hpp>
+
+#include "Fixture.hpp"
+
+#include <atomic>
+
+
+class TestEpochReclaimer : public CxxTest::TestSuite
+{
+
+private:
+
+  struct Node
+  {
+    Node( const int value ) : m_value(value) { alive++; }
+    ~Node() { m_value = -1; alive--; }
+
+    volatile int m_value;
+    static std::atomic<int> alive;
+  };
+
+  class ReaderThread : public Thread
+  {
+  public:
+
+    ReaderThread( EpochReclaimer &reclaimer, std::atomic<Node*> &shared )
+      : m_reclaimer(reclaimer), m_shared(shared), m_freedSeen(0) {}
+
+    int getFreedSeen() const { return m_freedSeen; }
+
+  private:
+
+    ReaderThread(const ReaderThread&);
+    ReaderThread& operator=(const ReaderThread&);
+
+    void* run()
+    {
+      for ( int i = 0; i < 200000; ++i ) {
+        ScopedEpoch se(m_reclaimer);
+        if ( m_shared.load()->m_value < 0 )
+          m_freedSeen++;
+      }
+      return 0;
+    }
+
+    EpochReclaimer &m_reclaimer;
+    std::atomic<Node*> &m_shared;
+    int m_freedSeen;
+  };
+
+public:
+
+  void testRetire( void )
+  {
+    TEST_HEADER;
+
+    EpochReclaimer reclaimer(4, 1000);
+    reclaimer.retire(new Node(1));
+    reclaimer.retire(new Node(2));
+    TS_ASSERT_EQUALS( reclaimer.getPending(), 2u );
+    TS_ASSERT_EQUALS( Node::alive.load(), 2 );
+
+    TS_ASSERT_EQUALS( reclaimer.reclaim(), 2u );
+    TS_ASSERT_EQUALS( reclaimer.getPending(), 0u );
+    TS_ASSERT_EQUALS( Node::alive.load(), 0 );
+  }
+
+  void testRegionHoldsBack( void )
+  {
+    TEST_HEADER;
+
+    EpochReclaimer reclaimer(4, 1000);
+    const size_t slot = reclaimer.enter();
+    reclaimer.retire(new Node(1));
+
+    TS_ASSERT_EQUALS( reclaimer.reclaim(), 0u );
+    TS_ASSERT_EQUALS( reclaimer.reclaim(), 0u );
+    TS_ASSERT_EQUALS( Node::alive.load(), 1 );
+
+    reclaimer.leave(slot);
+    TS_ASSERT_EQUALS( reclaimer.reclaim(), 1u );
+    TS_ASSERT_EQUALS( Node::alive.load(), 0 );
+  }
+
+  void testDestructorFrees( void )
+  {
+    TEST_HEADER;
+
+    {
+      EpochReclaimer reclaimer;
+      reclaimer.retire(new Node(1));
+    }
+    TS_ASSERT_EQUALS( Node::alive.load(), 0 );
+  }
+
+  void testConcurrentReaders( void )
+  {
+    TEST_HEADER;
+
+    EpochReclaimer reclaimer(0, 16);
+    std::atomic<Node*> shared(new Node(0));
+
+    ReaderThread r1(reclaimer, shared), r2(reclaimer, shared);
+    r1.start();
+    r2.start();
+
+    for ( int i = 1; i < 20000; ++i ) {
+      Node *old = shared.exchange(new Node(i));
+      reclaimer.retire(old);
+    }
+
+    r1.join();
+    r2.join();
+    TS_ASSERT_EQUALS( r1.getFreedSeen(), 0 );
+    TS_ASSERT_EQUALS( r2.getFreedSeen(), 0 );
+
+    reclaimer.reclaim();
+    TS_ASSERT_EQUALS( reclaimer.getPending(), 0u );
+    delete shared.load();
+    TS_ASSERT_EQUALS( Node::alive.load(), 0 );
+  }
+
+};
+
+std::atomic<int> TestEpochReclaimer::Node::alive(0);
@@ -0,0 +1,96 @@
+#include <cxxtest/TestSuite.h>
+
+#include <cpp_utils/Event.hpp>
+#include <cpp_utils/Thread.hpp>
+#include <cpp_utils/Common.hpp>
+
+#include "Fixture.hpp"
+
+#include <atomic>
+
+class TestEvent : public CxxTest::TestSuite
+{
+
+private:
+
+  class WaiterThread : public Thread
+  {
+  public:
+
+    WaiterThread( Event &event, std::atomic<int> &passed )
+      : m_event(event), m_passed(passed) {}
+
+  private:
+
+    WaiterThread(const WaiterThread&);
+    WaiterThread& operator=(const WaiterThread&);
+
+    void* run( void ) {
+      TRACE;
+      if ( m_event.wait(2) )
+        m_passed++;
+      return 0;
+    }
+
+    Event &m_event;
+    std::atomic<int> &m_passed;
+  };
+
+public:
+
+  void testBasic( void )
+  {
+    TEST_HEADER;
+
+    Event e;
+    TS_ASSERT_EQUALS( e.isSet(), false );
+    TS_ASSERT_EQUALS( e.wait(0, 100000000), false );
+    e.set();
+    TS_ASSERT_EQUALS( e.isSet(), true );
+    TS_ASSERT_EQUALS( e.wait(), true );
+    TS_ASSERT_EQUALS( e.wait(), true );
+    e.reset();
+    TS_ASSERT_EQUALS( e.isSet(), false );
+
+    Event autoReset(true, true);
+    TS_ASSERT_EQUALS( autoReset.wait(), true );
+    TS_ASSERT_EQUALS( autoReset.isSet(), false );
+    TS_ASSERT_EQUALS( autoReset.wait(0, 100000000), false );
+  }
+
+  void testManualResetWakesAll( void )
+  {
+    TEST_HEADER;
+
+    Event e;
+    std::atomic<int> passed(0);
+    WaiterThread t1(e, passed), t2(e, passed), t3(e, passed);
+    t1.start(); t2.start(); t3.start();
+
+    usleep(100000);
+    e.set();
+    t1.join(); t2.join(); t3.join();
+    TS_ASSERT_EQUALS( passed.load(), 3 );
+  }
+
+  void testAutoResetWakesOne( void )
+  {
+    TEST_HEADER;
+
+    Event e(true);
+    std::atomic<int> passed(0);
+    WaiterThread t1(e, passed), t2(e, passed);
+    t1.start(); t2.start();
+
+    usleep(100000);
+    e.set();
+    usleep(100000);
+    TS_ASSERT_EQUALS( passed.load(), 1 );
+    TS_ASSERT_EQUALS( e.isSet(), false );
+
+    e.set();
+    t1.join(); t2.join();
+    TS_ASSERT_EQUALS( passed.load(), 2 );
+  }
+
+};
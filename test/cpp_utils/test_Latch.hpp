@@ -0,0 +1,80 @@
+#include <cxxtest/TestSuite.h>
+
+#include <cpp_utils/Latch.hpp>
+#include <cpp_utils/Thread.hpp>
+#include <cpp_utils/Common.hpp>
+
+#include "Fixture.hpp"
+
+#include <atomic>
+
+class TestLatch : public CxxTest::TestSuite
+{
+
+private:
+
+  class ArrivingThread : public Thread
+  {
+  public:
+
+    ArrivingThread( Latch &latch, std::atomic<int> &passed )
+      : m_latch(latch), m_passed(passed) {}
+
+  private:
+
+    ArrivingThread(const ArrivingThread&);
+    ArrivingThread& operator=(const ArrivingThread&);
+
+    void* run( void ) {
+      TRACE;
+      m_latch.arriveAndWait();
+      m_passed++;
+      return 0;
+    }
+
+    Latch &m_latch;
+    std::atomic<int> &m_passed;
+  };
+
+public:
+
+  void testBasic( void )
+  {
+    TEST_HEADER;
+
+    Latch latch(3);
+    TS_ASSERT_EQUALS( latch.getCount(), 3 );
+    TS_ASSERT_EQUALS( latch.tryWait(), false );
+    TS_ASSERT_EQUALS( latch.wait(0, 100000000), false );
+
+    latch.countDown(2);
+    TS_ASSERT_EQUALS( latch.getCount(), 1 );
+    latch.countDown();
+    TS_ASSERT_EQUALS( latch.getCount(), 0 );
+    TS_ASSERT_EQUALS( latch.tryWait(), true );
+    TS_ASSERT_EQUALS( latch.wait(), true );
+
+    latch.countDown();
+    TS_ASSERT_EQUALS( latch.getCount(), 0 );
+  }
+
+  void testArriveAndWait( void )
+  {
+    TEST_HEADER;
+
+    Latch latch(3);
+    std::atomic<int> passed(0);
+    ArrivingThread t1(latch, passed), t2(latch, passed);
+    t1.start();
+    t2.start();
+
+    usleep(100000);
+    TS_ASSERT_EQUALS( passed.load(), 0 );
+
+    latch.arriveAndWait();
+    t1.join();
+    t2.join();
+    TS_ASSERT_EQUALS( passed.load(), 2 );
+  }
+
+};
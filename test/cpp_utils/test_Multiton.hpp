@@ -3,6 +3,9 @@
 #include <cpp_utils/Common.hpp>
 #include "Fixture.hpp"
 #include <cpp_utils/Multiton.hpp>
+#include <cpp_utils/Thread.hpp>
+
+#include <atomic>
 
 
 class TestMultitonSuite : public CxxTest::TestSuite
@@ -22,6 +25,35 @@ private:
 
     };
 
+    class Counted
+    {
+    public:
+        Counted() { ++created; }
+        static std::atomic<int> created;
+    };
+
+    class CountedMultiton : public Multiton<int, Counted>
+    {
+
+    };
+
+    // all of them ask for the same keys at once
+    class GetterThread : public Thread
+    {
+    public:
+        GetterThread() : m_instances() {}
+        Counted* m_instances[10];
+
+    private:
+        void* run()
+        {
+            for ( int round = 0; round < 1000; ++round )
+                for ( int key = 0; key < 10; ++key )
+                    m_instances[key] = CountedMultiton::getPtr(key);
+            return 0;
+        }
+    };
+
 public:
 
   void testBasic( void )
@@ -34,5 +66,68 @@ public:
     DummyMultiton::destroy();
   }
 
+  void testRemove( void )
+  {
+    TEST_HEADER;
+
+    Dummy *dummy = DummyMultiton::getPtr("foo");
+    TS_ASSERT_EQUALS(DummyMultiton::getPtr("foo"), dummy);
+    DummyMultiton::getPtr("bar");
+
+    TS_ASSERT_EQUALS(DummyMultiton::remove("foo"), true);
+    TS_ASSERT_EQUALS(DummyMultiton::remove("foo"), false);
+    TS_ASSERT_EQUALS(DummyMultiton::remove("baz"), false);
+
+    // a new one
+    DummyMultiton::getPtr("foo")->sayHi();
+    DummyMultiton::reclaim();
+    DummyMultiton::getPtr("bar")->sayHi();
+
+    DummyMultiton::destroy();
+    TS_ASSERT_EQUALS(DummyMultiton::remove("bar"), false);
+  }
+
+  void testConcurrentCreate( void )
+  {
+    TEST_HEADER;
+
+    Counted::created = 0;
+    GetterThread t1, t2, t3, t4;
+    t1.start(); t2.start(); t3.start(); t4.start();
+    t1.join(); t2.join(); t3.join(); t4.join();
+
+    // one per key, the same for everybody
+    TS_ASSERT_EQUALS(Counted::created, 10);
+    for ( int key = 0; key < 10; ++key ) {
+      TS_ASSERT_EQUALS(t1.m_instances[key], CountedMultiton::getPtr(key));
+      TS_ASSERT_EQUALS(t2.m_instances[key], t1.m_instances[key]);
+      TS_ASSERT_EQUALS(t3.m_instances[key], t1.m_instances[key]);
+      TS_ASSERT_EQUALS(t4.m_instances[key], t1.m_instances[key]);
+    }
+
+    CountedMultiton::destroy();
+  }
+
+  void testGrowWhileRead( void )
+  {
+    TEST_HEADER;
+
+    // the replaced maps are freed meanwhile, not under the getters
+    Counted::created = 0;
+    GetterThread t1, t2, t3, t4;
+    t1.start(); t2.start(); t3.start(); t4.start();
+    for ( int key = 10; key < 2010; ++key )
+      CountedMultiton::getPtr(key);
+    t1.join(); t2.join(); t3.join(); t4.join();
+
+    TS_ASSERT_EQUALS(Counted::created, 2010);
+    for ( int key = 0; key < 10; ++key )
+      TS_ASSERT_EQUALS(t1.m_instances[key], CountedMultiton::getPtr(key));
+
+    CountedMultiton::destroy();
+  }
+
 
 };
+
+std::atomic<int> TestMultitonSuite::Counted::created(0);
@@ -3,12 +3,70 @@
 #include <cpp_utils/Common.hpp>
 #include "Fixture.hpp"
 #include <cpp_utils/Mutex.hpp>
+#include <cpp_utils/ScopedLock.hpp>
+#include <cpp_utils/LockStats.hpp>
+#include <cpp_utils/Thread.hpp>
+
+#include <sstream>
 
 #include <errno.h> // EDEADLK, EPERM, ETIMEDOUT
 
 class TestMutex : public CxxTest::TestSuite
 {
 
+private:
+
+  class IncrementerThread : public Thread
+  {
+  public:
+
+    IncrementerThread( Mutex &mutex, int &counter )
+      : m_mutex(mutex), m_counter(counter) {}
+
+  private:
+
+    IncrementerThread(const IncrementerThread&);
+    IncrementerThread& operator=(const IncrementerThread&);
+
+    void* run()
+    {
+      for ( int i = 0; i < 100000; ++i ) {
+        ScopedLock sl(m_mutex);
+        ++m_counter;
+      }
+      return 0;
+    }
+
+    Mutex &m_mutex;
+    int &m_counter;
+  };
+
+  // holds the mutex for a while
+  class HolderThread : public Thread
+  {
+  public:
+
+    HolderThread( Mutex &mutex, volatile bool &locked )
+      : m_mutex(mutex), m_locked(locked) {}
+
+  private:
+
+    HolderThread(const HolderThread&);
+    HolderThread& operator=(const HolderThread&);
+
+    void* run()
+    {
+      m_mutex.lock();
+      m_locked = true;
+      usleep(50000);
+      m_mutex.unlock();
+      return 0;
+    }
+
+    Mutex &m_mutex;
+    volatile bool &m_locked;
+  };
+
 
 public:
 
@@ -47,5 +105,78 @@ public:
     TS_ASSERT_EQUALS ( m.unlock() , EPERM );
   }
 
+  void testAdaptive( void )
+  {
+    TEST_HEADER;
+    Mutex m(Mutex::Adaptive);
+    TS_ASSERT_EQUALS ( m.getType(), Mutex::Adaptive );
+    TS_ASSERT_EQUALS ( m.lock() , 0 );
+    TS_ASSERT_EQUALS ( m.tryLock(0), EBUSY );
+    TS_ASSERT_EQUALS ( m.unlock() , 0 );
+
+    int counter(0);
+    IncrementerThread t1(m, counter), t2(m, counter), t3(m, counter);
+    t1.start(); t2.start(); t3.start();
+    t1.join(); t2.join(); t3.join();
+    TS_ASSERT_EQUALS ( counter, 300000 );
+  }
+
+  void testStats( void )
+  {
+    TEST_HEADER;
+    Mutex m(Mutex::Adaptive);
+    TS_ASSERT_EQUALS ( m.getStats(), (const LockStats*)0 );
+    m.enableStats("test_Mutex::testStats");
+
+    {
+      ScopedLock sl(m);
+    }
+    TS_ASSERT_EQUALS ( m.tryLock(), 0 );
+    TS_ASSERT_EQUALS ( m.unlock(), 0 );
+    TS_ASSERT_EQUALS ( m.getStats()->getAcquisitions(), 2u );
+    TS_ASSERT_EQUALS ( m.getStats()->getContended(), 0u );
+
+    int counter(0);
+    IncrementerThread t1(m, counter), t2(m, counter);
+    t1.start(); t2.start();
+    t1.join(); t2.join();
+
+    const LockStats *stats = m.getStats();
+    TS_ASSERT_EQUALS ( stats->getAcquisitions(), 200002u );
+    uint64_t waits(0);
+    for ( size_t i = 0; i < LockStats::BUCKETS; ++i )
+      waits += stats->getWaits(i);
+    TS_ASSERT_EQUALS ( waits, stats->getContended() );
+
+    std::ostringstream report;
+    LockStats::report(report);
+    TS_ASSERT_DIFFERS ( report.str().find("test_Mutex::testStats"), std::string::npos );
+  }
+
+  void testTimedTryLockStats( void )
+  {
+    TEST_HEADER;
+    Mutex m;
+    m.enableStats("test_Mutex::testTimedTryLockStats");
+
+    // waited for in the timed lock: a contended one
+    volatile bool locked(false);
+    HolderThread holder(m, locked);
+    holder.start();
+    while ( !locked )
+      usleep(1000);
+    TS_ASSERT_EQUALS ( m.tryLock(2), 0 );
+    TS_ASSERT_EQUALS ( m.unlock(), 0 );
+    holder.join();
+
+    const LockStats *stats = m.getStats();
+    TS_ASSERT_EQUALS ( stats->getAcquisitions(), 2u );
+    TS_ASSERT_EQUALS ( stats->getContended(), 1u );
+    uint64_t waits(0);
+    for ( size_t i = 0; i < LockStats::BUCKETS; ++i )
+      waits += stats->getWaits(i);
+    TS_ASSERT_EQUALS ( waits, 1u );
+  }
+
 
 };
@@ -0,0 +1,124 @@
+#include <cxxtest/TestSuite.h>
+
+#include <cpp_utils/Parallel.hpp>
+#include <cpp_utils/WorkerThread.hpp>
+#include <cpp_utils/Common.hpp>
+
+#include "Fixture.hpp"
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <functional>
+#include <stdint.h>
+
+class TestParallel : public CxxTest::TestSuite
+{
+
+private:
+
+  ThreadPool *m_pool;
+
+  static std::vector<int> randomInts( const size_t count )
+  {
+    std::vector<int> v(count);
+    uint32_t seed = 2463534242u;
+    for ( size_t i = 0; i < count; ++i ) {
+      seed ^= seed << 13;
+      seed ^= seed >> 17;
+      seed ^= seed << 5;
+      v[i] = seed % 1000000;
+    }
+    return v;
+  }
+
+public:
+
+  void setUp()
+  {
+    m_pool = new ThreadPool;
+    for ( int i = 0; i < 3; ++i )
+      m_pool->pushWorkerThread(new WorkerThread(*m_pool));
+    m_pool->startWorkerThreads();
+  }
+
+  void tearDown()
+  {
+    m_pool->stop();
+    m_pool->join();
+    delete m_pool;
+  }
+
+  void testFor( void )
+  {
+    TEST_HEADER;
+
+    std::vector<long> v(100000, -1);
+    parallelFor(*m_pool, 0, (int)v.size(), [&]( const int i ) { v[i] = (long)i * i; });
+    for ( size_t i = 0; i < v.size(); ++i )
+      TS_ASSERT_EQUALS( v[i], (long)(i * i) );
+
+    // explicit grain, and an empty range
+    std::vector<int> w(1000, 0);
+    parallelFor(*m_pool, (size_t)0, w.size(), [&]( const size_t i ) { w[i]++; }, 7);
+    parallelFor(*m_pool, 10, 10, [&]( const int i ) { w[i]++; });
+    TS_ASSERT_EQUALS( std::count(w.begin(), w.end(), 1), 1000 );
+  }
+
+  void testForWithoutWorkers( void )
+  {
+    TEST_HEADER;
+
+    ThreadPool pool;
+    std::vector<int> v(10000, 0);
+    parallelFor(pool, (size_t)0, v.size(), [&]( const size_t i ) { v[i] = 1; });
+    TS_ASSERT_EQUALS( std::count(v.begin(), v.end(), 1), 10000 );
+  }
+
+  void testTransform( void )
+  {
+    TEST_HEADER;
+
+    const std::vector<int> in = randomInts(50000);
+    std::vector<std::string> out(in.size());
+    parallelTransform(*m_pool, in.begin(), in.end(), out.begin(),
+                      []( const int i ) { return TToStr(i); });
+    for ( size_t i = 0; i < in.size(); ++i )
+      TS_ASSERT_EQUALS( out[i], TToStr(in[i]) );
+  }
+
+  void testReduce( void )
+  {
+    TEST_HEADER;
+
+    const long sum = parallelReduce(*m_pool, 0, 100000, 0L,
+                                    []( const int i ) { return (long)i; },
+                                    std::plus<long>());
+    TS_ASSERT_EQUALS( sum, 100000L * 99999 / 2 );
+
+    // associative but not commutative, the order is kept
+    const std::string digits = parallelReduce(*m_pool, 0, 5000, std::string(),
+        []( const int i ) { return std::string(1, '0' + i % 10); },
+        std::plus<std::string>());
+    TS_ASSERT_EQUALS( digits.size(), 5000u );
+    bool ordered = true;
+    for ( size_t i = 0; i < digits.size(); ++i )
+      ordered = ordered && digits[i] == '0' + (int)(i % 10);
+    TS_ASSERT( ordered );
+  }
+
+  void testSort( void )
+  {
+    TEST_HEADER;
+
+    std::vector<int> v = randomInts(200000);
+    std::vector<int> expected = v;
+    std::sort(expected.begin(), expected.end());
+    parallelSort(*m_pool, v.begin(), v.end());
+    TS_ASSERT( v == expected );
+
+    parallelSort(*m_pool, v.begin(), v.end(), std::greater<int>());
+    TS_ASSERT( std::is_sorted(v.begin(), v.end(), std::greater<int>()) );
+  }
+
+};
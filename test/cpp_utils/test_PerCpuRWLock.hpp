@@ -0,0 +1,85 @@
+#include <cxxtest/TestSuite.h>
+
+#include <cpp_utils/Common.hpp>
+#include "Fixture.hpp"
+#include <cpp_utils/PerCpuRWLock.hpp>
+#include <cpp_utils/Thread.hpp>
+
+class TestPerCpuRWLock : public CxxTest::TestSuite
+{
+private:
+
+  // two fields written together, readers check they match
+  class WorkerThread : public Thread
+  {
+  public:
+
+    WorkerThread( PerCpuRWLock &rwLock, volatile int *pair, int &mismatches )
+      : m_rwLock(rwLock), m_pair(pair), m_mismatches(mismatches) {}
+
+  private:
+
+    WorkerThread(const WorkerThread&);
+    WorkerThread& operator=(const WorkerThread&);
+
+    void* run()
+    {
+      for ( int i = 0; i < 20000; ++i ) {
+        if ( i % 100 == 0 ) {
+          ScopedPerCpuWriteLock wl(m_rwLock);
+          ++m_pair[0];
+          ++m_pair[1];
+        } else {
+          ScopedPerCpuReadLock rl(m_rwLock);
+          if ( m_pair[0] != m_pair[1] )
+            ++m_mismatches;
+        }
+      }
+      return 0;
+    }
+
+    PerCpuRWLock &m_rwLock;
+    volatile int *m_pair;
+    int &m_mismatches;
+  };
+
+public:
+
+  void testBasic( void )
+  {
+    TEST_HEADER;
+
+    PerCpuRWLock l(4);
+    TS_ASSERT_EQUALS ( l.getSlots(), 4u );
+
+    const size_t slot1 = l.readLock();
+    const size_t slot2 = l.readLock();
+    TS_ASSERT ( slot1 < 4u );
+    l.readUnlock(slot2);
+    l.readUnlock(slot1);
+
+    l.writeLock();
+    l.writeUnlock();
+
+    PerCpuRWLock perCpu;
+    TS_ASSERT ( perCpu.getSlots() > 0u );
+  }
+
+  void testExclusion( void )
+  {
+    TEST_HEADER;
+
+    PerCpuRWLock l;
+    volatile int pair[2] = { 0, 0 };
+    int mismatches1(0), mismatches2(0), mismatches3(0);
+    WorkerThread t1(l, pair, mismatches1), t2(l, pair, mismatches2),
+                 t3(l, pair, mismatches3);
+    t1.start(); t2.start(); t3.start();
+    t1.join(); t2.join(); t3.join();
+
+    TS_ASSERT_EQUALS ( mismatches1 + mismatches2 + mismatches3, 0 );
+    TS_ASSERT_EQUALS ( pair[0], 3 * 200 );
+    TS_ASSERT_EQUALS ( pair[1], 3 * 200 );
+  }
+
+};
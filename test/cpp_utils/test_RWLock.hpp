@@ -0,0 +1,83 @@
+#include <cxxtest/TestSuite.h>
+
+#include <cpp_utils/Common.hpp>
+#include "Fixture.hpp"
+#include <cpp_utils/RWLock.hpp>
+#include <cpp_utils/ScopedLock.hpp>
+#include <cpp_utils/Thread.hpp>
+
+#include <errno.h> // EBUSY
+#include <unistd.h> // usleep
+
+class TestRWLock : public CxxTest::TestSuite
+{
+private:
+
+  class WriterThread : public Thread
+  {
+  public:
+
+    WriterThread( RWLock &rwLock, volatile bool &written )
+      : m_rwLock(rwLock), m_written(written) {}
+
+  private:
+
+    WriterThread(const WriterThread&);
+    WriterThread& operator=(const WriterThread&);
+
+    void* run()
+    {
+      ScopedWriteLock wl(m_rwLock);
+      m_written = true;
+      return 0;
+    }
+
+    RWLock &m_rwLock;
+    volatile bool &m_written;
+  };
+
+public:
+
+  void testBasic( void )
+  {
+    TEST_HEADER;
+    RWLock l;
+
+    // readers share it
+    TS_ASSERT_EQUALS ( l.readLock(), 0 );
+    TS_ASSERT_EQUALS ( l.tryReadLock(), 0 );
+    TS_ASSERT_EQUALS ( l.tryWriteLock(), EBUSY );
+    TS_ASSERT_EQUALS ( l.unlock(), 0 );
+    TS_ASSERT_EQUALS ( l.unlock(), 0 );
+
+    // a writer does not
+    TS_ASSERT_EQUALS ( l.writeLock(), 0 );
+    TS_ASSERT_EQUALS ( l.tryReadLock(), EBUSY );
+    TS_ASSERT_EQUALS ( l.tryWriteLock(), EBUSY );
+    TS_ASSERT_EQUALS ( l.unlock(), 0 );
+  }
+
+  void testWriterPreferred( void )
+  {
+    TEST_HEADER;
+    RWLock l;
+    volatile bool written(false);
+
+    WriterThread writer(l, written);
+    {
+      ScopedReadLock rl(l);
+      writer.start();
+      usleep(100000);
+
+      // the waiting writer keeps new readers out
+      TS_ASSERT_EQUALS ( l.tryReadLock(), EBUSY );
+      TS_ASSERT_EQUALS ( written, false );
+    }
+
+    writer.join();
+    TS_ASSERT_EQUALS ( written, true );
+    TS_ASSERT_EQUALS ( l.tryReadLock(), 0 );
+    TS_ASSERT_EQUALS ( l.unlock(), 0 );
+  }
+
+};
@@ -0,0 +1,85 @@
+#include <cxxtest/TestSuite.h>
+
+#include "Fixture.hpp"
+
+#include <cpp_utils/Resolver.hpp>
+
+#include <atomic>
+#include <unistd.h> // sleep
+
+class TestResolver : public CxxTest::TestSuite
+{
+public:
+
+  void testResolveAndCache()
+  {
+    TEST_HEADER;
+
+    Resolver resolver(2, 60, 60);
+    TS_ASSERT_EQUALS(resolver.lookup("localhost", "80") == 0, true);
+
+    Resolver::Result result = resolver.resolve("localhost", "80").get();
+    TS_ASSERT_EQUALS(result == 0, false);
+    TS_ASSERT_EQUALS((*result)[0] == 0, false);
+
+    TS_ASSERT_EQUALS(resolver.cacheSize(), 1u);
+    TS_ASSERT_EQUALS(resolver.lookup("localhost", "80"), result);
+    TS_ASSERT_EQUALS(resolver.resolve("localhost", "80").get(), result);
+
+    resolver.invalidate("localhost", "80");
+    TS_ASSERT_EQUALS(resolver.cacheSize(), 0u);
+  }
+
+  void testFailureIsCached()
+  {
+    TEST_HEADER;
+
+    Resolver resolver(1, 60, 60);
+    Resolver::Result result = resolver.resolve("no.such.host.invalid", "80").get();
+    TS_ASSERT_EQUALS(result == 0, true);
+    TS_ASSERT_EQUALS(resolver.cacheSize(), 1u);
+
+    resolver.clear();
+    TS_ASSERT_EQUALS(resolver.cacheSize(), 0u);
+  }
+
+  void testExpiry()
+  {
+    TEST_HEADER;
+
+    Resolver resolver(1, 1);
+    TS_ASSERT_EQUALS(resolver.resolve("localhost", "80").get() == 0, false);
+    TS_ASSERT_EQUALS(resolver.lookup("localhost", "80") == 0, false);
+    sleep(2);
+    TS_ASSERT_EQUALS(resolver.lookup("localhost", "80") == 0, true);
+  }
+
+  void testCoalescing()
+  {
+    TEST_HEADER;
+
+    Resolver resolver(1, 0);
+    std::atomic<int> called(0);
+
+    // keep the only resolver thread busy, so the next lookups queue up
+    resolver.resolve("localhost", "80",
+                     [&called](const Resolver::Result&) { sleep(1); called++; });
+
+    std::shared_future<Resolver::Result> f1 = resolver.resolve("localhost", "81");
+    std::shared_future<Resolver::Result> f2 = resolver.resolve("localhost", "81");
+    Resolver::Result r3;
+    resolver.resolve("localhost", "81",
+                     [&called, &r3](const Resolver::Result& r) { r3 = r; called++; });
+
+    TS_ASSERT_EQUALS(f1.get() == 0, false);
+    TS_ASSERT_EQUALS(f1.get(), f2.get());
+
+    while ( called != 2 )
+      sleep(1);
+    TS_ASSERT_EQUALS(r3, f1.get());
+
+    // ttl 0: nothing is cached
+    TS_ASSERT_EQUALS(resolver.cacheSize(), 0u);
+  }
+
+};
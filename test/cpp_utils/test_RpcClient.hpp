@@ -0,0 +1,169 @@
+#include <cxxtest/TestSuite.h>
+
+#include "Fixture.hpp"
+
+#include <cpp_utils/RpcClient.hpp>
+#include <cpp_utils/TcpConnection.hpp>
+#include <cpp_utils/SocketOptions.hpp>
+#include <cpp_utils/Thread.hpp>
+
+#include <atomic>
+#include <string>
+#include <vector>
+#include <unistd.h> // usleep
+
+class TestRpcClient : public CxxTest::TestSuite
+{
+private:
+
+  // echoes, except "drop" which is never answered and "batch*" ones,
+  // answered in reverse order by three
+  class RpcServerThread : public Thread
+  {
+  public:
+
+    RpcServerThread( const std::string port )
+      : m_batch()
+      , m_message( [this](Connection *c, uint64_t id, const std::string &p)
+                   { handle(c, id, p); } )
+      , m_server("localhost", port, &m_message)
+    {
+      m_server.setSocketOptions(SocketOptions().set(SocketOptions::ReuseAddress, 1));
+      m_server.bind();
+      m_server.listen();
+    }
+
+  private:
+
+    void handle( Connection *connection, uint64_t id, const std::string &payload )
+    {
+      if ( payload == "drop" )
+        return;
+
+      if ( payload.compare(0, 5, "batch") != 0 ) {
+        RpcMessage::reply(connection, id, payload.data(), payload.length());
+        return;
+      }
+
+      m_batch.push_back( std::make_pair(id, payload) );
+      if ( m_batch.size() < 3 )
+        return;
+
+      while ( !m_batch.empty() ) {
+        RpcMessage::reply(connection, m_batch.back().first,
+                          m_batch.back().second.data(), m_batch.back().second.length());
+        m_batch.pop_back();
+      }
+    }
+
+    void* run()
+    {
+      int socket;
+      if ( !m_server.accept(socket) )
+        return 0;
+
+      Connection *client = m_server.clone(socket);
+      while ( client->receive() )
+        ;
+      delete client;
+      return 0;
+    }
+
+    std::vector< std::pair<uint64_t, std::string> > m_batch;
+    RpcMessage     m_message;
+    TcpConnection  m_server;
+  };
+
+public:
+
+  void testManyInFlight()
+  {
+    TEST_HEADER;
+
+    RpcServerThread server("4491");
+    server.start();
+
+    RpcMessage message;
+    TcpConnection connection("localhost", "4491", &message);
+    RpcClient client(&connection, &message);
+    TS_ASSERT_EQUALS(client.connect(), true);
+
+    std::vector< std::shared_future<RpcClient::Response> > futures;
+    for ( int i = 0; i < 1000; ++i ) {
+      const std::string request = "request " + std::to_string(i);
+      futures.push_back(client.call(request.data(), request.length()));
+    }
+
+    for ( int i = 0; i < 1000; ++i ) {
+      TS_ASSERT_EQUALS(futures[i].get().status, RpcClient::Response::OK);
+      TS_ASSERT_EQUALS(futures[i].get().payload, "request " + std::to_string(i));
+    }
+    TS_ASSERT_EQUALS(client.getNumberOfPending(), 0u);
+
+    client.disconnect();
+    server.join();
+  }
+
+  void testOutOfOrderAndTimeout()
+  {
+    TEST_HEADER;
+
+    RpcServerThread server("4492");
+    server.start();
+
+    RpcMessage message;
+    TcpConnection connection("localhost", "4492", &message);
+    RpcClient client(&connection, &message);
+    TS_ASSERT_EQUALS(client.connect(), true);
+
+    std::shared_future<RpcClient::Response> dropped = client.call("drop", 4, 200);
+    std::shared_future<RpcClient::Response> b1 = client.call("batch1", 6);
+    std::shared_future<RpcClient::Response> b2 = client.call("batch2", 6);
+    std::shared_future<RpcClient::Response> b3 = client.call("batch3", 6);
+
+    TS_ASSERT_EQUALS(b1.get().payload, std::string("batch1"));
+    TS_ASSERT_EQUALS(b2.get().payload, std::string("batch2"));
+    TS_ASSERT_EQUALS(b3.get().payload, std::string("batch3"));
+
+    TS_ASSERT_EQUALS(dropped.get().status, RpcClient::Response::TIMEOUT);
+    TS_ASSERT_EQUALS(client.getNumberOfPending(), 0u);
+
+    client.disconnect();
+    server.join();
+  }
+
+  void testCallbackOnDisconnect()
+  {
+    TEST_HEADER;
+
+    RpcServerThread server("4493");
+    server.start();
+
+    RpcMessage message;
+    TcpConnection connection("localhost", "4493", &message);
+    RpcClient client(&connection, &message, 60000);
+    TS_ASSERT_EQUALS(client.connect(), true);
+
+    std::atomic<int> ok(0), failed(0);
+    RpcClient::Callback callback = [&ok, &failed](const RpcClient::Response &r)
+      { r.status == RpcClient::Response::OK ? ok++ : failed++; };
+
+    client.call("hello", 5, callback);
+    client.call("drop", 4, callback);
+    for ( int i = 0; i < 100 && ok == 0; ++i )
+      usleep(10000);
+
+    TS_ASSERT_EQUALS(ok, 1);
+    TS_ASSERT_EQUALS(client.getNumberOfPending(), 1u);
+
+    client.disconnect();
+    TS_ASSERT_EQUALS(failed, 1);
+    TS_ASSERT_EQUALS(client.getNumberOfPending(), 0u);
+    server.join();
+
+    // not connected any more
+    TS_ASSERT_EQUALS(client.call("hello", 5).get().status,
+                     RpcClient::Response::DISCONNECTED);
+  }
+
+};
@@ -111,4 +111,84 @@ public:
     delete t2;
   }
 
+  void testBatch( void )
+  {
+    TEST_HEADER;
+
+    Semaphore s(5);
+    TS_ASSERT_EQUALS( s.acquire(3), true );
+    TS_ASSERT_EQUALS( s.getCount(), 2 );
+    TS_ASSERT_EQUALS( s.tryAcquire(3), false );
+    TS_ASSERT_EQUALS( s.getCount(), 2 );
+    TS_ASSERT_EQUALS( s.release(4), false );
+    TS_ASSERT_EQUALS( s.release(3), true );
+    TS_ASSERT_EQUALS( s.getCount(), 5 );
+    TS_ASSERT_EQUALS( s.tryAcquire(5), true );
+    TS_ASSERT_EQUALS( s.getCount(), 0 );
+  }
+
+  void testTimedWait( void )
+  {
+    TEST_HEADER;
+
+    Semaphore s(2);
+    TS_ASSERT_EQUALS( s.acquire(2), true );
+
+    timespec before, after;
+    clock_gettime(CLOCK_MONOTONIC, &before);
+    TS_ASSERT_EQUALS( s.acquire(1, 0, 200000000), false );
+    clock_gettime(CLOCK_MONOTONIC, &after);
+    const timespec elapsed = timespecSubstract(after, before);
+    TS_ASSERT( elapsed.tv_sec > 0 || elapsed.tv_nsec >= 200000000 );
+    TS_ASSERT_EQUALS( s.getCount(), 0 );
+  }
+
+private:
+
+  class AcquirerThread : public Thread
+  {
+  public:
+
+    AcquirerThread( Semaphore &semaphore, const int n, const int times )
+      : m_semaphore(semaphore), m_n(n), m_times(times) {}
+
+  private:
+
+    AcquirerThread(const AcquirerThread&);
+    AcquirerThread& operator=(const AcquirerThread&);
+
+    void* run( void ) {
+      TRACE;
+      for ( int i = 0; i < m_times; ++i )
+        m_semaphore.acquire(m_n);
+      return 0;
+    }
+
+    Semaphore &m_semaphore;
+    const int m_n;
+    const int m_times;
+  };
+
+public:
+
+  void testWakeBatchWaiters( void )
+  {
+    TEST_HEADER;
+
+    // one waits for one, the other for three, releases come one by one
+    Semaphore s(4);
+    TS_ASSERT_EQUALS( s.acquire(4), true );
+    AcquirerThread single(s, 1, 1000), batch(s, 3, 1000);
+    single.start();
+    batch.start();
+
+    for ( int i = 0; i < 4000; ++i )
+      while ( !s.release(1) )
+        sched_yield();
+
+    single.join();
+    batch.join();
+    TS_ASSERT_EQUALS( s.getCount(), 0 );
+  }
+
 };
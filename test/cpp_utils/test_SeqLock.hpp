@@ -0,0 +1,84 @@
+#include <cxxtest/TestSuite.h>
+
+#include <cpp_utils/Common.hpp>
+#include "Fixture.hpp"
+#include <cpp_utils/SeqLock.hpp>
+#include <cpp_utils/Thread.hpp>
+
+class TestSeqLock : public CxxTest::TestSuite
+{
+private:
+
+  // the fields always equal, a torn read would show
+  struct Stats
+  {
+    int a;
+    long b;
+    short c;
+  };
+
+  class WriterThread : public Thread
+  {
+  public:
+
+    WriterThread( SeqLock<Stats> &stats ) : m_stats(stats) {}
+
+  private:
+
+    WriterThread(const WriterThread&);
+    WriterThread& operator=(const WriterThread&);
+
+    void* run()
+    {
+      for ( int i = 1; i <= 100000; ++i ) {
+        const Stats stats = { i, i, (short)i };
+        m_stats.write(stats);
+      }
+      return 0;
+    }
+
+    SeqLock<Stats> &m_stats;
+  };
+
+public:
+
+  void testBasic( void )
+  {
+    TEST_HEADER;
+
+    const Stats initial = { 1, 2, 3 };
+    SeqLock<Stats> stats(initial);
+    TS_ASSERT_EQUALS ( stats.read().b, 2 );
+    TS_ASSERT_EQUALS ( stats.getSequence(), 0u );
+
+    const Stats next = { 4, 5, 6 };
+    stats.write(next);
+    TS_ASSERT_EQUALS ( stats.read().a, 4 );
+    TS_ASSERT_EQUALS ( stats.read().c, 6 );
+    TS_ASSERT_EQUALS ( stats.getSequence(), 2u );
+  }
+
+  void testNoTornRead( void )
+  {
+    TEST_HEADER;
+
+    const Stats initial = { 0, 0, 0 };
+    SeqLock<Stats> stats(initial);
+    WriterThread writer1(stats), writer2(stats);
+    writer1.start();
+    writer2.start();
+
+    int torn(0);
+    for ( int i = 0; i < 100000; ++i ) {
+      const Stats read = stats.read();
+      if ( read.a != read.b || (short)read.a != read.c )
+        ++torn;
+    }
+
+    writer1.join();
+    writer2.join();
+    TS_ASSERT_EQUALS ( torn, 0 );
+    TS_ASSERT_EQUALS ( stats.getSequence(), 2u * 200000 );
+  }
+
+};
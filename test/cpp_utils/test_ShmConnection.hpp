@@ -0,0 +1,161 @@
+#include <cxxtest/TestSuite.h>
+
+#include "Fixture.hpp"
+
+#include <cpp_utils/ShmConnection.hpp>
+#include <cpp_utils/Thread.hpp>
+
+#include <vector>
+
+class TestShmConnection : public CxxTest::TestSuite
+{
+private:
+
+  class StoreMessage : public Message
+  {
+  public:
+
+    StoreMessage()
+      : Message()
+      , m_messages()
+    {
+      TRACE;
+    }
+
+    bool buildMessage( const void *msgPart, const size_t msgLen )
+    {
+      TRACE;
+      m_messages.push_back( std::string( (const char*)msgPart, msgLen ) );
+      return true;
+    }
+
+    void onMessageReady() {}
+    Message* clone() { return new StoreMessage; }
+
+    std::vector<std::string> m_messages;
+
+  protected:
+
+    size_t getExpectedLength() { return 0; }
+
+  }; // StoreMessage
+
+  class ReceiverThread : public Thread
+  {
+  public:
+
+    ReceiverThread( ShmConnection &connection )
+      : m_received(0)
+      , m_connection(connection)
+    {
+      TRACE;
+    }
+
+    int m_received;
+
+  private:
+
+    ReceiverThread(const ReceiverThread&);
+    ReceiverThread& operator=(const ReceiverThread&);
+
+    void* run( void )
+    {
+      TRACE;
+      while ( m_connection.receive() )
+        m_received++;
+
+      return 0;
+    }
+
+    ShmConnection &m_connection;
+
+  }; // ReceiverThread
+
+public:
+
+  void testBasic()
+  {
+    TEST_HEADER;
+
+    StoreMessage serverMessage;
+    StoreMessage clientMessage;
+    ShmConnection server("/test_cpp_utils_shm", &serverMessage, 4096);
+    ShmConnection client("/test_cpp_utils_shm", &clientMessage);
+
+    TS_ASSERT_EQUALS(client.connect(), false); // not created yet
+    TS_ASSERT_EQUALS(server.bind(), true);
+    TS_ASSERT_EQUALS(client.connect(), true);
+    TS_ASSERT_EQUALS(client.getMaxMessageLength(), server.getMaxMessageLength());
+    TS_ASSERT_EQUALS(client.getSocket(), -1);
+    TS_ASSERT_EQUALS(client.clone(1) == 0, true);
+
+    std::string msg1("hello"), msg2("world");
+    TS_ASSERT_EQUALS(client.send(msg1.c_str(), msg1.length()), true);
+    TS_ASSERT_EQUALS(client.send(msg2.c_str(), msg2.length()), true);
+    TS_ASSERT_EQUALS(server.receive(), true);
+    TS_ASSERT_EQUALS(serverMessage.m_messages.size(), 2u);
+    TS_ASSERT_EQUALS(serverMessage.m_messages[0], msg1);
+    TS_ASSERT_EQUALS(serverMessage.m_messages[1], msg2);
+
+    TS_ASSERT_EQUALS(server.send(msg2.c_str(), msg2.length()), true);
+    TS_ASSERT_EQUALS(client.receive(), true);
+    TS_ASSERT_EQUALS(clientMessage.m_messages.size(), 1u);
+    TS_ASSERT_EQUALS(clientMessage.m_messages[0], msg2);
+
+    std::string tooLong(server.getMaxMessageLength() + 1, 'x');
+    TS_ASSERT_EQUALS(server.send(tooLong.c_str(), tooLong.length()), false);
+
+    TS_ASSERT_EQUALS(client.disconnect(), true);
+    TS_ASSERT_EQUALS(server.closed(), true);
+    TS_ASSERT_EQUALS(server.receive(), false);
+    TS_ASSERT_EQUALS(server.disconnect(), true);
+    TS_ASSERT_EQUALS(server.disconnect(), false);
+  }
+
+  void testWrapAround()
+  {
+    TEST_HEADER;
+
+    StoreMessage serverMessage;
+    StoreMessage clientMessage;
+    ShmConnection server("/test_cpp_utils_shm_wrap", &serverMessage, 4096);
+    ShmConnection client("/test_cpp_utils_shm_wrap", &clientMessage);
+    TS_ASSERT_EQUALS(server.bind(), true);
+    TS_ASSERT_EQUALS(client.connect(), true);
+
+    for ( int i = 0; i < 100; ++i ) {
+      std::string msg(100 + i * 7 % 1500, 'a' + i % 26);
+      TS_ASSERT_EQUALS(client.send(msg.c_str(), msg.length()), true);
+      TS_ASSERT_EQUALS(server.receive(), true);
+      TS_ASSERT_EQUALS(serverMessage.m_messages.back(), msg);
+    }
+    TS_ASSERT_EQUALS(serverMessage.m_messages.size(), 100u);
+  }
+
+  void testBlockingReceiver()
+  {
+    TEST_HEADER;
+
+    StoreMessage serverMessage;
+    StoreMessage clientMessage;
+    ShmConnection server("/test_cpp_utils_shm_thread", &serverMessage, 4096);
+    ShmConnection client("/test_cpp_utils_shm_thread", &clientMessage);
+    TS_ASSERT_EQUALS(server.bind(), true);
+    TS_ASSERT_EQUALS(client.connect(), true);
+
+    ReceiverThread receiver(server);
+    receiver.start();
+
+    // more than the ring can hold: the writer has to wait for the reader
+    std::string msg(1000, 'q');
+    for ( int i = 0; i < 1000; ++i )
+      TS_ASSERT_EQUALS(client.send(msg.c_str(), msg.length()), true);
+
+    client.disconnect();
+    receiver.join();
+
+    TS_ASSERT_EQUALS(serverMessage.m_messages.size(), 1000u);
+    TS_ASSERT_LESS_THAN_EQUALS(receiver.m_received, 1000);
+  }
+
+};
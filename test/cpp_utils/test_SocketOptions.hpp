@@ -0,0 +1,122 @@
+#include <cxxtest/TestSuite.h>
+
+#include "Fixture.hpp"
+
+#include <cpp_utils/SocketOptions.hpp>
+#include <cpp_utils/TcpConnection.hpp>
+
+class TestSocketOptions : public CxxTest::TestSuite
+{
+private:
+
+  class NullMessage : public Message
+  {
+  public:
+
+    NullMessage() : Message() {}
+
+    bool buildMessage( const void*, const size_t ) { return true; }
+    void onMessageReady() {}
+    Message* clone() { return new NullMessage; }
+
+  protected:
+
+    size_t getExpectedLength() { return 0; }
+
+  }; // NullMessage
+
+public:
+
+  void testSetGet()
+  {
+    TEST_HEADER;
+
+    SocketOptions options;
+    TS_ASSERT_EQUALS(options.empty(), true);
+
+    options.set(SocketOptions::NoDelay, 1).set(SocketOptions::SendBuffer, 65536);
+    TS_ASSERT_EQUALS(options.empty(), false);
+
+    int value(0);
+    TS_ASSERT_EQUALS(options.get(SocketOptions::SendBuffer, value), true);
+    TS_ASSERT_EQUALS(value, 65536);
+    TS_ASSERT_EQUALS(options.get(SocketOptions::Cork, value), false);
+
+    TS_ASSERT_EQUALS(options.unset(SocketOptions::SendBuffer), true);
+    TS_ASSERT_EQUALS(options.unset(SocketOptions::SendBuffer), false);
+
+    SocketOptions other;
+    other.set(SocketOptions::NoDelay, 0).set(SocketOptions::KeepAlive, 1);
+    options.merge(other);
+    TS_ASSERT_EQUALS(options.get(SocketOptions::NoDelay, value), true);
+    TS_ASSERT_EQUALS(value, 0);
+    TS_ASSERT_EQUALS(options.get(SocketOptions::KeepAlive, value), true);
+
+    TS_ASSERT_EQUALS(std::string(SocketOptions::optionName(SocketOptions::ReusePort)),
+                     std::string("SO_REUSEPORT"));
+  }
+
+  void testProfiles()
+  {
+    TEST_HEADER;
+
+    int value(0);
+    TS_ASSERT_EQUALS(SocketOptions::lowLatency().get(SocketOptions::NoDelay, value), true);
+    TS_ASSERT_EQUALS(value, 1);
+    TS_ASSERT_EQUALS(SocketOptions::bulk().get(SocketOptions::SendBuffer, value), true);
+    TS_ASSERT_LESS_THAN(65536, value);
+  }
+
+  void testInheritedByClone()
+  {
+    TEST_HEADER;
+
+    NullMessage message;
+    TcpConnection server("localhost", "4471", &message);
+    TcpConnection client("localhost", "4471", &message);
+
+    SocketOptions options = SocketOptions::lowLatency();
+    options.set(SocketOptions::ReuseAddress, 1)
+           .set(SocketOptions::ReceiveBuffer, 128 * 1024);
+    TS_ASSERT_EQUALS(server.setSocketOptions(options), true);
+
+    int value(0);
+    TS_ASSERT_EQUALS(SocketOptions::getOption(server.getSocket(),
+                                              SocketOptions::ReuseAddress,
+                                              value), true);
+    TS_ASSERT_EQUALS(value, 1);
+
+    TS_ASSERT_EQUALS(server.bind(), true);
+    TS_ASSERT_EQUALS(server.listen(), true);
+    TS_ASSERT_EQUALS(client.connect(), true);
+
+    int clientSocket;
+    TS_ASSERT_EQUALS(server.accept(clientSocket), true);
+    TcpConnection *peer = dynamic_cast<TcpConnection*>(server.clone(clientSocket));
+
+    TS_ASSERT_EQUALS(peer->getSocketOptions().get(SocketOptions::NoDelay, value), true);
+    TS_ASSERT_EQUALS(SocketOptions::getOption(peer->getSocket(),
+                                              SocketOptions::NoDelay,
+                                              value), true);
+    TS_ASSERT_EQUALS(value, 1);
+
+    // the kernel doubles the requested buffer size
+    TS_ASSERT_EQUALS(SocketOptions::getOption(peer->getSocket(),
+                                              SocketOptions::ReceiveBuffer,
+                                              value), true);
+    TS_ASSERT_LESS_THAN_EQUALS(128 * 1024, value);
+
+    delete peer->getMessage();
+    delete peer;
+    client.disconnect();
+    server.disconnect();
+  }
+
+  void testInvalidSocket()
+  {
+    TEST_HEADER;
+
+    TS_ASSERT_EQUALS(SocketOptions::lowLatency().apply(-1), false);
+  }
+
+};
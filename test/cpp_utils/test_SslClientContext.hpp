@@ -0,0 +1,209 @@
+#include <cxxtest/TestSuite.h>
+
+#include "Fixture.hpp"
+
+#include <cpp_utils/SslClientContext.hpp>
+#include <cpp_utils/SslSessionCache.hpp>
+#include <cpp_utils/SslConnection.hpp>
+#include <cpp_utils/TcpConnection.hpp>
+#include <cpp_utils/SocketOptions.hpp>
+#include <cpp_utils/Thread.hpp>
+
+#include <string>
+#include <unistd.h> // close
+
+#include <openssl/ssl.h>
+#include <openssl/evp.h>
+#include <openssl/x509.h>
+
+class TestSslClientContext : public CxxTest::TestSuite
+{
+private:
+
+  class StoreMessage : public Message
+  {
+  public:
+
+    StoreMessage() : Message() {}
+
+    bool buildMessage( const void *msgPart, const size_t msgLen )
+    {
+      m_buffer = std::string( (const char*) msgPart, msgLen );
+      return true;
+    }
+    void onMessageReady() {}
+    Message* clone() { return new StoreMessage; }
+    std::string get() const { return m_buffer; }
+
+  protected:
+
+    size_t getExpectedLength() { return 0; }
+
+  }; // StoreMessage
+
+  // self-signed, generated so the test needs no files
+  static bool useNewCertificate( SSL_CTX *context )
+  {
+    EVP_PKEY *key(0);
+    EVP_PKEY_CTX *keyContext = EVP_PKEY_CTX_new_id(EVP_PKEY_RSA, 0);
+    if ( keyContext == 0 || EVP_PKEY_keygen_init(keyContext) != 1 ||
+         EVP_PKEY_CTX_set_rsa_keygen_bits(keyContext, 2048) != 1 ||
+         EVP_PKEY_keygen(keyContext, &key) != 1 ) {
+      EVP_PKEY_CTX_free(keyContext);
+      return false;
+    }
+    EVP_PKEY_CTX_free(keyContext);
+
+    X509 *cert = X509_new();
+    ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+    X509_gmtime_adj(X509_get_notBefore(cert), 0);
+    X509_gmtime_adj(X509_get_notAfter(cert), 3600);
+    X509_set_pubkey(cert, key);
+    X509_NAME *name = X509_get_subject_name(cert);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC,
+                               (const unsigned char*)"localhost", -1, -1, 0);
+    X509_set_issuer_name(cert, name);
+    X509_sign(cert, key, EVP_sha256());
+
+    const bool ok = SSL_CTX_use_certificate(context, cert) == 1 &&
+                    SSL_CTX_use_PrivateKey(context, key) == 1;
+    X509_free(cert);
+    EVP_PKEY_free(key);
+    return ok;
+  }
+
+  // echoes over TLS for the given number of connections, one at a time
+  class EchoServerThread : public Thread
+  {
+  public:
+
+    EchoServerThread( const std::string port,
+                      SslSessionCache &cache,
+                      const int connections )
+      : m_message()
+      , m_listener("localhost", port, &m_message)
+      , m_context(SSL_CTX_new(SSLv23_server_method()))
+      , m_connections(connections)
+    {
+      // stateful sessions, so the cache sees the resumption
+      SSL_CTX_set_options(m_context, SSL_OP_NO_TICKET);
+      useNewCertificate(m_context);
+      cache.attach(m_context);
+
+      m_listener.setSocketOptions(SocketOptions().set(SocketOptions::ReuseAddress, 1));
+      m_listener.bind();
+      m_listener.listen();
+      start();
+    }
+
+    ~EchoServerThread()
+    {
+      join();
+      SSL_CTX_free(m_context);
+    }
+
+  private:
+
+    EchoServerThread(const EchoServerThread&);
+    EchoServerThread& operator=(const EchoServerThread&);
+
+    void* run()
+    {
+      for ( int i = 0; i < m_connections; ++i ) {
+        int socket;
+        if ( !m_listener.accept(socket) )
+          break;
+
+        SSL *ssl = SSL_new(m_context);
+        SSL_set_fd(ssl, socket);
+        if ( SSL_accept(ssl) == 1 ) {
+          char buffer[64];
+          int length;
+          while ( (length = SSL_read(ssl, buffer, sizeof(buffer))) > 0 )
+            SSL_write(ssl, buffer, length);
+          SSL_shutdown(ssl);
+        }
+        SSL_free(ssl);
+        close(socket);
+      }
+      return 0;
+    }
+
+    StoreMessage   m_message;
+    TcpConnection  m_listener;
+    SSL_CTX       *m_context;
+    const int      m_connections;
+  };
+
+  static std::string echo( SslConnection &connection, StoreMessage &message,
+                           const std::string &msg )
+  {
+    if ( !connection.connect() ||
+         !connection.send(msg.c_str(), msg.length()) ||
+         !connection.receive() )
+      return std::string();
+
+    connection.disconnect();
+    return message.get();
+  }
+
+public:
+
+  void testReconnectResumes()
+  {
+    TEST_HEADER;
+
+    SslSessionCache serverCache;
+    EchoServerThread server("4601", serverCache, 3);
+
+    SslClientContext clientContext;
+    StoreMessage message;
+    SslConnection connection("localhost", "4601", &message);
+    TS_ASSERT_EQUALS(connection.initClientContext(&clientContext), true);
+
+    TS_ASSERT_EQUALS(echo(connection, message, "full"), std::string("full"));
+    TS_ASSERT_EQUALS(clientContext.size(), 1u);
+    TS_ASSERT_EQUALS(clientContext.getMisses(), 1u);
+    TS_ASSERT_EQUALS(serverCache.getHits(), 0u);
+
+    // the same connection again
+    TS_ASSERT_EQUALS(echo(connection, message, "again"), std::string("again"));
+    TS_ASSERT_EQUALS(clientContext.getHits(), 1u);
+    TS_ASSERT_EQUALS(serverCache.getHits(), 1u);
+
+    // a new one to the same peer
+    StoreMessage message2;
+    SslConnection connection2("localhost", "4601", &message2);
+    TS_ASSERT_EQUALS(connection2.initClientContext(&clientContext), true);
+    TS_ASSERT_EQUALS(echo(connection2, message2, "pooled"), std::string("pooled"));
+    TS_ASSERT_EQUALS(clientContext.getHits(), 2u);
+    TS_ASSERT_EQUALS(serverCache.getHits(), 2u);
+  }
+
+  void testSessionPerPeer()
+  {
+    TEST_HEADER;
+
+    SslSessionCache serverCache;
+    EchoServerThread server("4602", serverCache, 2);
+
+    SslClientContext clientContext;
+    StoreMessage message;
+    SslConnection connection("localhost", "4602", &message);
+    SslConnection connection2("127.0.0.1", "4602", &message);
+    TS_ASSERT_EQUALS(connection.initClientContext(&clientContext), true);
+    TS_ASSERT_EQUALS(connection2.initClientContext(&clientContext), true);
+
+    TS_ASSERT_EQUALS(echo(connection, message, "one"), std::string("one"));
+    TS_ASSERT_EQUALS(echo(connection2, message, "two"), std::string("two"));
+
+    // same server, but another name
+    TS_ASSERT_EQUALS(clientContext.size(), 2u);
+    TS_ASSERT_EQUALS(clientContext.getHits(), 0u);
+    TS_ASSERT_EQUALS(serverCache.getHits(), 0u);
+
+    clientContext.clear();
+    TS_ASSERT_EQUALS(clientContext.size(), 0u);
+  }
+
+};
@@ -0,0 +1,544 @@
+#include <cxxtest/TestSuite.h>
+
+#include "Fixture.hpp"
+
+#include <cpp_utils/SslConnection.hpp>
+#include <cpp_utils/SocketServer.hpp>
+#include <cpp_utils/TcpConnection.hpp>
+#include <cpp_utils/ConnectionManager.hpp>
+#include <cpp_utils/SocketOptions.hpp>
+#include <cpp_utils/Thread.hpp>
+#include <cpp_utils/ThreadPool.hpp>
+#include <cpp_utils/WorkerThread.hpp>
+#include <cpp_utils/BufferPool.hpp>
+
+#include <atomic>
+#include <string>
+#include <stdio.h> // fopen
+#include <unistd.h> // usleep, getpid, fork, pipe
+#include <fcntl.h> // open
+#include <malloc.h> // mallinfo2
+#include <poll.h>
+#include <sys/uio.h> // iovec
+#include <sys/wait.h> // waitpid
+
+#include <openssl/ssl.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/x509.h>
+
+class TestSslConnection : public CxxTest::TestSuite
+{
+private:
+
+  class EchoMessage : public Message
+  {
+  public:
+
+    EchoMessage() : Message() {}
+
+    bool buildMessage( const void *msgPart, const size_t msgLen )
+    {
+      m_buffer = std::string( (const char*) msgPart, msgLen );
+      onMessageReady();
+      return true;
+    }
+    void onMessageReady() { m_connection->send(m_buffer.c_str(), m_buffer.length()); }
+    Message* clone() { return new EchoMessage; }
+
+  protected:
+
+    size_t getExpectedLength() { return 0; }
+
+  }; // EchoMessage
+
+  class StoreMessage : public Message
+  {
+  public:
+
+    StoreMessage() : Message() {}
+
+    // a record longer than the buffer comes in several parts
+    bool buildMessage( const void *msgPart, const size_t msgLen )
+    {
+      m_buffer.append( (const char*) msgPart, msgLen );
+      return true;
+    }
+    void onMessageReady() {}
+    Message* clone() { return new StoreMessage; }
+    std::string get() { std::string received; received.swap(m_buffer); return received; }
+
+  protected:
+
+    size_t getExpectedLength() { return 0; }
+
+  }; // StoreMessage
+
+  // self-signed into PEM files, initServerContext loads files
+  static bool writeNewCertificate( const std::string &certificateFile,
+                                   const std::string &keyFile )
+  {
+    EVP_PKEY *key(0);
+    EVP_PKEY_CTX *keyContext = EVP_PKEY_CTX_new_id(EVP_PKEY_RSA, 0);
+    if ( keyContext == 0 || EVP_PKEY_keygen_init(keyContext) != 1 ||
+         EVP_PKEY_CTX_set_rsa_keygen_bits(keyContext, 2048) != 1 ||
+         EVP_PKEY_keygen(keyContext, &key) != 1 ) {
+      EVP_PKEY_CTX_free(keyContext);
+      return false;
+    }
+    EVP_PKEY_CTX_free(keyContext);
+
+    X509 *cert = X509_new();
+    ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+    X509_gmtime_adj(X509_get_notBefore(cert), 0);
+    X509_gmtime_adj(X509_get_notAfter(cert), 3600);
+    X509_set_pubkey(cert, key);
+    X509_NAME *name = X509_get_subject_name(cert);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC,
+                               (const unsigned char*)"localhost", -1, -1, 0);
+    X509_set_issuer_name(cert, name);
+    X509_sign(cert, key, EVP_sha256());
+
+    bool ok(false);
+    FILE *certFp = fopen(certificateFile.c_str(), "w");
+    FILE *keyFp = fopen(keyFile.c_str(), "w");
+    if ( certFp != 0 && keyFp != 0 )
+      ok = PEM_write_X509(certFp, cert) == 1 &&
+           PEM_write_PrivateKey(keyFp, key, 0, 0, 0, 0, 0) == 1;
+    if ( certFp != 0 )
+      fclose(certFp);
+    if ( keyFp != 0 )
+      fclose(keyFp);
+
+    X509_free(cert);
+    EVP_PKEY_free(key);
+    return ok;
+  }
+
+  class EchoServerThread : public Thread
+  {
+  public:
+
+    EchoServerThread( const std::string port,
+                      const bool nonBlocking = false,
+                      const bool kernelTls = false,
+                      ThreadPool *cryptoPool = 0,
+                      BufferPool *bufferPool = 0 )
+      : m_message()
+      , m_connection("localhost", port, &m_message)
+      , m_server(&m_connection, 8, 10, 100)
+    {
+      const std::string prefix = "/tmp/test_SslConnection_" + TToStr(getpid());
+      writeNewCertificate(prefix + "_cert.pem", prefix + "_key.pem");
+      m_connection.initServerContext(prefix + "_cert.pem", prefix + "_key.pem");
+      unlink((prefix + "_cert.pem").c_str());
+      unlink((prefix + "_key.pem").c_str());
+
+      m_connection.setSocketOptions(SocketOptions().set(SocketOptions::ReuseAddress, 1));
+      m_connection.setNonBlocking(nonBlocking);
+      m_connection.setKernelTls(kernelTls);
+      m_connection.setCryptoPool(cryptoPool);
+      m_connection.setBufferPool(bufferPool);
+      start();
+    }
+
+    ~EchoServerThread()
+    {
+      m_server.stop();
+      join();
+    }
+
+  private:
+
+    EchoServerThread(const EchoServerThread&);
+    EchoServerThread& operator=(const EchoServerThread&);
+
+    void* run()
+    {
+      m_server.start();
+      return 0;
+    }
+
+    EchoMessage    m_message;
+    SslConnection  m_connection;
+    SocketServer   m_server;
+  };
+
+  static std::string receive( SslConnection &connection, StoreMessage &message,
+                              const size_t length )
+  {
+    std::string received;
+    while ( received.length() < length && connection.receive() )
+      received += message.get();
+    return received;
+  }
+
+  static std::string echo( SslConnection &connection, StoreMessage &message,
+                           const std::string &msg )
+  {
+    if ( !connection.send(msg.c_str(), msg.length()) || !connection.receive() )
+      return std::string();
+
+    return message.get();
+  }
+
+public:
+
+  void testConcurrentClients()
+  {
+    TEST_HEADER;
+
+    EchoServerThread server("4603");
+    usleep(100000);
+
+    StoreMessage message1, message2, message3;
+    SslConnection client1("localhost", "4603", &message1);
+    SslConnection client2("localhost", "4603", &message2);
+    SslConnection client3("localhost", "4603", &message3);
+    TS_ASSERT_EQUALS(client1.initClientContext(), true);
+    TS_ASSERT_EQUALS(client2.initClientContext(), true);
+    TS_ASSERT_EQUALS(client3.initClientContext(), true);
+
+    // all of them connected at once, each with its own handle on the server
+    TS_ASSERT_EQUALS(client1.connect(), true);
+    TS_ASSERT_EQUALS(client2.connect(), true);
+    TS_ASSERT_EQUALS(client3.connect(), true);
+
+    TS_ASSERT_EQUALS(echo(client3, message3, "three"), std::string("three"));
+    TS_ASSERT_EQUALS(echo(client1, message1, "one"), std::string("one"));
+    TS_ASSERT_EQUALS(echo(client2, message2, "two"), std::string("two"));
+
+    // the others keep working
+    client2.disconnect();
+    TS_ASSERT_EQUALS(echo(client1, message1, "again"), std::string("again"));
+    TS_ASSERT_EQUALS(echo(client3, message3, "again"), std::string("again"));
+
+    client1.disconnect();
+    client3.disconnect();
+  }
+
+  void testReconnect()
+  {
+    TEST_HEADER;
+
+    EchoServerThread server("4604");
+    usleep(100000);
+
+    StoreMessage message;
+    SslConnection client("localhost", "4604", &message);
+    TS_ASSERT_EQUALS(client.initClientContext(), true);
+
+    // the context outlives disconnect
+    for ( int i = 0; i < 3; ++i ) {
+      TS_ASSERT_EQUALS(client.connect(), true);
+      TS_ASSERT_EQUALS(echo(client, message, "hello"), std::string("hello"));
+      TS_ASSERT_EQUALS(client.disconnect(), true);
+    }
+  }
+
+  void testStalledHandshake()
+  {
+    TEST_HEADER;
+
+    EchoServerThread server("4605", true);
+    usleep(100000);
+
+    // the start of a client hello, then nothing
+    StoreMessage stalledMessage;
+    TcpConnection stalled("localhost", "4605", &stalledMessage);
+    TS_ASSERT_EQUALS(stalled.connect(), true);
+    TS_ASSERT_EQUALS(stalled.send("\x16\x03\x01", 3), true);
+    usleep(100000);
+
+    // a blocking server would wait for the rest of it
+    StoreMessage message;
+    SslConnection client("localhost", "4605", &message);
+    TS_ASSERT_EQUALS(client.initClientContext(), true);
+    TS_ASSERT_EQUALS(client.connect(), true);
+    TS_ASSERT_EQUALS(echo(client, message, "hello"), std::string("hello"));
+
+    // more than a TLS record, written in parts
+    const std::string large(100 * 1024, 'x');
+    TS_ASSERT_EQUALS(client.send(large.c_str(), large.length()), true);
+    TS_ASSERT_EQUALS(receive(client, message, large.length()) == large, true);
+
+    client.disconnect();
+    stalled.disconnect();
+  }
+
+  void testNonBlockingClient()
+  {
+    TEST_HEADER;
+
+    EchoServerThread server("4606", true);
+    usleep(100000);
+
+    StoreMessage message;
+    SslConnection client("localhost", "4606", &message);
+    TS_ASSERT_EQUALS(client.initClientContext(), true);
+    client.setNonBlocking(true);
+
+    // sent before the handshake is done, goes out after it
+    volatile bool echoed(false);
+    ConnectionManager::Callbacks callbacks;
+    callbacks.onConnected = [](StreamConnection *connection)
+      { connection->send("hello", 5); };
+    callbacks.onReceived = [&message, &echoed](StreamConnection*)
+      { echoed = echoed || message.get() == "hello"; };
+
+    ConnectionManager manager(1, 2000, 100, 1000, false);
+    TS_ASSERT_EQUALS(manager.start(), true);
+    TS_ASSERT_EQUALS(manager.addConnection(&client, callbacks), true);
+
+    for ( int i = 0; i < 300 && !echoed; ++i )
+      usleep(10000);
+    TS_ASSERT_EQUALS(echoed, true);
+
+    TS_ASSERT_EQUALS(manager.removeConnection(&client), true);
+    manager.stop();
+  }
+
+  void testNonBlockingLargeSend()
+  {
+    TEST_HEADER;
+
+    EchoServerThread server("4610", true);
+    usleep(100000);
+
+    StoreMessage message;
+    SslConnection client("localhost", "4610", &message);
+    TS_ASSERT_EQUALS(client.initClientContext(), true);
+    client.setNonBlocking(true);
+    client.setSocketOptions(SocketOptions().set(SocketOptions::SendBuffer, 16 * 1024));
+
+    std::atomic<bool> connected(false);
+    std::atomic<size_t> echoed(0);
+    ConnectionManager::Callbacks callbacks;
+    callbacks.onConnected = [&connected](StreamConnection*) { connected = true; };
+    callbacks.onReceived = [&message, &echoed](StreamConnection*)
+      { echoed += message.get().length(); };
+
+    ConnectionManager manager(1, 2000, 100, 1000, false);
+    TS_ASSERT_EQUALS(manager.start(), true);
+    TS_ASSERT_EQUALS(manager.addConnection(&client, callbacks), true);
+    for ( int i = 0; i < 300 && !connected; ++i )
+      usleep(10000);
+    TS_ASSERT_EQUALS(connected.load(), true);
+
+    // from this thread, while the reactor reads the echo: most of it is
+    // queued, the reactor writes it as the socket drains
+    const std::string large(4 * 1024 * 1024, 'x');
+    TS_ASSERT_EQUALS(manager.send(&client, large.c_str(), large.length()), true);
+    for ( int i = 0; i < 1000 && echoed < large.length(); ++i )
+      usleep(10000);
+    TS_ASSERT_EQUALS(echoed.load(), large.length());
+
+    TS_ASSERT_EQUALS(manager.removeConnection(&client), true);
+    manager.stop();
+  }
+
+  void testKernelTls()
+  {
+    TEST_HEADER;
+
+    EchoServerThread server("4607", false, true);
+    usleep(100000);
+
+    StoreMessage message;
+    SslConnection client("localhost", "4607", &message);
+    TS_ASSERT_EQUALS(client.initClientContext(), true);
+    client.setKernelTls(true);
+    TS_ASSERT_EQUALS(client.connect(), true);
+
+    // either way, only the path differs
+    TS_TRACE(client.isKernelTlsSend() ? "kernel TLS send" : "no kernel TLS send");
+    TS_ASSERT_EQUALS(echo(client, message, "hello"), std::string("hello"));
+
+    char first[] = "vec", second[] = "tored";
+    struct iovec iov[2] = { { first, 3 }, { second, 5 } };
+    TS_ASSERT_EQUALS(client.send(iov, 2), true);
+    TS_ASSERT_EQUALS(receive(client, message, 8), std::string("vectored"));
+
+    const std::string path = "/tmp/test_SslConnection_" + TToStr(getpid()) + "_file";
+    std::string content;
+    for ( int i = 0; content.length() < 40 * 1024; ++i )
+      content += TToStr(i);
+    FILE *fp = fopen(path.c_str(), "w");
+    fwrite(content.data(), 1, content.length(), fp);
+    fclose(fp);
+
+    const int fd = open(path.c_str(), O_RDONLY);
+    TS_ASSERT_EQUALS(client.sendFile(fd, 10, content.length() - 10), true);
+    TS_ASSERT_EQUALS(receive(client, message, content.length() - 10) ==
+                     content.substr(10), true);
+    close(fd);
+    unlink(path.c_str());
+
+    client.disconnect();
+  }
+
+  void testCryptoPool()
+  {
+    TEST_HEADER;
+
+    ThreadPool pool;
+    for ( int i = 0; i < 3; ++i )
+      pool.pushWorkerThread(new WorkerThread(pool));
+    pool.startWorkerThreads();
+
+    {
+      EchoServerThread server("4608", false, false, &pool);
+      usleep(100000);
+
+      StoreMessage message1, message2;
+      SslConnection client1("localhost", "4608", &message1);
+      SslConnection client2("localhost", "4608", &message2);
+      TS_ASSERT_EQUALS(client1.initClientContext(), true);
+      TS_ASSERT_EQUALS(client2.initClientContext(), true);
+      TS_ASSERT_EQUALS(client1.connect(), true);
+      TS_ASSERT_EQUALS(client2.connect(), true);
+
+      TS_ASSERT_EQUALS(echo(client1, message1, "one"), std::string("one"));
+      TS_ASSERT_EQUALS(echo(client2, message2, "two"), std::string("two"));
+
+      // more than the BIO pair holds, in several rounds
+      const std::string large(100 * 1024, 'x');
+      TS_ASSERT_EQUALS(client1.send(large.c_str(), large.length()), true);
+      TS_ASSERT_EQUALS(client2.send(large.c_str(), large.length()), true);
+      TS_ASSERT_EQUALS(receive(client1, message1, large.length()) == large, true);
+      TS_ASSERT_EQUALS(receive(client2, message2, large.length()) == large, true);
+
+      client1.disconnect();
+      TS_ASSERT_EQUALS(echo(client2, message2, "still"), std::string("still"));
+      client2.disconnect();
+    }
+
+    pool.stop();
+    pool.join();
+  }
+
+  void testIdleBuffers()
+  {
+    TEST_HEADER;
+
+    BufferPool serverPool(16 * 1024), clientPool(4 * 1024);
+    EchoServerThread server("4609", true, false, 0, &serverPool);
+    usleep(100000);
+
+    StoreMessage message;
+    SslConnection client("localhost", "4609", &message);
+    TS_ASSERT_EQUALS(client.initClientContext(), true);
+    client.setBufferPool(&clientPool);
+    TS_ASSERT_EQUALS(client.connect(), true);
+
+    TS_ASSERT_EQUALS(echo(client, message, "hello"), std::string("hello"));
+    TS_ASSERT_EQUALS(clientPool.getUsed(), 0u);
+    TS_ASSERT_EQUALS(clientPool.getFree(), 1u);
+
+    // records longer than the buffer are read in several parts, then it goes back
+    const std::string large(100 * 1024, 'x');
+    TS_ASSERT_EQUALS(client.send(large.c_str(), large.length()), true);
+    TS_ASSERT_EQUALS(receive(client, message, large.length()) == large, true);
+    TS_ASSERT_EQUALS(clientPool.getUsed(), 0u);
+
+    // the server's goes back when its read is done
+    for ( int i = 0; i < 100 && serverPool.getUsed() != 0; ++i )
+      usleep(10000);
+    TS_ASSERT_EQUALS(serverPool.getUsed(), 0u);
+    TS_ASSERT_EQUALS(serverPool.getFree(), 1u);
+
+    client.disconnect();
+  }
+
+  void testIdleConnectionMemory()
+  {
+    TEST_HEADER;
+
+    const std::string prefix = "/tmp/test_SslConnection_idle_" + TToStr(getpid());
+    writeNewCertificate(prefix + "_cert.pem", prefix + "_key.pem");
+
+    BufferPool pool(16 * 1024);
+    StoreMessage message;
+    SslConnection listener("localhost", "4611", &message);
+    TS_ASSERT_EQUALS(listener.initServerContext(prefix + "_cert.pem", prefix + "_key.pem"), true);
+    unlink((prefix + "_cert.pem").c_str());
+    unlink((prefix + "_key.pem").c_str());
+    listener.setSocketOptions(SocketOptions().set(SocketOptions::ReuseAddress, 1));
+    listener.setNonBlocking(true);
+    listener.setBufferPool(&pool);
+    TS_ASSERT_EQUALS(listener.bind(), true);
+    TS_ASSERT_EQUALS(listener.listen(), true);
+
+    // the clients in another process, only the accepted side is counted;
+    // a byte on ready for each handshake done, done closed to let them go
+    const int connections = 100;
+    int ready[2], done[2];
+    TS_ASSERT_EQUALS(pipe(ready), 0);
+    TS_ASSERT_EQUALS(pipe(done), 0);
+    const pid_t child = fork();
+    if ( child == 0 ) {
+      close(done[1]);
+      StoreMessage clientMessage;
+      std::vector<SslConnection*> clients;
+      for ( int i = 0; i < connections; ++i ) {
+        SslConnection *client = new SslConnection("localhost", "4611", &clientMessage);
+        if ( !client->initClientContext() || !client->connect() )
+          _exit(1);
+        clients.push_back(client);
+        if ( write(ready[1], "x", 1) != 1 )
+          _exit(1);
+      }
+      char byte;
+      while ( read(done[0], &byte, 1) > 0 )
+        ;
+      _exit(0);
+    }
+    close(ready[1]);
+    close(done[0]);
+
+    std::vector<Connection*> accepted;
+    accepted.reserve(connections);
+    const size_t before = mallinfo2().uordblks;
+
+    for ( int i = 0; i < connections; ++i ) {
+      int socket;
+      if ( !listener.accept(socket) )
+        break;
+      Connection *connection = listener.clone(socket);
+      accepted.push_back(connection);
+
+      // the handshake goes on as the client's flights come in
+      bool handshaken(false);
+      while ( !handshaken ) {
+        pollfd fds[2] = { { socket, POLLIN, 0 }, { ready[0], POLLIN, 0 } };
+        if ( poll(fds, 2, 1000) <= 0 )
+          break;
+        if ( fds[0].revents != 0 && !connection->receive() )
+          break;
+        char byte;
+        handshaken = fds[1].revents != 0 && read(ready[0], &byte, 1) == 1;
+      }
+      if ( !handshaken )
+        break;
+    }
+
+    const size_t after = mallinfo2().uordblks;
+    TS_ASSERT_EQUALS(accepted.size(), (size_t)connections);
+    TS_ASSERT_EQUALS(pool.getUsed(), 0u);
+
+    // about 14 KB, mostly OpenSSL's handle and session; with the record
+    // and read buffers kept it would be over 45 KB
+    const size_t perConnection = (after - before) / connections;
+    TS_TRACE(("Heap per idle accepted connection: " +
+              TToStr(perConnection) + " bytes").c_str());
+    TS_ASSERT_LESS_THAN(perConnection, (size_t)20 * 1024);
+
+    close(done[1]);
+    int status;
+    waitpid(child, &status, 0);
+    close(ready[0]);
+    for ( size_t i = 0; i < accepted.size(); ++i )
+      delete accepted[i];
+  }
+
+};
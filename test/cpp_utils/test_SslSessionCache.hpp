@@ -0,0 +1,169 @@
+#include <cxxtest/TestSuite.h>
+
+#include "Fixture.hpp"
+
+#include <cpp_utils/SslSessionCache.hpp>
+
+#include <openssl/ssl.h>
+#include <openssl/evp.h>
+#include <openssl/x509.h>
+
+class TestSslSessionCache : public CxxTest::TestSuite
+{
+private:
+
+  // self-signed, generated so the test needs no files
+  static bool useNewCertificate( SSL_CTX *context )
+  {
+    EVP_PKEY *key(0);
+    EVP_PKEY_CTX *keyContext = EVP_PKEY_CTX_new_id(EVP_PKEY_RSA, 0);
+    if ( keyContext == 0 || EVP_PKEY_keygen_init(keyContext) != 1 ||
+         EVP_PKEY_CTX_set_rsa_keygen_bits(keyContext, 2048) != 1 ||
+         EVP_PKEY_keygen(keyContext, &key) != 1 ) {
+      EVP_PKEY_CTX_free(keyContext);
+      return false;
+    }
+    EVP_PKEY_CTX_free(keyContext);
+
+    X509 *cert = X509_new();
+    ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+    X509_gmtime_adj(X509_get_notBefore(cert), 0);
+    X509_gmtime_adj(X509_get_notAfter(cert), 3600);
+    X509_set_pubkey(cert, key);
+    X509_NAME *name = X509_get_subject_name(cert);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC,
+                               (const unsigned char*)"localhost", -1, -1, 0);
+    X509_set_issuer_name(cert, name);
+    X509_sign(cert, key, EVP_sha256());
+
+    const bool ok = SSL_CTX_use_certificate(context, cert) == 1 &&
+                    SSL_CTX_use_PrivateKey(context, key) == 1;
+    X509_free(cert);
+    EVP_PKEY_free(key);
+    return ok;
+  }
+
+  // handshakes over a BIO pair, returns the client session
+  static SSL_SESSION* handshake( SSL_CTX *serverContext, SSL_CTX *clientContext,
+                                 SSL_SESSION *resume, bool &reused )
+  {
+    SSL *server = SSL_new(serverContext);
+    SSL *client = SSL_new(clientContext);
+    BIO *serverBio, *clientBio;
+    BIO_new_bio_pair(&serverBio, 0, &clientBio, 0);
+    SSL_set_bio(server, serverBio, serverBio);
+    SSL_set_bio(client, clientBio, clientBio);
+    SSL_set_accept_state(server);
+    SSL_set_connect_state(client);
+    if ( resume != 0 )
+      SSL_set_session(client, resume);
+
+    bool serverDone(false), clientDone(false);
+    for ( int i = 0; i < 100 && !(serverDone && clientDone); ++i ) {
+      clientDone = SSL_do_handshake(client) == 1;
+      serverDone = SSL_do_handshake(server) == 1;
+    }
+
+    // TLS 1.3 tickets arrive after the handshake
+    char buffer[16];
+    SSL_write(server, "x", 1);
+    SSL_read(client, buffer, sizeof(buffer));
+
+    reused = SSL_session_reused(client) == 1;
+    SSL_SESSION *session = serverDone && clientDone ? SSL_get1_session(client) : 0;
+
+    // without a clean shutdown the session is dropped
+    SSL_shutdown(client);
+    SSL_shutdown(server);
+    SSL_free(client);
+    SSL_free(server);
+    return session;
+  }
+
+  static SSL_CTX* newServerContext( SslSessionCache &cache, const bool tickets )
+  {
+    SSL_CTX *context = SSL_CTX_new(SSLv23_server_method());
+    if ( !tickets )
+      SSL_CTX_set_options(context, SSL_OP_NO_TICKET);
+    if ( !useNewCertificate(context) || !cache.attach(context) ) {
+      SSL_CTX_free(context);
+      return 0;
+    }
+    return context;
+  }
+
+public:
+
+  void testResumeOnOtherContext()
+  {
+    TEST_HEADER;
+
+    // session ids, stored in the cache
+    SslSessionCache cache(16, 60);
+    SSL_CTX *server1 = newServerContext(cache, false);
+    SSL_CTX *server2 = newServerContext(cache, false);
+    SSL_CTX *client = SSL_CTX_new(SSLv23_client_method());
+    SSL_CTX_set_max_proto_version(client, TLS1_2_VERSION);
+    TS_ASSERT_EQUALS(server1 == 0 || server2 == 0, false);
+
+    bool reused(true);
+    SSL_SESSION *session = handshake(server1, client, 0, reused);
+    TS_ASSERT_EQUALS(session == 0, false);
+    TS_ASSERT_EQUALS(reused, false);
+    TS_ASSERT_EQUALS(cache.size(), 1u);
+
+    // another listener, same cache
+    SSL_SESSION *resumed = handshake(server2, client, session, reused);
+    TS_ASSERT_EQUALS(reused, true);
+    TS_ASSERT_EQUALS(cache.getHits(), 1u);
+
+    cache.clear();
+    SSL_SESSION_free(resumed);
+    resumed = handshake(server2, client, session, reused);
+    TS_ASSERT_EQUALS(reused, false);
+    TS_ASSERT_EQUALS(cache.getMisses(), 1u);
+
+    SSL_SESSION_free(resumed);
+    SSL_SESSION_free(session);
+    SSL_CTX_free(client);
+    SSL_CTX_free(server2);
+    SSL_CTX_free(server1);
+  }
+
+  void testTicketKeyRotation()
+  {
+    TEST_HEADER;
+
+    SslSessionCache cache;
+    SSL_CTX *server = newServerContext(cache, true);
+    SSL_CTX *client = SSL_CTX_new(SSLv23_client_method());
+    TS_ASSERT_EQUALS(server == 0, false);
+
+    bool reused(true);
+    SSL_SESSION *session = handshake(server, client, 0, reused);
+    TS_ASSERT_EQUALS(session == 0, false);
+    TS_ASSERT_EQUALS(reused, false);
+
+    SSL_SESSION *resumed = handshake(server, client, session, reused);
+    TS_ASSERT_EQUALS(reused, true);
+    SSL_SESSION_free(resumed);
+
+    // previous keys still decrypt
+    TS_ASSERT_EQUALS(cache.rotateTicketKeys(), true);
+    resumed = handshake(server, client, session, reused);
+    TS_ASSERT_EQUALS(reused, true);
+    SSL_SESSION_free(resumed);
+
+    // too old
+    TS_ASSERT_EQUALS(cache.rotateTicketKeys(), true);
+    TS_ASSERT_EQUALS(cache.rotateTicketKeys(), true);
+    resumed = handshake(server, client, session, reused);
+    TS_ASSERT_EQUALS(reused, false);
+
+    SSL_SESSION_free(resumed);
+    SSL_SESSION_free(session);
+    SSL_CTX_free(client);
+    SSL_CTX_free(server);
+  }
+
+};
@@ -0,0 +1,153 @@
+#include <cxxtest/TestSuite.h>
+
+#include <cpp_utils/TaskGroup.hpp>
+#include <cpp_utils/ThreadPool.hpp>
+#include <cpp_utils/WorkerThread.hpp>
+#include <cpp_utils/Common.hpp>
+
+#include "Fixture.hpp"
+
+#include <atomic>
+
+class TestTaskGroup : public CxxTest::TestSuite
+{
+
+private:
+
+  class CountingTask : public Task
+  {
+  public:
+
+    CountingTask( std::atomic<int> &counter ) : m_counter(counter) {}
+    void run() { m_counter++; }
+
+  private:
+
+    CountingTask(const CountingTask&);
+    CountingTask& operator=(const CountingTask&);
+
+    std::atomic<int> &m_counter;
+  };
+
+  class DeletedTask : public Task
+  {
+  public:
+
+    DeletedTask( std::atomic<int> &ran, std::atomic<int> &deleted )
+      : m_ran(ran), m_deleted(deleted) {}
+    ~DeletedTask() { m_deleted++; }
+    void run() { m_ran++; }
+
+  private:
+
+    DeletedTask(const DeletedTask&);
+    DeletedTask& operator=(const DeletedTask&);
+
+    std::atomic<int> &m_ran;
+    std::atomic<int> &m_deleted;
+  };
+
+  // forks a group for the two halves and waits for them, on the pool
+  class SumTask : public Task
+  {
+  public:
+
+    SumTask( ThreadPool &pool, const int from, const int to, std::atomic<long> &sum )
+      : m_pool(pool), m_from(from), m_to(to), m_sum(sum) {}
+
+    void run()
+    {
+      if ( m_to - m_from <= 16 ) {
+        long sum(0);
+        for ( int i = m_from; i < m_to; ++i )
+          sum += i;
+        m_sum += sum;
+        return;
+      }
+
+      const int middle = m_from + (m_to - m_from) / 2;
+      TaskGroup group(m_pool);
+      group.run(new SumTask(m_pool, m_from, middle, m_sum));
+      group.run(new SumTask(m_pool, middle, m_to, m_sum));
+      group.wait();
+    }
+
+  private:
+
+    SumTask(const SumTask&);
+    SumTask& operator=(const SumTask&);
+
+    ThreadPool &m_pool;
+    const int m_from;
+    const int m_to;
+    std::atomic<long> &m_sum;
+  };
+
+public:
+
+  void testWaitRunsTasks( void )
+  {
+    TEST_HEADER;
+
+    // no worker, the waiting thread runs them all
+    ThreadPool pool;
+    std::atomic<int> counter(0);
+    TaskGroup group(pool);
+    for ( int i = 0; i < 100; ++i )
+      group.run(new CountingTask(counter));
+    TS_ASSERT_EQUALS( group.getPending(), 100 );
+
+    group.wait();
+    TS_ASSERT_EQUALS( counter.load(), 100 );
+    TS_ASSERT_EQUALS( group.getPending(), 0 );
+  }
+
+  void testStoppedPool( void )
+  {
+    TEST_HEADER;
+
+    // nobody runs the queued ones, waiting must not hang
+    ThreadPool pool;
+    std::atomic<int> ran(0);
+    std::atomic<int> deleted(0);
+    {
+      TaskGroup group(pool);
+      group.run(new DeletedTask(ran, deleted));
+      group.run(new DeletedTask(ran, deleted));
+      TS_ASSERT_EQUALS( group.getPending(), 2 );
+
+      pool.stop();
+      group.wait();
+      TS_ASSERT_EQUALS( group.getPending(), 0 );
+      TS_ASSERT_EQUALS( ran.load(), 0 );
+      TS_ASSERT_EQUALS( deleted.load(), 2 );
+
+      TS_ASSERT_THROWS( group.run(new DeletedTask(ran, deleted)), CancelledException );
+      TS_ASSERT_EQUALS( deleted.load(), 3 );
+      TS_ASSERT_EQUALS( group.getPending(), 0 );
+    }
+  }
+
+  void testNestedOnSmallPool( void )
+  {
+    TEST_HEADER;
+
+    // nested waits would use up both workers without helping
+    ThreadPool pool;
+    pool.pushWorkerThread(new WorkerThread(pool));
+    pool.pushWorkerThread(new WorkerThread(pool));
+    pool.startWorkerThreads();
+
+    std::atomic<long> sum(0);
+    {
+      TaskGroup group(pool);
+      group.run(new SumTask(pool, 0, 10000, sum));
+      group.wait();
+    }
+    TS_ASSERT_EQUALS( sum.load(), 10000L * 9999 / 2 );
+
+    pool.stop();
+    pool.join();
+  }
+
+};
@@ -9,6 +9,9 @@
 
 #include <stdlib.h> // malloc
 #include <signal.h> // SIGINT
+#include <sched.h> // sched_getcpu
+#include <string>
+#include <vector>
 
 
 class TestThread : public CxxTest::TestSuite
@@ -183,4 +186,90 @@ public:
     et.join();
   }
 
+private:
+
+  // what the started thread sees of its attributes
+  class AttributesThread : public Thread
+  {
+  public:
+
+    AttributesThread() : m_cpuCount(0), m_cpu(-1), m_stackSize(0), m_name() {}
+
+    int m_cpuCount;
+    int m_cpu;
+    size_t m_stackSize;
+    std::string m_name;
+
+  private:
+
+    void* run( void )
+    {
+      TRACE;
+
+      cpu_set_t cpuSet;
+      pthread_getaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);
+      m_cpuCount = CPU_COUNT(&cpuSet);
+      m_cpu = sched_getcpu();
+
+      pthread_attr_t attr;
+      pthread_getattr_np(pthread_self(), &attr);
+      pthread_attr_getstacksize(&attr, &m_stackSize);
+      pthread_attr_destroy(&attr);
+
+      char name[16];
+      pthread_getname_np(pthread_self(), name, sizeof(name));
+      m_name = name;
+      return 0;
+    }
+  };
+
+public:
+
+  void testAttributes()
+  {
+    TEST_HEADER;
+
+    AttributesThread t;
+    t.setCpus(std::vector<int>(1, 0));
+    t.setStackSize(1024 * 1024);
+    t.setName("attributes-thread");
+    TS_ASSERT_EQUALS( t.start(), true );
+    t.join();
+
+    TS_ASSERT_EQUALS( t.m_cpuCount, 1 );
+    TS_ASSERT_EQUALS( t.m_cpu, 0 );
+    TS_ASSERT_EQUALS( t.m_stackSize, 1024u * 1024 );
+    TS_ASSERT_EQUALS( t.m_name, "attributes-thre" );
+  }
+
+  void testNumaNode()
+  {
+    TEST_HEADER;
+
+    // every CPU is on node 0 without NUMA
+    AttributesThread t;
+    TS_ASSERT_EQUALS( t.setNumaNode(0), true );
+    TS_ASSERT_EQUALS( t.getCpus().empty(), false );
+
+    const std::vector<int> cpus = t.getCpus();
+    TS_ASSERT_EQUALS( t.setNumaNode(4096), false );
+    TS_ASSERT_EQUALS( t.getCpus() == cpus, true );
+  }
+
+  void testRefusedScheduling()
+  {
+    TEST_HEADER;
+
+    // SCHED_FIFO needs CAP_SYS_NICE, either way start() tells
+    AttributesThread t;
+    t.setScheduling(SCHED_FIFO, 1);
+    if ( t.start() ) {
+      t.join();
+      TS_ASSERT_EQUALS( t.m_cpuCount > 0, true );
+    } else {
+      TS_ASSERT_EQUALS( t.isRunning(), false );
+      TS_ASSERT_EQUALS( t.join(), (void*)0 );
+    }
+  }
+
 };
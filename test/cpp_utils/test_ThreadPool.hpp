@@ -8,6 +8,10 @@
 
 #include "Fixture.hpp"
 
+#include <atomic>
+#include <algorithm> // max
+#include <sched.h> // CPU_COUNT
+
 
 
 class TestThreadPoolSuite : public CxxTest::TestSuite
@@ -58,4 +62,184 @@ public:
     tp->join();
     delete tp;
   }
+
+private:
+
+  class AffinityTask : public Task
+  {
+  public:
+
+    AffinityTask( std::atomic<int> &pinned, std::atomic<int> &done )
+      : m_pinned(pinned), m_done(done) {}
+
+    void run()
+    {
+      cpu_set_t cpuSet;
+      pthread_getaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);
+      if ( CPU_COUNT(&cpuSet) == 1 )
+        m_pinned++;
+      m_done++;
+    }
+
+  private:
+
+    AffinityTask(const AffinityTask&);
+    AffinityTask& operator=(const AffinityTask&);
+
+    std::atomic<int> &m_pinned;
+    std::atomic<int> &m_done;
+  };
+
+public:
+
+  void testPlacement()
+  {
+    TEST_HEADER;
+    ThreadPool tp;
+    tp.pushWorkerThread(new WorkerThread(tp));
+    tp.pushWorkerThread(new WorkerThread(tp));
+    tp.setPlacement(ThreadPool::Compact);
+    tp.startWorkerThreads();
+
+    std::atomic<int> pinned(0), done(0);
+    for ( int i = 0; i < 10; ++i )
+      tp.pushTask(new AffinityTask(pinned, done));
+    while ( done.load() < 10 )
+      usleep(1000);
+    TS_ASSERT_EQUALS( pinned.load(), 10 );
+
+    tp.stop();
+    tp.join();
+  }
+
+  void testWorkerNotStarted()
+  {
+    TEST_HEADER;
+    ThreadPool tp;
+    tp.pushWorkerThread(new WorkerThread(tp));
+
+    // pinned outside of the affinity mask
+    cpu_set_t allowed;
+    sched_getaffinity(0, sizeof(allowed), &allowed);
+    int outside = 0;
+    while ( outside < CPU_SETSIZE - 1 && CPU_ISSET(outside, &allowed) )
+      ++outside;
+    Thread* refused = new WorkerThread(tp);
+    refused->setCpus(std::vector<int>(1, outside));
+    tp.pushWorkerThread(refused);
+
+    TS_ASSERT_EQUALS( tp.startWorkerThreads(), false );
+    TS_ASSERT_EQUALS( tp.getWorkerCount(), 1u );
+
+    std::atomic<int> pinned(0), done(0);
+    tp.pushTask(new AffinityTask(pinned, done));
+    while ( done.load() < 1 )
+      usleep(1000);
+
+    tp.stop();
+    tp.join();
+  }
+
+private:
+
+  class SleepTask : public Task
+  {
+  public:
+
+    SleepTask( std::atomic<int> &done ) : m_done(done) {}
+    void run() { usleep(50 * 1000); m_done++; }
+
+  private:
+
+    SleepTask(const SleepTask&);
+    SleepTask& operator=(const SleepTask&);
+
+    std::atomic<int> &m_done;
+  };
+
+  // blocks until released, telling the pool
+  class BlockingTask : public Task
+  {
+  public:
+
+    BlockingTask( std::atomic<bool> &release, std::atomic<int> &done )
+      : m_release(release), m_done(done) {}
+
+    void run()
+    {
+      ScopedBlocking sb;
+      while ( !m_release.load() )
+        usleep(1000);
+      m_done++;
+    }
+
+  private:
+
+    BlockingTask(const BlockingTask&);
+    BlockingTask& operator=(const BlockingTask&);
+
+    std::atomic<bool> &m_release;
+    std::atomic<int> &m_done;
+  };
+
+public:
+
+  void testElastic()
+  {
+    TEST_HEADER;
+    ThreadPool tp;
+    tp.setElastic(1, 4, 10, 200);
+    tp.startWorkerThreads();
+    TS_ASSERT_EQUALS( tp.getWorkerCount(), 1u );
+
+    std::atomic<int> done(0);
+    for ( int i = 0; i < 16; ++i )
+      tp.pushTask(new SleepTask(done));
+
+    size_t most(0);
+    while ( done.load() < 16 ) {
+      most = std::max(most, tp.getWorkerCount());
+      usleep(1000);
+    }
+    TS_ASSERT( most > 1 );
+    TS_ASSERT( most <= 4 );
+
+    // the extra ones leave after being idle
+    for ( int i = 0; i < 200 && tp.getWorkerCount() > 1; ++i )
+      usleep(10 * 1000);
+    TS_ASSERT_EQUALS( tp.getWorkerCount(), 1u );
+
+    tp.stop();
+    tp.join();
+  }
+
+  void testScopedBlocking()
+  {
+    TEST_HEADER;
+    ThreadPool tp;
+    tp.setElastic(1, 1, 10 * 1000, 200);
+    tp.startWorkerThreads();
+
+    std::atomic<bool> release(false);
+    std::atomic<int> blockedDone(0), done(0);
+    tp.pushTask(new BlockingTask(release, blockedDone));
+    usleep(50 * 1000);
+
+    // the only worker blocks, a compensating one runs this
+    tp.pushTask(new SleepTask(done));
+    for ( int i = 0; i < 200 && done.load() == 0; ++i )
+      usleep(10 * 1000);
+    TS_ASSERT_EQUALS( done.load(), 1 );
+    TS_ASSERT_EQUALS( blockedDone.load(), 0 );
+    TS_ASSERT_EQUALS( tp.getWorkerCount(), 2u );
+
+    release = true;
+    for ( int i = 0; i < 200 && tp.getWorkerCount() > 1; ++i )
+      usleep(10 * 1000);
+    TS_ASSERT_EQUALS( blockedDone.load(), 1 );
+    TS_ASSERT_EQUALS( tp.getWorkerCount(), 1u );
+
+    tp.stop();
+    tp.join();
+  }
 };
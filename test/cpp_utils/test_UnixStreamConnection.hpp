@@ -0,0 +1,182 @@
+#include <cxxtest/TestSuite.h>
+
+#include "Fixture.hpp"
+
+#include <cpp_utils/UnixStreamConnection.hpp>
+#include <cpp_utils/SocketClient.hpp>
+
+#include <unistd.h> // pipe, unlink, access
+
+class TestUnixStreamConnection : public CxxTest::TestSuite
+{
+private:
+
+  class StoreMessage : public Message
+  {
+  public:
+
+    StoreMessage( void *msgParam = 0 )
+      : Message(msgParam)
+    {
+      TRACE;
+    }
+
+    bool buildMessage( const void *msgPart, const size_t msgLen )
+    {
+      TRACE;
+      m_buffer.append( (const char*)msgPart, msgLen );
+      onMessageReady();
+      return true;
+    }
+
+    void onMessageReady()
+    {
+      TRACE;
+      if ( m_param )
+        *( static_cast<bool*>(m_param) ) = true;
+    }
+
+    Message* clone()
+    {
+      TRACE;
+      return new StoreMessage(m_param);
+    }
+
+    std::string getBuffer() const
+    {
+      TRACE;
+      return m_buffer;
+    }
+
+  protected:
+
+    size_t getExpectedLength() { return 0; }
+
+  }; // StoreMessage
+
+
+public:
+
+  void testBindToPath()
+  {
+    TEST_HEADER;
+
+    const std::string path("/tmp/test_cpp_utils_unix.sock");
+    unlink(path.c_str());
+
+    StoreMessage message;
+    UnixStreamConnection server(path, &message);
+
+    TS_ASSERT_EQUALS(server.isAbstract(), false);
+    TS_ASSERT_EQUALS(server.bind(), true);
+    TS_ASSERT_EQUALS(access(path.c_str(), F_OK), 0);
+    TS_ASSERT_EQUALS(server.listen(), true);
+    TS_ASSERT_EQUALS(server.closed(), false);
+
+    TS_ASSERT_EQUALS(server.disconnect(), true);
+    TS_ASSERT_DIFFERS(access(path.c_str(), F_OK), 0);
+  }
+
+  void testAbstractNamespace()
+  {
+    TEST_HEADER;
+
+    StoreMessage message;
+    UnixStreamConnection server("@test_cpp_utils_abstract", &message);
+    UnixStreamConnection server2("@test_cpp_utils_abstract", &message);
+
+    TS_ASSERT_EQUALS(server.isAbstract(), true);
+    TS_ASSERT_EQUALS(server.bind(), true);
+    TS_ASSERT_EQUALS(server2.bind(), false);
+    TS_ASSERT_EQUALS(server.listen(), true);
+    TS_ASSERT_EQUALS(server.disconnect(), true);
+  }
+
+  void testCommunicationWithFdPassing()
+  {
+    TEST_HEADER;
+
+    StoreMessage serverMessage;
+    StoreMessage clientMessage;
+    UnixStreamConnection server("@test_cpp_utils_fdpass", &serverMessage);
+    UnixStreamConnection client("@test_cpp_utils_fdpass", &clientMessage);
+
+    TS_ASSERT_EQUALS(server.bind(), true);
+    TS_ASSERT_EQUALS(server.listen(), true);
+    TS_ASSERT_EQUALS(client.connect(), true);
+
+    int clientSocket;
+    TS_ASSERT_EQUALS(server.accept(clientSocket), true);
+    UnixStreamConnection *peer = dynamic_cast<UnixStreamConnection*>(
+                                   server.clone(clientSocket));
+    TS_ASSERT_EQUALS(peer->getHost(), std::string("@test_cpp_utils_fdpass"));
+
+    std::string msg("hello");
+    TS_ASSERT_EQUALS(client.send(msg.c_str(), msg.length()), true);
+    TS_ASSERT_EQUALS(peer->receive(), true);
+    TS_ASSERT_EQUALS(
+      dynamic_cast<StoreMessage*>(peer->getMessage())->getBuffer(), msg);
+
+    // pass the read end of a pipe, then read through the received copy
+    int pipeFds[2];
+    TS_ASSERT_EQUALS(pipe(pipeFds), 0);
+    TS_ASSERT_EQUALS(client.sendFd(pipeFds[0], "x", 1), true);
+    TS_ASSERT_EQUALS(client.sendFd(pipeFds[0], "", 0), false);
+    TS_ASSERT_EQUALS(peer->receive(), true);
+
+    int receivedFd(-1);
+    TS_ASSERT_EQUALS(peer->popReceivedFd(receivedFd), true);
+    TS_ASSERT_EQUALS(peer->popReceivedFd(receivedFd), false);
+    TS_ASSERT_DIFFERS(receivedFd, pipeFds[0]);
+
+    char c(0);
+    TS_ASSERT_EQUALS(write(pipeFds[1], "z", 1), 1);
+    TS_ASSERT_EQUALS(read(receivedFd, &c, 1), 1);
+    TS_ASSERT_EQUALS(c, 'z');
+
+    close(receivedFd);
+    close(pipeFds[0]);
+    close(pipeFds[1]);
+
+    delete peer->getMessage();
+    delete peer;
+    TS_ASSERT_EQUALS(client.disconnect(), true);
+    TS_ASSERT_EQUALS(server.disconnect(), true);
+  }
+
+  void testWithSocketClient()
+  {
+    TEST_HEADER;
+
+    bool finished = false;
+    StoreMessage serverMessage;
+    StoreMessage clientMessage(&finished);
+    UnixStreamConnection server("@test_cpp_utils_client", &serverMessage);
+    UnixStreamConnection client("@test_cpp_utils_client", &clientMessage);
+
+    TS_ASSERT_EQUALS(server.bind(), true);
+    TS_ASSERT_EQUALS(server.listen(), true);
+
+    SocketClient socketClient(&client);
+    TS_ASSERT_EQUALS(socketClient.connect(), true);
+
+    int clientSocket;
+    TS_ASSERT_EQUALS(server.accept(clientSocket), true);
+    Connection *peer = server.clone(clientSocket);
+
+    std::string msg("pong");
+    TS_ASSERT_EQUALS(peer->send(msg.c_str(), msg.length()), true);
+
+    for ( int i = 0; i < 10 && !finished; ++i )
+      sleep(1);
+
+    TS_ASSERT_EQUALS(finished, true);
+    TS_ASSERT_EQUALS(clientMessage.getBuffer(), msg);
+
+    socketClient.disconnect();
+    delete dynamic_cast<UnixStreamConnection*>(peer)->getMessage();
+    delete peer;
+    TS_ASSERT_EQUALS(server.disconnect(), true);
+  }
+
+};